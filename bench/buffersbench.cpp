@@ -0,0 +1,333 @@
+#include <empoweragentproto/networklib.hh>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace NL = Empower::NetworkLib;
+
+//
+// Accessors, with and without bounds checks
+//
+
+static void BM_GetUint32At(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 4;
+
+    for (auto _ : state) {
+        std::uint32_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += buffer.getUint32At(i * 4);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_GetUint32At);
+
+static void BM_GetUint32At_nocheck(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 4;
+
+    for (auto _ : state) {
+        std::uint32_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += buffer.getUint32At_nocheck(i * 4);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_GetUint32At_nocheck);
+
+static void BM_GetUint16At(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 2;
+
+    for (auto _ : state) {
+        std::uint32_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += buffer.getUint16At(i * 2);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 2);
+}
+BENCHMARK(BM_GetUint16At);
+
+static void BM_GetUint16At_nocheck(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 2;
+
+    for (auto _ : state) {
+        std::uint32_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += buffer.getUint16At_nocheck(i * 2);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 2);
+}
+BENCHMARK(BM_GetUint16At_nocheck);
+
+static void BM_SetUint32At(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 4;
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer.setUint32At(i * 4, static_cast<std::uint32_t>(i));
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_SetUint32At);
+
+static void BM_SetUint32At_nocheck(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 4;
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer.setUint32At_nocheck(i * 4, static_cast<std::uint32_t>(i));
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_SetUint32At_nocheck);
+
+// Decoding a 24-byte header field by field: checking bounds on every
+// field...
+static void BM_HeaderFieldsChecked(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 24;
+
+    for (auto _ : state) {
+        std::uint64_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::size_t offset = i * 24;
+            sum += buffer.getUint8At(offset) + buffer.getUint16At(offset + 2) +
+                   buffer.getUint32At(offset + 4) +
+                   buffer.getUint32At(offset + 8) +
+                   buffer.getUint64At(offset + 12) +
+                   buffer.getUint32At(offset + 20);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_HeaderFieldsChecked);
+
+// ...and once per header.
+static void BM_HeaderFieldsCheckedRegion(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = buffer.size() / 24;
+
+    for (auto _ : state) {
+        std::uint64_t sum = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const NL::CheckedRegion<24> header(buffer, i * 24);
+            sum += header.getUint8At<0>() + header.getUint16At<2>() +
+                   header.getUint32At<4>() + header.getUint32At<8>() +
+                   header.getUint64At<12>() + header.getUint32At<20>();
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_HeaderFieldsCheckedRegion);
+
+//
+// Bulk byte order conversions (e.g. arrays of PRB counters)
+//
+
+static void BM_GetUint32ArrayLoop(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<std::uint32_t> values(count);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = buffer.getUint32At_nocheck(i * 4);
+        }
+
+        benchmark::DoNotOptimize(values.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_GetUint32ArrayLoop)->Arg(100)->Arg(1000)->Arg(16000);
+
+static void BM_GetUint32ArrayAt(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<std::uint32_t> values(count);
+
+    for (auto _ : state) {
+        buffer.getUint32ArrayAt(0, values.data(), count);
+        benchmark::DoNotOptimize(values.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 4);
+}
+BENCHMARK(BM_GetUint32ArrayAt)->Arg(100)->Arg(1000)->Arg(16000);
+
+static void BM_SetUint64ArrayAt(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<std::uint64_t> values(count, 0x0102030405060708ULL);
+
+    for (auto _ : state) {
+        buffer.setUint64ArrayAt(0, values.data(), count);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * count * 8);
+}
+BENCHMARK(BM_SetUint64ArrayAt)->Arg(100)->Arg(1000)->Arg(8000);
+
+//
+// Checksums
+//
+
+static void BM_GetSum16(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    auto view = buffer.getSub(0, static_cast<std::size_t>(state.range(0)));
+
+    for (std::size_t i = 0; i < view.size(); ++i) {
+        view.setUint8At(i, static_cast<std::uint8_t>(i));
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(view.getSum16());
+    }
+
+    state.SetBytesProcessed(state.iterations() * view.size());
+}
+BENCHMARK(BM_GetSum16)->Arg(20)->Arg(64)->Arg(1500)->Arg(65500);
+
+// Re-stamping a 32-bit field of a summed message: updating the
+// checksum...
+static void BM_InternetChecksumReplace(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    auto view = buffer.getSub(0, static_cast<std::size_t>(state.range(0)));
+    NL::InternetChecksum checksum(view);
+    std::uint32_t value = 0;
+
+    for (auto _ : state) {
+        view.setUint32At(8, value + 1);
+        checksum.replaceUint32(8, value, value + 1);
+        ++value;
+        benchmark::DoNotOptimize(checksum.checksum());
+    }
+}
+BENCHMARK(BM_InternetChecksumReplace)->Arg(1500)->Arg(65500);
+
+// ...and by summing it again.
+static void BM_InternetChecksumRescan(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    auto view = buffer.getSub(0, static_cast<std::size_t>(state.range(0)));
+    std::uint32_t value = 0;
+
+    for (auto _ : state) {
+        view.setUint32At(8, ++value);
+        benchmark::DoNotOptimize(NL::InternetChecksum(view).checksum());
+    }
+}
+BENCHMARK(BM_InternetChecksumRescan)->Arg(1500)->Arg(65500);
+
+//
+// Views and pools
+//
+
+static void BM_GetSub(benchmark::State &state) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+
+    for (auto _ : state) {
+        auto sub = buffer.getSub(4, 16);
+        benchmark::DoNotOptimize(sub);
+    }
+}
+BENCHMARK(BM_GetSub);
+
+static void BM_PacketBufferSizedPool(benchmark::State &state) {
+    NL::PacketBufferPool pool;
+
+    for (auto _ : state) {
+        auto buffer = pool.getBufferWritableView();
+        benchmark::DoNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_PacketBufferSizedPool);
+
+static void BM_ConcurrentPacketBufferSizedPool(benchmark::State &state) {
+    static NL::ConcurrentPacketBufferPool pool;
+
+    for (auto _ : state) {
+        auto buffer = pool.getBufferWritableView();
+        benchmark::DoNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_ConcurrentPacketBufferSizedPool)->ThreadRange(1, 4);
+
+static void BM_PacketBufferArena(benchmark::State &state) {
+    static NL::PacketBufferArena arena;
+    const std::size_t size = static_cast<std::size_t>(state.range(0));
+
+    for (auto _ : state) {
+        auto buffer = arena.getBufferWritableView(size);
+        benchmark::DoNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_PacketBufferArena)->Arg(64)->Arg(4096)->Arg(65500);
+
+static void BM_MakeEthBuffer(benchmark::State &state) {
+    for (auto _ : state) {
+        auto buffer = NL::BufferWritableView::makeEthBuffer();
+        benchmark::DoNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_MakeEthBuffer);
+
+static void BM_SPSCRingPushPop(benchmark::State &state) {
+    NL::SPSCRing<NL::BufferView> ring(1024);
+    NL::BufferView buffer = NL::BufferWritableView::makeEthBuffer();
+    NL::BufferView out;
+
+    for (auto _ : state) {
+        ring.tryPush(buffer);
+        ring.tryPop(out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_SPSCRingPushPop);
+
+static void BM_MetricsCounter(benchmark::State &state) {
+    for (auto _ : state) {
+        NL::Metrics::add(NL::Counter::BYTES_READ, 64);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_MetricsCounter)->ThreadRange(1, 4);
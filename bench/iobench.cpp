@@ -0,0 +1,369 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+// A pair of IO objects connected via the loopback interface (or via
+// a Unix-domain socket).
+struct Loopback {
+    AGT::IO server;
+    AGT::IO client;
+
+    explicit Loopback(bool nonBlocking,
+                      AGT::IO::Transport transport =
+                          AGT::IO::Transport::READINESS,
+                      bool unixDomain = false) {
+        // Use a different port each time, so we don't have to care
+        // about connections of previous runs still in TIME_WAIT.
+        static std::uint16_t nextPort = 0;
+        const std::uint16_t port = 22100 + (nextPort++ % 1000);
+
+        server.port(port).nonBlocking(nonBlocking).transport(transport);
+        client.port(port).nonBlocking(nonBlocking).transport(transport);
+
+        if (unixDomain) {
+            const std::string path =
+                "/tmp/agentbench-" + std::to_string(port) + ".sock";
+            server.unixPath(path);
+            client.unixPath(path);
+        }
+
+        server.openListeningSocket();
+
+        // The connection completes in the listen backlog, so we can
+        // accept it afterwards.
+        while (!client.openSocket()) {
+        }
+
+        server.acceptConnectionIfNeeded();
+    }
+};
+
+// Encode a small ECHO request
+static NL::BufferView makeEchoRequest(std::uint32_t sequence) {
+    auto buffer = AGT::IO::makeMessageBuffer(256);
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE)
+        .sequence(sequence);
+
+    auto tlv = AGT::TLVBinaryData().stringData("ping");
+    encoder.add(tlv).end();
+    return encoder.data();
+}
+
+// Round trip latency of a small message (client -> server -> client),
+// with blocking sockets.
+static void BM_IOLoopbackLatency(benchmark::State &state) {
+    Loopback loopback(false);
+    auto request = makeEchoRequest(0);
+    auto serverBuffer = AGT::IO::makeMessageBuffer();
+    auto clientBuffer = AGT::IO::makeMessageBuffer();
+
+    std::vector<double> latencies;
+
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+
+        loopback.client.writeMessage(request);
+        auto received = loopback.server.readMessage(serverBuffer);
+        loopback.server.writeMessage(received);
+        auto reply = loopback.client.readMessage(clientBuffer);
+
+        const auto end = std::chrono::steady_clock::now();
+
+        benchmark::DoNotOptimize(reply);
+        latencies.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    if (!latencies.empty()) {
+        state.counters["p50_us"] = latencies[latencies.size() / 2];
+        state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];
+    }
+
+    state.counters["msgs_per_s"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_IOLoopbackLatency)->UseRealTime();
+
+// The transport selected by a benchmark argument (1 for io_uring).
+static AGT::IO::Transport transportArg(benchmark::State &state,
+                                       std::size_t arg) {
+    if (state.range(arg) == 0) {
+        return AGT::IO::Transport::READINESS;
+    }
+
+    if (!AGT::Uring::available()) {
+        state.SkipWithError("io_uring not available");
+    }
+
+    return AGT::IO::Transport::IO_URING;
+}
+
+// Round trip latency of a small message (client -> server -> client),
+// with the event-driven interface, both IO objects being run by the
+// same thread. range(0) selects the transport (1 for io_uring), and
+// range(1) the socket (1 for Unix-domain, 0 for TCP).
+static void BM_IOEventLatency(benchmark::State &state) {
+    Loopback loopback(true, transportArg(state, 0), state.range(1) != 0);
+    auto request = makeEchoRequest(0);
+
+    loopback.server.onMessage(
+        [&loopback](AGT::IO::ConnectionHandle connection,
+                    NL::BufferView message) {
+            loopback.server.sendMessage(connection, message);
+        });
+
+    std::int64_t replies = 0;
+    loopback.client.onMessage(
+        [&replies](AGT::IO::ConnectionHandle, NL::BufferView) { ++replies; });
+
+    for (auto _ : state) {
+        const std::int64_t wanted = replies + 1;
+        loopback.client.sendMessage(request);
+
+        while (replies < wanted) {
+            loopback.client.processEvents(0);
+            loopback.server.processEvents(0);
+        }
+    }
+
+    state.counters["msgs_per_s"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_IOEventLatency)
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->UseRealTime();
+
+// One-way throughput of small messages through a SharedMemoryRing,
+// encoded right into the ring by another thread, and decoded in
+// place.
+static void BM_SharedMemoryRingThroughput(benchmark::State &state) {
+    AGT::SharedMemoryRing ring;
+    std::atomic<bool> stop(false);
+
+    std::thread producer([&ring, &stop]() {
+        std::uint32_t sequence = 0;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto space = ring.reserve(256);
+
+            if (space.empty()) {
+                ring.waitForSpace(256, 10);
+                continue;
+            }
+
+            AGT::MessageEncoder encoder(space);
+            encoder.header()
+                .messageClass(AGT::MessageClass::REQUEST_GET)
+                .entityClass(AGT::EntityClass::ECHO_SERVICE)
+                .sequence(sequence++);
+
+            auto tlv = AGT::TLVBinaryData().stringData("ping");
+            encoder.add(tlv).end();
+            ring.commit(encoder.data().size());
+        }
+    });
+
+    for (auto _ : state) {
+        while (!ring.waitForData(10)) {
+        }
+
+        AGT::MessageDecoder decoder(ring.front());
+        benchmark::DoNotOptimize(decoder.header().sequence());
+        ring.pop();
+    }
+
+    stop = true;
+    producer.join();
+
+    state.counters["msgs_per_s"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SharedMemoryRingThroughput)->UseRealTime();
+
+// One-way throughput of small messages, with non-blocking sockets and
+// the event-driven interface. With range(0) == 1 messages are
+// coalesced via IO::queueMessage(), otherwise they are sent one by one
+// via IO::sendMessage(). range(1) selects the transport (1 for
+// io_uring).
+static void BM_IOLoopbackThroughput(benchmark::State &state) {
+    Loopback loopback(true, transportArg(state, 1));
+    auto request = makeEchoRequest(0);
+    const bool coalesce = state.range(0) == 1;
+
+    std::int64_t received = 0;
+    loopback.server.onMessage(
+        [&received](AGT::IO::ConnectionHandle, NL::BufferView) {
+            ++received;
+        });
+
+    std::int64_t sent = 0;
+
+    for (auto _ : state) {
+        if (coalesce) {
+            loopback.client.queueMessage(request);
+        } else {
+            loopback.client.sendMessage(request);
+        }
+
+        if (++sent % 64 == 0) {
+            loopback.client.processEvents(0);
+            loopback.server.processEvents(0);
+        }
+    }
+
+    // Wait for everything to get to the other side
+    loopback.client.flush();
+
+    while (received < sent) {
+        loopback.client.processEvents(0);
+        loopback.server.processEvents(10);
+    }
+
+    state.SetItemsProcessed(received);
+    state.counters["msgs_per_s"] = benchmark::Counter(
+        static_cast<double>(received), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_IOLoopbackThroughput)
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->UseRealTime();
+
+// Round trip latency of a small message sent and received via an
+// AgentRuntime (i.e. via its I/O thread), to an echo server running in
+// another thread. Also reports the time spent in
+// AgentRuntime::Producer::publish() (i.e. by the "RAN thread").
+static void BM_AgentRuntimeLatency(benchmark::State &state) {
+    AGT::AgentRuntime runtime;
+    AGT::IO server;
+
+    static std::uint16_t nextPort = 0;
+    const std::uint16_t port = 23100 + (nextPort++ % 1000);
+
+    server.port(port).nonBlocking(true);
+    server.openListeningSocket();
+    server.onMessage([&server](AGT::IO::ConnectionHandle connection,
+                               NL::BufferView message) {
+        server.sendMessage(connection, message);
+    });
+
+    runtime.io().port(port);
+
+    while (!runtime.io().openSocket()) {
+    }
+
+    server.acceptConnectionIfNeeded();
+
+    std::atomic<bool> done{false};
+    std::thread serverThread([&server, &done] {
+        while (!done.load()) {
+            server.processEvents(10);
+        }
+    });
+
+    auto &producer = runtime.addProducer();
+    runtime.start();
+
+    auto request = makeEchoRequest(0);
+    AGT::AgentRuntime::Message reply;
+    std::vector<double> latencies;
+    double publishTime = 0;
+
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+
+        producer.publish(request);
+
+        const auto published = std::chrono::steady_clock::now();
+
+        while (!runtime.receive(reply)) {
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        publishTime +=
+            std::chrono::duration<double, std::micro>(published - start)
+                .count();
+        latencies.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    runtime.stop();
+    done.store(true);
+    serverThread.join();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    if (!latencies.empty()) {
+        state.counters["p50_us"] = latencies[latencies.size() / 2];
+        state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];
+        state.counters["publish_us"] = publishTime / latencies.size();
+    }
+}
+BENCHMARK(BM_AgentRuntimeLatency)->UseRealTime();
+
+// Scheduling and cancelling a job among state.range(0) others.
+static void BM_TimerWheelScheduleCancel(benchmark::State &state) {
+    AGT::TimerWheel timers;
+    auto job = [](AGT::TimerWheel::TimerId, std::uint64_t) {};
+
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        timers.schedulePeriodic(std::chrono::milliseconds(1 + i % 5000), i,
+                                job);
+    }
+
+    std::uint64_t key = 0;
+
+    for (auto _ : state) {
+        auto id = timers.schedule(std::chrono::milliseconds(key % 100000),
+                                  key, job);
+        timers.cancel(id);
+        ++key;
+    }
+}
+BENCHMARK(BM_TimerWheelScheduleCancel)->Arg(100)->Arg(10000);
+
+// Running one second of state.range(0) periodic jobs (from 10 ms to
+// 5 s), one tick at a time.
+static void BM_TimerWheelAdvance(benchmark::State &state) {
+    auto start = AGT::TimerWheel::Clock::now();
+    AGT::TimerWheel timers(std::chrono::milliseconds(1), start);
+    std::uint64_t runs = 0;
+    auto job = [&](AGT::TimerWheel::TimerId, std::uint64_t) { ++runs; };
+
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        timers.schedulePeriodic(std::chrono::milliseconds(10 + i % 4990), i,
+                                job);
+    }
+
+    std::int64_t msec = 0;
+
+    for (auto _ : state) {
+        for (int i = 0; i < 1000; ++i) {
+            timers.advance(start + std::chrono::milliseconds(++msec));
+        }
+    }
+
+    state.counters["jobs/s"] = benchmark::Counter(
+        static_cast<double>(runs), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_TimerWheelAdvance)->Arg(1000)->Arg(10000);
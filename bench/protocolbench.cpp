@@ -0,0 +1,152 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include <benchmark/benchmark.h>
+
+namespace AGT = Empower::Agent;
+
+static void BM_CommonHeaderEncode(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    std::uint32_t sequence = 0;
+
+    for (auto _ : state) {
+        AGT::CommonHeaderEncoder encoder(buffer);
+        encoder.messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE)
+            .elementId(0x123456789ULL)
+            .transactionId(sequence)
+            .sequence(sequence)
+            .totalLengthBytes(encoder.size());
+        ++sequence;
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_CommonHeaderEncode);
+
+static void BM_CommonHeaderDecode(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::CommonHeaderEncoder encoder(buffer);
+    encoder.messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE)
+        .totalLengthBytes(encoder.size());
+
+    for (auto _ : state) {
+        AGT::CommonHeaderDecoder decoder(buffer);
+        benchmark::DoNotOptimize(decoder.messageClass());
+        benchmark::DoNotOptimize(decoder.entityClass());
+        benchmark::DoNotOptimize(decoder.sequence());
+        benchmark::DoNotOptimize(decoder.totalLengthBytes());
+    }
+}
+BENCHMARK(BM_CommonHeaderDecode);
+
+static void BM_CommonHeaderRoundTrip(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    std::uint32_t sequence = 0;
+
+    for (auto _ : state) {
+        AGT::CommonHeaderEncoder encoder(buffer);
+        encoder.messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE)
+            .sequence(sequence)
+            .totalLengthBytes(encoder.size());
+        ++sequence;
+
+        AGT::CommonHeaderDecoder decoder(buffer);
+        benchmark::DoNotOptimize(decoder.sequence());
+    }
+}
+BENCHMARK(BM_CommonHeaderRoundTrip);
+
+// Rejecting junk data (a wrong version) by catching the exception...
+static void BM_CommonHeaderRejectThrow(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    buffer.setUint8At(AGT::CommonHeader::versionOffset, 1);
+
+    for (auto _ : state) {
+        try {
+            AGT::CommonHeaderDecoder decoder(buffer);
+            benchmark::DoNotOptimize(decoder.sequence());
+        } catch (std::runtime_error &) {
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_CommonHeaderRejectThrow);
+
+// ...and by checking the Status.
+static void BM_CommonHeaderRejectStatus(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    buffer.setUint8At(AGT::CommonHeader::versionOffset, 1);
+
+    for (auto _ : state) {
+        if (AGT::CommonHeaderDecoder::check(buffer)) {
+            AGT::CommonHeaderDecoder decoder(buffer);
+            benchmark::DoNotOptimize(decoder.sequence());
+        } else {
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_CommonHeaderRejectStatus);
+
+// Routing a message through a Dispatcher...
+static void BM_DispatcherDispatch(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::CommonHeaderEncoder encoder(buffer);
+    encoder.messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE)
+        .totalLengthBytes(encoder.size());
+
+    std::uint64_t handled = 0;
+    auto handler = [&](const AGT::Dispatcher::Message &m) {
+        handled += m.header.sequence;
+    };
+
+    AGT::Dispatcher dispatcher;
+    dispatcher.on(AGT::EntityClass::HELLO_SERVICE, handler)
+        .on(AGT::EntityClass::CAPABILITIES_SERVICE, handler)
+        .on(AGT::EntityClass::UE_REPORTS_SERVICE,
+            AGT::MessageClass::REQUEST_GET, handler)
+        .on(AGT::EntityClass::ECHO_SERVICE, handler);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dispatcher.dispatch(0, buffer));
+    }
+
+    benchmark::DoNotOptimize(handled);
+}
+BENCHMARK(BM_DispatcherDispatch);
+
+// ...and through a hand-written switch.
+static void BM_SwitchDispatch(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::CommonHeaderEncoder encoder(buffer);
+    encoder.messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE)
+        .totalLengthBytes(encoder.size());
+
+    std::uint64_t handled = 0;
+
+    for (auto _ : state) {
+        AGT::MessageDecoder decoder(buffer);
+
+        switch (decoder.header().entityClass()) {
+        case AGT::EntityClass::HELLO_SERVICE:
+        case AGT::EntityClass::CAPABILITIES_SERVICE:
+        case AGT::EntityClass::ECHO_SERVICE:
+            handled += decoder.header().sequence();
+            break;
+        case AGT::EntityClass::UE_REPORTS_SERVICE:
+            if (decoder.header().messageClass() ==
+                AGT::MessageClass::REQUEST_GET) {
+                handled += decoder.header().sequence();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    benchmark::DoNotOptimize(handled);
+}
+BENCHMARK(BM_SwitchDispatch);
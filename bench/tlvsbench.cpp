@@ -0,0 +1,408 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include <benchmark/benchmark.h>
+
+namespace AGT = Empower::Agent;
+
+// Fill in a TLV with some sample data.
+static void fill(AGT::TLVError &tlv) {
+    tlv.errcode(42).message("Something went wrong");
+}
+
+static void fill(AGT::TLVBinaryData &tlv) {
+    tlv.stringData("The quick brown fox jumps over the lazy dog");
+}
+
+static void fill(AGT::TLVKeyValueStringPairs &tlv) {
+    tlv.setValue({{"key1", "value1"}, {"key2", "value2"}});
+}
+
+static void fill(AGT::TLVList &) {}
+
+static void fill(AGT::TLVPeriodicityMs &tlv) { tlv.milliseconds(1000); }
+
+static void fill(AGT::TLVCell &tlv) {
+    tlv.pci(1).dlEarfcn(3400).ulEarfcn(21400).nPrb(50);
+}
+
+static void fill(AGT::TLVUEReport &tlv) {
+    tlv.imsi(222930000000001ULL).tmsi(0x12345678).rnti(70).status(1).pci(1);
+}
+
+static void fill(AGT::TLVUEMeasurementConfig &tlv) {
+    tlv.rnti(70).measId(1).interval(2).amount(3);
+}
+
+static void fill(AGT::TLVUEMeasurementId &tlv) { tlv.rnti(70).measId(1); }
+
+static void fill(AGT::TLVUEMeasurementReport &tlv) {
+    tlv.rnti(70).measId(1).rsrp(50).rsrq(20);
+}
+
+static void fill(AGT::TLVMACPrbReportReport &tlv) {
+    tlv.nPrb(50).dlPrbCounters(1000).ulPrbCounters(2000).pci(1);
+}
+
+// Encode a message with a single TLV.
+template <typename T> static void BM_TLVEncode(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    T tlv;
+    fill(tlv);
+
+    for (auto _ : state) {
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE);
+        encoder.add(tlv).end();
+        benchmark::ClobberMemory();
+    }
+}
+
+// Decode a message with a single TLV.
+template <typename T> static void BM_TLVDecode(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    T tlv;
+    fill(tlv);
+
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE);
+    encoder.add(tlv).end();
+    auto message = encoder.data();
+
+    for (auto _ : state) {
+        AGT::MessageDecoder decoder(message);
+        T decoded;
+        decoder.get(decoded);
+        benchmark::DoNotOptimize(decoded);
+    }
+}
+
+#define EMPOWER_TLV_BENCHMARKS(T)                                              \
+    BENCHMARK_TEMPLATE(BM_TLVEncode, T);                                       \
+    BENCHMARK_TEMPLATE(BM_TLVDecode, T)
+
+EMPOWER_TLV_BENCHMARKS(AGT::TLVError);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVBinaryData);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVKeyValueStringPairs);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVList);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVPeriodicityMs);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVCell);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVUEReport);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVUEMeasurementConfig);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVUEMeasurementId);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVUEMeasurementReport);
+EMPOWER_TLV_BENCHMARKS(AGT::TLVMACPrbReportReport);
+
+// Same as BM_TLVEncode, but through the TLVBase interface (i.e. with
+// virtual calls also for TLVs with a fixed layout).
+template <typename T>
+static void BM_TLVEncodeVirtual(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    T tlv;
+    fill(tlv);
+
+    for (auto _ : state) {
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE);
+        encoder.add(static_cast<AGT::TLVBase &>(tlv)).end();
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_TLVEncodeVirtual, AGT::TLVCell);
+BENCHMARK_TEMPLATE(BM_TLVEncodeVirtual, AGT::TLVUEReport);
+
+// Inspect just RNTI and RSRP of a measurement report, decoding it as
+// a view (compare with BM_TLVDecode<TLVUEMeasurementReport>).
+static void BM_TLVViewUEMeasurementReport(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::TLVUEMeasurementReport tlv;
+    fill(tlv);
+
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE);
+    encoder.add(tlv).end();
+    auto message = encoder.data();
+
+    for (auto _ : state) {
+        AGT::MessageDecoder decoder(message);
+        AGT::TLVUEMeasurementReportView view(decoder.next());
+        benchmark::DoNotOptimize(view.rnti());
+        benchmark::DoNotOptimize(view.rsrp());
+    }
+}
+BENCHMARK(BM_TLVViewUEMeasurementReport);
+
+// Encode a report on N UEs, as N separate TLVs (Arg(0)) or as a single
+// TLVListOf (Arg(1)).
+static void BM_TLVEncodeUEReports(benchmark::State &state) {
+    const std::size_t n = 500;
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::TLVUEReport tlv;
+    fill(tlv);
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+    list.elements().assign(n, tlv);
+
+    for (auto _ : state) {
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE);
+
+        if (state.range(0) == 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                encoder.add(tlv);
+            }
+        } else {
+            encoder.add(list);
+        }
+
+        encoder.end();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TLVEncodeUEReports)->Arg(0)->Arg(1);
+
+// Decode a report on N UEs, from N separate TLVs (Arg(0)), from a
+// single TLVListOf (Arg(1)), or reading only the RNTIs through a
+// TLVListOfView (Arg(2)).
+static void BM_TLVDecodeUEReports(benchmark::State &state) {
+    const std::size_t n = 500;
+    AGT::TLVUEReport tlv;
+    fill(tlv);
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+    list.elements().assign(n, tlv);
+
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE);
+
+    if (state.range(0) == 0) {
+        for (std::size_t i = 0; i < n; ++i) {
+            encoder.add(tlv);
+        }
+    } else {
+        encoder.add(list);
+    }
+
+    encoder.end();
+    auto message = encoder.data();
+
+    std::vector<AGT::TLVUEReport> reports(n);
+    AGT::TLVListOf<AGT::TLVUEReport> decodedList;
+    std::vector<std::uint16_t> rntis(n);
+
+    for (auto _ : state) {
+        AGT::MessageDecoder decoder(message);
+
+        switch (state.range(0)) {
+        case 0:
+            for (std::size_t i = 0; i < n; ++i) {
+                decoder.get(reports[i]);
+            }
+            break;
+
+        case 1:
+            decoder.get(decodedList);
+            break;
+
+        default:
+            AGT::TLVListOfView<AGT::TLVUEReport>(decoder.next())
+                .column<2>(rntis.begin());
+            break;
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TLVDecodeUEReports)->Arg(0)->Arg(1)->Arg(2);
+
+// A periodic PRB report, encoded every period (Arg(0)), by reusing
+// the encoder (Arg(1)), or by patching a MessageTemplate (Arg(2)).
+static void BM_PeriodicPrbReport(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::TLVCell cell;
+    AGT::TLVMACPrbReportReport report;
+    fill(cell);
+    fill(report);
+
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE)
+        .elementId(0x123456789ULL);
+    encoder.add(cell).add(report).end();
+
+    const AGT::MessageTemplate reportTemplate(encoder.data());
+    const auto prb = reportTemplate.slot<AGT::TLVMACPrbReportReport>();
+    auto message = reportTemplate.instantiate(AGT::IO::makeMessageBuffer());
+    std::uint32_t sequence = 0;
+
+    for (auto _ : state) {
+        ++sequence;
+
+        switch (state.range(0)) {
+        case 0: {
+            AGT::MessageEncoder periodEncoder(buffer);
+            periodEncoder.header()
+                .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+                .entityClass(AGT::EntityClass::ECHO_SERVICE)
+                .elementId(0x123456789ULL)
+                .sequence(sequence);
+            report.dlPrbCounters(sequence).ulPrbCounters(sequence);
+            periodEncoder.add(cell).add(report).end();
+            break;
+        }
+
+        case 1:
+            encoder.reset(buffer);
+            encoder.header()
+                .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+                .entityClass(AGT::EntityClass::ECHO_SERVICE)
+                .elementId(0x123456789ULL)
+                .sequence(sequence);
+            report.dlPrbCounters(sequence).ulPrbCounters(sequence);
+            encoder.add(cell).add(report).end();
+            break;
+
+        default:
+            AGT::MessageTemplate::sequence(message, sequence);
+            prb.set<1>(message, sequence);
+            prb.set<2>(message, sequence);
+            break;
+        }
+
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PeriodicPrbReport)->Arg(0)->Arg(1)->Arg(2);
+
+// Decode a capabilities-like TLVKeyValueStringPairs with 200 pairs
+// into a new object (Arg(0)), into the same object (Arg(1)), or
+// without copying the strings (Arg(2)).
+static void BM_TLVDecodeKeyValuePairs(benchmark::State &state) {
+    AGT::TLVKeyValueStringPairs::value_type pairs;
+
+    for (int i = 0; i < 200; ++i) {
+        pairs.emplace_back("capability-key-" + std::to_string(i),
+                           "capability-value-" + std::to_string(i));
+    }
+
+    AGT::TLVKeyValueStringPairs tlv;
+    tlv.setValue(std::move(pairs));
+
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+        .entityClass(AGT::EntityClass::ECHO_SERVICE);
+    encoder.add(tlv).end();
+    auto message = encoder.data();
+
+    AGT::TLVKeyValueStringPairs decoded;
+    decoded.zeroCopy(state.range(0) == 2);
+
+    for (auto _ : state) {
+        AGT::MessageDecoder decoder(message);
+
+        if (state.range(0) == 0) {
+            AGT::TLVKeyValueStringPairs fresh;
+            decoder.get(fresh);
+            benchmark::DoNotOptimize(fresh);
+        } else {
+            decoder.get(decoded);
+            benchmark::DoNotOptimize(decoded);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * 200);
+}
+BENCHMARK(BM_TLVDecodeKeyValuePairs)->Arg(0)->Arg(1)->Arg(2);
+
+// Encode a message with a single small TLV, with durations measured
+// (range(0) == 1) or not by the library metrics.
+static void BM_TLVEncodeTimed(benchmark::State &state) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::TLVCell tlv;
+    fill(tlv);
+
+    Empower::NetworkLib::Metrics::timing(state.range(0) == 1);
+
+    for (auto _ : state) {
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE);
+        encoder.add(tlv).end();
+        benchmark::ClobberMemory();
+    }
+
+    Empower::NetworkLib::Metrics::timing(false);
+}
+BENCHMARK(BM_TLVEncodeTimed)->Arg(0)->Arg(1);
+
+// A periodic report on N UEs, where only 1% of them changed since the
+// previous period: as a full TLVListOf (Arg(0)) or as a delta from a
+// DeltaReporter (Arg(1), with the default resync period).
+static void BM_UEReportsDelta(benchmark::State &state) {
+    const std::size_t n = 2000;
+    auto buffer = AGT::IO::makeMessageBuffer(65500);
+    std::vector<AGT::TLVUEReport> ues(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        fill(ues[i]);
+        ues[i].rnti(static_cast<std::uint16_t>(i + 1));
+    }
+
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+    AGT::DeltaReporter<AGT::TLVUEReport> reporter;
+    std::uint32_t tmsi = 0;
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < n / 100; ++i) {
+            ++tmsi;
+            ues[tmsi % n].tmsi(tmsi);
+        }
+
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::REQUEST_GET)
+            .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE);
+
+        if (state.range(0) == 0) {
+            list.elements().assign(ues.begin(), ues.end());
+            encoder.add(list);
+        } else {
+            reporter.begin();
+
+            for (const auto &ue : ues) {
+                reporter.update(ue);
+            }
+
+            encoder.add(reporter.end());
+        }
+
+        encoder.end();
+        bytes += encoder.data().size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["bytes_per_report"] =
+        static_cast<double>(bytes) / state.iterations();
+}
+BENCHMARK(BM_UEReportsDelta)->Arg(0)->Arg(1);
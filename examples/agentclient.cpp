@@ -8,6 +8,19 @@ int main(void) {
 
     AGT::IO io;
 
+    // Sends the requests without waiting for each reply, and matches
+    // the replies to the requests.
+    AGT::ClientSession session(io);
+    session.timeout(std::chrono::milliseconds(io.delay()));
+
+    io.onMessage(session.callback(
+                     [](AGT::IO::ConnectionHandle, NL::BufferView message) {
+                         std::cout << "Unexpected message\n" << message;
+                     }))
+        .onConnectionClosed([&session](AGT::IO::ConnectionHandle c) {
+            session.connectionClosed(c);
+        });
+
     // Leave default destination address (127.0.0.1) and port (2210).
 
     try {
@@ -30,53 +43,64 @@ int main(void) {
 
             auto ioBuffer = AGT::IO::makeMessageBuffer();
 
-            // Prepare a request for the ECHO SERVICE
-            AGT::MessageEncoder messageEncoder(ioBuffer);
-
-            messageEncoder.header()
-                .messageClass(AGT::MessageClass::REQUEST_GET)
-                .entityClass(AGT::EntityClass::ECHO_SERVICE);
+            // Send a few requests for the ECHO SERVICE at once
+            for (int i = 0; i < 4; ++i) {
+                AGT::MessageEncoder messageEncoder(ioBuffer);
 
-            auto tlv =
-                AGT::TLVBinaryData().stringData("Is there anybody out there?");
+                messageEncoder.header()
+                    .messageClass(AGT::MessageClass::REQUEST_GET)
+                    .entityClass(AGT::EntityClass::ECHO_SERVICE);
 
-            messageEncoder.add(tlv).end();
+                auto tlv = AGT::TLVBinaryData().stringData(
+                    "Is there anybody out there?");
 
-            std::cout << "Sending message\n" << messageEncoder.data();
+                messageEncoder.add(tlv).end();
 
-            // Write a message to the socket
-            io.writeMessage(messageEncoder.data());
+                // Sets the sequence and transaction ID, and sends the
+                // message (the buffer can be reused right away).
+                auto transactionId = session.request(
+                    messageEncoder, [](const NL::Status &status,
+                                       const AGT::ClientSession::Response &r) {
+                        if (!status) {
+                            std::cout << "No reply: " << status << '\n';
+                            return;
+                        }
 
-            // Wait for a reply
-            NL::BufferView reply = io.readMessage(ioBuffer);
+                        AGT::MessageDecoder messageDecoder(r.data);
 
-            if (reply.size() > 0) {
+                        std::cout << "Got back a message (transaction "
+                                  << r.header.transactionId << ")\n";
 
-                AGT::MessageDecoder messageDecoder(reply);
+                        if (messageDecoder.isSuccess() &&
+                            (r.header.entityClass ==
+                             AGT::EntityClass::ECHO_SERVICE)) {
 
-                std::cout << "Got back a message\n";
+                            AGT::TLVBinaryData tlv;
+                            messageDecoder.get(tlv);
 
-                if (messageDecoder.isSuccess() &&
-                    (messageDecoder.header().entityClass() ==
-                     AGT::EntityClass::ECHO_SERVICE)) {
+                            std::cout << "Got back message: "
+                                      << tlv.stringData() << '\n';
 
-                    AGT::TLVBinaryData tlv;
-                    messageDecoder.get(tlv);
+                        } else if (messageDecoder.isFailure()) {
+                            AGT::TLVError err;
+                            messageDecoder.get(err);
 
-                    std::cout << "Got back message: " << tlv.stringData()
-                              << '\n';
+                            std::cout << "Errcode is " << err.errcode()
+                                      << ", message: " << err.message()
+                                      << '\n';
+                        } else {
+                            std::cout << "Unexpected reply\n";
+                        }
+                    });
 
-                } else if (messageDecoder.isFailure()) {
-                    AGT::TLVError err;
-                    messageDecoder.get(err);
+                std::cout << "Sent message (transaction " << transactionId
+                          << ")\n"
+                          << messageEncoder.data();
+            }
 
-                    std::cout << "Errcode is " << err.errcode()
-                              << ", message: " << err.message() << '\n';
-                } else {
-                    std::cout << "Unexpected reply\n";
-                }
-            } else {
-                io.closeConnection();
+            // Wait for the replies (or for them to time out)
+            while (session.outstanding() > 0) {
+                io.processEvents(io.delay());
             }
 
             io.sleep();
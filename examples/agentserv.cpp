@@ -12,6 +12,58 @@ int main(void) {
         auto readBuffer = io.makeMessageBuffer();
         auto writeBuffer = io.makeMessageBuffer();
 
+        // Failure responses are ignored
+        auto ignore = [](const AGT::Dispatcher::Message &) {};
+
+        AGT::Dispatcher dispatcher;
+
+        dispatcher
+            .on(AGT::EntityClass::ECHO_SERVICE,
+                [&](const AGT::Dispatcher::Message &message) {
+                    std::cout << "Got message class for ECHO SERVICE\n";
+
+                    AGT::MessageDecoder messageDecoder(message.data);
+                    AGT::TLVBinaryData tlv;
+                    messageDecoder.get(tlv);
+                    tlv.stringData(tlv.stringData() + " Here I am!");
+
+                    AGT::MessageEncoder messageEncoder(writeBuffer);
+
+                    // The transaction ID tells which request this is
+                    // the reply to (see ClientSession).
+                    messageEncoder.header()
+                        .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+                        .entityClass(AGT::EntityClass::ECHO_SERVICE)
+                        .sequence(message.header.sequence)
+                        .transactionId(message.header.transactionId);
+
+                    messageEncoder.add(tlv).end();
+
+                    std::cout << "Sending back reply\n"
+                              << messageEncoder.data();
+
+                    // Write a message to the socket
+                    size_t len = io.writeMessage(messageEncoder.data());
+
+                    std::cout << "Wrote " << len << " bytes\n";
+                })
+            .on(AGT::EntityClass::ECHO_SERVICE,
+                AGT::MessageClass::RESPONSE_FAILURE, ignore)
+            .on(AGT::EntityClass::AGENT_STATS_SERVICE,
+                [&](const AGT::Dispatcher::Message &message) {
+                    std::cout << "Got message class for AGENT STATS "
+                                 "SERVICE\n";
+
+                    AGT::CommonHeaderDecoder request(message.data);
+                    io.writeMessage(
+                        AGT::encodeAgentStatsReply(writeBuffer, request));
+                })
+            .on(AGT::EntityClass::AGENT_STATS_SERVICE,
+                AGT::MessageClass::RESPONSE_FAILURE, ignore)
+            .onUnhandled([](const AGT::Dispatcher::Message &) {
+                std::cout << "Got unmanaged message class\n";
+            });
+
         for (;;) {
             bool performPeriodicTasks = false;
             bool dataIsAvailable = false;
@@ -44,48 +96,8 @@ int main(void) {
 
                     std::cout << "Received message\n" << messageBuffer;
 
-                    // Decode the message
-                    AGT::MessageDecoder messageDecoder(messageBuffer);
-
-                    if (!messageDecoder.isFailure()) {
-
-                        switch (messageDecoder.header().entityClass()) {
-                        case AGT::EntityClass::ECHO_SERVICE:
-                            std::cout << "Got message class for ECHO SERVICE\n";
-
-                            {
-                                AGT::TLVBinaryData tlv;
-                                messageDecoder.get(tlv);
-                                tlv.stringData(tlv.stringData() +
-                                               " Here I am!");
-
-                                AGT::MessageEncoder messageEncoder(writeBuffer);
-
-                                messageEncoder.header()
-                                    .messageClass(
-                                        AGT::MessageClass::RESPONSE_SUCCESS)
-                                    .entityClass(
-                                        AGT::EntityClass::ECHO_SERVICE);
-
-                                messageEncoder.add(tlv).end();
-
-                                std::cout << "Sending back reply\n"
-                                          << messageEncoder.data();
-
-                                // Write a message to the socket
-                                size_t len =
-                                    io.writeMessage(messageEncoder.data());
-
-                                std::cout << "Wrote " << len << " bytes\n";
-                            }
-
-                            break;
-
-                        default:
-                            std::cout << "Got unmanaged message class\n";
-                            break;
-                        }
-                    }
+                    dispatcher.dispatch(io.defaultConnection(),
+                                        messageBuffer);
                 }
             } else if (performPeriodicTasks) {
                 // Timeout expired
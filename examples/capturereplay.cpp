@@ -0,0 +1,218 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+// Reads back a capture file (see CaptureWriter and IO::capture()),
+// decoding each message straight from the mapped file, and optionally
+// sends the captured outgoing messages again (e.g. to load a
+// controller with recorded traffic).
+
+namespace {
+
+struct Options {
+    std::string file;
+    AGT::CaptureReader::Pacing pacing =
+        AGT::CaptureReader::Pacing::AS_FAST_AS_POSSIBLE;
+    double speed = 1.0;
+    bool send = false;
+    NL::IPv4Address address{127, 0, 0, 1};
+    std::uint16_t port = 2210;
+    std::string unixPath;
+};
+
+void usage(const char *program) {
+    std::cerr << "Usage: " << program << " [OPTIONS] FILE\n"
+              << "  --original-pacing  replay with the captured delays\n"
+              << "  --speed X          ... divided by X (1)\n"
+              << "  --send             send the captured outgoing messages\n"
+              << "  --address A        ... to the given address (127.0.0.1)\n"
+              << "  --port P           ... and port (2210)\n"
+              << "  --unix PATH        ... or Unix-domain socket\n";
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+
+        if (option == "--original-pacing") {
+            options.pacing = AGT::CaptureReader::Pacing::ORIGINAL;
+            continue;
+        } else if (option == "--send") {
+            options.send = true;
+            continue;
+        } else if (option.compare(0, 2, "--") != 0) {
+            options.file = option;
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            return false;
+        }
+
+        const char *value = argv[++i];
+
+        if (option == "--speed") {
+            options.speed = std::strtod(value, nullptr);
+        } else if (option == "--address") {
+            unsigned char a[4];
+
+            if (inet_pton(AF_INET, value, a) != 1) {
+                return false;
+            }
+
+            options.address = NL::IPv4Address(a[0], a[1], a[2], a[3]);
+        } else if (option == "--port") {
+            options.port =
+                static_cast<std::uint16_t>(std::strtoul(value, nullptr, 10));
+        } else if (option == "--unix") {
+            options.unixPath = value;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.file.empty() && options.speed > 0.0;
+}
+
+// Per entity class and direction
+struct Counts {
+    std::uint64_t messages = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t tlvs = 0;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        AGT::CaptureReader reader(options.file);
+        AGT::IO io;
+
+        if (options.send) {
+            io.nonBlocking(true)
+                .address(options.address)
+                .port(options.port)
+                .unixPath(options.unixPath);
+
+            if (!io.openSocket()) {
+                std::cerr << "Cannot connect\n";
+                return 1;
+            }
+        }
+
+        std::map<std::pair<int, bool>, Counts> counts;
+        std::uint64_t malformed = 0;
+        std::uint64_t ueReports = 0;
+        std::uint64_t prbReports = 0;
+        std::uint64_t sent = 0;
+
+        AGT::TLVListOf<AGT::TLVUEReport> ues;
+        AGT::TLVMACPrbReportReport prb;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        const std::uint64_t records = reader.replay(
+            [&](const AGT::CaptureReader::Record &record) {
+                const bool outgoing =
+                    record.direction == AGT::CaptureDirection::SENT;
+
+                if (!AGT::MessageDecoder::check(record.message)) {
+                    ++malformed;
+                    return;
+                }
+
+                // Decoded right from the mapped file
+                AGT::MessageDecoder decoder(record.message);
+
+                if (!decoder.index_nothrow()) {
+                    ++malformed;
+                    return;
+                }
+
+                const AGT::EntityClass entityClass =
+                    decoder.header().entityClass();
+                Counts &c =
+                    counts[std::make_pair(static_cast<int>(entityClass),
+                                          outgoing)];
+                ++c.messages;
+                c.bytes += record.message.size();
+                c.tlvs += decoder.index().size();
+
+                if (entityClass == AGT::EntityClass::UE_REPORTS_SERVICE &&
+                    decoder.tryGet(ues)) {
+                    ueReports += ues.size();
+                } else if (entityClass ==
+                               AGT::EntityClass::MAC_PRB_UTILIZATION_SERVICE &&
+                           decoder.tryGet(prb)) {
+                    ++prbReports;
+                }
+
+                if (options.send && outgoing && !io.isConnectionClosed()) {
+                    io.sendMessage(record.message);
+                    io.processEvents(0);
+                    ++sent;
+                }
+            },
+            options.pacing, options.speed);
+
+        // Wait for the messages sent to go out.
+        while (options.send && !io.isConnectionClosed() &&
+               io.hasPendingOutput()) {
+            io.processEvents(io.delay());
+        }
+
+        const double seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+
+        std::cout << "entity class, direction, messages, bytes, TLVs\n";
+
+        std::uint64_t bytes = 0;
+
+        for (const auto &entry : counts) {
+            std::cout << "0x" << std::hex << entry.first.first << std::dec
+                      << (entry.first.second ? ", sent, " : ", received, ")
+                      << entry.second.messages << ", " << entry.second.bytes
+                      << ", " << entry.second.tlvs << '\n';
+            bytes += entry.second.bytes;
+        }
+
+        std::cout << records << " messages (" << bytes << " bytes, "
+                  << malformed << " malformed, " << ueReports
+                  << " UE reports, " << prbReports << " PRB reports) in "
+                  << seconds << " s (" << records / seconds << " msg/s, "
+                  << bytes / seconds / 1e6 << " MB/s)\n";
+
+        if (options.send) {
+            std::cout << "Sent " << sent << " messages\n";
+        }
+
+        if (reader.truncated()) {
+            std::cout << "The capture ends with a truncated record\n";
+        }
+
+        io.closeConnection();
+
+    } catch (std::exception &e) {
+        std::cerr << "Caught exception: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+// Emulates many eNBs, each with many UEs, sending UE reports and MAC
+// PRB utilization reports to a controller at a fixed period, to find
+// out how far the controller (or the agent library) scales.
+
+namespace {
+
+struct Options {
+    std::size_t enbs = 1;
+    std::size_t ues = 64;
+    std::chrono::milliseconds period{100};
+    std::chrono::seconds duration{10};
+    NL::IPv4Address address{127, 0, 0, 1};
+    std::uint16_t port = 2210;
+    std::string unixPath;
+    std::string capture;
+    bool quiet = false;
+};
+
+void usage(const char *program) {
+    std::cerr
+        << "Usage: " << program << " [OPTIONS]\n"
+        << "  --enbs N         number of eNBs, one connection each (1)\n"
+        << "  --ues M          number of UEs of each eNB (64)\n"
+        << "  --period MS      reporting period, in milliseconds (100)\n"
+        << "  --duration S     how long to run, in seconds, 0 = forever (10)\n"
+        << "  --address A      address of the controller (127.0.0.1)\n"
+        << "  --port P         port of the controller (2210)\n"
+        << "  --unix PATH      connect to a Unix-domain socket instead\n"
+        << "  --capture FILE   capture all the messages (see CaptureWriter)\n"
+        << "  --quiet          don't print the statistics every second\n";
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+
+        if (option == "--quiet") {
+            options.quiet = true;
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            return false;
+        }
+
+        const char *value = argv[++i];
+
+        if (option == "--enbs") {
+            options.enbs = std::strtoul(value, nullptr, 10);
+        } else if (option == "--ues") {
+            options.ues = std::strtoul(value, nullptr, 10);
+        } else if (option == "--period") {
+            options.period =
+                std::chrono::milliseconds(std::strtoul(value, nullptr, 10));
+        } else if (option == "--duration") {
+            options.duration =
+                std::chrono::seconds(std::strtoul(value, nullptr, 10));
+        } else if (option == "--address") {
+            unsigned char a[4];
+
+            if (inet_pton(AF_INET, value, a) != 1) {
+                return false;
+            }
+
+            options.address = NL::IPv4Address(a[0], a[1], a[2], a[3]);
+        } else if (option == "--port") {
+            options.port =
+                static_cast<std::uint16_t>(std::strtoul(value, nullptr, 10));
+        } else if (option == "--unix") {
+            options.unixPath = value;
+        } else if (option == "--capture") {
+            options.capture = value;
+        } else {
+            return false;
+        }
+    }
+
+    return options.enbs > 0 && options.period.count() > 0;
+}
+
+// The UE reports of a message (so that it fits in a message buffer)
+const std::size_t maxUEsPerMessage = 1024;
+
+// An emulated eNB
+struct ENB {
+    AGT::IO io;
+    std::uint64_t elementId = 0;
+    std::uint16_t pci = 0;
+    std::uint32_t sequence = 0;
+
+    std::vector<AGT::TLVUEReport> ues;
+    AGT::TLVMACPrbReportReport prb;
+};
+
+// Totals across all the eNBs
+struct Counters {
+    std::uint64_t messagesSent = 0;
+    std::uint64_t bytesSent = 0;
+    std::uint64_t messagesReceived = 0;
+    std::uint64_t missedPeriods = 0;
+};
+
+void queue(ENB &enb, AGT::MessageEncoder &encoder, Counters &counters) {
+    encoder.end();
+    enb.io.queueMessage(encoder.data());
+
+    ++counters.messagesSent;
+    counters.bytesSent += encoder.data().size();
+}
+
+// Send the reports of one period (coalesced, see IO::queueMessage()).
+void sendReports(ENB &enb, NL::BufferWritableView buffer, std::mt19937 &rng,
+                 Counters &counters) {
+    // A few UEs change every period (e.g. they get a new TMSI).
+    if (!enb.ues.empty()) {
+        std::uniform_int_distribution<std::size_t> anyUE(0,
+                                                          enb.ues.size() - 1);
+
+        for (std::size_t n = enb.ues.size() / 100 + 1; n > 0; --n) {
+            enb.ues[anyUE(rng)].tmsi(static_cast<std::uint32_t>(rng()));
+        }
+    }
+
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+
+    for (std::size_t first = 0; first < enb.ues.size();
+         first += maxUEsPerMessage) {
+        const std::size_t last =
+            std::min(enb.ues.size(), first + maxUEsPerMessage);
+        list.elements().assign(enb.ues.begin() + first,
+                               enb.ues.begin() + last);
+
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+            .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE)
+            .elementId(enb.elementId)
+            .sequence(enb.sequence++);
+        encoder.add(list);
+        queue(enb, encoder, counters);
+    }
+
+    // The PRB counters keep growing.
+    std::uniform_int_distribution<std::uint32_t> used(
+        0, enb.prb.nPrb() * static_cast<std::uint32_t>(10));
+    enb.prb.dlPrbCounters(enb.prb.dlPrbCounters() + used(rng))
+        .ulPrbCounters(enb.prb.ulPrbCounters() + used(rng));
+
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+        .entityClass(AGT::EntityClass::MAC_PRB_UTILIZATION_SERVICE)
+        .elementId(enb.elementId)
+        .sequence(enb.sequence++);
+    encoder.add(enb.prb);
+    queue(enb, encoder, counters);
+
+    enb.io.flush();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        // All the eNBs share the capture (and are told apart by the
+        // element ID of their messages).
+        std::unique_ptr<AGT::CaptureWriter> capture;
+
+        if (!options.capture.empty()) {
+            capture.reset(new AGT::CaptureWriter(options.capture));
+        }
+
+        Counters counters;
+        std::vector<std::unique_ptr<ENB>> enbs;
+
+        for (std::size_t e = 0; e < options.enbs; ++e) {
+            std::unique_ptr<ENB> enb(new ENB);
+
+            enb->elementId = 0x1000 + e;
+            enb->pci = static_cast<std::uint16_t>(e % 504);
+
+            for (std::size_t u = 0; u < options.ues; ++u) {
+                AGT::TLVUEReport ue;
+                ue.imsi(222930000000000ULL + e * options.ues + u)
+                    .tmsi(static_cast<std::uint32_t>(u))
+                    .rnti(static_cast<std::uint16_t>(0x100 + u))
+                    .status(1)
+                    .pci(static_cast<std::uint8_t>(enb->pci));
+                enb->ues.push_back(ue);
+            }
+
+            enb->prb.nPrb(100).pci(enb->pci);
+
+            enb->io.nonBlocking(true)
+                .address(options.address)
+                .port(options.port)
+                .unixPath(options.unixPath)
+                .autoReconnect(true)
+                .capture(capture.get())
+                .onMessage([&counters](AGT::IO::ConnectionHandle,
+                                       NL::BufferView) {
+                    ++counters.messagesReceived;
+                });
+            enb->io.openSocketAsync();
+
+            enbs.push_back(std::move(enb));
+        }
+
+        auto buffer = AGT::IO::makeMessageBuffer();
+        std::mt19937 rng(2210);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto end = start + options.duration;
+        auto nextPeriod = start;
+        auto nextStats = start + std::chrono::seconds(1);
+        Counters last;
+
+        for (;;) {
+            auto now = std::chrono::steady_clock::now();
+
+            if (options.duration.count() > 0 && now >= end) {
+                break;
+            }
+
+            if (now >= nextPeriod) {
+                for (auto &enb : enbs) {
+                    if (!enb->io.isConnectionClosed()) {
+                        sendReports(*enb, buffer, rng, counters);
+                    }
+                }
+
+                nextPeriod += options.period;
+                now = std::chrono::steady_clock::now();
+
+                if (nextPeriod < now) {
+                    // Too slow: skip the periods we missed.
+                    while (nextPeriod < now) {
+                        nextPeriod += options.period;
+                        ++counters.missedPeriods;
+                    }
+                }
+            }
+
+            for (auto &enb : enbs) {
+                enb->io.processEvents(0);
+            }
+
+            if (now >= nextStats) {
+                std::size_t connected = 0;
+
+                for (auto &enb : enbs) {
+                    connected += enb->io.isConnectionClosed() ? 0 : 1;
+                }
+
+                if (!options.quiet) {
+                    std::cout
+                        << "connected " << connected << '/' << enbs.size()
+                        << ", sent "
+                        << counters.messagesSent - last.messagesSent
+                        << " msg/s ("
+                        << (counters.bytesSent - last.bytesSent) / 1024
+                        << " KiB/s), received "
+                        << counters.messagesReceived - last.messagesReceived
+                        << " msg/s, missed periods "
+                        << counters.missedPeriods << '\n';
+                }
+
+                last = counters;
+                nextStats += std::chrono::seconds(1);
+            }
+
+            std::this_thread::sleep_until(
+                std::min(nextPeriod, std::chrono::steady_clock::now() +
+                                         std::chrono::milliseconds(1)));
+        }
+
+        for (auto &enb : enbs) {
+            enb->io.closeConnection();
+        }
+
+        const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+
+        std::cout << "Sent " << counters.messagesSent << " messages ("
+                  << counters.bytesSent << " bytes) in " << seconds
+                  << " s, received " << counters.messagesReceived
+                  << ", missed periods " << counters.missedPeriods << '\n';
+
+        if (capture) {
+            capture->flush();
+            std::cout << "Captured " << capture->records() << " messages to "
+                      << capture->path() << '\n';
+        }
+
+    } catch (std::exception &e) {
+        std::cerr << "Caught exception: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+#ifndef EMPOWER_AGENT_AGENTRUNTIME_HH
+#define EMPOWER_AGENT_AGENTRUNTIME_HH
+
+#include <empoweragentproto/io.hh>
+#include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/spscring.hh>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief Runs an IO in a dedicated thread (the *I/O thread*), so that
+ *        the threads producing and consuming messages (e.g. the RAN
+ *        threads) never make system calls nor wait on the network.
+ *
+ * Each thread sending messages gets its own Producer (see
+ * `addProducer()`), which hands messages over to the I/O thread via a
+ * lock-free single-producer single-consumer ring. Received messages
+ * are copied to another ring, which a single thread drains via
+ * `receive()`:
+ *
+ *     AgentRuntime runtime;
+ *     runtime.io().address(...).port(...).openSocket();
+ *     auto &producer = runtime.cpuAffinity(3).addProducer();
+ *     runtime.start();
+ *     ...
+ *     // In the RAN thread
+ *     producer.publish(encoder.data());
+ *     ...
+ *     AgentRuntime::Message message;
+ *     while (runtime.receive(message)) { ... }
+ *
+ * While there's work to do, the I/O thread polls the rings and the
+ * sockets without waiting. When idle, it waits on the sockets (see
+ * `idleTimeout()`) and the first message published afterwards wakes
+ * it up (see `IO::wakeup()`), so a system call is made by a producer
+ * only then.
+ *
+ * Messages are handed over as NetworkLib::BufferView (i.e. by
+ * reference), so the library must use atomic reference counts (i.e.
+ * it must **not** be built with EMPOWER_NETWORKLIB_NON_ATOMIC_REFCOUNT),
+ * and a published buffer must not be modified any more.
+ */
+class AgentRuntime {
+  public:
+    /// @brief A message, with its connection.
+    struct Message {
+        /// @brief For published messages, `IO::noConnection` means
+        ///        the default connection.
+        IO::ConnectionHandle connection = IO::noConnection;
+        NetworkLib::BufferView data;
+    };
+
+    /// @brief What `Producer::publish()` does when the ring is full.
+    enum class OverflowPolicy {
+        /// @brief Fail (and count the message in Stats::txRejected).
+        REJECT,
+
+        /// @brief Wait (spinning) for the I/O thread to make room.
+        SPIN
+    };
+
+    /// @brief Counters (see `stats()`).
+    struct Stats {
+        /// @brief Messages handed over to IO.
+        std::uint64_t sent = 0;
+
+        /// @brief Messages IO refused (e.g. the connection is closed).
+        std::uint64_t sendFailures = 0;
+
+        /// @brief Messages received and queued for `receive()`.
+        std::uint64_t received = 0;
+
+        /// @brief Messages received and dropped because the receive
+        ///        ring was full.
+        std::uint64_t receiveDropped = 0;
+
+        /// @brief Messages not published because the ring was full.
+        std::uint64_t txRejected = 0;
+
+        /// @brief Errors (exceptions) while processing IO events.
+        std::uint64_t ioErrors = 0;
+    };
+
+    /**
+     * @brief Publishes messages from a single thread to the I/O
+     *        thread.
+     */
+    class Producer {
+      public:
+        ///@name No copy semantic
+        ///@{
+        Producer(const Producer &) = delete;
+        Producer &operator=(const Producer &) = delete;
+        ///@}
+
+        /// @brief Hand the message over to the I/O thread, which will
+        ///        send it to the given connection (the default one if
+        ///        `IO::noConnection`).
+        ///
+        /// Must always be called from the same thread.
+        ///
+        /// @return false if the ring is full and the overflow policy
+        ///         is OverflowPolicy::REJECT, or if the runtime was
+        ///         stopped while waiting for room.
+        bool publish(const NetworkLib::BufferView &message,
+                     IO::ConnectionHandle connection = IO::noConnection);
+
+      private:
+        friend class AgentRuntime;
+
+        Producer(AgentRuntime &runtime, std::size_t capacity)
+            : mRuntime(runtime), mRing(capacity) {}
+
+        AgentRuntime &mRuntime;
+        NetworkLib::SPSCRing<Message> mRing;
+    };
+
+    /// @brief Constructor. The IO is made non-blocking (see
+    ///        `IO::nonBlocking()`) and its wakeup is enabled (see
+    ///        `IO::enableWakeup()`).
+    AgentRuntime();
+
+    /// @brief Destructor. Stop the I/O thread if needed.
+    ~AgentRuntime();
+
+    ///@name No copy semantic
+    ///@{
+    AgentRuntime(const AgentRuntime &) = delete;
+    AgentRuntime &operator=(const AgentRuntime &) = delete;
+    ///@}
+
+    /// @brief Return the IO.
+    ///
+    /// Use it to set up the connections before `start()`, and not
+    /// at all afterwards (it then belongs to the I/O thread). The
+    /// message callback (see `IO::onMessage()`) is reserved to
+    /// AgentRuntime. The other callbacks are invoked in the I/O
+    /// thread.
+    IO &io() { return mIO; }
+
+    ///@name Configuration (before `start()`, and before `addProducer()`
+    ///      for `txCapacity()`)
+    ///@{
+
+    /// @brief Set the capacity of the rings of the producers
+    ///        (default: 1024 messages).
+    AgentRuntime &txCapacity(std::size_t v) {
+        mTxCapacity = v;
+        return *this;
+    }
+
+    /// @brief Set the capacity of the ring of the received messages
+    ///        (default: 1024 messages).
+    AgentRuntime &rxCapacity(std::size_t v) {
+        mRxCapacity = v;
+        return *this;
+    }
+
+    /// @brief Set what happens when a producer ring is full
+    ///        (default: OverflowPolicy::REJECT).
+    AgentRuntime &overflowPolicy(OverflowPolicy v) {
+        mOverflowPolicy = v;
+        return *this;
+    }
+
+    /// @brief Pin the I/O thread to the given CPU (default: `-1`,
+    ///        i.e. don't pin). Only supported on Linux.
+    AgentRuntime &cpuAffinity(int cpu) {
+        mCPU = cpu;
+        return *this;
+    }
+
+    /// @brief Set for how long at most (in milliseconds) the idle
+    ///        I/O thread waits on the sockets before checking again
+    ///        the rings (default: 100).
+    ///
+    /// Publishing wakes up the I/O thread anyway: this only bounds
+    /// the delay for other events (e.g. for queued messages, see
+    /// `IO::flushLatency()`, which is also honoured).
+    AgentRuntime &idleTimeout(int msec) {
+        mIdleTimeout_msec = msec;
+        return *this;
+    }
+
+    ///@}
+
+    /// @brief Add a producer (with a ring of `txCapacity()` messages),
+    ///        which must be used by a single thread. Only before
+    ///        `start()`.
+    Producer &addProducer();
+
+    /// @brief Start the I/O thread.
+    ///
+    /// Throw std::logic_error if already running, and
+    /// std::runtime_error if the CPU affinity can't be set.
+    void start();
+
+    /// @brief Stop the I/O thread and wait for it to terminate.
+    ///
+    /// Messages still in the producer rings are handed over to IO,
+    /// but their pending output (see `IO::sendMessage()`) is not
+    /// waited for.
+    void stop() noexcept;
+
+    /// @brief Tell if the I/O thread is running.
+    bool running() const { return mThread.joinable(); }
+
+    /// @brief Retrieve the oldest received message (copied out of the
+    ///        IO buffers, so it can be kept).
+    ///
+    /// Must always be called from the same thread.
+    ///
+    /// @return false if there's no message.
+    bool receive(Message &message) {
+        return mRxRing && mRxRing->tryPop(message);
+    }
+
+    /// @brief Return a snapshot of the counters (from any thread).
+    Stats stats() const;
+
+  private:
+    IO mIO;
+
+    std::size_t mTxCapacity = 1024;
+    std::size_t mRxCapacity = 1024;
+    OverflowPolicy mOverflowPolicy = OverflowPolicy::REJECT;
+    int mCPU = -1;
+    int mIdleTimeout_msec = 100;
+
+    std::vector<std::unique_ptr<Producer>> mProducers;
+
+    // Made (with mRxCapacity slots) by start()
+    std::unique_ptr<NetworkLib::SPSCRing<Message>> mRxRing;
+
+    std::thread mThread;
+    std::atomic<bool> mStopRequested{false};
+
+    // Set by the I/O thread before waiting on the sockets, cleared by
+    // the first producer which then wakes it up.
+    std::atomic<bool> mIdle{false};
+
+    ///@name Counters (see Stats)
+    ///@{
+    std::atomic<std::uint64_t> mSent{0};
+    std::atomic<std::uint64_t> mSendFailures{0};
+    std::atomic<std::uint64_t> mReceived{0};
+    std::atomic<std::uint64_t> mReceiveDropped{0};
+    std::atomic<std::uint64_t> mTxRejected{0};
+    std::atomic<std::uint64_t> mIOErrors{0};
+    ///@}
+
+    // Wake up the I/O thread if it's idle (see mIdle).
+    void wakeupIfIdle() noexcept;
+
+    // The body of the I/O thread.
+    void run() noexcept;
+
+    // Send all the messages in the producer rings. Return false if
+    // there were none.
+    bool drainProducers() noexcept;
+
+    // Process the IO events, waiting up to the given time.
+    void processEvents(int timeoutMsec) noexcept;
+
+    // Queue a message received by IO for receive().
+    void handleMessage(IO::ConnectionHandle connection,
+                       const NetworkLib::BufferView &message);
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef EMPOWER_AGENT_AGENTSTATS_HH
+#define EMPOWER_AGENT_AGENTSTATS_HH
+
+#include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/tlvs.hh>
+
+namespace Empower {
+namespace Agent {
+
+/// @brief Return the given metrics as key-value pairs (e.g. for a
+///        TLVKeyValueStringPairs).
+///
+/// Each counter gives a pair named after it (e.g. `bytes_read`).
+/// Each non-empty timer histogram gives the pairs
+/// `<timer>.<key>.count`, `.mean_ns`, `.p50_ns`, `.p99_ns` and
+/// `.max_ns`, where the key is the TLV type (or `other`), e.g.
+/// `tlv_encode.3.p99_ns`.
+TLVKeyValueStringPairs::value_type
+agentStatsPairs(const NetworkLib::MetricsSnapshot &snapshot);
+
+/// @brief Encode in the given buffer the reply to an
+///        EntityClass::AGENT_STATS_SERVICE request, with the given
+///        metrics in a TLVKeyValueStringPairs.
+///
+/// The reply has the same sequence number and transaction id as the
+/// request.
+///
+/// @return The encoded reply.
+NetworkLib::BufferView
+encodeAgentStatsReply(NetworkLib::BufferWritableView buffer,
+                      const CommonHeaderDecoder &request,
+                      const NetworkLib::MetricsSnapshot &snapshot =
+                          NetworkLib::Metrics::snapshot());
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -1,12 +1,19 @@
 #ifndef EMPOWER_NETWORKLIB_BUFFERS_HH
 #define EMPOWER_NETWORKLIB_BUFFERS_HH
 
+#include <empoweragentproto/metrics.hh>
+#include <empoweragentproto/status.hh>
 #include <empoweragentproto/utils.hh>
 
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <deque>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace Empower {
 namespace NetworkLib {
@@ -17,6 +24,18 @@ namespace NetworkLib {
  *
  * Neither this type nor its specializations are meant to be used
  * directly: instead, use BufferView and BufferWritableView.
+ *
+ * A PacketBuffer carries its own reference count (see
+ * PacketBufferPtr). When the last reference goes away, `recycle()` is
+ * invoked, which by default deletes the PacketBuffer (which then must
+ * have been allocated with `new`). Pools override it to take the
+ * PacketBuffer back.
+ *
+ * The reference count is atomic, unless the library is built with
+ * `EMPOWER_NETWORKLIB_NON_ATOMIC_REFCOUNT` defined (CMake option of
+ * the same name): that saves atomic operations each time a BufferView
+ * is copied, but then BufferView objects referring to the same
+ * PacketBuffer must never be used by different threads.
  */
 class PacketBuffer {
   public:
@@ -27,6 +46,48 @@ class PacketBuffer {
 
     /// @brief Get a pointer to the underlying buffer.
     virtual unsigned char *data() = 0;
+
+    ///@name Reference counting
+    ///@{
+
+    /// @brief Add a reference to this PacketBuffer.
+    void addReference() noexcept {
+#if defined(EMPOWER_NETWORKLIB_NON_ATOMIC_REFCOUNT)
+        ++mReferences;
+#else
+        mReferences.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    /// @brief Remove a reference to this PacketBuffer, recycling it
+    ///        if it was the last one.
+    void removeReference() noexcept {
+#if defined(EMPOWER_NETWORKLIB_NON_ATOMIC_REFCOUNT)
+        if (--mReferences == 0) {
+            recycle();
+        }
+#else
+        if (mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            recycle();
+        }
+#endif
+    }
+
+    /// @brief Return the number of references to this PacketBuffer.
+    std::size_t references() const noexcept { return mReferences; }
+
+    ///@}
+
+  protected:
+    /// @brief Invoked when the last reference goes away.
+    virtual void recycle() noexcept { delete this; }
+
+  private:
+#if defined(EMPOWER_NETWORKLIB_NON_ATOMIC_REFCOUNT)
+    std::size_t mReferences = 0;
+#else
+    std::atomic<std::size_t> mReferences{0};
+#endif
 };
 
 /**
@@ -48,6 +109,103 @@ template <std::size_t s> class PacketBufferArrayBased : public PacketBuffer {
     std::array<unsigned char, s> mData;
 };
 
+/**
+ * @brief A pointer to a PacketBuffer, keeping a reference to it (an
+ *        *intrusive* reference-counted pointer).
+ *
+ * Unlike a ``std::shared_ptr<PacketBuffer>``, it's just one pointer,
+ * and copying it just increments the counter in the PacketBuffer (a
+ * plain increment, when the reference count is not atomic).
+ */
+class PacketBufferPtr {
+  public:
+    ///@name Constructors
+    ///@{
+
+    /// @brief Construct a null PacketBufferPtr.
+    PacketBufferPtr(std::nullptr_t = nullptr) noexcept : mBuffer(nullptr) {}
+
+    /// @brief Construct a PacketBufferPtr referring to the given
+    ///        PacketBuffer (which can be `nullptr`).
+    explicit PacketBufferPtr(PacketBuffer *b) noexcept : mBuffer(b) {
+        if (mBuffer != nullptr) {
+            mBuffer->addReference();
+        }
+    }
+
+    /// @brief Construct a PacketBufferPtr referring to the
+    ///        PacketBuffer managed by the given std::shared_ptr
+    ///        (which keeps managing its lifecycle).
+    ///
+    /// This costs an additional allocation: prefer creating
+    /// PacketBuffer objects with `new`, or better taking them from a
+    /// pool.
+    explicit PacketBufferPtr(std::shared_ptr<PacketBuffer> b);
+
+    ///@}
+
+    ~PacketBufferPtr() { reset(); }
+
+    ///@name Copy semantic
+    ///@{
+    PacketBufferPtr(const PacketBufferPtr &other) noexcept
+        : PacketBufferPtr(other.mBuffer) {}
+
+    PacketBufferPtr &operator=(const PacketBufferPtr &other) noexcept {
+        if (other.mBuffer != nullptr) {
+            other.mBuffer->addReference();
+        }
+
+        reset();
+        mBuffer = other.mBuffer;
+        return *this;
+    }
+    ///@}
+
+    ///@name Move semantic
+    ///@{
+    PacketBufferPtr(PacketBufferPtr &&other) noexcept
+        : mBuffer(other.mBuffer) {
+        other.mBuffer = nullptr;
+    }
+
+    PacketBufferPtr &operator=(PacketBufferPtr &&other) noexcept {
+        if (this != &other) {
+            reset();
+            mBuffer = other.mBuffer;
+            other.mBuffer = nullptr;
+        }
+
+        return *this;
+    }
+    ///@}
+
+    /// @brief Drop the reference (if any), becoming a null
+    ///        PacketBufferPtr.
+    void reset() noexcept {
+        if (mBuffer != nullptr) {
+            mBuffer->removeReference();
+            mBuffer = nullptr;
+        }
+    }
+
+    PacketBuffer *get() const noexcept { return mBuffer; }
+    PacketBuffer *operator->() const noexcept { return mBuffer; }
+    PacketBuffer &operator*() const noexcept { return *mBuffer; }
+    explicit operator bool() const noexcept { return mBuffer != nullptr; }
+
+    bool operator==(std::nullptr_t) const noexcept {
+        return mBuffer == nullptr;
+    }
+
+    bool operator!=(std::nullptr_t) const noexcept {
+        return mBuffer != nullptr;
+    }
+
+  private:
+    PacketBuffer *mBuffer;
+};
+
 // Pre-declaration of class BufferWritableView, for BufferView.copyTo()
 class BufferWritableView;
 
@@ -64,7 +222,7 @@ class BufferWritableView;
  * * nothing at all: in this case we have an empty BufferView;
  *
  * * a PacketBuffer: the BufferView shares ownership of the
- *   PacketBuffer via a ``std::shared_ptr<PacketBuffer>``;
+ *   PacketBuffer via a PacketBufferPtr;
  *
  * * a generic buffer of ``unsigned char`` of arbitrary size,
  *   **non-owned**.  Users must ensure that the underlying buffer exists
@@ -78,8 +236,8 @@ class BufferWritableView;
  *
  * * it's not a template;
  *
- * * it can use a ``std::shared_ptr<PacketBuffer>`` to manage the lifecycle
- *   of the underlying PacketBuffer;
+ * * it can use a PacketBufferPtr to manage the lifecycle of the
+ *   underlying PacketBuffer;
  *
  * * data in the buffer is read-only;
  *
@@ -112,10 +270,21 @@ class BufferView {
     /// PacketBuffer.
     ///
     explicit BufferView(std::shared_ptr<PacketBuffer> b)
-        : mBufferPtr(b), mSize{b ? b->size() : 0}, mPtr{(b != nullptr &&
-                                                         mSize > 0)
-                                                            ? b->data()
-                                                            : nullptr} {}
+        : BufferView(PacketBufferPtr(b)) {}
+
+    /// @brief Constructor from a PacketBufferPtr.
+    ///
+    /// @param b A PacketBufferPtr. When its value is `nullptr`,
+    ///        just construct an empty BufferView.
+    ///
+    /// The resulting BufferView comprises all the underlying
+    /// PacketBuffer.
+    ///
+    explicit BufferView(PacketBufferPtr b)
+        : mBufferPtr(std::move(b)),
+          mSize{mBufferPtr ? mBufferPtr->size() : 0},
+          mPtr{(mBufferPtr != nullptr && mSize > 0) ? mBufferPtr->data()
+                                                    : nullptr} {}
 
     /// @brief Make a BufferView which is attached to some buffer
     ///        allocated externally.
@@ -155,6 +324,17 @@ class BufferView {
     /// @brief Return the BufferView size.
     std::size_t size() const { return mSize; }
 
+    /// @brief Return true if the area starting at `offset` and
+    ///        extending for `length` bytes is entirely within the
+    ///        bounds of this BufferView.
+    ///
+    /// Useful to check bounds once, without throwing, before a series
+    /// of `_nocheck` accesses.
+    bool isWithinBounds(std::size_t offset, std::size_t length) const
+        noexcept {
+        return offset <= mSize && length <= mSize - offset;
+    }
+
     /// @brief Sum the BufferView contents as 16-bit integers.
     ///
     /// Consider the BufferView content as an array of
@@ -166,30 +346,13 @@ class BufferView {
     ///
     /// This method is needed to compute UDP and IPv4 checksums. See
     /// also RFC 1071, 1141 et alt.
+    ///
+    /// Uses SIMD instructions where available (see getSum16At()).
+    /// See also InternetChecksum.
     std::uint32_t getSum16() const {
         // Note: don't bother checking if the BufferView is empty,
         //       as the result will be 0 anyways.
-        const std::size_t evenSize = mSize - (mSize % 2);
-        const unsigned char *p = mPtr;
-        const unsigned char *endP = mPtr + evenSize;
-        std::uint_fast32_t sum1 = 0;
-        std::uint_fast32_t sum2 = 0;
-        std::uint32_t result = 0;
-
-        while (p != endP) {
-            sum1 += *p++;
-            sum2 += *p++;
-        }
-
-        result = sum2 + (sum1 << 8);
-
-        if (mSize != evenSize) {
-            // Add the bits of the last byte as if a 0 was appended
-            // to make the size even.
-            result += (*p) << 8;
-        }
-
-        return result;
+        return static_cast<std::uint32_t>(getSum16At(mPtr, mSize));
     }
 
     /// @brief Get a new BufferView entirely contained within this
@@ -229,12 +392,19 @@ class BufferView {
             err << NETWORKLIB_CURRENT_FUNCTION
                 << ": requested area out of bounds (offset: " << offset
                 << ", buffer size: " << mSize << ")";
-            throw std::out_of_range(err.str());
+            NETWORKLIB_THROW(std::out_of_range, err.str());
         }
 
         return BufferView(mBufferPtr, mPtr + offset, mSize - offset);
     }
 
+    /// @brief Same as `getSub(offset, len)`, but **without** checking
+    ///        bounds (see `isWithinBounds()`).
+    BufferView getSub_nocheck(std::size_t offset, std::size_t len) const
+        noexcept {
+        return BufferView(mBufferPtr, mPtr + offset, len);
+    }
+
     /// @brief Shrink the size of this BufferView to the given new
     ///        size.
     ///
@@ -258,7 +428,7 @@ class BufferView {
             err << NETWORKLIB_CURRENT_FUNCTION
                 << ": requested area out of bounds (requested: " << newSize
                 << ", buffer size: " << mSize << ")";
-            throw std::out_of_range(err.str());
+            NETWORKLIB_THROW(std::out_of_range, err.str());
         }
 
         mSize = newSize;
@@ -339,31 +509,87 @@ class BufferView {
                           *(mPtr + offset + 4), *(mPtr + offset + 5));
     }
 
+    /// @brief Get `count` consecutive values stored in network order
+    ///        from the given offset, in host order, checking
+    ///        bounds (see
+    ///        NetworkLib::getUint32ArrayAt()).
+    ///@{
+    void getUint64ArrayAt(std::size_t offset, std::uint64_t *values,
+                          std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 8);
+        NetworkLib::getUint64ArrayAt(mPtr + offset, values, count);
+    }
+
+    void getUint32ArrayAt(std::size_t offset, std::uint32_t *values,
+                          std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 4);
+        NetworkLib::getUint32ArrayAt(mPtr + offset, values, count);
+    }
+
+    void getUint16ArrayAt(std::size_t offset, std::uint16_t *values,
+                          std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 2);
+        NetworkLib::getUint16ArrayAt(mPtr + offset, values, count);
+    }
+    ///@}
+
     /// @brief Get a zero-terminated string of char, stored at the
     ///        given offset, checking bounds.
     std::string getCStringAt(std::size_t offset) const {
+        return getCStringViewAt(offset).str();
+    }
+
+    /// @brief Get a StringView referring to a zero-terminated string
+    ///        of char stored at the given offset (excluding the
+    ///        terminating NUL), checking bounds.
+    ///
+    /// No copy is made: the StringView is valid as long as the
+    /// underlying buffer is unchanged.
+    StringView getCStringViewAt(std::size_t offset) const {
 
         // First check that the offset is within bounds
         throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset, 0);
 
         // Then check that the string is entirely within bounds.
-        auto end = offset;
-
-        while ((end < mSize) && (*(mPtr + end) != 0)) {
-            ++end;
-        }
+        const void *nul = std::memchr(mPtr + offset, 0, mSize - offset);
 
-        if (end == mSize) {
+        if (nul == nullptr) {
             /// We reached the end of the buffer without finding the
             /// terminating NUL.
             std::ostringstream err;
             err << NETWORKLIB_CURRENT_FUNCTION
                 << ": string not zero-terminated within bounds (offset: "
                 << offset << ", buffer size: " << mSize << ")";
-            throw std::runtime_error(err.str());
+            NETWORKLIB_THROW(std::runtime_error, err.str());
         }
 
-        return std::string(reinterpret_cast<const char *>(mPtr + offset));
+        return StringView(reinterpret_cast<const char *>(mPtr + offset),
+                          static_cast<const unsigned char *>(nul) -
+                              (mPtr + offset));
+    }
+
+    /// @brief Same as `getCStringViewAt()`, but return
+    ///        ErrorCode::OUT_OF_BOUNDS instead of throwing if the
+    ///        string isn't zero-terminated within bounds.
+    Status getCStringViewAt_nothrow(std::size_t offset,
+                                    StringView &view) const noexcept {
+        if (offset >= mSize) {
+            return ErrorCode::OUT_OF_BOUNDS;
+        }
+
+        const void *nul = std::memchr(mPtr + offset, 0, mSize - offset);
+
+        if (nul == nullptr) {
+            return ErrorCode::OUT_OF_BOUNDS;
+        }
+
+        view = StringView(reinterpret_cast<const char *>(mPtr + offset),
+                          static_cast<const unsigned char *>(nul) -
+                              (mPtr + offset));
+        return Status();
     }
 
     ///@}
@@ -436,6 +662,27 @@ class BufferView {
                           *(mPtr + offset + 4), *(mPtr + offset + 5));
     }
 
+    /// @brief Get `count` consecutive values stored in network order
+    ///        from the given offset, in host order, without
+    ///        checking bounds (see
+    ///        NetworkLib::getUint32ArrayAt()).
+    ///@{
+    void getUint64ArrayAt_nocheck(std::size_t offset, std::uint64_t *values,
+                                  std::size_t count) const noexcept {
+        NetworkLib::getUint64ArrayAt(mPtr + offset, values, count);
+    }
+
+    void getUint32ArrayAt_nocheck(std::size_t offset, std::uint32_t *values,
+                                  std::size_t count) const noexcept {
+        NetworkLib::getUint32ArrayAt(mPtr + offset, values, count);
+    }
+
+    void getUint16ArrayAt_nocheck(std::size_t offset, std::uint16_t *values,
+                                  std::size_t count) const noexcept {
+        NetworkLib::getUint16ArrayAt(mPtr + offset, values, count);
+    }
+    ///@}
+
     ///@}
 
     ///@name Other utilities.
@@ -480,7 +727,7 @@ class BufferView {
             err << method
                 << ": requested area out of bounds (offset: " << offset
                 << ", len: " << length << ", buffer size: " << mSize << ")";
-            throw std::runtime_error(err.str());
+            NETWORKLIB_THROW(std::runtime_error, err.str());
         }
 #else
         (void)method;
@@ -493,7 +740,7 @@ class BufferView {
 
   protected:
     /// @brief Points either to `nullptr` or to the underlying PacketBuffer
-    std::shared_ptr<PacketBuffer> mBufferPtr;
+    PacketBufferPtr mBufferPtr;
 
     /// @brief Size of the view
     std::size_t mSize;
@@ -502,9 +749,10 @@ class BufferView {
     unsigned char *mPtr;
 
     /// @brief Constructor to be used by specializations.
-    explicit BufferView(std::shared_ptr<PacketBuffer> b, unsigned char *ptr,
+    explicit BufferView(PacketBufferPtr b, unsigned char *ptr,
                         std::size_t size)
-        : mBufferPtr(b), mSize(size), mPtr{(size > 0) ? ptr : nullptr} {}
+        : mBufferPtr(std::move(b)), mSize(size), mPtr{(size > 0) ? ptr
+                                                                 : nullptr} {}
 };
 
 /**
@@ -525,12 +773,12 @@ class BufferView {
  * pointing to a free buffer:
  *
  * 1. get one from a PacketBufferPool (or from a
- *    PacketBufferSizedPool). Its std::shared_ptr takes care of
+ *    PacketBufferSizedPool). Its PacketBufferPtr takes care of
  *    returning the underlying PacketBuffer to the buffer pool when
  *    it's not needed any more.
  *
  * 2. allocate a new one on the heap via static method
- *    `makeEthBuffer()`.  Its std::shared_ptr takes care of freeing
+ *    `makeEthBuffer()`.  Its PacketBufferPtr takes care of freeing
  *    the underlying PacketBuffer when it's not needed any more.
  *    Please use this sparingly.
  *
@@ -564,6 +812,14 @@ class BufferWritableView : public BufferView {
     ///
     /// When the shared pointer is null, construct an empty BufferWritableView
     explicit BufferWritableView(std::shared_ptr<PacketBuffer> b)
+        : BufferWritableView(PacketBufferPtr(b)) {}
+
+    /// Constructor from a PacketBufferPtr.
+    ///
+    /// The BufferWritableView comprises all the PacketBuffer.
+    ///
+    /// When the pointer is null, construct an empty BufferWritableView
+    explicit BufferWritableView(PacketBufferPtr b)
         : BufferView(b, (b ? b->data() : nullptr), (b ? b->size() : 0)) {}
 
     ///@}
@@ -589,9 +845,8 @@ class BufferWritableView : public BufferView {
     /// @brief Allocate on the heap a BufferWritableView suitable for
     ///        storing a Ethernet Frame.
     static BufferWritableView makeEthBuffer() {
-        auto pd = std::make_shared<PacketBufferArrayBased<66500>>();
-        auto pb = std::static_pointer_cast<PacketBuffer>(pd);
-        return BufferWritableView(pb);
+        return BufferWritableView(
+            PacketBufferPtr(new PacketBufferArrayBased<66500>()));
     }
 
     ///@}
@@ -654,12 +909,19 @@ class BufferWritableView : public BufferView {
             err << NETWORKLIB_CURRENT_FUNCTION
                 << ": requested area out of bounds (offset: " << offset
                 << ", buffer size: " << mSize << ")";
-            throw std::runtime_error(err.str());
+            NETWORKLIB_THROW(std::runtime_error, err.str());
         }
 
         return BufferWritableView(mBufferPtr, mPtr + offset, mSize - offset);
     }
 
+    /// @brief Same as `getSub(offset, len)`, but **without** checking
+    ///        bounds (see `isWithinBounds()`).
+    BufferWritableView getSub_nocheck(std::size_t offset,
+                                      std::size_t len) const noexcept {
+        return BufferWritableView(mBufferPtr, mPtr + offset, len);
+    }
+
     ///@name Data setters (checking bounds)
     ///
     /// These methods provide write access to 64, 32, 16 and 8 bit
@@ -747,6 +1009,39 @@ class BufferWritableView : public BufferView {
         return *this;
     }
 
+    /// @brief Store `count` consecutive values given in host order
+    ///        from the given offset, in network order, checking
+    ///        bounds (see
+    ///        NetworkLib::setUint32ArrayAt()).
+    ///@{
+    const BufferWritableView &
+    setUint64ArrayAt(std::size_t offset, const std::uint64_t *values,
+                     std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 8);
+        NetworkLib::setUint64ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+
+    const BufferWritableView &
+    setUint32ArrayAt(std::size_t offset, const std::uint32_t *values,
+                     std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 4);
+        NetworkLib::setUint32ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+
+    const BufferWritableView &
+    setUint16ArrayAt(std::size_t offset, const std::uint16_t *values,
+                     std::size_t count) const {
+        throwExceptionIfOutOfBounds(NETWORKLIB_CURRENT_FUNCTION, offset,
+                                    count * 2);
+        NetworkLib::setUint16ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+    ///@}
+
     /// @brief Set a zero-terminated string at the given offset,
     ///        checking bounds.
     const BufferWritableView &setCStringAt(std::size_t offset,
@@ -850,13 +1145,389 @@ class BufferWritableView : public BufferView {
         return *this;
     }
 
+    /// Set a zero-terminated string at the given offset (which must
+    /// have room for `str.size() + 1` bytes)
+    const BufferWritableView &setCStringAt_nocheck(std::size_t offset,
+                                                   const std::string &str) const
+        noexcept {
+        auto x = std::copy(str.begin(), str.end(),
+                           reinterpret_cast<char *>(mPtr + offset));
+        *x = '\0';
+        return *this;
+    }
+
+    /// @brief Store `count` consecutive values given in host order
+    ///        from the given offset, in network order, without
+    ///        checking bounds (see
+    ///        NetworkLib::setUint32ArrayAt()).
+    ///@{
+    const BufferWritableView &
+    setUint64ArrayAt_nocheck(std::size_t offset, const std::uint64_t *values,
+                             std::size_t count) const noexcept {
+        NetworkLib::setUint64ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+
+    const BufferWritableView &
+    setUint32ArrayAt_nocheck(std::size_t offset, const std::uint32_t *values,
+                             std::size_t count) const noexcept {
+        NetworkLib::setUint32ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+
+    const BufferWritableView &
+    setUint16ArrayAt_nocheck(std::size_t offset, const std::uint16_t *values,
+                             std::size_t count) const noexcept {
+        NetworkLib::setUint16ArrayAt(mPtr + offset, values, count);
+        return *this;
+    }
+    ///@}
+
     ///@}
 
   protected:
     /// @brief An ad-hoc constructor
-    explicit BufferWritableView(std::shared_ptr<PacketBuffer> b,
-                                unsigned char *ptr, std::size_t size)
-        : BufferView(b, ptr, size) {}
+    explicit BufferWritableView(PacketBufferPtr b, unsigned char *ptr,
+                                std::size_t size)
+        : BufferView(std::move(b), ptr, size) {}
+};
+
+/**
+ * @brief A fixed-size area of a BufferView whose bounds are checked
+ *        once, when it's built.
+ *
+ * Its getters take the offset as a template argument, and check at
+ * compile time that the accessed field is within the `Size` bytes of
+ * the region, so they never check bounds at run time. This way a
+ * decoder checks bounds once per header (or once per TLV), instead
+ * of once per field via the checking getters of BufferView:
+ *
+ *     const CheckedRegion<TLVHeader::headerLength> header(buffer, offset);
+ *     auto type = header.getUint16At<TLVHeader::typeOffset>();
+ *     auto length = header.getUint16At<TLVHeader::lengthOffset>();
+ *
+ * A CheckedRegion does not keep the underlying buffer alive: it's
+ * meant to be used on the stack, while the BufferView it was built
+ * from is still around.
+ *
+ * @param Size The size in bytes of the region
+ */
+template <std::size_t Size> class CheckedRegion {
+  public:
+    /// @brief Construct a region of the given BufferView starting at
+    ///        the given offset, throwing std::out_of_range if it's
+    ///        not entirely within bounds.
+    CheckedRegion(const BufferView &view, std::size_t offset = 0)
+        : mPtr{view.getUnderlyingBufferPtr()} {
+        check(view, offset).raise(NETWORKLIB_CURRENT_FUNCTION);
+        mPtr += offset;
+    }
+
+    /// @brief Check if a region of the given BufferView starting at
+    ///        the given offset would be entirely within bounds.
+    static Status check(const BufferView &view, std::size_t offset) noexcept {
+        return view.isWithinBounds(offset, Size) ? Status()
+                                                 : ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    /// @brief Construct a region **without** checking bounds (e.g.
+    ///        after calling `check()`).
+    static CheckedRegion make_nocheck(const BufferView &view,
+                                      std::size_t offset) noexcept {
+        return CheckedRegion(view.getUnderlyingBufferPtr() + offset);
+    }
+
+    /// @brief Return the size of the region.
+    static constexpr std::size_t size() noexcept { return Size; }
+
+    ///@name Data getters
+    ///
+    /// Get the value of 64, 32, 16 and 8 bit integers (in **network
+    /// order**) and other data types stored at the given offset
+    /// within the region.
+    ///
+    ///@{
+
+    template <std::size_t offset> std::uint64_t getUint64At() const noexcept {
+        static_assert(offset + 8 <= Size, "field out of the region");
+        return NetworkLib::getUint64At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::int64_t getInt64At() const noexcept {
+        static_assert(offset + 8 <= Size, "field out of the region");
+        return NetworkLib::getInt64At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::uint32_t getUint32At() const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        return NetworkLib::getUint32At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::int32_t getInt32At() const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        return NetworkLib::getInt32At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::uint16_t getUint16At() const noexcept {
+        static_assert(offset + 2 <= Size, "field out of the region");
+        return NetworkLib::getUint16At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::int16_t getInt16At() const noexcept {
+        static_assert(offset + 2 <= Size, "field out of the region");
+        return NetworkLib::getInt16At(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::uint8_t getUint8At() const noexcept {
+        static_assert(offset + 1 <= Size, "field out of the region");
+        return *(mPtr + offset);
+    }
+
+    template <std::size_t offset> std::int8_t getInt8At() const noexcept {
+        static_assert(offset + 1 <= Size, "field out of the region");
+        return *(mPtr + offset);
+    }
+
+    template <std::size_t offset>
+    IPv4Address getIPv4AddressAt() const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        return IPv4Address(*(mPtr + offset), *(mPtr + offset + 1),
+                           *(mPtr + offset + 2), *(mPtr + offset + 3));
+    }
+
+    template <std::size_t offset> MACAddress getMACAddressAt() const noexcept {
+        static_assert(offset + 6 <= Size, "field out of the region");
+        return MACAddress(*(mPtr + offset), *(mPtr + offset + 1),
+                          *(mPtr + offset + 2), *(mPtr + offset + 3),
+                          *(mPtr + offset + 4), *(mPtr + offset + 5));
+    }
+
+    ///@}
+
+  protected:
+    const unsigned char *mPtr;
+
+    explicit CheckedRegion(const unsigned char *ptr) noexcept : mPtr{ptr} {}
+};
+
+/**
+ * @brief A CheckedRegion of a BufferWritableView, with setters too.
+ *
+ * @param Size The size in bytes of the region
+ */
+template <std::size_t Size>
+class CheckedWritableRegion : public CheckedRegion<Size> {
+  public:
+    /// @brief Construct a region of the given BufferWritableView
+    ///        starting at the given offset, throwing
+    ///        std::out_of_range if it's not entirely within bounds.
+    CheckedWritableRegion(const BufferWritableView &view,
+                          std::size_t offset = 0)
+        : CheckedRegion<Size>(view, offset) {}
+
+    /// @brief Construct a region **without** checking bounds (e.g.
+    ///        after calling `check()`).
+    static CheckedWritableRegion make_nocheck(const BufferWritableView &view,
+                                              std::size_t offset) noexcept {
+        return CheckedWritableRegion(view.getUnderlyingWritableBufferPtr() +
+                                     offset);
+    }
+
+    ///@name Data setters
+    ///
+    /// Set the value of 64, 32, 16 and 8 bit integers (in **network
+    /// order**) and other data types at the given offset within the
+    /// region.
+    ///
+    ///@{
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setUint64At(std::uint64_t v) const noexcept {
+        static_assert(offset + 8 <= Size, "field out of the region");
+        NetworkLib::setUint64At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setInt64At(std::int64_t v) const noexcept {
+        static_assert(offset + 8 <= Size, "field out of the region");
+        NetworkLib::setInt64At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setUint32At(std::uint32_t v) const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        NetworkLib::setUint32At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setInt32At(std::int32_t v) const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        NetworkLib::setInt32At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setUint16At(std::uint16_t v) const noexcept {
+        static_assert(offset + 2 <= Size, "field out of the region");
+        NetworkLib::setUint16At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setInt16At(std::int16_t v) const noexcept {
+        static_assert(offset + 2 <= Size, "field out of the region");
+        NetworkLib::setInt16At(ptr() + offset, v);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setUint8At(std::uint8_t v) const noexcept {
+        static_assert(offset + 1 <= Size, "field out of the region");
+        *(ptr() + offset) = v;
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &setInt8At(std::int8_t v) const noexcept {
+        static_assert(offset + 1 <= Size, "field out of the region");
+        *(ptr() + offset) = v;
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &
+    setIPv4AddressAt(const IPv4Address &v) const noexcept {
+        static_assert(offset + 4 <= Size, "field out of the region");
+        std::copy(v.array().begin(), v.array().end(), ptr() + offset);
+        return *this;
+    }
+
+    template <std::size_t offset>
+    const CheckedWritableRegion &
+    setMACAddressAt(const MACAddress &v) const noexcept {
+        static_assert(offset + 6 <= Size, "field out of the region");
+        std::copy(v.array().begin(), v.array().end(), ptr() + offset);
+        return *this;
+    }
+
+    ///@}
+
+  private:
+    explicit CheckedWritableRegion(unsigned char *ptr) noexcept
+        : CheckedRegion<Size>(ptr) {}
+
+    // The region was built from a BufferWritableView, so it's fine to
+    // cast away the const.
+    unsigned char *ptr() const noexcept {
+        return const_cast<unsigned char *>(this->mPtr);
+    }
+};
+
+/// @brief A sequence of BufferView objects (*segments*) which, taken
+///        in order, make up a single piece of data (e.g. a message
+///        to be written out with a single `writev(2)`).
+using BufferViewSegments = std::vector<BufferView>;
+
+/**
+ * @brief An Internet checksum (RFC 1071) computed incrementally.
+ *
+ * The data can be added in pieces (e.g. the BufferViewSegments of a
+ * message), of any length, as if they were a single contiguous area.
+ *
+ * Once the checksum is computed, it can be updated after patching
+ * some bytes of the data (e.g. re-stamping the sequence number in a
+ * common header) without scanning the data again, as described by
+ * RFC 1624.
+ *
+ * Example:
+ *
+ *     InternetChecksum cs(segments);
+ *     header.setUint32At(offset, newSequence);
+ *     cs.replaceUint32(offset, oldSequence, newSequence);
+ *     ... cs.checksum() ...
+ */
+class InternetChecksum {
+  public:
+    /// @brief Default constructor: no data.
+    InternetChecksum() noexcept = default;
+
+    /// @brief Construct the checksum of the given data.
+    explicit InternetChecksum(const BufferView &data) noexcept {
+        add(data);
+    }
+
+    /// @brief Construct the checksum of the given segments.
+    explicit InternetChecksum(const BufferViewSegments &segments) noexcept {
+        add(segments);
+    }
+
+    /// @brief Append data to what was already summed.
+    InternetChecksum &add(const BufferView &data) noexcept;
+
+    /// @brief Append the segments, in order, to what was already
+    ///        summed.
+    InternetChecksum &add(const BufferViewSegments &segments) noexcept;
+
+    /// @brief Update the checksum after replacing `oldData` with
+    ///        `newData` (of the same size) at the given offset of the
+    ///        summed data, throwing std::invalid_argument if the sizes
+    ///        differ.
+    InternetChecksum &replace(std::size_t offset, const BufferView &oldData,
+                              const BufferView &newData);
+
+    /// @brief Update the checksum after replacing `size` bytes at the
+    ///        given offset of the summed data.
+    InternetChecksum &replace(std::size_t offset, const void *oldData,
+                              const void *newData, std::size_t size) noexcept;
+
+    ///@name Update the checksum after replacing an integer stored in
+    ///      network order at the given offset of the summed data.
+    ///@{
+    InternetChecksum &replaceUint16(std::size_t offset, std::uint16_t oldValue,
+                                    std::uint16_t newValue) noexcept;
+    InternetChecksum &replaceUint32(std::size_t offset, std::uint32_t oldValue,
+                                    std::uint32_t newValue) noexcept;
+    InternetChecksum &replaceUint64(std::size_t offset, std::uint64_t oldValue,
+                                    std::uint64_t newValue) noexcept;
+    ///@}
+
+    /// @brief Return how many bytes were summed.
+    std::size_t length() const noexcept { return mLength; }
+
+    /// @brief Return the 16-bit one's complement sum of the data.
+    std::uint16_t sum() const noexcept {
+        std::uint64_t s = mSum;
+
+        while ((s >> 16) != 0) {
+            s = (s & 0xFFFF) + (s >> 16);
+        }
+
+        return static_cast<std::uint16_t>(s);
+    }
+
+    /// @brief Return the checksum (the one's complement of `sum()`).
+    std::uint16_t checksum() const noexcept {
+        return static_cast<std::uint16_t>(~sum());
+    }
+
+    /// @brief Forget all the data summed so far.
+    void reset() noexcept {
+        mSum = 0;
+        mLength = 0;
+    }
+
+  private:
+    // Not folded, but it can't overflow in practice, as we add at
+    // most 0x1FFFE at a time.
+    std::uint64_t mSum = 0;
+    std::size_t mLength = 0;
+
+    // Add the sum of the 16-bit words of an area starting at the
+    // given offset of the summed data.
+    void addAt(std::size_t offset, std::uint64_t sum16) noexcept;
 };
 
 /**
@@ -879,6 +1550,7 @@ template <std::size_t s> class PacketBufferSizedPool {
         // The pool already contains its initial capacity.  Let's
         // fix the free deque, just as growBy() would do.
         for (auto &i : mPool) {
+            i.pool = this;
             mFree.push_back(&i);
         }
     }
@@ -906,40 +1578,45 @@ template <std::size_t s> class PacketBufferSizedPool {
     ///@}
 
   private:
-    using PacketBufferImplType = PacketBufferArrayBased<s>;
+    // A buffer of the pool, which goes back to the pool when the last
+    // reference to it goes away.
+    struct PacketBufferImplType : public PacketBufferArrayBased<s> {
+        PacketBufferSizedPool *pool = nullptr;
+
+      protected:
+        void recycle() noexcept override { pool->releaseToPool(this); }
+    };
 
     std::deque<PacketBufferImplType *> mFree;
     std::deque<PacketBufferImplType> mPool;
 
     void growBy(std::size_t size) {
+        Metrics::add(Counter::POOL_GROWTHS);
+        Metrics::add(Counter::POOL_BUFFERS_ADDED, size);
+
         for (std::size_t i = 0; i < size; ++i) {
             // Add a new free buffer
             mPool.emplace_back();
+            mPool.back().pool = this;
             mFree.push_back(&(mPool.back()));
         }
     }
 
-    void releaseToPool(PacketBuffer *p) {
-        auto *p1 = dynamic_cast<PacketBufferImplType *>(p);
-
-        if (p1 == nullptr) {
-            // Note: this should be completely impossible, as
-            //       this method is private, thus the release of
-            //       buffers can happen only through our
-            //       custom deleter;
-            return;
-        }
-
+    void releaseToPool(PacketBufferImplType *p) noexcept {
+#if NETWORKLIB_HAS_EXCEPTIONS
         try {
-            mFree.push_back(p1);
+            mFree.push_back(p);
         } catch (...) {
             // Don't allow exceptions to propagate, as that would
             // result in a call to std::terminate().
         }
+#else
+        mFree.push_back(p);
+#endif
     }
 
     // Get a PacketBuffer from the pool
-    std::shared_ptr<PacketBuffer> getPacketBuffer() {
+    PacketBufferPtr getPacketBuffer() {
         if (mFree.empty()) {
             growBy(1);
         }
@@ -948,10 +1625,9 @@ template <std::size_t s> class PacketBufferSizedPool {
         PacketBuffer *p = mFree.back();
         mFree.pop_back();
 
-        // Return a std::shared_ptr with a custom deleter
-        // which returns the buffer to the pool
-        return std::shared_ptr<PacketBuffer>(
-            p, [this](PacketBuffer *p) { this->releaseToPool(p); });
+        // When the last reference goes away, the buffer goes back to
+        // the pool (see PacketBufferImplType::recycle()).
+        return PacketBufferPtr(p);
     }
 };
 
@@ -963,6 +1639,306 @@ template <std::size_t s> class PacketBufferSizedPool {
 /// for an Ethernet header which could have 802.1Q tags.
 using PacketBufferPool = PacketBufferSizedPool<66500>;
 
+/**
+ * @brief A thread-safe pool of PacketBuffer objects of the given size.
+ *
+ * Like PacketBufferSizedPool, with the same `getBufferWritableView()`
+ * interface, but buffers can be taken from the pool and released to
+ * the pool by any thread (a buffer can be released by a thread other
+ * than the one which took it).
+ *
+ * The free list is a lock-free stack. Its head is an index into the
+ * pool plus a tag, updated together by a single compare-and-swap (so
+ * that a buffer taken and released in the meantime by another thread
+ * can't be mistaken for the one we saw). A mutex is used only when the
+ * pool grows.
+ *
+ * Each buffer knows which pool it belongs to, so releasing a buffer
+ * costs just a push on the free list (no `dynamic_cast`, no
+ * allocations). Note that with non-atomic reference counts (see
+ * PacketBuffer) a buffer can still be released by a different thread,
+ * but all the BufferView objects referring to it must be used by the
+ * same thread at any given time.
+ *
+ * The pool must outlive all the BufferWritableView and BufferView
+ * objects referring to its buffers.
+ *
+ * @param s The desired size of the PacketBuffer
+ */
+template <std::size_t s> class ConcurrentPacketBufferSizedPool {
+  public:
+    /// @brief Default constructor
+    ///
+    /// @param initial_capacity The initial capacity of the pool. The
+    ///        pool grows by as many buffers each time it runs out of
+    ///        free ones.
+    ConcurrentPacketBufferSizedPool(std::size_t initial_capacity = 16)
+        : mChunkSize(initial_capacity > 0 ? initial_capacity : 1) {
+        for (auto &c : mChunks) {
+            c.store(nullptr, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(mGrowMutex);
+        releaseToPool(growBy());
+    }
+
+    ///@name No copy semantic
+    ///@{
+    ConcurrentPacketBufferSizedPool(const ConcurrentPacketBufferSizedPool &) =
+        delete;
+    ConcurrentPacketBufferSizedPool &
+    operator=(const ConcurrentPacketBufferSizedPool &) = delete;
+    ///@}
+
+    /// @brief Get a BufferWritableView from the pool.
+    ///
+    /// Release to the pool is automatic when all the
+    /// BufferWritableView and BufferView objects referring to the
+    /// PacketBuffer are destroyed.
+    BufferWritableView getBufferWritableView() {
+        return BufferWritableView(getPacketBuffer());
+    }
+
+    ///@name Info on the pool
+    ///@{
+
+    // @brief Return how many PacketBuffer instances there are
+    //        currently in the pool (both busy and free).
+    std::size_t capacity() const {
+        return mCapacity.load(std::memory_order_relaxed);
+    }
+
+    // @brief Return how many free PacketBuffer instances there are
+    //        currently in the pool (just a hint, as other threads can
+    //        change it at any time).
+    std::size_t free_count() const {
+        return mFreeCount.load(std::memory_order_relaxed);
+    }
+
+    ///@}
+
+  private:
+    // A buffer of the pool, linked in the free list, which goes back
+    // to the pool when the last reference to it goes away.
+    struct Node : public PacketBufferArrayBased<s> {
+        ConcurrentPacketBufferSizedPool *pool = nullptr;
+        std::uint32_t index = 0;
+
+        // Index + 1 of the next free Node, or 0 at the end of the list.
+        std::atomic<std::uint32_t> next{0};
+
+      protected:
+        void recycle() noexcept override { pool->releaseToPool(this); }
+    };
+
+    // The maximum number of times the pool can grow. Beyond that,
+    // buffers are just allocated on the heap.
+    static const std::size_t maxChunks = 256;
+
+    const std::size_t mChunkSize;
+
+    // The head of the free list: the index + 1 of the first free
+    // Node (or 0 if there's none) in the lower 32 bits, a tag counting
+    // the updates in the upper 32 bits.
+    std::atomic<std::uint64_t> mFreeHead{0};
+
+    std::atomic<std::size_t> mFreeCount{0};
+    std::atomic<std::size_t> mCapacity{0};
+
+    // Chunks of Node objects (only ever added, never moved or
+    // removed while the pool exists).
+    std::atomic<Node *> mChunks[maxChunks];
+    std::size_t mChunkCount = 0;
+    std::mutex mGrowMutex;
+    std::deque<std::unique_ptr<Node[]>> mChunkStorage;
+
+    static std::uint64_t makeHead(std::uint64_t tag, std::uint32_t next) {
+        return (tag << 32) | next;
+    }
+
+    Node *nodeAt(std::uint32_t index) const {
+        Node *chunk =
+            mChunks[index / mChunkSize].load(std::memory_order_acquire);
+        return &chunk[index % mChunkSize];
+    }
+
+    // Push a Node on the free list.
+    void releaseToPool(Node *n) {
+        std::uint64_t head = mFreeHead.load(std::memory_order_relaxed);
+
+        do {
+            n->next.store(static_cast<std::uint32_t>(head),
+                          std::memory_order_relaxed);
+        } while (!mFreeHead.compare_exchange_weak(
+            head, makeHead((head >> 32) + 1, n->index + 1),
+            std::memory_order_release, std::memory_order_relaxed));
+
+        mFreeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Pop a Node from the free list, or return nullptr if there's none.
+    Node *tryAcquire() {
+        std::uint64_t head = mFreeHead.load(std::memory_order_acquire);
+
+        for (;;) {
+            const std::uint32_t first = static_cast<std::uint32_t>(head);
+
+            if (first == 0) {
+                return nullptr;
+            }
+
+            // Note: the Node could be taken by another thread in the
+            //       meantime, in which case its `next` is bogus, but the
+            //       tag makes the compare-and-swap fail.
+            Node *n = nodeAt(first - 1);
+            const std::uint32_t next = n->next.load(std::memory_order_relaxed);
+
+            if (mFreeHead.compare_exchange_weak(
+                    head, makeHead((head >> 32) + 1, next),
+                    std::memory_order_acquire, std::memory_order_acquire)) {
+                mFreeCount.fetch_sub(1, std::memory_order_relaxed);
+                return n;
+            }
+        }
+    }
+
+    // Add a new chunk of Node objects, keep one and put the others in
+    // the free list. Return nullptr if the pool can't grow any more.
+    // Must be called with mGrowMutex locked.
+    Node *growBy() {
+        if (mChunkCount == maxChunks) {
+            return nullptr;
+        }
+
+        std::unique_ptr<Node[]> chunk(new Node[mChunkSize]);
+
+        for (std::size_t i = 0; i < mChunkSize; ++i) {
+            chunk[i].pool = this;
+            chunk[i].index =
+                static_cast<std::uint32_t>(mChunkCount * mChunkSize + i);
+        }
+
+        Node *nodes = chunk.get();
+        mChunkStorage.push_back(std::move(chunk));
+        mChunks[mChunkCount].store(nodes, std::memory_order_release);
+        ++mChunkCount;
+        mCapacity.fetch_add(mChunkSize, std::memory_order_relaxed);
+
+        Metrics::add(Counter::POOL_GROWTHS);
+        Metrics::add(Counter::POOL_BUFFERS_ADDED, mChunkSize);
+
+        for (std::size_t i = 1; i < mChunkSize; ++i) {
+            releaseToPool(&nodes[i]);
+        }
+
+        return &nodes[0];
+    }
+
+    // Get a PacketBuffer from the pool
+    PacketBufferPtr getPacketBuffer() {
+        Node *n = tryAcquire();
+
+        if (n == nullptr) {
+            std::lock_guard<std::mutex> lock(mGrowMutex);
+
+            // Some other thread could have grown the pool meanwhile
+            n = tryAcquire();
+
+            if (n == nullptr) {
+                n = growBy();
+            }
+        }
+
+        if (n == nullptr) {
+            // The pool is as large as it can be: fall back to the heap.
+            return PacketBufferPtr(new PacketBufferArrayBased<s>());
+        }
+
+        return PacketBufferPtr(n);
+    }
+};
+
+template <std::size_t s>
+const std::size_t ConcurrentPacketBufferSizedPool<s>::maxChunks;
+
+/// @brief A type for a thread-safe pool of PacketBuffer objects sized
+///        for common needs (see PacketBufferPool).
+using ConcurrentPacketBufferPool = ConcurrentPacketBufferSizedPool<66500>;
+
+/**
+ * @brief A thread-safe arena of PacketBuffer objects with
+ *        power-of-two size classes, from `minSize` (256 bytes) to
+ *        `maxSize` (64KiB).
+ *
+ * A request for a buffer is served by the smallest size class which
+ * is large enough, so small messages get small buffers. Each size
+ * class is a ConcurrentPacketBufferSizedPool growing by slabs of about
+ * 16KiB (at least two buffers).
+ *
+ * The arena must outlive all the BufferWritableView and BufferView
+ * objects referring to its buffers.
+ */
+class PacketBufferArena {
+  public:
+    /// @brief The size of the smallest size class.
+    static const std::size_t minSize = 256;
+
+    /// @brief The size of the largest size class.
+    static const std::size_t maxSize = 65536;
+
+    /// @brief The number of size classes.
+    static const std::size_t sizeClassCount = 9;
+
+    PacketBufferArena() {}
+
+    ///@name No copy semantic
+    ///@{
+    PacketBufferArena(const PacketBufferArena &) = delete;
+    PacketBufferArena &operator=(const PacketBufferArena &) = delete;
+    ///@}
+
+    /// @brief Return the index of the size class used for buffers of
+    ///        the given size. Throws exceptions if the size is larger
+    ///        than `maxSize`.
+    static std::size_t sizeClass(std::size_t size);
+
+    /// @brief Return the size of the buffers of the given size class.
+    static std::size_t sizeClassSize(std::size_t sizeClass) {
+        return minSize << sizeClass;
+    }
+
+    /// @brief Get a BufferWritableView with at least the given size
+    ///        (its size is the one of the size class).
+    ///
+    /// Release to the arena is automatic when all the
+    /// BufferWritableView and BufferView objects referring to the
+    /// PacketBuffer are destroyed. Throws exceptions if the size is
+    /// larger than `maxSize`.
+    BufferWritableView getBufferWritableView(std::size_t size);
+
+    /// @brief Get a BufferWritableView for a whole message, given a
+    ///        BufferView on its preamble (at least the first
+    ///        `lengthOffset + 4` bytes), which holds the message
+    ///        length as a 32 bit integer at `lengthOffset`.
+    ///
+    /// The BufferWritableView is shrunk to the message length.
+    BufferWritableView getBufferForMessage(const BufferView &preamble,
+                                           std::size_t lengthOffset);
+
+  private:
+    // One pool per size class, each one starting (and growing) with
+    // about 16KiB worth of buffers.
+    ConcurrentPacketBufferSizedPool<256> mPool256{64};
+    ConcurrentPacketBufferSizedPool<512> mPool512{32};
+    ConcurrentPacketBufferSizedPool<1024> mPool1K{16};
+    ConcurrentPacketBufferSizedPool<2048> mPool2K{8};
+    ConcurrentPacketBufferSizedPool<4096> mPool4K{4};
+    ConcurrentPacketBufferSizedPool<8192> mPool8K{2};
+    ConcurrentPacketBufferSizedPool<16384> mPool16K{2};
+    ConcurrentPacketBufferSizedPool<32768> mPool32K{2};
+    ConcurrentPacketBufferSizedPool<65536> mPool64K{2};
+};
+
 } // namespace NetworkLib
 } // namespace Empower
 
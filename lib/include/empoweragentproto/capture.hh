@@ -0,0 +1,231 @@
+#ifndef EMPOWER_AGENT_CAPTURE_HH
+#define EMPOWER_AGENT_CAPTURE_HH
+
+#include <empoweragentproto/networklib.hh>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief The direction of a captured message.
+ */
+enum class CaptureDirection : std::uint8_t {
+    /// @brief Received from the peer (as returned by
+    ///        `IO::readMessage()`, or handed out to the callbacks).
+    RECEIVED = 0,
+
+    /// @brief Sent to the peer (as passed to `IO::writeMessage()`,
+    ///        `IO::sendMessage()` or `IO::queueMessage()`).
+    SENT = 1
+};
+
+/**
+ * @brief Appends messages, with their timestamp, to a capture file
+ *        (see `IO::capture()`), to be read back by CaptureReader.
+ *
+ * The file starts with a 16 bytes header (the "EMPCAP01" magic, and
+ * the version of the format), followed by the records. Each record is
+ * a 24 bytes header (the timestamp in nanoseconds since the epoch of
+ * std::chrono::system_clock, the connection, the size of the message
+ * and its direction, all in host byte order), followed by the message
+ * as it went over the wire, padded to 8 bytes.
+ *
+ * The records are buffered, and written out when the buffer is full
+ * or on `flush()` (and by the destructor), so a crash may leave the
+ * last one cut short: readers then stop there (see
+ * `CaptureReader::truncated()`).
+ *
+ * Not thread safe.
+ */
+class CaptureWriter {
+  public:
+    /// @brief Open the given file for appending to it, creating it if
+    ///        needed. Throws std::runtime_error on errors (e.g. if the
+    ///        file isn't empty, and isn't a capture file).
+    ///
+    /// A last record cut short (or corrupted) is dropped first (see
+    /// `CaptureReader::truncated()`), so that the records appended
+    /// can be read back.
+    ///
+    /// @param bufferSize How many bytes of records are buffered before
+    ///        being written out (larger records are written out right
+    ///        away).
+    explicit CaptureWriter(const std::string &path,
+                           std::size_t bufferSize = 64 * 1024);
+
+    /// @brief Destructor. Writes out the buffered records (ignoring
+    ///        errors).
+    ~CaptureWriter();
+
+    ///@name No copy semantic
+    ///@{
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+    ///@}
+
+    /// @brief Append a message (its first `message.size()` bytes),
+    ///        timestamped now. Throws std::runtime_error on errors.
+    void record(std::uint32_t connection, CaptureDirection direction,
+                const NetworkLib::BufferView &message);
+
+    /// @brief Like `record()`, but return an error instead of
+    ///        throwing. After an error, all records are dropped (and
+    ///        the error returned again, see `status()`).
+    NetworkLib::Status record_nothrow(std::uint32_t connection,
+                                      CaptureDirection direction,
+                                      const NetworkLib::BufferView &message);
+
+    /// @brief Like `record_nothrow(std::uint32_t, CaptureDirection,
+    ///        const NetworkLib::BufferView &)`, but for a message (or
+    ///        messages) made of the given segments, recorded as a
+    ///        single one.
+    NetworkLib::Status
+    record_nothrow(std::uint32_t connection, CaptureDirection direction,
+                   const NetworkLib::BufferViewSegments &segments);
+
+    /// @brief Write out the buffered records. Throws
+    ///        std::runtime_error on errors.
+    void flush();
+
+    /// @brief Like `flush()`, but return an error instead of throwing.
+    NetworkLib::Status flush_nothrow();
+
+    /// @brief Return the first error (if any), after which all records
+    ///        are dropped.
+    const NetworkLib::Status &status() const { return mStatus; }
+
+    /// @brief Return the path of the file.
+    const std::string &path() const { return mPath; }
+
+    /// @brief Return the number of records appended (including the
+    ///        buffered ones).
+    std::uint64_t records() const { return mRecords; }
+
+  private:
+    std::string mPath;
+    int mFD = -1;
+
+    std::vector<unsigned char> mBuffer;
+    std::size_t mBuffered = 0;
+
+    std::uint64_t mRecords = 0;
+    NetworkLib::Status mStatus;
+
+    // Append the header of a record, and then the segments (with the
+    // padding).
+    NetworkLib::Status append(std::uint32_t connection,
+                              CaptureDirection direction,
+                              const NetworkLib::BufferView *segments,
+                              std::size_t count);
+};
+
+/**
+ * @brief Reads back a capture file (see CaptureWriter), mapped in
+ *        memory (see mmap(2)).
+ *
+ * The messages are handed out as BufferView objects pointing right
+ * into the mapping (see `NetworkLib::BufferView::makeNonOwningBufferView()`),
+ * valid as long as the reader, e.g. to be decoded with no copy:
+ *
+ *     CaptureReader reader("agent.cap");
+ *
+ *     reader.replay([](const CaptureReader::Record &r) {
+ *         MessageDecoder decoder(r.message);
+ *         ...
+ *     }, CaptureReader::Pacing::ORIGINAL);
+ *
+ * Not thread safe (but many readers can map the same file).
+ */
+class CaptureReader {
+  public:
+    /// @brief A captured message.
+    struct Record {
+        /// @brief When the message was captured (since the epoch of
+        ///        std::chrono::system_clock).
+        std::chrono::nanoseconds timestamp{0};
+
+        /// @brief The connection of the message (see
+        ///        `IO::ConnectionHandle`).
+        std::uint32_t connection = 0;
+
+        CaptureDirection direction = CaptureDirection::RECEIVED;
+
+        /// @brief The message (pointing into the mapping).
+        NetworkLib::BufferView message;
+    };
+
+    /// @brief How `replay()` hands out the records.
+    enum class Pacing {
+        /// @brief One after the other, right away.
+        AS_FAST_AS_POSSIBLE,
+
+        /// @brief Each one after the same delay (from the first one)
+        ///        as when it was captured (divided by the speed).
+        ORIGINAL
+    };
+
+    /// @brief Invoked by `replay()` for each record.
+    using RecordCallback = std::function<void(const Record &)>;
+
+    /// @brief Map the given file. Throws std::runtime_error on errors
+    ///        (e.g. if it isn't a capture file).
+    explicit CaptureReader(const std::string &path);
+
+    ~CaptureReader();
+
+    ///@name No copy semantic
+    ///@{
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+    ///@}
+
+    /// @brief Get the next record.
+    ///
+    /// @return false at the end of the file (or of its last complete
+    ///         record, see `truncated()`).
+    bool next(Record &record);
+
+    /// @brief Go back to the first record.
+    void rewind() {
+        mOffset = mFirstOffset;
+        mTruncated = false;
+    }
+
+    /// @brief Tell if `next()` stopped at a record cut short (or
+    ///        corrupted), rather than at the end of the file.
+    bool truncated() const { return mTruncated; }
+
+    /// @brief Return the size of the file.
+    std::size_t size() const { return mSize; }
+
+    /// @brief Invoke the callback for each of the remaining records,
+    ///        with the given pacing.
+    ///
+    /// @param speed With Pacing::ORIGINAL, how many times faster than
+    ///        originally (e.g. `2.0` halves the delays). Must be
+    ///        positive.
+    ///
+    /// @return The number of records handed out.
+    std::uint64_t replay(const RecordCallback &callback,
+                         Pacing pacing = Pacing::AS_FAST_AS_POSSIBLE,
+                         double speed = 1.0);
+
+  private:
+    const unsigned char *mData = nullptr;
+    std::size_t mSize = 0;
+
+    std::size_t mFirstOffset = 0;
+    std::size_t mOffset = 0;
+    bool mTruncated = false;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
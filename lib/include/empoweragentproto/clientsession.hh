@@ -0,0 +1,226 @@
+#ifndef EMPOWER_AGENT_CLIENTSESSION_HH
+#define EMPOWER_AGENT_CLIENTSESSION_HH
+
+#include <empoweragentproto/io.hh>
+#include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/timerwheel.hh>
+#include <empoweragentproto/tlvencoding.hh>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <unordered_map>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief Sends requests over an IO without waiting for the responses,
+ *        and hands out each response (matched by its transaction ID)
+ *        to the callback (or the future) of its request.
+ *
+ * Many requests can be in flight on the same connection, so a high
+ * round-trip time doesn't limit the rate of requests:
+ *
+ *     ClientSession session(io);
+ *     io.onMessage(session.callback(dispatcher.callback()))
+ *         .onConnectionClosed([&](IO::ConnectionHandle c) {
+ *             session.connectionClosed(c);
+ *         });
+ *
+ *     MessageEncoder encoder(buffer);
+ *     encoder.header()
+ *         .messageClass(MessageClass::REQUEST_GET)
+ *         .entityClass(EntityClass::ECHO_SERVICE);
+ *     encoder.add(tlv).end();
+ *
+ *     session.request(encoder, [](const NetworkLib::Status &status,
+ *                                 const ClientSession::Response &r) {
+ *         ...
+ *     });
+ *
+ *     for (;;) {
+ *         io.processEvents(...);
+ *     }
+ *
+ * The session assigns the sequence number and the transaction ID of
+ * each request (overwriting the ones in the CommonHeaderEncoder), and
+ * the responses must carry the transaction ID of their request (like
+ * the ones made by `encodeAgentStatsReply()`). Each callback is
+ * invoked exactly once, with either the response or the reason why
+ * there's none: ErrorCode::TIMED_OUT (see `timeout()`, checked by the
+ * timers of the IO) or ErrorCode::NO_CONNECTION (see
+ * `connectionClosed()`).
+ *
+ * Not thread safe: use it from the thread running the IO (its
+ * callbacks are invoked from `IO::processEvents()`).
+ */
+class ClientSession {
+  public:
+    /// @brief A response to a request.
+    struct Response {
+        /// @brief The decoded common header.
+        CommonHeaderFields header;
+
+        /// @brief The whole message (e.g. for a MessageDecoder).
+        NetworkLib::BufferView data;
+    };
+
+    /// @brief Invoked once per request, with the response (and an OK
+    ///        status), or with the reason why there's none (and an
+    ///        empty Response).
+    using ResponseCallback = std::function<void(const NetworkLib::Status &,
+                                                const Response &)>;
+
+    /// @brief Counters (see `stats()`).
+    struct Stats {
+        /// @brief Requests sent.
+        std::uint64_t requests = 0;
+
+        /// @brief Responses matched to their request.
+        std::uint64_t responses = 0;
+
+        /// @brief Requests with no response in time.
+        std::uint64_t timeouts = 0;
+
+        /// @brief Requests failed because their connection was closed
+        ///        (or because of `cancelAll()`).
+        std::uint64_t failures = 0;
+
+        /// @brief Responses matching no request in flight (e.g. late
+        ///        ones, after a timeout).
+        std::uint64_t unmatched = 0;
+    };
+
+    /// @brief Constructor. The IO must outlive the session.
+    explicit ClientSession(IO &io) : mIO(io) {}
+
+    /// @brief Destructor. The requests still in flight are dropped,
+    ///        without invoking their callbacks (the futures get a
+    ///        `std::future_errc::broken_promise` error).
+    ~ClientSession();
+
+    ///@name No copy semantic
+    ///@{
+    ClientSession(const ClientSession &) = delete;
+    ClientSession &operator=(const ClientSession &) = delete;
+    ///@}
+
+    ///@name Configuration
+    ///@{
+
+    /// @brief Set the connection to send the requests to. Default is
+    ///        `IO::noConnection`, i.e. the default connection of the
+    ///        IO at the time of each request.
+    ClientSession &connection(IO::ConnectionHandle v) {
+        mConnection = v;
+        return *this;
+    }
+
+    IO::ConnectionHandle connection() const { return mConnection; }
+
+    /// @brief Set how long to wait for a response (unless given to
+    ///        `request()`). Default is 5 seconds.
+    ClientSession &timeout(std::chrono::milliseconds v) {
+        mTimeout = v;
+        return *this;
+    }
+
+    std::chrono::milliseconds timeout() const { return mTimeout; }
+
+    ///@}
+
+    /// @brief Send the request encoded by the given (ended)
+    ///        MessageEncoder, after setting its sequence number and
+    ///        transaction ID, via `IO::sendMessage()`.
+    ///
+    /// Throws what `IO::sendMessage()` throws (in which case the
+    /// callback is never invoked), and std::runtime_error if there's
+    /// no connection.
+    ///
+    /// @return The transaction ID of the request (never `0`).
+    std::uint32_t request(MessageEncoder &encoder, ResponseCallback callback);
+
+    /// @brief Like `request(MessageEncoder &, ResponseCallback)`, but
+    ///        with the given timeout.
+    std::uint32_t request(MessageEncoder &encoder, ResponseCallback callback,
+                          std::chrono::milliseconds timeout);
+
+    /// @brief Like `request(MessageEncoder &, ResponseCallback)`, but
+    ///        hand out the response through a future.
+    ///
+    /// The future gets ready only while the IO is run (by
+    /// `IO::processEvents()`), so don't wait for it in the thread
+    /// running the IO.
+    std::future<NetworkLib::Result<Response>>
+    request(MessageEncoder &encoder);
+
+    /// @brief Hand out a received message to the callback of its
+    ///        request, if it's a response to a request in flight on
+    ///        the same connection.
+    ///
+    /// @return false if it isn't (the message is then left to the
+    ///         caller).
+    bool handleMessage(IO::ConnectionHandle connection,
+                       const NetworkLib::BufferView &message);
+
+    /// @brief Return a callback calling `handleMessage()` (see
+    ///        `IO::onMessage()`), and then `next` (if any) for the
+    ///        messages which aren't responses to requests in flight.
+    ///        The session must outlive it.
+    IO::MessageCallback callback(IO::MessageCallback next = nullptr);
+
+    /// @brief Fail the requests in flight on the given connection with
+    ///        ErrorCode::NO_CONNECTION (see `IO::onConnectionClosed()`).
+    void connectionClosed(IO::ConnectionHandle connection);
+
+    /// @brief Fail all the requests in flight with the given status
+    ///        (which must not be OK).
+    void cancelAll(NetworkLib::Status status);
+
+    /// @brief Forget the given request, without invoking its callback.
+    ///
+    /// @return false if it isn't in flight.
+    bool cancel(std::uint32_t transactionId) noexcept;
+
+    /// @brief Return the number of requests in flight.
+    std::size_t outstanding() const { return mRequests.size(); }
+
+    /// @brief Return the counters.
+    const Stats &stats() const { return mStats; }
+
+  private:
+    // A request in flight
+    struct Outstanding {
+        IO::ConnectionHandle connection = IO::noConnection;
+        ResponseCallback callback;
+        TimerWheel::TimerId timer = TimerWheel::noTimer;
+    };
+
+    IO &mIO;
+    IO::ConnectionHandle mConnection = IO::noConnection;
+    std::chrono::milliseconds mTimeout{5000};
+
+    // By transaction ID
+    std::unordered_map<std::uint32_t, Outstanding> mRequests;
+
+    std::uint32_t mNextSequence = 0;
+    std::uint32_t mNextTransactionId = 0;
+
+    Stats mStats;
+
+    // Return a transaction ID which is neither 0 nor in flight.
+    std::uint32_t nextTransactionId();
+
+    // Remove a request and invoke its callback. Return false if it
+    // isn't in flight (any more).
+    bool complete(std::uint32_t transactionId,
+                  const NetworkLib::Status &status, const Response &response);
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef EMPOWER_AGENT_DISPATCHER_HH
+#define EMPOWER_AGENT_DISPATCHER_HH
+
+#include <empoweragentproto/io.hh>
+#include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/protocol.hh>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief Routes received messages to the handlers registered for
+ *        their EntityClass and MessageClass.
+ *
+ * The common header of each message is decoded once (see
+ * CommonHeaderFields), and the handler is found with two indexings
+ * in a dense table (one row per EntityClass value, one column per
+ * MessageClass):
+ *
+ *     Dispatcher dispatcher;
+ *     dispatcher
+ *         .on(EntityClass::ECHO_SERVICE, MessageClass::REQUEST_GET,
+ *             [&](const Dispatcher::Message &m) { ... })
+ *         .on(EntityClass::AGENT_STATS_SERVICE,
+ *             [&](const Dispatcher::Message &m) { ... });
+ *     io.onMessage(dispatcher.callback());
+ *
+ * By default handlers run in the thread calling `dispatch()`. Entity
+ * classes marked as concurrent (see `concurrent()`) are instead
+ * handled by a pool of worker threads (see `workers()` and
+ * `start()`), so that e.g. a slow capabilities request never delays
+ * the handling of periodic reports. Such messages are copied, and
+ * their handlers must not use the IO (which is not thread safe):
+ * they can reply e.g. through a Producer of an AgentRuntime (one per
+ * worker, see Message::worker).
+ *
+ * Handlers must be registered before the first `dispatch()` (and
+ * before `start()`).
+ */
+class Dispatcher {
+  public:
+    /// @brief The value of Message::worker for messages handled in
+    ///        the thread calling `dispatch()`.
+    static const std::size_t inlineWorker = static_cast<std::size_t>(-1);
+
+    /// @brief A message being dispatched.
+    struct Message {
+        /// @brief The connection the message was received from.
+        IO::ConnectionHandle connection = IO::noConnection;
+
+        /// @brief The decoded common header.
+        CommonHeaderFields header;
+
+        /// @brief The whole message (e.g. for a MessageDecoder).
+        NetworkLib::BufferView data;
+
+        /// @brief The index of the worker handling the message (from
+        ///        `0` to `workers() - 1`), or `inlineWorker`.
+        std::size_t worker = inlineWorker;
+    };
+
+    /// @brief A message handler.
+    using Handler = std::function<void(const Message &)>;
+
+    /// @brief Counters (see `stats()`).
+    struct Stats {
+        /// @brief Messages passed to a registered handler (or queued
+        ///        for the workers).
+        std::uint64_t dispatched = 0;
+
+        /// @brief Messages with no registered handler (including the
+        ///        ones passed to the `onUnhandled()` handler).
+        std::uint64_t unhandled = 0;
+
+        /// @brief Errors (exceptions) thrown by handlers run by the
+        ///        workers.
+        std::uint64_t workerErrors = 0;
+    };
+
+    Dispatcher() = default;
+
+    /// @brief Destructor. Stop the workers if needed.
+    ~Dispatcher();
+
+    ///@name No copy semantic
+    ///@{
+    Dispatcher(const Dispatcher &) = delete;
+    Dispatcher &operator=(const Dispatcher &) = delete;
+    ///@}
+
+    ///@name Configuration (before `start()` and `dispatch()`)
+    ///@{
+
+    /// @brief Register the handler of the messages of the given
+    ///        entity and message class (replacing any previous one).
+    Dispatcher &on(EntityClass entityClass, MessageClass messageClass,
+                   Handler handler);
+
+    /// @brief Register the handler of the messages of the given
+    ///        entity, for all the message classes (replacing any
+    ///        previous ones).
+    Dispatcher &on(EntityClass entityClass, Handler handler);
+
+    /// @brief Register the handler of the messages with no other
+    ///        handler (default: none, i.e. ignore them).
+    Dispatcher &onUnhandled(Handler handler) {
+        mUnhandled = std::move(handler);
+        return *this;
+    }
+
+    /// @brief Tell whether the messages of the given entity are
+    ///        handled by the workers (default: `false`). They are
+    ///        handled inline anyway while the workers are not running.
+    Dispatcher &concurrent(EntityClass entityClass, bool v = true);
+
+    /// @brief Set the number of workers (default: `0`). Without
+    ///        workers, all the messages are handled inline.
+    Dispatcher &workers(std::size_t n) {
+        mWorkerCount = n;
+        return *this;
+    }
+
+    /// @brief Return the number of workers.
+    std::size_t workers() const { return mWorkerCount; }
+
+    ///@}
+
+    /// @brief Start the workers.
+    ///
+    /// Throw std::logic_error if already started.
+    void start();
+
+    /// @brief Stop the workers, after they have handled all the
+    ///        queued messages, and wait for them to terminate.
+    void stop() noexcept;
+
+    /// @brief Tell if the workers are running.
+    bool running() const { return !mThreads.empty(); }
+
+    /// @brief Route a message to its handler (the message is copied
+    ///        if handled by a worker).
+    ///
+    /// Messages with a malformed header (see
+    /// `CommonHeaderDecoder::check()`), or a length past their end,
+    /// are counted as unhandled, and not passed to any handler.
+    /// Throws whatever an inline handler throws.
+    ///
+    /// @return false if there's no handler for the message (even
+    ///         if passed to the `onUnhandled()` handler).
+    bool dispatch(IO::ConnectionHandle connection,
+                  const NetworkLib::BufferView &message);
+
+    /// @brief Return a callback calling `dispatch()` (see
+    ///        `IO::onMessage()`). The Dispatcher must outlive it.
+    IO::MessageCallback callback() {
+        return [this](IO::ConnectionHandle connection,
+                      NetworkLib::BufferView message) {
+            dispatch(connection, message);
+        };
+    }
+
+    /// @brief Return a snapshot of the counters (from any thread).
+    Stats stats() const;
+
+  private:
+    // One column per MessageClass (see columnOf())
+    static const std::size_t columns = 7;
+
+    // The handlers of an entity class, as indexes in mHandlers plus
+    // one (i.e. 0 is no handler).
+    struct Row {
+        std::array<std::uint16_t, columns> handlers{};
+        bool concurrent = false;
+    };
+
+    // Indexed by EntityClass value (up to the largest registered one)
+    std::vector<Row> mRows;
+    std::vector<Handler> mHandlers;
+    Handler mUnhandled;
+
+    // Drop the handlers replaced by later ones (see on()).
+    void dropUnusedHandlers();
+
+    std::size_t mWorkerCount = 0;
+    std::vector<std::thread> mThreads;
+
+    // The messages waiting for the workers, with their handler
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::pair<const Handler *, Message>> mQueue;
+    bool mStopRequested = false;
+
+    ///@name Counters (see Stats)
+    ///@{
+    std::atomic<std::uint64_t> mDispatched{0};
+    std::atomic<std::uint64_t> mUnhandledCount{0};
+    std::atomic<std::uint64_t> mWorkerErrors{0};
+    ///@}
+
+    // Return the table column of a message class.
+    static std::size_t columnOf(MessageClass messageClass) {
+        // INVALID and REQUEST_* are 0-4, RESPONSE_* are 64-65.
+        const auto v = static_cast<std::size_t>(messageClass);
+        return v < 5 ? v : v - 59;
+    }
+
+    // Return the row of an entity class, adding it if needed.
+    Row &row(EntityClass entityClass);
+
+    // The body of a worker thread.
+    void work(std::size_t worker) noexcept;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
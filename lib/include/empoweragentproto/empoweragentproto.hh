@@ -1,8 +1,19 @@
 #ifndef EMPOWER_AGENT_HH
 #define EMPOWER_AGENT_HH
 
+#include <empoweragentproto/agentruntime.hh>
+#include <empoweragentproto/agentstats.hh>
+#include <empoweragentproto/capture.hh>
+#include <empoweragentproto/clientsession.hh>
+#include <empoweragentproto/dispatcher.hh>
 #include <empoweragentproto/io.hh>
+#include <empoweragentproto/messagetemplate.hh>
 #include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/shmring.hh>
+#include <empoweragentproto/timerwheel.hh>
+#include <empoweragentproto/tlvdelta.hh>
 #include <empoweragentproto/tlvs.hh>
+#include <empoweragentproto/tlvviews.hh>
+#include <empoweragentproto/uring.hh>
 
 #endif
@@ -1,18 +1,136 @@
 #ifndef EMPOWER_AGENT_IO_HH
 #define EMPOWER_AGENT_IO_HH
 
+#include <empoweragentproto/capture.hh>
+#include <empoweragentproto/messageframer.hh>
 #include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/reactor.hh>
+#include <empoweragentproto/timerwheel.hh>
+#include <empoweragentproto/uring.hh>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Empower {
 namespace Agent {
 
+/// @brief The options of the TCP sockets of the connections (see
+///        `IO::socketOptions()`).
+///
+/// The options marked as Linux only are ignored elsewhere. A value of
+/// `0` leaves the system default.
+struct SocketOptions {
+    /// @brief Disable Nagle's algorithm (TCP_NODELAY), so that small
+    ///        messages are sent right away. Default is `true`.
+    ///
+    /// Each write then goes out as its own segment: send streams of
+    /// small messages via `IO::queueMessage()`, which coalesces them.
+    bool noDelay = true;
+
+    /// @brief Send ACKs right away (TCP_QUICKACK, Linux only). The
+    ///        kernel clears it as it sees fit, so IO sets it again
+    ///        after each read (with io_uring, once per batch of
+    ///        completions). Default is `false`.
+    bool quickAck = false;
+
+    /// @brief The size (in bytes) of the send buffer (SO_SNDBUF).
+    int sendBufferBytes = 0;
+
+    /// @brief The size (in bytes) of the receive buffer (SO_RCVBUF).
+    int receiveBufferBytes = 0;
+
+    /// @brief Enable TCP keepalive probes (SO_KEEPALIVE). Default is
+    ///        `false`.
+    bool keepAlive = false;
+
+    /// @brief Seconds of inactivity before the first keepalive probe
+    ///        (TCP_KEEPIDLE, Linux only).
+    int keepAliveIdleSec = 0;
+
+    /// @brief Seconds between keepalive probes (TCP_KEEPINTVL, Linux
+    ///        only).
+    int keepAliveIntervalSec = 0;
+
+    /// @brief Unanswered keepalive probes before the connection is
+    ///        dropped (TCP_KEEPCNT, Linux only).
+    int keepAliveCount = 0;
+
+    /// @brief Milliseconds transmitted data may stay unacknowledged
+    ///        before the connection is dropped (TCP_USER_TIMEOUT,
+    ///        Linux only).
+    unsigned userTimeoutMsec = 0;
+
+    /// @brief Microseconds to busy poll the device queue when reading
+    ///        with no data (SO_BUSY_POLL, Linux only).
+    int busyPollUsec = 0;
+};
+
 /// @brief Manages the network communication with an agent, including
 ///        what's needed to send and receive the data of encoded
 ///        messages.
+///
+/// By default IO manages a single connection (either opened via
+/// `openSocket()` or accepted on a listening socket). In server mode
+/// (see `serverMode()`) it accepts and manages many connections at
+/// once, each one identified by a ConnectionHandle.
 class IO {
   public:
+    /// @brief Identifies a connection managed by IO.
+    ///
+    /// Handles are never reused (a handle to a connection which has
+    /// been closed stays invalid).
+    using ConnectionHandle = std::uint32_t;
+
+    /// @brief A ConnectionHandle value which never identifies a
+    ///        connection.
+    static const ConnectionHandle noConnection = 0;
+
+    /// @brief Callback invoked (in event-driven mode) for each
+    ///        complete message that has been received.
+    ///
+    /// The BufferView points into the receive buffer, which stays
+    /// valid as long as the BufferView (or any copy of it) exists.
+    using MessageCallback =
+        std::function<void(ConnectionHandle, NetworkLib::BufferView)>;
+
+    /// @brief Callback invoked (in event-driven mode) when all the
+    ///        pending output data of a connection has been written
+    ///        out.
+    using WritableCallback = std::function<void(ConnectionHandle)>;
+
+    /// @brief Callback invoked when a connection is opened (or
+    ///        accepted), or closed.
+    using ConnectionCallback = std::function<void(ConnectionHandle)>;
+
+    /// @brief How the data of the connections is moved (see
+    ///        `transport()`).
+    enum class Transport {
+        /// @brief Wait for the sockets to be ready (see Reactor), and
+        ///        then read(2) and write(2) them.
+        READINESS,
+
+        /// @brief Submit receive and send requests, and collect their
+        ///        completions, in batches with `io_uring(7)` (see
+        ///        Uring).
+        IO_URING,
+    };
+
+    IO();
     ~IO();
 
+    ///@name No copy semantic
+    ///@{
+    IO(const IO &) = delete;
+    IO &operator=(const IO &) = delete;
+    ///@}
+
     /// @name Setup
     /// @{
 
@@ -39,6 +157,24 @@ class IO {
 
     NetworkLib::IPv4Address address() const { return mAddress; }
 
+    /// @brief Use a Unix-domain stream socket (see unix(7)) bound to
+    ///        the given path, instead of TCP (the address and the port
+    ///        are then ignored). Takes effect on the next call to
+    ///        `openListeningSocket()` or to `openSocket()`. Default is
+    ///        empty (use TCP).
+    ///
+    /// The messages and the interface are the same as with TCP, but
+    /// the options of SocketOptions only specific to TCP are ignored.
+    /// A stale socket left at the path (e.g. by a crashed process) is
+    /// removed when listening, and the path is removed again when the
+    /// listening socket is closed.
+    IO &unixPath(const std::string &path) {
+        mUnixPath = path;
+        return *this;
+    }
+
+    const std::string &unixPath() const { return mUnixPath; }
+
     IO &delay(int msec) {
         mDelay_msec = msec;
         return *this;
@@ -46,12 +182,137 @@ class IO {
 
     int delay() const { return mDelay_msec; }
 
+    /// @brief Use non-blocking sockets. Takes effect on the next
+    ///        opened (or accepted) connection. Default is `false`.
+    ///
+    /// With non-blocking sockets `readMessage()` and `writeMessage()`
+    /// still return only when a whole message has been read/written,
+    /// but they wait for the socket to become ready instead of
+    /// sleeping (with no timeout, whatever `delay()` is). The
+    /// event-driven interface (`processEvents()`) works in both modes,
+    /// but it never blocks only with non-blocking sockets.
+    IO &nonBlocking(bool v) {
+        mNonBlocking = v;
+        return *this;
+    }
+
+    bool nonBlocking() const { return mNonBlocking; }
+
+    /// @brief Accept and manage many connections at once on the
+    ///        listening socket. Default is `false` (accept a new
+    ///        connection only when there's none).
+    IO &serverMode(bool v) {
+        mServerMode = v;
+        return *this;
+    }
+
+    bool serverMode() const { return mServerMode; }
+
+    /// @brief Set the backlog of the listening socket (see
+    ///        `listen(2)`). Takes effect on the next call to
+    ///        `openListeningSocket()`. Default is `16`.
+    IO &listenBacklog(int v) {
+        mListenBacklog = v;
+        return *this;
+    }
+
+    int listenBacklog() const { return mListenBacklog; }
+
+    /// @brief Set the maximum number of connections accepted in
+    ///        server mode (further attempts are accepted and closed
+    ///        immediately). Default is `64`.
+    IO &maxConnections(std::size_t v) {
+        mMaxConnections = v;
+        return *this;
+    }
+
+    std::size_t maxConnections() const { return mMaxConnections; }
+
+    /// @brief Set the options of the sockets. Take effect on the next
+    ///        opened (or accepted) connection (and on the next call to
+    ///        `openListeningSocket()` for the buffer sizes, inherited
+    ///        by accepted connections).
+    IO &socketOptions(const SocketOptions &v) {
+        mSocketOptions = v;
+        return *this;
+    }
+
+    const SocketOptions &socketOptions() const { return mSocketOptions; }
+
+    /// @brief Set how many bytes of messages queued via
+    ///        `queueMessage()` trigger a flush. Default is `16384`.
+    IO &flushThreshold(std::size_t bytes) {
+        mFlushThreshold = bytes;
+        return *this;
+    }
+
+    std::size_t flushThreshold() const { return mFlushThreshold; }
+
+    /// @brief Set how long a message queued via `queueMessage()` can
+    ///        wait before being flushed (see `processEvents()`).
+    ///        Default is 1 millisecond.
+    IO &flushLatency(std::chrono::microseconds latency) {
+        mFlushLatency = latency;
+        return *this;
+    }
+
+    std::chrono::microseconds flushLatency() const { return mFlushLatency; }
+
+    /// @brief Append all the messages received and sent (on any
+    ///        connection) to the given capture (see CaptureWriter),
+    ///        or stop if `nullptr`. Default is `nullptr`.
+    ///
+    /// The messages are captured as read from the socket (before
+    /// being checked, and whatever their version), and as passed to
+    /// `writeMessage()`, `sendMessage()` (and thus
+    /// `broadcastMessage()`) or `queueMessage()`. Errors of the
+    /// capture are left to the writer (see `CaptureWriter::status()`).
+    /// The writer must outlive its use by the IO.
+    IO &capture(CaptureWriter *writer) {
+        mCapture = writer;
+        return *this;
+    }
+
+    CaptureWriter *capture() const { return mCapture; }
+
+    /// @brief Set the transport. Can't be changed while there are
+    ///        connections (or a listening socket, or a connection
+    ///        attempt), throws std::logic_error otherwise. Default is
+    ///        `Transport::READINESS`.
+    ///
+    /// `Transport::IO_URING` is used only if available (see
+    /// `Uring::available()`), otherwise IO keeps using
+    /// `Transport::READINESS` (as `transport()` then tells). With it:
+    ///
+    /// - each connection has a multishot receive request, completing
+    ///   into a ring of buffers from which data is copied into the
+    ///   framer;
+    /// - `sendMessage()` never writes right away: the pending output
+    ///   of each connection goes out by a single request at a time
+    ///   (of up to 64 buffers), which is submitted by the next call to
+    ///   `processEvents()` (together with the other requests, and
+    ///   while waiting for completions);
+    /// - the listening socket, the wakeup file descriptor and the
+    ///   connection attempts are still monitored by the reactor,
+    ///   which is itself monitored through the ring;
+    /// - only the event-driven interface works: `isDataAvailable()`,
+    ///   `readMessage()` and `writeMessage()` fail with
+    ///   NetworkLib::ErrorCode::UNSUPPORTED.
+    ///
+    /// Must not be called from callbacks.
+    IO &transport(Transport t);
+
+    Transport transport() const {
+        return mUring ? Transport::IO_URING : Transport::READINESS;
+    }
+
     /// @}
 
     /// @name Incoming connections
     /// @{
 
-    /// @brief (Re)open a listening TCP socket on the given port.
+    /// @brief (Re)open a listening TCP socket on the given port (or a
+    ///        Unix-domain one, see `unixPath()`).
     ///        Don't wait for a connection (use `isDataAvailable()` to
     ///        wait and accept a connection attempt.
     ///
@@ -60,32 +321,134 @@ class IO {
     void openListeningSocket();
 
     /// @brief Wait for an incoming connection and accept it.
+    ///
+    /// In server mode, accept a connection even if there are already
+    /// others.
     void acceptConnectionIfNeeded();
 
+    /// @brief Like `acceptConnectionIfNeeded()`, but return an error
+    ///        Status (e.g. ErrorCode::SYSTEM_ERROR if accept(2) fails)
+    ///        instead of throwing.
+    NetworkLib::Status acceptConnectionIfNeeded_nothrow();
+
     /// @}
 
     /// @name Outgoing connections (for C++ clients)
     /// @{
 
     /// @brief (Re)open a TCP connection (client) to the given address and
-    ///        port.
+    ///        port (or a Unix-domain one, see `unixPath()`).
     ///
     /// @return True if the connection was opened.
     bool openSocket();
 
+    /// @brief Like `openSocket()`, but without waiting: the
+    ///        connection is completed by `processEvents()` (see
+    ///        `onConnectionOpened()`).
+    ///
+    /// Failed attempts (including the ones exceeding
+    /// `connectTimeout()`) are retried after a jittered, exponential
+    /// backoff (see `reconnectBackoff()`), until the connection is
+    /// opened or `closeConnection()` is called.
+    ///
+    /// Throws on errors which can't be recovered from (e.g. socket(2)
+    /// failing) on the first attempt. The same errors on a retry (made
+    /// by `processEvents()`) just lead to the next retry.
+    void openSocketAsync();
+
+    /// @brief Tell if an outgoing connection is being opened (see
+    ///        `openSocketAsync()`), i.e. if connect(2) is in progress
+    ///        or a retry is scheduled.
+    bool isConnecting() const {
+        return mConnectingFD != -1 || mTimers.scheduled(mConnectTimer);
+    }
+
+    /// @brief Set how long an asynchronous connection attempt may
+    ///        take before being retried. Default is 3 seconds.
+    IO &connectTimeout(std::chrono::milliseconds v) {
+        mConnectTimeout = v;
+        return *this;
+    }
+
+    std::chrono::milliseconds connectTimeout() const {
+        return mConnectTimeout;
+    }
+
+    /// @brief Set the backoff of asynchronous connection attempts:
+    ///        the n-th retry waits between half and all of
+    ///        `min(max, initial * 2^(n-1))`. Default is from 100 ms
+    ///        to 5 seconds.
+    IO &reconnectBackoff(std::chrono::milliseconds initial,
+                         std::chrono::milliseconds max) {
+        mBackoffInitial = initial;
+        mBackoffMax = max;
+        return *this;
+    }
+
+    /// @brief When the outgoing connection (opened by `openSocket()`
+    ///        or `openSocketAsync()`) gets closed (e.g. by the peer,
+    ///        but not by `closeConnection()` without arguments), open
+    ///        it again asynchronously (see `openSocketAsync()`) from
+    ///        `processEvents()`. Default is `false`.
+    IO &autoReconnect(bool v) {
+        mAutoReconnect = v;
+        return *this;
+    }
+
+    bool autoReconnect() const { return mAutoReconnect; }
+
     /// @}
 
     /// @name Incoming and outgoing connections
     /// @{
 
     /// @brief Close every opened connection (incoming or
-    ///        outgoing). Don't complain if there isn't a open
-    ///        connection.
+    ///        outgoing), and stop opening one (see
+    ///        `openSocketAsync()`). Don't complain if there isn't a
+    ///        open connection.
     void closeConnection() noexcept;
 
+    /// @brief Close the given connection. Don't complain if the
+    ///        connection is already closed.
+    void closeConnection(ConnectionHandle connection) noexcept;
+
     /// @brief Tells if the network connection is currently closed
-    ///        (works for both directions).
-    bool isConnectionClosed() const { return mConnectionFD == -1; }
+    ///        (works for both directions). In server mode, tells if
+    ///        there are no connections at all.
+    bool isConnectionClosed() const { return mConnections.empty(); }
+
+    /// @brief Tells if the given connection is closed.
+    bool isConnectionClosed(ConnectionHandle connection) const {
+        return mConnections.find(connection) == mConnections.end();
+    }
+
+    /// @brief Return the handles of all the opened connections (oldest
+    ///        first).
+    std::vector<ConnectionHandle> connections() const;
+
+    /// @brief Return the handle of the *default* connection (i.e. the
+    ///        oldest one), which is the one used by the methods not
+    ///        taking a ConnectionHandle. Return `noConnection` if
+    ///        there are no connections.
+    ConnectionHandle defaultConnection() const {
+        return mConnections.empty() ? noConnection
+                                    : mConnections.begin()->first;
+    }
+
+    /// @brief Set the callback invoked when a connection is opened or
+    ///        accepted.
+    IO &onConnectionOpened(ConnectionCallback cb) {
+        mConnectionOpenedCallback = cb;
+        return *this;
+    }
+
+    /// @brief Set the callback invoked when a connection is closed
+    ///        (not invoked by the destructor). The callback must not
+    ///        throw exceptions.
+    IO &onConnectionClosed(ConnectionCallback cb) {
+        mConnectionClosedCallback = cb;
+        return *this;
+    }
 
     /// @}
 
@@ -93,14 +456,37 @@ class IO {
     ///        newly allocated buffer that is suitable to hold a whole
     ///        message.
     ///
-    /// The lifecycle of the BufferWritableView is managed automatically via
-    /// a std::shared_ptr<T>
+    /// The buffer is a PacketBuffer with an intrusive reference count,
+    /// shared by the returned view and by all the views (and copies)
+    /// derived from it. Buffers are taken from a PacketBufferArena
+    /// shared by all threads (here, from its largest size class), and
+    /// go back to the arena when the last view referring to them is
+    /// gone.
     ///
     /// Note: the buffer size is slighly less than the maximum theoretical
     ///       size for a message (64KiB), to play nice with memory
     ///       allocators.
     static NetworkLib::BufferWritableView makeMessageBuffer();
 
+    /// @brief Return a NetworkLib::BufferWritableView associated to a
+    ///        buffer of at least the given size (possibly much
+    ///        smaller than the one returned by `makeMessageBuffer()`).
+    ///
+    /// Like `makeMessageBuffer()`, buffers are taken from the arena,
+    /// from the smallest size class which is large enough, and go back
+    /// there with the last view. Throws exceptions if the size is
+    /// larger than the size of the buffers returned by
+    /// `makeMessageBuffer()`.
+    static NetworkLib::BufferWritableView makeMessageBuffer(std::size_t size);
+
+    /// @brief Return a NetworkLib::BufferWritableView associated to a
+    ///        buffer suitable to hold the message whose preamble is in
+    ///        the given NetworkLib::BufferView (which must hold at
+    ///        least the whole preamble). The BufferWritableView is
+    ///        shrunk to the message length.
+    static NetworkLib::BufferWritableView
+    makeMessageBufferFor(const NetworkLib::BufferView &preamble);
+
     /// @name Receive data
     /// @{
 
@@ -110,17 +496,68 @@ class IO {
     ///        Return only when either an entire message has been read
     ///        in or there are unrecoverable read errors.
     ///
+    /// Reads from the default connection. Blocks with no timeout
+    /// (whatever `delay()` is): to wait with one, call
+    /// `isDataAvailable()` first, or use `processEvents()`.
+    ///
     /// @return A NetworkLib::BufferView with the message, or an empty
     ///         BufferView.
     NetworkLib::BufferView
     readMessage(NetworkLib::BufferWritableView &inputBuffer);
 
+    /// @brief Like `readMessage(NetworkLib::BufferWritableView &)`,
+    ///        but read from the given connection.
+    NetworkLib::BufferView
+    readMessage(ConnectionHandle connection,
+                NetworkLib::BufferWritableView &inputBuffer);
+
+    /// @brief Wait for a whole message and read (receive) it all from
+    ///        the default connection, returning it in a buffer which
+    ///        is sized after the length in its preamble (see
+    ///        `makeMessageBufferFor()`). Return only when either an
+    ///        entire message has been read in or there are
+    ///        unrecoverable read errors. Blocks with no timeout, like
+    ///        `readMessage(NetworkLib::BufferWritableView &)`.
+    ///
+    /// Unlike `readMessage(NetworkLib::BufferWritableView &)`, the
+    /// returned message stays valid as long as the BufferView (or any
+    /// copy of it) exists.
+    ///
+    /// @return A NetworkLib::BufferView with the message, or an empty
+    ///         BufferView.
+    NetworkLib::BufferView readMessage();
+
+    /// @brief Like `readMessage()`, but read from the given connection.
+    NetworkLib::BufferView readMessage(ConnectionHandle connection);
+
+    /// @brief Like `readMessage(ConnectionHandle)`, but return an
+    ///        error Status instead of throwing (e.g. when the
+    ///        connection doesn't exist, when the peer sends junk
+    ///        data, in which case the connection is closed, or with
+    ///        `Transport::IO_URING`).
+    NetworkLib::Result<NetworkLib::BufferView>
+    readMessage_nothrow(ConnectionHandle connection);
+
+    /// @brief Like `readMessage(ConnectionHandle,
+    ///        NetworkLib::BufferWritableView &)`, but return an error
+    ///        Status instead of throwing.
+    NetworkLib::Result<NetworkLib::BufferView>
+    readMessage_nothrow(ConnectionHandle connection,
+                        NetworkLib::BufferWritableView &inputBuffer);
+
     /// @brief Wait up to the configured delay for for data to be
     ///        available to read, or for a remote connection to take
     ///        place (in the latter case, the remote connection is
     ///        accepted via `acceptConnectionIfNeeded()`, and the we
     ///        wait again for data to read).
     ///
+    /// In server mode, new connections are accepted and data on any
+    /// connection counts (use the event-driven interface to know
+    /// which one).
+    ///
+    /// Return immediately if a whole message has been received
+    /// already (e.g. along with the one last read).
+    ///
     /// @return False if the timeout expired.
     bool isDataAvailable();
 
@@ -136,21 +573,481 @@ class IO {
     ///        given NetworkLib::BufferView. Return only when an
     ///        entire message has been written out.
     ///
+    /// Writes to the default connection.
+    ///
     /// @return the number of bytes written (`0` == no message written or
     ///         EOF).
     std::size_t writeMessage(const NetworkLib::BufferView &messageBuffer);
 
+    /// @brief Like `writeMessage(const NetworkLib::BufferView &)`,
+    ///        but write to the given connection.
+    std::size_t writeMessage(ConnectionHandle connection,
+                             const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Write (send) the data of a message made of the given
+    ///        segments (e.g. encoded by MessageSegmentEncoder), with
+    ///        as few `writev(2)` calls as possible. Return only when
+    ///        the entire message has been written out.
+    ///
+    /// Writes to the default connection.
+    ///
+    /// @return the number of bytes written (`0` == no message written
+    ///         or EOF).
+    std::size_t writeMessage(const NetworkLib::BufferViewSegments &segments);
+
+    /// @brief Like `writeMessage(const NetworkLib::BufferViewSegments &)`,
+    ///        but write to the given connection.
+    std::size_t writeMessage(ConnectionHandle connection,
+                             const NetworkLib::BufferViewSegments &segments);
+
+    /// @brief Like `writeMessage(ConnectionHandle, const
+    ///        NetworkLib::BufferView &)`, but return an error Status
+    ///        instead of throwing (e.g. when the connection doesn't
+    ///        exist, when `write(2)` fails, in which case the
+    ///        connection is closed, or with `Transport::IO_URING`).
+    NetworkLib::Result<std::size_t>
+    writeMessage_nothrow(ConnectionHandle connection,
+                         const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Like `writeMessage(ConnectionHandle, const
+    ///        NetworkLib::BufferViewSegments &)`, but return an error
+    ///        Status instead of throwing.
+    NetworkLib::Result<std::size_t>
+    writeMessage_nothrow(ConnectionHandle connection,
+                         const NetworkLib::BufferViewSegments &segments);
+
+    /// @}
+
+    /// @name Event-driven interface
+    ///
+    /// Instead of calling `isDataAvailable()` and then
+    /// `readMessage()`, the caller registers callbacks and then
+    /// repeatedly calls `processEvents()`, which never waits longer
+    /// than the given timeout. Partially received messages are kept
+    /// across calls, and reading resumes where it stopped.
+    ///
+    /// @{
+
+    /// @brief Set the callback invoked for each complete message.
+    IO &onMessage(MessageCallback cb) {
+        mMessageCallback = cb;
+        return *this;
+    }
+
+    /// @brief Set the callback invoked when the pending output data
+    ///        (see `sendMessage()`) of a connection has been
+    ///        completely written out.
+    IO &onWritable(WritableCallback cb) {
+        mWritableCallback = cb;
+        return *this;
+    }
+
+    /// @brief Wait up to `timeoutMsec` milliseconds (`-1` means
+    ///        forever, `0` means don't wait at all) for socket
+    ///        events, and process them: accept incoming connections,
+    ///        read in available data (invoking the message callback
+    ///        for each complete message) and write out pending data
+    ///        (invoking the writable callback when done).
+    ///
+    /// @return The number of events processed (`0` if the timeout
+    ///         expired).
+    std::size_t processEvents(int timeoutMsec);
+
+    /// @brief Like `processEvents()`, but return an error Status
+    ///        instead of throwing when a connection fails (e.g. the
+    ///        peer sends a malformed message, see `readMessage()`),
+    ///        or accept(2) does.
+    ///
+    /// The failed connection is closed, and the other events are
+    /// processed anyway: the first error is returned. Exceptions
+    /// thrown by the callbacks are let through, and so are failures
+    /// of the reactor itself (e.g. of epoll_wait(2)) or of setting up
+    /// a new socket (see `socketOptions()`).
+    NetworkLib::Result<std::size_t> processEvents_nothrow(int timeoutMsec);
+
+    /// @brief Send the data of the message encoded in the given
+    ///        NetworkLib::BufferView to the default connection
+    ///        without waiting.
+    ///
+    /// Whatever can't be written out immediately is copied and kept
+    /// as pending output, which is written out by `processEvents()`
+    /// as soon as the socket is writable. The caller can then reuse
+    /// the buffer immediately.
+    ///
+    /// With `Transport::IO_URING` nothing is written out immediately
+    /// (see `transport()`).
+    ///
+    /// @return the number of bytes written out immediately.
+    std::size_t sendMessage(const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Like `sendMessage(const NetworkLib::BufferView &)`, but
+    ///        send to the given connection.
+    std::size_t sendMessage(ConnectionHandle connection,
+                            const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Like `sendMessage(ConnectionHandle, const
+    ///        NetworkLib::BufferView &)`, but return an error Status
+    ///        instead of throwing.
+    NetworkLib::Result<std::size_t>
+    sendMessage_nothrow(ConnectionHandle connection,
+                        const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Queue the message encoded in the given
+    ///        NetworkLib::BufferView for sending to the default
+    ///        connection, coalescing it with other queued messages.
+    ///
+    /// The message is copied (so the caller can reuse the buffer
+    /// immediately) and queued messages are sent together with a
+    /// single write when the flush threshold is reached (see
+    /// `flushThreshold()`), when the oldest queued message has waited
+    /// long enough (see `flushLatency()`, checked by
+    /// `processEvents()`), on `flush()`, or before any other message
+    /// gets sent to the same connection.
+    void queueMessage(const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Like `queueMessage(const NetworkLib::BufferView &)`, but
+    ///        queue for the given connection.
+    void queueMessage(ConnectionHandle connection,
+                      const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Like `queueMessage(ConnectionHandle, const
+    ///        NetworkLib::BufferView &)`, but return an error Status
+    ///        (e.g. ErrorCode::BAD_MESSAGE_LENGTH if the length in the
+    ///        preamble doesn't fit in the buffer) instead of throwing.
+    NetworkLib::Status
+    queueMessage_nothrow(ConnectionHandle connection,
+                         const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Send out the messages queued via `queueMessage()` on all
+    ///        the connections, without waiting (whatever can't be
+    ///        written out immediately is kept as pending output).
+    void flush();
+
+    /// @brief Like `flush()`, but only for the given connection.
+    void flush(ConnectionHandle connection);
+
+    /// @brief Like `flush()`, but return an error Status instead of
+    ///        throwing. A failed connection (which is closed) doesn't
+    ///        keep the others from being flushed: the first error is
+    ///        returned.
+    NetworkLib::Status flush_nothrow();
+
+    /// @brief Like `flush(ConnectionHandle)`, but return an error
+    ///        Status instead of throwing.
+    NetworkLib::Status flush_nothrow(ConnectionHandle connection);
+
+    /// @brief Send (see `sendMessage()`) the same message to all the
+    ///        connections.
+    ///
+    /// Connections failing while sending are closed and skipped.
+    ///
+    /// @return the number of connections the message was sent to.
+    std::size_t broadcastMessage(const NetworkLib::BufferView &messageBuffer);
+
+    /// @brief Tell if there's output data still waiting to be written
+    ///        on any connection.
+    bool hasPendingOutput() const;
+
+    /// @brief Tell if there's output data still waiting to be written
+    ///        on the given connection.
+    bool hasPendingOutput(ConnectionHandle connection) const;
+
+    /// @brief Return the timer wheel whose jobs are run by
+    ///        `processEvents()` (which never waits past the next job).
+    ///
+    /// Messages queued (see `queueMessage()`) by the jobs run in the
+    /// same call are flushed together, after the last job.
+    TimerWheel &timers() { return mTimers; }
+
+    /// @brief Invoke the given callback (from `processEvents()`, or
+    ///        `isDataAvailable()`) each time the given file descriptor
+    ///        is readable, e.g. the `SharedMemoryRing::dataFD()` of a
+    ///        ring (until `unwatch()`). Watching it again replaces the
+    ///        callback.
+    ///
+    /// The file descriptor must stay open while watched.
+    IO &watch(int fd, std::function<void()> cb);
+
+    /// @brief Stop watching the given file descriptor (if watched).
+    void unwatch(int fd) noexcept;
+
+    /// @brief Make `wakeup()` work (it does nothing otherwise).
+    ///
+    /// Must be called before any other thread may call `wakeup()`.
+    /// Throw std::runtime_error if the wakeup file descriptor can't
+    /// be created.
+    IO &enableWakeup();
+
+    /// @brief Make a `processEvents()` or `isDataAvailable()` call
+    ///        waiting in another thread return as soon as possible
+    ///        (or the next one, if none is waiting right now).
+    ///
+    /// This is the only method of IO which can be called from any
+    /// thread (see `enableWakeup()`).
+    void wakeup() noexcept {
+        if (mWaker) {
+            mWaker->wake();
+        }
+    }
+
     /// @}
 
   private:
     NetworkLib::IPv4Address mAddress = {0, 0, 0, 0};
     std::uint16_t mPort = 2210;
+    std::string mUnixPath;
 
     // Default delay/timeout is 1500 milliseconds
     int mDelay_msec = 1500;
 
-    int mConnectionFD = -1;
+    bool mNonBlocking = false;
+    bool mServerMode = false;
+    int mListenBacklog = 16;
+    std::size_t mMaxConnections = 64;
+    std::size_t mFlushThreshold = 16384;
+    std::chrono::microseconds mFlushLatency{1000};
+    SocketOptions mSocketOptions;
+
+    // Where to capture the messages, if anywhere (see capture())
+    CaptureWriter *mCapture = nullptr;
+
     int mListeningSocketFD = -1;
+
+    // The path the listening socket is bound to (if Unix-domain), to
+    // be removed when closing it.
+    std::string mListeningPath;
+
+    // The state of a connection
+    struct Connection {
+        int fd = -1;
+
+        // Tell if it's a TCP connection (see unixPath()).
+        bool tcp = true;
+
+        // Splits incoming data into messages (used both by
+        // readMessage() and by the event-driven mode).
+        MessageFramer framer{65500, &IO::makeMessageBuffer};
+
+        // Data still waiting to be written out (the first element may
+        // have been only partially written, see pendingOutputOffset).
+        std::deque<NetworkLib::BufferView> pendingOutput;
+        std::size_t pendingOutputOffset = 0;
+
+        // Messages queued by queueMessage() and not yet flushed, and
+        // when they must be flushed at the latest.
+        NetworkLib::BufferWritableView batch;
+        std::size_t batchSize = 0;
+        std::chrono::steady_clock::time_point batchDeadline;
+
+        // Tell if TCP_QUICKACK is to be set again at the end of the
+        // current batch of completions (see rearmQuickAcks()).
+        bool quickAckPending = false;
+    };
+
+    // Connections by handle (ordered, so the oldest comes first) and
+    // handles by file descriptor.
+    std::map<ConnectionHandle, std::unique_ptr<Connection>> mConnections;
+    std::unordered_map<int, ConnectionHandle> mHandlesByFD;
+    ConnectionHandle mLastHandle = noConnection;
+
+    // Monitors the listening socket and the connections.
+    Reactor mReactor;
+    std::vector<Reactor::Event> mEvents;
+
+    // Makes the reactor return on wakeup() (see enableWakeup()).
+    std::unique_ptr<Waker> mWaker;
+
+    // The jobs run by processEvents() (see timers()).
+    TimerWheel mTimers;
+
+    // The callbacks of the watched file descriptors (see watch()).
+    std::unordered_map<int, std::function<void()>> mWatched;
+
+    ///@name Outgoing connection (see openSocketAsync())
+    ///@{
+    ConnectionHandle mOutgoingConnection = noConnection;
+    int mConnectingFD = -1;
+
+    // The timeout of the connection attempt, or the next retry
+    TimerWheel::TimerId mConnectTimer = TimerWheel::noTimer;
+
+    unsigned mConnectFailures = 0;
+    bool mAutoReconnect = false;
+    bool mReconnectNeeded = false;
+    std::chrono::milliseconds mConnectTimeout{3000};
+    std::chrono::milliseconds mBackoffInitial{100};
+    std::chrono::milliseconds mBackoffMax{5000};
+    std::minstd_rand mBackoffRandom;
+
+    // Make a connection attempt (without waiting).
+    void startConnect();
+
+    // Complete the connection attempt in progress.
+    NetworkLib::Status finishConnect();
+
+    // Give up the connection attempt in progress (if any), and
+    // schedule a retry.
+    void retryConnect() noexcept;
+
+    // Give up the connection attempt in progress (if any), and any
+    // scheduled retry.
+    void cancelConnect() noexcept;
+
+    // Set the socket options on a newly created (or accepted) socket.
+    void applySocketOptions(int fd, const char *method) const;
+    ///@}
+
+    ///@name IO_URING transport (see transport())
+    ///@{
+    std::unique_ptr<Uring> mUring;
+
+    // The completions collected by the last wait, and how many of them
+    // have been handled (the others are handled first on the next
+    // call, e.g. if a callback threw).
+    std::vector<Uring::Completion> mCompletions;
+    std::size_t mCompletionsHandled = 0;
+
+    // A send request in flight, with the data it refers to (kept until
+    // it completes, even if the connection is closed meanwhile).
+    struct InFlightSend;
+    std::unordered_map<ConnectionHandle, std::unique_ptr<InFlightSend>>
+        mInFlightSends;
+
+    // Tell if the reactor is monitored through the ring, and if it had
+    // events the last time we looked.
+    bool mReactorPolled = false;
+    bool mReactorReady = false;
+
+    // The connections which received data in the current batch of
+    // completions, to set TCP_QUICKACK on (see SocketOptions).
+    std::vector<ConnectionHandle> mQuickAcks;
+
+    // Prepare the receive request of a connection.
+    void armReceive(ConnectionHandle handle, int fd);
+
+    // Set TCP_QUICKACK again on the connections of mQuickAcks.
+    void rearmQuickAcks();
+
+    // Prepare the send request of a connection, if it has pending
+    // output and no request in flight.
+    void submitSend(ConnectionHandle handle);
+
+    // Wait for completions (like Reactor::wait()), and handle them
+    // (see processEvents_nothrow() for errors).
+    NetworkLib::Result<std::size_t> processCompletions(int timeoutMsec);
+
+    // Handle the completion of a receive or send request. On errors,
+    // the connection has been closed, and the status tells why.
+    NetworkLib::Status handleReceived(const Uring::Completion &completion);
+    NetworkLib::Status handleSent(const Uring::Completion &completion);
+
+    // Wait for the send requests in flight, and drop the ring.
+    void stopUring() noexcept;
+    ///@}
+
+    // Handle the events stored in mEvents by the reactor, returning
+    // the first error.
+    NetworkLib::Status handleReactorEvents();
+
+    // Tell if the event is for the waker (draining it if so).
+    bool isWakeup(const Reactor::Event &event) noexcept;
+
+    // Invoke the callback of a watched file descriptor (see watch()).
+    // Return false if it's not watched.
+    bool invokeWatcher(int fd);
+
+    MessageCallback mMessageCallback;
+    WritableCallback mWritableCallback;
+    ConnectionCallback mConnectionOpenedCallback;
+    ConnectionCallback mConnectionClosedCallback;
+
+    // Return the given connection, or nullptr.
+    Connection *findConnection(ConnectionHandle connection) const;
+
+    // Return the given connection, throwing if there's none.
+    Connection &getConnection(ConnectionHandle connection,
+                              const char *method) const;
+
+    // Setup a newly opened (or accepted) connection.
+    ConnectionHandle setupConnection(int fd);
+
+    // Write out what's pending on the connection (waiting for the
+    // socket as needed). The connection may have been closed
+    // meanwhile, even if there's no error.
+    NetworkLib::Status drainPendingOutput(ConnectionHandle handle);
+
+    // Turn the messages queued by queueMessage() into pending output,
+    // and try writing it out (see `flush()`).
+    NetworkLib::Status flushBatch(ConnectionHandle handle);
+
+    // Flush the batches whose deadline expired, and return how long
+    // (in milliseconds, rounded up) until the next deadline, or
+    // timeoutMsec if it comes earlier. The first error (if any) is
+    // stored in status, unless it's already an error.
+    int flushExpiredBatches(int timeoutMsec, NetworkLib::Status &status);
+
+    // Wait (with no timeout) for the given fd to become ready for the
+    // given Reactor events, or for a signal.
+    void waitForFD(int fd, unsigned events) const;
+
+    enum class FillResult { DATA, WOULD_BLOCK, CLOSED, FAILED };
+
+    // Read in whatever is available (in one read(2)) into the
+    // connection framer. On FAILED the connection has been closed, and
+    // the status tells why.
+    FillResult fillFramer(ConnectionHandle handle, Connection &connection,
+                          NetworkLib::Status &status);
+
+    // Read in whatever is available (in one read(2)) into the given
+    // memory, setting count to the number of bytes read. On CLOSED
+    // and FAILED the connection has been closed.
+    FillResult readSome(ConnectionHandle handle, int fd, unsigned char *data,
+                        std::size_t size, std::size_t &count,
+                        NetworkLib::Status &status);
+
+    // Read in exactly size bytes into the given memory, waiting as
+    // needed. Returns DATA, CLOSED or FAILED (as readSome()).
+    FillResult readFully(ConnectionHandle handle, int fd, unsigned char *data,
+                         std::size_t size, NetworkLib::Status &status);
+
+    // Read the next message of the connection (with nothing pending in
+    // its framer) straight into the given buffer. The message is empty
+    // if the connection was closed.
+    NetworkLib::Status readMessageInto(ConnectionHandle handle,
+                                       NetworkLib::BufferWritableView &buffer,
+                                       NetworkLib::BufferView &message);
+
+    // Read in data until there's a whole message, waiting as needed.
+    // The message is empty if the connection was closed.
+    NetworkLib::Status receiveMessage(ConnectionHandle handle,
+                                      Connection &connection,
+                                      NetworkLib::BufferView &message);
+
+    // Get the next whole message (or an empty one) from the
+    // connection framer, closing the connection if the data is
+    // broken.
+    NetworkLib::Status nextFramedMessage(ConnectionHandle handle,
+                                         Connection &connection,
+                                         NetworkLib::BufferView &message);
+
+    // Invoke the message callback for all the whole messages in the
+    // connection framer (the callbacks may close the connection).
+    NetworkLib::Status deliverMessages(ConnectionHandle handle);
+
+    // Drop the given number of bytes written out from the pending
+    // output.
+    static void consumePendingOutput(Connection &connection, std::size_t n);
+
+    // Event-driven mode: read in available data
+    NetworkLib::Status handleReadable(ConnectionHandle handle);
+
+    // Event-driven mode: write out pending data
+    NetworkLib::Status handleWritable(ConnectionHandle handle);
+
+    // Update the events we are interested in for the connection and
+    // for the listening socket.
+    void updateConnectionInterest(Connection &connection);
+    void updateListeningInterest();
 };
 
 } // namespace Agent
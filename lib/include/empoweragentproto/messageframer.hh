@@ -0,0 +1,143 @@
+#ifndef EMPOWER_AGENT_MESSAGEFRAMER_HH
+#define EMPOWER_AGENT_MESSAGEFRAMER_HH
+
+#include <empoweragentproto/networklib.hh>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief Split a stream of bytes (e.g. what is read from a TCP
+ *        connection) into whole messages, keeping track of partially
+ *        received messages.
+ *
+ * There should be one MessageFramer per connection. Incoming data is
+ * accepted in whatever amount is available (see `freeSpace()` and
+ * `commit()`, or `feed()`), and complete messages are handed out by
+ * `nextMessage()` as NetworkLib::BufferView objects pointing straight
+ * into the receive buffer (no further copies).
+ *
+ * The receive buffer is large, so a single `read(2)` into
+ * `freeSpace()` can bring in several small messages at once. When the
+ * free space at the end of the receive buffer is not enough any more,
+ * a new receive buffer is allocated and the (partial) data not yet
+ * handed out is moved there. Buffers with messages still referred to
+ * by some BufferView are kept alive by the BufferView itself.
+ */
+class MessageFramer {
+  public:
+    /// @brief Where we are with the message currently being received.
+    enum class State {
+        /// @brief Reading the preamble (the message length is not
+        ///        yet known).
+        READING_PREAMBLE,
+
+        /// @brief Reading the rest of the message.
+        READING_BODY,
+
+        /// @brief At least one whole message is available (call
+        ///        `nextMessage()`).
+        COMPLETE,
+    };
+
+    /// @brief Return a new receive buffer of at least the given size
+    ///        (e.g. `IO::makeMessageBuffer(std::size_t)`).
+    using BufferFactory = NetworkLib::BufferWritableView (*)(std::size_t size);
+
+    ///@name Constructors
+    ///@{
+
+    /// @brief Default constructor.
+    ///
+    /// @param maxMessageSize The maximum size of an acceptable
+    ///        message. Also the minimum size of receive buffers.
+    ///
+    /// @param bufferFactory Where the receive buffers come from. By
+    ///        default, they are allocated on the heap (see
+    ///        `NetworkLib::BufferWritableView::makeEthBuffer()`).
+    explicit MessageFramer(std::size_t maxMessageSize = 65500,
+                           BufferFactory bufferFactory = nullptr)
+        : mMaxMessageSize(maxMessageSize), mBufferFactory(bufferFactory) {}
+
+    ///@}
+
+    /// @name Feeding data
+    /// @{
+
+    /// @brief Return a BufferWritableView on the free space at the
+    ///        end of the receive buffer, where incoming data can be
+    ///        stored (e.g. via `read(2)`). It is never empty, and it
+    ///        is always large enough to hold the rest of the message
+    ///        currently being received (and at times no larger, when
+    ///        that's all what's left of the receive buffer).
+    ///
+    /// After storing data, call `commit()`.
+    NetworkLib::BufferWritableView freeSpace();
+
+    /// @brief Same as `freeSpace()`, but return
+    ///        ErrorCode::BUFFER_TOO_SMALL instead of throwing.
+    NetworkLib::Status freeSpace_nothrow(NetworkLib::BufferWritableView &space);
+
+    /// @brief Tell that `n` bytes have been stored at the beginning
+    ///        of the area returned by the last call to `freeSpace()`.
+    void commit(std::size_t n);
+
+    /// @brief Copy the given data in the receive buffer (it's
+    ///        equivalent to a sequence of `freeSpace()` and
+    ///        `commit()`).
+    void feed(const NetworkLib::BufferView &data);
+
+    /// @}
+
+    /// @name Getting messages
+    /// @{
+
+    /// @brief Return the next complete message, or an empty
+    ///        BufferView if there isn't one (yet).
+    ///
+    /// Throws exceptions if the data doesn't look like a valid
+    /// message (i.e. its length is shorter than the preamble or
+    /// larger than the maximum message size): in that case the
+    /// stream is hopelessly broken, and should be closed.
+    NetworkLib::BufferView nextMessage();
+
+    /// @brief Same as `nextMessage()`, but return
+    ///        ErrorCode::BAD_MESSAGE_LENGTH instead of throwing.
+    NetworkLib::Status
+    nextMessage_nothrow(NetworkLib::BufferView &message) noexcept;
+
+    /// @brief Return the current state.
+    State state() const;
+
+    /// @brief Return how many bytes are still needed to get to the
+    ///        next state (i.e. to complete the preamble, or to
+    ///        complete the message, or `0` when already COMPLETE).
+    std::size_t remaining() const;
+
+    /// @brief Return how many bytes have been received and not yet
+    ///        handed out as messages.
+    std::size_t pendingBytes() const { return mEnd - mBegin; }
+
+    /// @}
+
+    /// @brief Forget about all the data not yet handed out (e.g.
+    ///        because the connection was closed).
+    void reset();
+
+  private:
+    const std::size_t mMaxMessageSize;
+    const BufferFactory mBufferFactory;
+
+    // Receive buffer, with data not yet handed out in [mBegin, mEnd)
+    NetworkLib::BufferWritableView mBuffer;
+    std::size_t mBegin = 0;
+    std::size_t mEnd = 0;
+
+    // Length of the current message, or 0 when not known yet.
+    std::size_t currentMessageLength() const;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef EMPOWER_AGENT_MESSAGETEMPLATE_HH
+#define EMPOWER_AGENT_MESSAGETEMPLATE_HH
+
+#include <empoweragentproto/networklib.hh>
+#include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/tlvencoding.hh>
+#include <empoweragentproto/tlvindex.hh>
+
+#include <cstdint>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief A pre-encoded message (common header and TLVs), to be sent
+ *        many times with just a few fields changed (e.g. a periodic
+ *        report).
+ *
+ * The message is encoded once (e.g. with a MessageEncoder) and
+ * indexed on construction. The TLVs which change are looked up once
+ * too (see `slot()`). Then each message is a copy of the template
+ * (see `instantiate()`) where only the changing fields are patched:
+ *
+ *     MessageTemplate report(encoder.data());
+ *     auto prb = report.slot<TLVMACPrbReportReport>();
+ *     ...
+ *     auto message = report.instantiate(IO::makeMessageBuffer());
+ *     MessageTemplate::sequence(message, ++sequence);
+ *     prb.set<1>(message, dl); // The DL PRB counters
+ *     prb.set<2>(message, ul); // The UL PRB counters
+ *     io.writeMessage(message);
+ *
+ * If a message is not referenced anywhere else any more (e.g. it's
+ * not pending output of IO), it can also be patched again instead of
+ * making a new copy.
+ */
+class MessageTemplate {
+  public:
+    /**
+     * @brief A TLV with a fixed layout (see TLVLayout) within the
+     *        messages made from a MessageTemplate.
+     *
+     * Its methods do not check bounds, and must only be used on
+     * messages obtained from `MessageTemplate::instantiate()`.
+     */
+    template <typename T> class Slot {
+      public:
+        using Layout = typename T::Layout;
+
+        /// @brief The type of the i-th field.
+        template <std::size_t i>
+        using value_type =
+            typename Layout::template Field<i>::type::value_type;
+
+        /// @brief Set the i-th field in the given message.
+        template <std::size_t i>
+        void set(const NetworkLib::BufferWritableView &message,
+                 value_type<i> v) const noexcept {
+            Layout::template store_nocheck<i>(message, v, mOffset);
+        }
+
+        /// @brief Get the i-th field from the given message.
+        template <std::size_t i>
+        value_type<i> get(const NetworkLib::BufferView &message) const
+            noexcept {
+            return TLVFieldCodec<value_type<i>>::load(
+                message, mOffset + Layout::template Field<i>::fieldOffset());
+        }
+
+        /// @brief Encode the whole TLV in the given message.
+        void set(const NetworkLib::BufferWritableView &message,
+                 const T &tlv) const noexcept {
+            Layout::encode_nocheck(tlv, message, mOffset);
+        }
+
+        /// @brief Return the offset of the TLV data in the messages.
+        std::size_t offset() const { return mOffset; }
+
+      private:
+        friend class MessageTemplate;
+
+        explicit Slot(std::size_t offset) : mOffset{offset} {}
+
+        std::size_t mOffset;
+    };
+
+    /// @brief Constructor from an encoded message, which is referred
+    ///        to (not copied).
+    ///
+    /// Throw if the message is malformed (see MessageDecoder).
+    explicit MessageTemplate(const NetworkLib::BufferView &message);
+
+    /// @brief Return the size in bytes of the messages.
+    std::size_t size() const { return mMessage.size(); }
+
+    /// @brief Return the encoded message.
+    const NetworkLib::BufferView &data() const { return mMessage; }
+
+    /// @brief Return the index of the TLVs in the message.
+    const TLVIndex &index() const { return mIndex; }
+
+    /// @brief Return the n-th TLV of type T in the message (see
+    ///        Slot).
+    ///
+    /// Throw std::runtime_error if there's no such TLV, or if its
+    /// length is not the one of T.
+    template <typename T> Slot<T> slot(std::size_t n = 0) const;
+
+    /// @brief Copy the message to the beginning of the given buffer,
+    ///        and return the copy (i.e. the buffer shrinked to the
+    ///        size of the message).
+    ///
+    /// Throw if the buffer is too small.
+    NetworkLib::BufferWritableView
+    instantiate(NetworkLib::BufferWritableView buffer) const;
+
+    ///@name Set common header fields in the given message (obtained
+    ///      from `instantiate()`), **without** checking bounds.
+    ///@{
+    static void sequence(const NetworkLib::BufferWritableView &message,
+                         std::uint32_t v) noexcept {
+        message.setUint32At_nocheck(CommonHeader::sequenceOffset, v);
+    }
+
+    static void transactionId(const NetworkLib::BufferWritableView &message,
+                              std::uint32_t v) noexcept {
+        message.setUint32At_nocheck(CommonHeader::transactionIdOffset, v);
+    }
+    ///@}
+
+  private:
+    NetworkLib::BufferView mMessage;
+    TLVIndex mIndex;
+
+    // Return the position in mIndex of the n-th TLV of the given
+    // type, checking its length (throw if not found).
+    std::size_t findEntry(TLVType type, std::size_t length,
+                          std::size_t n) const;
+};
+
+/**********************************************************************/
+
+template <typename T>
+MessageTemplate::Slot<T> MessageTemplate::slot(std::size_t n) const {
+    using Layout = typename T::Layout;
+
+    const std::size_t i = findEntry(Layout::type(), Layout::size(), n);
+    return Slot<T>(mIndex[i].offset);
+}
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef EMPOWER_NETWORKLIB_METRICS_HH
+#define EMPOWER_NETWORKLIB_METRICS_HH
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Tell if the library keeps metrics (see Metrics).
+///
+/// The metrics are compiled out (and all the methods of Metrics do
+/// nothing) when the library is built with the CMake option
+/// EMPOWER_NETWORKLIB_NO_METRICS.
+#if defined(EMPOWER_NETWORKLIB_NO_METRICS)
+#define NETWORKLIB_HAS_METRICS 0
+#else
+#define NETWORKLIB_HAS_METRICS 1
+#endif
+
+namespace Empower {
+namespace NetworkLib {
+
+/// @brief The event counters kept by the library (see Metrics).
+enum class Counter : std::uint8_t {
+    /// @brief Bytes read from sockets.
+    BYTES_READ,
+
+    /// @brief Bytes written to sockets.
+    BYTES_WRITTEN,
+
+    /// @brief Messages read (framed) from sockets.
+    MESSAGES_READ,
+
+    /// @brief Messages written (or queued for writing) to sockets.
+    MESSAGES_WRITTEN,
+
+    /// @brief Reads which found no data (EAGAIN).
+    READ_WOULD_BLOCK,
+
+    /// @brief Writes which could not proceed (EAGAIN).
+    WRITE_WOULD_BLOCK,
+
+    /// @brief Connection attempts (see IO::openSocket()).
+    CONNECT_ATTEMPTS,
+
+    /// @brief Connection attempts which failed.
+    CONNECT_FAILURES,
+
+    /// @brief Connections accepted on listening sockets.
+    CONNECTIONS_ACCEPTED,
+
+    /// @brief Times a buffer pool had to allocate more buffers.
+    POOL_GROWTHS,
+
+    /// @brief Buffers allocated by growing pools.
+    POOL_BUFFERS_ADDED,
+
+    /// @brief Not a counter: the number of counters.
+    COUNT
+};
+
+/// @brief Return the name of a counter (e.g. "bytes_read").
+const char *counterName(Counter c);
+
+/// @brief The operations whose duration is measured by the library
+///        (see Metrics).
+enum class Timer : std::uint8_t {
+    /// @brief Encoding a TLV (keyed by TLV type).
+    TLV_ENCODE,
+
+    /// @brief Decoding a TLV (keyed by TLV type).
+    TLV_DECODE,
+
+    /// @brief Not a timer: the number of timers.
+    COUNT
+};
+
+/// @brief Return the name of a timer (e.g. "tlv_encode").
+const char *timerName(Timer t);
+
+/**
+ * @brief A histogram of durations (in nanoseconds) with fixed,
+ *        logarithmic buckets (like HDR histograms).
+ *
+ * Each power of two is split into 4 buckets, so that the relative
+ * error of the percentiles is at most 25%. Durations of about 7.5
+ * seconds or more all go in the last bucket.
+ */
+class LatencyHistogram {
+  public:
+    /// @brief The number of buckets.
+    static const std::size_t bucketCount = 128;
+
+    /// @brief Return the bucket of the given duration.
+    static std::size_t bucketOf(std::uint64_t nsec) noexcept {
+        if (nsec < subBuckets) {
+            return static_cast<std::size_t>(nsec);
+        }
+
+        const std::size_t msb =
+            63 - static_cast<std::size_t>(__builtin_clzll(nsec));
+        const std::size_t result =
+            ((msb - subBucketBits + 1) << subBucketBits) +
+            ((nsec >> (msb - subBucketBits)) & (subBuckets - 1));
+        return result < bucketCount ? result : bucketCount - 1;
+    }
+
+    /// @brief Return the smallest duration in the given bucket.
+    static std::uint64_t bucketLowerBound(std::size_t bucket) noexcept {
+        if (bucket < subBuckets) {
+            return bucket;
+        }
+
+        const std::size_t msb =
+            (bucket >> subBucketBits) + subBucketBits - 1;
+        const std::uint64_t mantissa =
+            subBuckets + (bucket & (subBuckets - 1));
+        return mantissa << (msb - subBucketBits);
+    }
+
+    /// @brief Add a duration.
+    void record(std::uint64_t nsec) noexcept {
+        ++mBuckets[bucketOf(nsec)];
+        ++mCount;
+        mSum += nsec;
+
+        if (nsec > mMax) {
+            mMax = nsec;
+        }
+    }
+
+    /// @brief Add all the durations of another histogram.
+    void merge(const LatencyHistogram &other) noexcept;
+
+    /// @brief Return the number of durations.
+    std::uint64_t count() const { return mCount; }
+
+    /// @brief Return the sum of the durations.
+    std::uint64_t sum() const { return mSum; }
+
+    /// @brief Return the longest duration.
+    std::uint64_t max() const { return mMax; }
+
+    /// @brief Return the mean duration (`0` if there are none).
+    std::uint64_t mean() const { return mCount == 0 ? 0 : mSum / mCount; }
+
+    /// @brief Return the number of durations in the given bucket.
+    std::uint64_t bucket(std::size_t i) const { return mBuckets[i]; }
+
+    /// @brief Return (an upper bound of) the duration below which
+    ///        the given fraction (from `0.0` to `1.0`) of durations
+    ///        fall.
+    std::uint64_t percentile(double fraction) const noexcept;
+
+  private:
+    friend class Metrics;
+
+    static const std::size_t subBucketBits = 2;
+    static const std::size_t subBuckets = 1 << subBucketBits;
+
+    std::array<std::uint64_t, bucketCount> mBuckets{};
+    std::uint64_t mCount = 0;
+    std::uint64_t mSum = 0;
+    std::uint64_t mMax = 0;
+};
+
+/// @brief The metrics of all the threads at some point in time (see
+///        Metrics::snapshot()).
+class MetricsSnapshot {
+  public:
+    /// @brief The number of keys of each timer: keys from `0` to
+    ///        `timerKeys - 2` (e.g. TLV types) have their own
+    ///        histogram, the others share the last one.
+    static const std::size_t timerKeys = 17;
+
+    MetricsSnapshot();
+
+    /// @brief Return the value of a counter.
+    std::uint64_t counter(Counter c) const {
+        return mCounters[static_cast<std::size_t>(c)];
+    }
+
+    /// @brief Return the histogram of a timer for the given key.
+    const LatencyHistogram &timer(Timer t, std::size_t key) const {
+        return mTimers[histogramIndex(t, key)];
+    }
+
+    /// @brief Return the histogram index (within a snapshot) of the
+    ///        given timer and key.
+    static std::size_t histogramIndex(Timer t, std::size_t key) {
+        return static_cast<std::size_t>(t) * timerKeys +
+               (key < timerKeys - 1 ? key : timerKeys - 1);
+    }
+
+  private:
+    friend class Metrics;
+
+    std::array<std::uint64_t, static_cast<std::size_t>(Counter::COUNT)>
+        mCounters{};
+    std::vector<LatencyHistogram> mTimers;
+};
+
+/**
+ * @brief Counters and latency histograms of the library internals,
+ *        kept per thread and summed up on demand (see `snapshot()`).
+ *
+ * Counting an event costs an (uncontended, non-atomic) increment of
+ * a thread-local value. Durations are only measured when enabled at
+ * run time (see `timing()`), as each of them takes two reads of the
+ * clock.
+ *
+ * Everything compiles to nothing when NETWORKLIB_HAS_METRICS is 0.
+ */
+class Metrics {
+  public:
+    /// @brief Count some events.
+    static void add(Counter c, std::uint64_t n = 1) noexcept {
+#if NETWORKLIB_HAS_METRICS
+        std::atomic<std::uint64_t> &value =
+            localCounters()[static_cast<std::size_t>(c)];
+
+        // Only this thread writes it: no need for an atomic increment.
+        value.store(value.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+#else
+        (void)c;
+        (void)n;
+#endif
+    }
+
+    /// @brief Add a duration (in nanoseconds) to the histogram of the
+    ///        given timer and key.
+    static void record(Timer t, std::size_t key, std::uint64_t nsec) noexcept;
+
+    /// @brief Tell if durations are measured (default: `false`).
+    static bool timing() noexcept {
+#if NETWORKLIB_HAS_METRICS
+        return sTiming.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    /// @brief Enable or disable measuring durations (from any thread).
+    static void timing(bool v) noexcept;
+
+    /// @brief Return the metrics of all the threads (including the
+    ///        ones which have terminated).
+    static MetricsSnapshot snapshot();
+
+    /**
+     * @brief Measures the duration of its scope (if `timing()` is
+     *        enabled).
+     */
+    class ScopedTimer {
+      public:
+        ScopedTimer(Timer t, std::size_t key) noexcept
+            : mTimer{t}, mKey{key}, mEnabled{timing()} {
+            if (mEnabled) {
+                mStart = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTimer() {
+            if (mEnabled) {
+                using namespace std::chrono;
+                const auto elapsed = duration_cast<nanoseconds>(
+                    steady_clock::now() - mStart);
+                record(mTimer, mKey,
+                       static_cast<std::uint64_t>(elapsed.count()));
+            }
+        }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+      private:
+        Timer mTimer;
+        std::size_t mKey;
+        bool mEnabled;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+#if NETWORKLIB_HAS_METRICS
+    // The metrics of a thread (defined in metrics.cpp).
+    struct ThreadMetrics;
+
+  private:
+    static std::atomic<bool> sTiming;
+
+    // Return the counters of the calling thread.
+    static std::atomic<std::uint64_t> *localCounters() noexcept;
+
+    // Add the metrics of a thread to a snapshot.
+    static void accumulate(MetricsSnapshot &snapshot,
+                           const ThreadMetrics &thread);
+#endif
+};
+
+} // namespace NetworkLib
+} // namespace Empower
+
+#endif
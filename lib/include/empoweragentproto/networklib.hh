@@ -2,6 +2,9 @@
 #define EMPOWER_NETWORKLIB_HH
 
 #include <empoweragentproto/buffers.hh>
+#include <empoweragentproto/metrics.hh>
+#include <empoweragentproto/spscring.hh>
+#include <empoweragentproto/status.hh>
 #include <empoweragentproto/utils.hh>
 
 #endif
@@ -25,6 +25,10 @@ enum class EntityClass : std::uint16_t {
     // Simple echo service
     ECHO_SERVICE = 0xff,
 
+    // This service provides the metrics of the agent library (see
+    // encodeAgentStatsReply())
+    AGENT_STATS_SERVICE = 0xfe,
+
     // This service sends out periodic requests to the controller
     // specifying the periodicity and expects back a responses.
     HELLO_SERVICE = 0x0,
@@ -242,6 +246,17 @@ enum class MessageClass : std::uint8_t {
     RESPONSE_FAILURE = 65,
 };
 
+/// @brief The fields of a common header, decoded once (see
+///        CommonHeaderDecoder::fields()).
+struct CommonHeaderFields {
+    MessageClass messageClass = MessageClass::INVALID;
+    EntityClass entityClass = EntityClass::ECHO_SERVICE;
+    std::uint32_t sequence = 0;
+    std::uint64_t elementId = 0;
+    std::uint32_t transactionId = 0;
+    std::size_t totalLength = 0;
+};
+
 /**
  * @brief Decode a preamble + common header from a data stored in a
  *        BufferView.
@@ -264,6 +279,17 @@ class CommonHeaderDecoder {
     CommonHeaderDecoder(NetworkLib::BufferView &&messageData);
     ///@}
 
+    /// @brief Check if a BufferView is suitable for decoding (i.e. if
+    ///        the constructors wouldn't throw), without throwing.
+    static NetworkLib::Status
+    check(const NetworkLib::BufferView &messageData) noexcept;
+
+    /// @brief Attach to another BufferView, as if newly constructed.
+    ///
+    /// Throws exceptions if the BufferView is unsuitable, in which
+    /// case the decoder is unchanged.
+    void reset(const NetworkLib::BufferView &messageData);
+
     ///@name No default constructor
     ///@{
     CommonHeaderDecoder() = delete;
@@ -302,12 +328,20 @@ class CommonHeaderDecoder {
     /// @brief Tells if this is a request to set, add, del, get some
     ///        value on a entity, of if this is a response which is
     ///        either successfull or a failure.
+    ///
+    /// Requests are told apart by bits 14-15 of ts_rc: UPDATE (`1`)
+    /// is MessageClass::REQUEST_SET, CREATE (`2`) REQUEST_ADD, DELETE
+    /// (`3`) REQUEST_DEL and UNDEFINED (`0`) REQUEST_GET (RETRIEVE,
+    /// `4`, doesn't fit there).
     MessageClass messageClass() const;
 
     /// @brief Tells the class of the entity involved in this message
     ///        exchange (think of it as a service type).
     EntityClass entityClass() const;
 
+    /// @brief Decode all the fields at once.
+    CommonHeaderFields fields() const;
+
     /// @brief Return a BufferView with the payload *after* the
     /// preamble and common header..
     NetworkLib::BufferView data() const {
@@ -327,7 +361,7 @@ class CommonHeaderDecoder {
         flagsRequestOrResponseMask = 1 << 7,
     };
 
-    const NetworkLib::BufferView mBufferView;
+    NetworkLib::BufferView mBufferView;
 
     /// @brief The version (from the preamble).
     std::uint8_t version() const;
@@ -335,7 +369,7 @@ class CommonHeaderDecoder {
     /// @brief The flags (from the preamble).
     std::uint8_t flags() const;
 
-    // Sanity checks performed on construction
+    // Sanity checks performed on construction (see `check()`)
     void throwIfBufferIsUnsuitable(const char *method);
 };
 
@@ -360,6 +394,20 @@ class CommonHeaderEncoder {
     CommonHeaderEncoder(NetworkLib::BufferWritableView &&buffer);
     ///@}
 
+    /// @brief Check if a BufferWritableView is suitable for encoding
+    ///        (i.e. if the constructors wouldn't throw), without
+    ///        throwing.
+    static NetworkLib::Status
+    check(const NetworkLib::BufferWritableView &buffer) noexcept;
+
+    /// @brief Attach to another BufferWritableView, as if newly
+    ///        constructed (i.e. setting the default values of the
+    ///        fields again).
+    ///
+    /// Throws exceptions if the BufferWritableView is unsuitable, in
+    /// which case the encoder is unchanged.
+    void reset(const NetworkLib::BufferWritableView &buffer);
+
     ///@name No default constructor
     ///@{
     CommonHeaderEncoder() = delete;
@@ -392,6 +440,10 @@ class CommonHeaderEncoder {
     ///@name Utilities
     ///@{
 
+    /// @brief Set the request/response flag and bits 14-15 of ts_rc
+    ///        (see `CommonHeaderDecoder::messageClass()`, which
+    ///        decodes them back). Throws std::invalid_argument with
+    ///        MessageClass::INVALID.
     CommonHeaderEncoder &messageClass(MessageClass);
     CommonHeaderEncoder &entityClass(EntityClass);
 
@@ -408,9 +460,9 @@ class CommonHeaderEncoder {
 
     CommonHeaderEncoder &version(std::uint8_t version);
 
-    const NetworkLib::BufferWritableView mBufferWritableView;
+    NetworkLib::BufferWritableView mBufferWritableView;
 
-    // Sanity checks performed on construction
+    // Sanity checks performed on construction (see `check()`)
     void throwIfBufferIsUnsuitable(const char *method);
 
     void setDefaults();
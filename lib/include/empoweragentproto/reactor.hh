@@ -0,0 +1,192 @@
+#ifndef EMPOWER_AGENT_REACTOR_HH
+#define EMPOWER_AGENT_REACTOR_HH
+
+#include <empoweragentproto/networklib.hh>
+
+// For struct pollfd
+#include <poll.h>
+
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief A minimal readiness notification facility for file
+ *        descriptors (a *reactor*).
+ *
+ * File descriptors are registered once together with the events we
+ * are interested in, and then `wait()` tells which of them are ready.
+ * Unlike `select(2)`, the set of monitored file descriptors is not
+ * rebuilt on each call.
+ *
+ * On Linux the reactor is based on `epoll(7)`. Everywhere else (or
+ * when explicitly asked for) it falls back to `poll(2)`.
+ */
+class Reactor {
+  public:
+    /// @brief The mechanism used to wait for events.
+    enum class Backend {
+        /// @brief Use `epoll(7)` (Linux only).
+        EPOLL,
+
+        /// @brief Use `poll(2)`.
+        POLL,
+    };
+
+    /// @brief Bits telling which events we are interested in (or
+    ///        which events occurred).
+    enum : unsigned {
+        /// @brief Data can be read (or a connection can be accepted).
+        READABLE = 1 << 0,
+
+        /// @brief Data can be written.
+        WRITABLE = 1 << 1,
+
+        /// @brief An error or a hang-up occurred (only reported,
+        ///        there's no need to ask for it).
+        FAILED = 1 << 2,
+    };
+
+    /// @brief An event reported by `wait()`.
+    struct Event {
+        /// @brief The file descriptor the event refers to.
+        int fd;
+
+        /// @brief A combination of `READABLE`, `WRITABLE` and `FAILED`.
+        unsigned events;
+    };
+
+    /// @brief Return the best backend available on this platform.
+    static Backend defaultBackend();
+
+    ///@name Constructors
+    ///@{
+
+    /// @brief Constructor using the given backend.
+    ///
+    /// Throws exceptions on errors.
+    explicit Reactor(Backend backend = defaultBackend());
+
+    ///@}
+
+    ~Reactor();
+
+    ///@name No copy semantic
+    ///@{
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+    ///@}
+
+    ///@name No move semantic
+    ///@{
+    Reactor(Reactor &&) = delete;
+    Reactor &operator=(Reactor &&) = delete;
+    ///@}
+
+    /// @brief Return the backend in use.
+    Backend backend() const { return mBackend; }
+
+    /// @brief Return a file descriptor which becomes readable when
+    ///        some registered file descriptor is ready (so that the
+    ///        reactor can be monitored by another event loop), or `-1`
+    ///        with the POLL backend.
+    int fd() const { return mEpollFD; }
+
+    /// @name Registration
+    /// @{
+
+    /// @brief Start monitoring the given file descriptor for the given
+    ///        events. Throws exceptions on errors.
+    void add(int fd, unsigned events);
+
+    /// @brief Change the events the given (already registered) file
+    ///        descriptor is monitored for. Throws exceptions on errors.
+    void modify(int fd, unsigned events);
+
+    /// @brief Stop monitoring the given file descriptor. Don't
+    ///        complain if it isn't registered.
+    void remove(int fd) noexcept;
+
+    /// @brief Tell if the given file descriptor is registered.
+    bool isRegistered(int fd) const;
+
+    /// @}
+
+    /// @brief Wait up to `timeoutMsec` milliseconds (`-1` means
+    ///        forever, `0` means don't wait at all) for events on the
+    ///        registered file descriptors.
+    ///
+    /// `events` is cleared and then filled with the events which
+    /// occurred. Being interrupted by a signal is not an error (it
+    /// just looks like a timeout).
+    ///
+    /// @return The number of events stored in `events` (`0` if the
+    ///         timeout expired).
+    std::size_t wait(int timeoutMsec, std::vector<Event> &events);
+
+  private:
+    Backend mBackend;
+
+    // Used only by the EPOLL backend
+    int mEpollFD = -1;
+
+    // Used only by the POLL backend (kept up to date by add(),
+    // modify() and remove(), so it's ready for poll(2)).
+    std::vector<pollfd> mPollFDs;
+
+    // The registered file descriptors and their interest set (used
+    // by both backends).
+    std::vector<Event> mRegistered;
+
+    std::vector<Event>::iterator findRegistered(int fd);
+    std::vector<Event>::const_iterator findRegistered(int fd) const;
+};
+
+/**
+ * @brief A file descriptor which becomes readable when `wake()` is
+ *        called, so that a thread waiting on a Reactor can be
+ *        interrupted by other threads.
+ *
+ * Based on `eventfd(2)` on Linux, and on a pipe elsewhere.
+ */
+class Waker {
+  public:
+    /// @brief Constructor. Throws exceptions on errors.
+    Waker();
+
+    ~Waker();
+
+    ///@name No copy semantic
+    ///@{
+    Waker(const Waker &) = delete;
+    Waker &operator=(const Waker &) = delete;
+    ///@}
+
+    ///@name No move semantic
+    ///@{
+    Waker(Waker &&) = delete;
+    Waker &operator=(Waker &&) = delete;
+    ///@}
+
+    /// @brief The file descriptor to monitor (for Reactor::READABLE).
+    int fd() const { return mReadFD; }
+
+    /// @brief Make the file descriptor readable. Can be called from
+    ///        any thread.
+    void wake() noexcept;
+
+    /// @brief Make the file descriptor not readable any more.
+    void drain() noexcept;
+
+  private:
+    int mReadFD = -1;
+
+    // Same as mReadFD with eventfd(2)
+    int mWriteFD = -1;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef EMPOWER_AGENT_SHMRING_HH
+#define EMPOWER_AGENT_SHMRING_HH
+
+#include <empoweragentproto/networklib.hh>
+
+#include <cstdint>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief A ring of messages in memory shared with another process (or
+ *        thread), with a single producer and a single consumer (Linux
+ *        only).
+ *
+ * The producer encodes messages right into the ring (or copies them
+ * there, see `tryWrite()`), and the consumer gets them as BufferView
+ * objects pointing into the ring, so messages go from one process to
+ * the other without being copied through the kernel:
+ *
+ *     // Producer
+ *     auto space = ring.reserve(1024);
+ *
+ *     if (!space.empty()) {
+ *         MessageEncoder encoder(space);
+ *         ...
+ *         encoder.end();
+ *         ring.commit(encoder.data().size());
+ *     }
+ *
+ *     // Consumer
+ *     for (auto m = ring.front(); !m.empty(); m = ring.front()) {
+ *         ...
+ *         ring.pop();
+ *     }
+ *
+ * Neither side calls into the kernel, unless the other one is waiting
+ * (see `waitForData()` and `waitForSpace()`, or `armDataNotification()`
+ * to wait in a main loop, e.g. via `IO::watch()`): then it's woken up
+ * through an eventfd(2).
+ *
+ * One process creates the ring (see `SharedMemoryRing(std::size_t)`)
+ * and hands its file descriptors (see `descriptors()`) to the other
+ * one, e.g. across fork(2) or over a Unix-domain socket (see
+ * `sendDescriptors()`), which attaches to it (see
+ * `SharedMemoryRing(const Descriptors &)`). For two-way communication,
+ * use two rings.
+ */
+class SharedMemoryRing {
+  public:
+    /// @brief The file descriptors of a ring.
+    struct Descriptors {
+        /// @brief The shared memory (see memfd_create(2)).
+        int memory = -1;
+
+        /// @brief Signalled by the producer (see `dataFD()`).
+        int data = -1;
+
+        /// @brief Signalled by the consumer (see `spaceFD()`).
+        int space = -1;
+    };
+
+    /// @brief Create a ring. Throws std::runtime_error on errors.
+    ///
+    /// @param capacity The size (in bytes) of the ring, rounded up to
+    ///        a power of two (and to at least 128 KiB, so that any
+    ///        message fits). Each message takes its size rounded up to
+    ///        8 bytes, plus 8 bytes.
+    explicit SharedMemoryRing(std::size_t capacity = 1 << 20);
+
+    /// @brief Attach to a ring created by another process (the file
+    ///        descriptors are duplicated, so the caller still has to
+    ///        close them). Throws std::runtime_error on errors.
+    explicit SharedMemoryRing(const Descriptors &descriptors);
+
+    ~SharedMemoryRing();
+
+    ///@name No copy semantic
+    ///@{
+    SharedMemoryRing(const SharedMemoryRing &) = delete;
+    SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+    ///@}
+
+    /// @brief Return the file descriptors to hand to the other side.
+    Descriptors descriptors() const;
+
+    /// @brief Return the size (in bytes) of the ring.
+    std::size_t capacity() const { return mCapacity; }
+
+    /// @brief Send the given file descriptors over a Unix-domain
+    ///        socket (see unix(7), SCM_RIGHTS). Throws
+    ///        std::runtime_error on errors.
+    static void sendDescriptors(int socketFD, const Descriptors &descriptors);
+
+    /// @brief Receive file descriptors sent by `sendDescriptors()`
+    ///        (waiting for them). They must be closed once attached.
+    ///        Throws std::runtime_error on errors.
+    static Descriptors receiveDescriptors(int socketFD);
+
+    /// @name Producer side
+    /// @{
+
+    /// @brief Return the room for a message of up to the given size,
+    ///        to be published by `commit()`, or an empty
+    ///        BufferWritableView if there's not enough room for now.
+    ///
+    /// Reserving again without committing drops the previous
+    /// reservation. Throws std::invalid_argument if the size is 0, or
+    /// more than `capacity() - 8`.
+    NetworkLib::BufferWritableView reserve(std::size_t size);
+
+    /// @brief Publish the first `size` bytes of the room returned by
+    ///        the last `reserve()` (`0` drops the reservation). Throws
+    ///        std::invalid_argument if that's more than what was
+    ///        reserved.
+    void commit(std::size_t size);
+
+    /// @brief Copy a message (the whole BufferView) into the ring.
+    ///
+    /// @return false if there's not enough room for now (see
+    ///         `reserve()` for the errors).
+    bool tryWrite(const NetworkLib::BufferView &message);
+
+    /// @brief Wait up to `timeoutMsec` milliseconds (`-1` means
+    ///        forever) until there's room for a message of the given
+    ///        size. Return false on timeout.
+    bool waitForSpace(std::size_t size, int timeoutMsec);
+
+    /// @brief Return a file descriptor which becomes readable when the
+    ///        consumer frees some room after `armSpaceNotification()`.
+    int spaceFD() const { return mSpaceFD; }
+
+    /// @brief Ask the consumer to signal `spaceFD()` when it frees
+    ///        some room.
+    ///
+    /// @return false (so don't wait) if there's room for a message of
+    ///         the given size already.
+    bool armSpaceNotification(std::size_t size) noexcept;
+
+    /// @}
+
+    /// @name Consumer side
+    /// @{
+
+    /// @brief Return the oldest message (pointing into the ring, and
+    ///        valid until `pop()`), or an empty BufferView if there's
+    ///        none (or if the ring is corrupted, see `corrupted()`).
+    NetworkLib::BufferView front();
+
+    /// @brief Drop the oldest message (if any).
+    void pop();
+
+    /// @brief Tell if there are no messages.
+    bool empty();
+
+    /// @brief Wait up to `timeoutMsec` milliseconds (`-1` means
+    ///        forever) for a message. Return false on timeout.
+    bool waitForData(int timeoutMsec);
+
+    /// @brief Return a file descriptor which becomes readable when the
+    ///        producer publishes a message after
+    ///        `armDataNotification()`.
+    int dataFD() const { return mDataFD; }
+
+    /// @brief Ask the producer to signal `dataFD()` on the next
+    ///        message (and clear the previous signal).
+    ///
+    /// @return false (so don't wait) if there are messages already.
+    ///
+    /// In a main loop, consume the messages until this returns true:
+    ///
+    ///     io.watch(ring.dataFD(), [&] {
+    ///         do {
+    ///             while (!ring.empty()) { ...; ring.pop(); }
+    ///         } while (!ring.armDataNotification());
+    ///     });
+    bool armDataNotification() noexcept;
+
+    /// @brief Tell if the producer published a record (or a tail)
+    ///        lying outside of the ring, or past what it published.
+    ///        From then on no more messages are handed out (and
+    ///        `waitForData()` returns false right away).
+    bool corrupted() const { return mCorrupted; }
+
+    /// @}
+
+  private:
+    // The part of the shared memory before the messages (defined in
+    // shmring.cpp).
+    struct Shared;
+
+    int mMemoryFD = -1;
+    int mDataFD = -1;
+    int mSpaceFD = -1;
+
+    Shared *mShared = nullptr;
+    unsigned char *mData = nullptr;
+    std::size_t mMappedSize = 0;
+    std::size_t mCapacity = 0;
+
+    ///@name Producer state
+    ///@{
+    std::uint64_t mTail = 0;
+    std::uint64_t mCachedHead = 0;
+
+    // The last reservation (see reserve())
+    std::size_t mReserved = 0;
+    bool mHasReservation = false;
+    ///@}
+
+    ///@name Consumer state
+    ///@{
+    std::uint64_t mHead = 0;
+    std::uint64_t mCachedTail = 0;
+
+    // The size of the record of the message returned by front()
+    std::size_t mFrontRecord = 0;
+
+    // See corrupted()
+    bool mCorrupted = false;
+    ///@}
+
+    // Map the shared memory, and check (or initialize) its header.
+    void map(bool create, const char *method);
+
+    // Undo the constructor (even a partial one).
+    void release() noexcept;
+
+    // Tell if there's room for a record of the given size at the tail,
+    // first skipping the end of the ring (with a wrap marker) if the
+    // record doesn't fit there.
+    bool makeRoom(std::size_t record) noexcept;
+
+    // Move the tail (producer side) or the head (consumer side), and
+    // wake up the other side if it's waiting.
+    void publish(std::uint64_t tail) noexcept;
+    void advance(std::uint64_t head) noexcept;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef EMPOWER_NETWORKLIB_SPSCRING_HH
+#define EMPOWER_NETWORKLIB_SPSCRING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Empower {
+namespace NetworkLib {
+
+/**
+ * @brief A bounded, lock-free queue with a single producer thread and
+ *        a single consumer thread (a *ring*).
+ *
+ * `tryPush()` must always be called by the same thread, and `tryPop()`
+ * by the same (other) thread. Neither of them ever blocks or calls
+ * into the kernel: they fail instead if the ring is full or empty.
+ *
+ * The producer and the consumer indexes are kept in different cache
+ * lines, and each side caches the index of the other one, so that in
+ * the common case an operation touches only its own cache line (plus
+ * the slot).
+ *
+ * @param T The type of the elements, which must be default
+ *          constructible and movable. Popped slots are reset to
+ *          `T()`, so that e.g. a BufferView releases its buffer as
+ *          soon as it's popped.
+ */
+template <typename T> class SPSCRing {
+  public:
+    /// @brief Constructor.
+    ///
+    /// @param capacity The maximum number of elements in the ring
+    ///        (rounded up to a power of two).
+    explicit SPSCRing(std::size_t capacity)
+        : mSlots(roundUpToPowerOfTwo(capacity)),
+          mMask{mSlots.size() - 1} {}
+
+    ///@name No copy semantic
+    ///@{
+    SPSCRing(const SPSCRing &) = delete;
+    SPSCRing &operator=(const SPSCRing &) = delete;
+    ///@}
+
+    /// @brief Return the maximum number of elements in the ring.
+    std::size_t capacity() const { return mSlots.size(); }
+
+    /// @brief Return the number of elements in the ring (exact only
+    ///        when called by the producer or by the consumer while the
+    ///        other side is idle).
+    std::size_t size() const {
+        return mProducer.index.load(std::memory_order_acquire) -
+               mConsumer.index.load(std::memory_order_acquire);
+    }
+
+    /// @brief Tell if the ring is empty (see `size()`).
+    bool empty() const { return size() == 0; }
+
+    /// @brief Append an element (producer only).
+    ///
+    /// @return false if the ring is full (and the element is left
+    ///         untouched).
+    bool tryPush(T &&v) {
+        const std::size_t tail =
+            mProducer.index.load(std::memory_order_relaxed);
+
+        if (tail - mProducer.cachedOther == mSlots.size()) {
+            // Looks full: see how far the consumer got.
+            mProducer.cachedOther =
+                mConsumer.index.load(std::memory_order_acquire);
+
+            if (tail - mProducer.cachedOther == mSlots.size()) {
+                return false;
+            }
+        }
+
+        mSlots[tail & mMask] = std::move(v);
+        mProducer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Append a copy of an element (producer only).
+    bool tryPush(const T &v) {
+        T copy(v);
+        return tryPush(std::move(copy));
+    }
+
+    /// @brief Remove the oldest element (consumer only).
+    ///
+    /// @return false if the ring is empty.
+    bool tryPop(T &v) {
+        const std::size_t head =
+            mConsumer.index.load(std::memory_order_relaxed);
+
+        if (head == mConsumer.cachedOther) {
+            // Looks empty: see how far the producer got.
+            mConsumer.cachedOther =
+                mProducer.index.load(std::memory_order_acquire);
+
+            if (head == mConsumer.cachedOther) {
+                return false;
+            }
+        }
+
+        T &slot = mSlots[head & mMask];
+        v = std::move(slot);
+        slot = T();
+        mConsumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    static const std::size_t cacheLineSize = 64;
+
+    // The index of one side (only ever incremented, wrapping around),
+    // and the last seen index of the other side, alone in their cache
+    // line.
+    struct Side {
+        std::atomic<std::size_t> index{0};
+        std::size_t cachedOther = 0;
+        char padding[cacheLineSize - sizeof(std::atomic<std::size_t>) -
+                     sizeof(std::size_t)];
+    };
+
+    // Keep the sides off the cache lines of whatever comes before
+    char mPadding[cacheLineSize];
+    Side mProducer;
+    Side mConsumer;
+
+    std::vector<T> mSlots;
+    const std::size_t mMask;
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t n) {
+        std::size_t result = 1;
+
+        while (result < n) {
+            result <<= 1;
+        }
+
+        return result;
+    }
+};
+
+} // namespace NetworkLib
+} // namespace Empower
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef EMPOWER_NETWORKLIB_STATUS_HH
+#define EMPOWER_NETWORKLIB_STATUS_HH
+
+#include <empoweragentproto/utils.hh>
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+namespace Empower {
+namespace NetworkLib {
+
+/**
+ * @brief The errors reported by the `_nothrow` variants of functions
+ *        (see Status).
+ */
+enum class ErrorCode : std::uint8_t {
+    /// @brief No error
+    OK = 0,
+
+    /// @brief Access out of the bounds of a buffer
+    OUT_OF_BOUNDS,
+
+    /// @brief Message shorter than its common header
+    MESSAGE_TOO_SHORT,
+
+    /// @brief Wrong protocol version
+    BAD_VERSION,
+
+    /// @brief Bad message length in the preamble
+    BAD_MESSAGE_LENGTH,
+
+    /// @brief TLV truncated, or with a bad length
+    BAD_TLV_LENGTH,
+
+    /// @brief TLV with an unexpected type
+    TLV_TYPE_MISMATCH,
+
+    /// @brief TLV with a length different from what its type requires
+    TLV_LENGTH_MISMATCH,
+
+    /// @brief Too many TLVs to index (see Agent::TLVIndex)
+    TOO_MANY_TLVS,
+
+    /// @brief Buffer too small for the data
+    BUFFER_TOO_SMALL,
+
+    /// @brief No such connection
+    NO_CONNECTION,
+
+    /// @brief Invalid argument
+    INVALID_ARGUMENT,
+
+    /// @brief A system call failed (see Status::sysErrno())
+    SYSTEM_ERROR,
+
+    /// @brief The operation is not supported (e.g. by the transport
+    ///        in use)
+    UNSUPPORTED,
+
+    /// @brief No answer in time (e.g. to a request, see
+    ///        Agent::ClientSession)
+    TIMED_OUT,
+};
+
+/**
+ * @brief The outcome of an operation which reports errors without
+ *        throwing exceptions: an ErrorCode, plus the `errno` value
+ *        for ErrorCode::SYSTEM_ERROR.
+ *
+ * It's small, it never allocates memory and its textual description
+ * is a string literal, so it's cheap even when the errors are
+ * frequent (e.g. when a peer sends junk data).
+ *
+ * The throwing variants of functions are built on top of the
+ * `_nothrow` ones via `raise()`.
+ */
+class Status {
+  public:
+    /// @brief Default constructor: no error.
+    Status() noexcept = default;
+
+    Status(ErrorCode code, int sysErrno = 0) noexcept
+        : mCode{code}, mSysErrno{sysErrno} {}
+
+    /// @brief Return true if there's no error.
+    bool ok() const noexcept { return mCode == ErrorCode::OK; }
+
+    /// @brief Same as `ok()`.
+    explicit operator bool() const noexcept { return ok(); }
+
+    ErrorCode code() const noexcept { return mCode; }
+
+    /// @brief Return the `errno` value for ErrorCode::SYSTEM_ERROR,
+    ///        or 0.
+    int sysErrno() const noexcept { return mSysErrno; }
+
+    /// @brief Return a description of the error (a string literal).
+    const char *message() const noexcept;
+
+    /// @brief If this is an error, throw the matching exception (see
+    ///        NETWORKLIB_THROW), mentioning `function`.
+    ///
+    /// ErrorCode::OUT_OF_BOUNDS throws std::out_of_range,
+    /// ErrorCode::MESSAGE_TOO_SHORT std::length_error,
+    /// ErrorCode::INVALID_ARGUMENT std::invalid_argument, any other
+    /// error std::runtime_error.
+    void raise(const char *function) const {
+        if (!ok()) {
+            raiseError(function);
+        }
+    }
+
+    friend bool operator==(const Status &lhs, const Status &rhs) {
+        return lhs.mCode == rhs.mCode && lhs.mSysErrno == rhs.mSysErrno;
+    }
+
+    friend bool operator!=(const Status &lhs, const Status &rhs) {
+        return !(lhs == rhs);
+    }
+
+  private:
+    ErrorCode mCode = ErrorCode::OK;
+    int mSysErrno = 0;
+
+    [[noreturn]] void raiseError(const char *function) const;
+};
+
+/// @brief Obtain a textual representation of a Status.
+std::ostream &operator<<(std::ostream &ostr, const Status &status);
+
+/**
+ * @brief Either a value of type T or an error Status (like
+ *        `std::expected`, which is C++23).
+ *
+ * T must be default-constructible.
+ */
+template <typename T> class Result {
+  public:
+    /// @brief A successful result.
+    Result(T value) : mValue(std::move(value)) {}
+
+    /// @brief A failure (`status` must not be OK).
+    Result(Status status) : mValue(), mStatus{status} {}
+
+    bool ok() const noexcept { return mStatus.ok(); }
+
+    explicit operator bool() const noexcept { return ok(); }
+
+    const Status &status() const noexcept { return mStatus; }
+
+    /// @brief Return the value (a default-constructed one on
+    ///        failure).
+    ///@{
+    const T &value() const & noexcept { return mValue; }
+    T &value() & noexcept { return mValue; }
+    T &&value() && noexcept { return std::move(mValue); }
+    ///@}
+
+    /// @brief Return the value, or throw if this is a failure (see
+    ///        Status::raise()).
+    T valueOrRaise(const char *function) && {
+        mStatus.raise(function);
+        return std::move(mValue);
+    }
+
+  private:
+    T mValue;
+    Status mStatus;
+};
+
+} // namespace NetworkLib
+} // namespace Empower
+
+#endif
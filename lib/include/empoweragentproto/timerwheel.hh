@@ -0,0 +1,197 @@
+#ifndef EMPOWER_AGENT_TIMERWHEEL_HH
+#define EMPOWER_AGENT_TIMERWHEEL_HH
+
+#include <empoweragentproto/networklib.hh>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief Schedules one-shot and periodic jobs, with a fixed time
+ *        granularity (the *tick*), in a hierarchical timer wheel.
+ *
+ * Scheduling and cancelling a job take constant time, whatever the
+ * number of jobs (e.g. one per UE measurement, keyed by RNTI and
+ * measId). Jobs are run by `advance()`, in the order of their
+ * expiration tick (jobs expiring in the same tick run in no
+ * particular order):
+ *
+ *     TimerWheel &timers = io.timers();
+ *     auto id = timers.schedulePeriodic(
+ *         std::chrono::milliseconds(periodicity.milliseconds()), rnti,
+ *         [&](TimerWheel::TimerId, std::uint64_t rnti) {
+ *             io.queueMessage(encodeReport(rnti));
+ *         });
+ *     ...
+ *     timers.cancel(id);
+ *
+ * IO runs the jobs of its own TimerWheel (see `IO::timers()`) in
+ * `IO::processEvents()`, and then flushes the messages they queued
+ * (see `IO::queueMessage()`) at once.
+ *
+ * The wheel has 4 levels of 256 slots: level 0 holds the jobs
+ * expiring in the next 256 ticks, level 1 the ones expiring in the
+ * next 65536 ticks, and so on. Every 256 ticks, the jobs in the next
+ * slot of level 1 move down to level 0 (and every 65536 ticks from
+ * level 2 to level 1, and so on).
+ *
+ * Not thread safe.
+ */
+class TimerWheel {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Identifies a scheduled job.
+    using TimerId = std::uint64_t;
+
+    /// @brief Never the identifier of a scheduled job.
+    static const TimerId noTimer = 0;
+
+    /// @brief A job, invoked with its identifier and its key.
+    using Callback = std::function<void(TimerId, std::uint64_t key)>;
+
+    /// @brief Constructor.
+    ///
+    /// @param tick The granularity of the wheel (at least 1 ms).
+    /// @param start The time of tick `0`.
+    explicit TimerWheel(std::chrono::milliseconds tick =
+                            std::chrono::milliseconds(1),
+                        Clock::time_point start = Clock::now());
+
+    ///@name No copy semantic
+    ///@{
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+    ///@}
+
+    /// @brief Return the granularity of the wheel.
+    std::chrono::milliseconds tick() const { return mTick; }
+
+    /// @brief Schedule a job to run once, after the given delay
+    ///        (rounded up to a whole number of ticks, at least one).
+    ///
+    /// @param key Passed as is to the callback (e.g. an RNTI).
+    TimerId schedule(std::chrono::milliseconds delay, std::uint64_t key,
+                     Callback callback);
+
+    /// @brief Schedule a job to run every `period` (rounded up to a
+    ///        whole number of ticks, at least one), starting one
+    ///        period from now.
+    ///
+    /// The job keeps its phase: if `advance()` is called late, it
+    /// runs once and is rescheduled for the next period boundary.
+    TimerId schedulePeriodic(std::chrono::milliseconds period,
+                             std::uint64_t key, Callback callback);
+
+    /// @brief Cancel a job (possibly from within a job).
+    ///
+    /// @return false if no such job is scheduled (e.g. a one-shot
+    ///         job which already ran).
+    bool cancel(TimerId id) noexcept;
+
+    /// @brief Tell if a job is scheduled.
+    bool scheduled(TimerId id) const noexcept;
+
+    /// @brief Return the number of scheduled jobs.
+    std::size_t size() const { return mSize; }
+
+    /// @brief Tell if no job is scheduled.
+    bool empty() const { return mSize == 0; }
+
+    /// @brief Run all the jobs expiring up to the given time.
+    ///
+    /// @return The number of jobs run.
+    std::size_t advance(Clock::time_point now = Clock::now());
+
+    /// @brief Return how long (in milliseconds, rounded up) to wait
+    ///        from the given time before calling `advance()` again,
+    ///        or `-1` if no job is scheduled.
+    ///
+    /// Jobs more than 256 ticks away make this return at most the
+    /// time to the next move between levels.
+    int timeoutMsec(Clock::time_point now = Clock::now()) const;
+
+  private:
+    static const std::size_t levels = 4;
+    static const std::size_t slotBits = 8;
+    static const std::size_t slotsPerLevel = 1 << slotBits;
+    static const std::uint32_t nil = 0xffffffff;
+
+    // A scheduled job (or a free one), linked in a slot (or in the
+    // free list, via next).
+    struct Node {
+        Callback callback;
+        std::uint64_t key = 0;
+        std::uint64_t expiry = 0;
+        std::uint64_t period = 0;
+        std::uint32_t prev = nil;
+        std::uint32_t next = nil;
+        std::uint32_t generation = 0;
+        std::uint16_t slot = 0;
+        bool active = false;
+    };
+
+    std::chrono::milliseconds mTick;
+    Clock::time_point mStart;
+
+    // The last tick processed by advance(), and the one it's going to
+    std::uint64_t mNow = 0;
+    std::uint64_t mTarget = 0;
+
+    std::size_t mSize = 0;
+    std::vector<Node> mNodes;
+    std::uint32_t mFreeList = nil;
+
+    // The first node of each slot (level * slotsPerLevel + index),
+    // and which slots of each level are non-empty.
+    std::array<std::uint32_t, levels * slotsPerLevel> mSlots;
+    std::array<std::array<std::uint64_t, slotsPerLevel / 64>, levels>
+        mOccupied{};
+
+    // Return the number of ticks (at least one) of a duration.
+    std::uint64_t ticksOf(std::chrono::milliseconds d) const;
+
+    // Return the number of ticks (at least one) from mNow to the first
+    // tick at or after the given duration from now.
+    std::uint64_t ticksFromNow(std::chrono::milliseconds d) const;
+
+    // Return the last tick started at the given time.
+    std::uint64_t tickAt(Clock::time_point t) const;
+
+    TimerId idOf(std::uint32_t index) const {
+        return (std::uint64_t(mNodes[index].generation) << 32) | (index + 1);
+    }
+
+    TimerId add(std::uint64_t ticks, std::uint64_t period, std::uint64_t key,
+                Callback &&callback);
+
+    // Return the node of a job, or nullptr.
+    Node *find(TimerId id) noexcept;
+
+    // Put a node in the slot of its expiry tick.
+    void link(std::uint32_t index) noexcept;
+
+    // Take a node out of its slot.
+    void unlink(std::uint32_t index) noexcept;
+
+    // Free a node (taken out of its slot).
+    void release(std::uint32_t index) noexcept;
+
+    // Move the jobs of the current slot of the given level to the
+    // lower levels.
+    void cascade(std::size_t level) noexcept;
+
+    // Run the jobs of the current slot of level 0. Return how many.
+    std::size_t expire();
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
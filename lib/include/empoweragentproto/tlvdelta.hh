@@ -0,0 +1,475 @@
+#ifndef EMPOWER_AGENT_TLVDELTA_HH
+#define EMPOWER_AGENT_TLVDELTA_HH
+
+#include <empoweragentproto/tlvs.hh>
+
+#include <cstdint>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief The key identifying the element of a stream of reports of
+ *        type T (see DeltaReporter), e.g. the RNTI of a UE.
+ *
+ * Specialized for the TLVs which can be delta-encoded.
+ */
+template <typename T> struct TLVDeltaKey;
+
+/// @brief UE reports are identified by RNTI.
+template <> struct TLVDeltaKey<TLVUEReport> {
+    static std::uint32_t of(const TLVUEReport &v) { return v.rnti(); }
+};
+
+/// @brief UE measurement reports are identified by RNTI and
+///        measurement id.
+template <> struct TLVDeltaKey<TLVUEMeasurementReport> {
+    static std::uint32_t of(const TLVUEMeasurementReport &v) {
+        return (static_cast<std::uint32_t>(v.rnti()) << 8) | v.measId();
+    }
+};
+
+/**
+ * @brief The changes to a set of TLVs of type T, which must have a
+ *        fixed layout (see TLVLayout) and a key (see TLVDeltaKey):
+ *        added or changed elements, and keys of removed elements.
+ *
+ * It is encoded as a TLVType::DELTA_LIST_OF_TLV TLV:
+ *
+ * * the elements type (16 bits);
+ * * flags (16 bits): bit 0 set means a full resync, i.e. the elements
+ *   are the whole set and replace whatever the receiver had;
+ * * the number of elements (16 bits);
+ * * the number of removed keys (16 bits);
+ * * the data of all the elements, like TLVListOf;
+ * * the removed keys (32 bits each).
+ *
+ * Usually obtained from a DeltaReporter, and sent in place of a
+ * TLVListOf (e.g. for EntityClass::UE_REPORTS_SERVICE or
+ * EntityClass::UE_MEASUREMENTS_SERVICE) by agents reporting deltas.
+ */
+template <typename T> class TLVDeltaListOf : public TLVBase {
+  public:
+    using LayoutType = typename T::Layout;
+    using value_type = std::vector<T>;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using key_type = std::uint32_t;
+
+    enum {
+        /// @brief The size of the delta header (elements type, flags
+        ///        and counts).
+        headerSize = 8,
+    };
+
+    enum {
+        /// @brief Flag set for a full resync.
+        fullFlag = 0x1,
+    };
+
+    virtual ~TLVDeltaListOf() {}
+
+    /// @name TLVBase interface
+    /// @{
+    virtual TLVType type() const override {
+        return TLVType::DELTA_LIST_OF_TLV;
+    }
+    virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
+    virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
+    /// @}
+
+    /// @name Getters and setters
+    /// @{
+
+    /// @brief Tell if this is a full resync (see above).
+    bool full() const { return mFull; }
+    TLVDeltaListOf &full(bool v) {
+        mFull = v;
+        return *this;
+    }
+
+    /// @brief The added or changed elements (or all of them, for a
+    ///        full resync).
+    const_reference elements() const { return mElements; }
+    reference elements() { return mElements; }
+
+    /// @brief The keys of the removed elements.
+    const std::vector<key_type> &removed() const { return mRemoved; }
+    std::vector<key_type> &removed() { return mRemoved; }
+
+    /// @brief Return the encoded size of the TLV data.
+    std::size_t encodedSize() const {
+        return headerSize + mElements.size() * LayoutType::size() +
+               mRemoved.size() * sizeof(key_type);
+    }
+
+    bool empty() const { return mElements.empty() && mRemoved.empty(); }
+
+    /// @brief Clear elements, removed keys and flags.
+    void clear() {
+        mElements.clear();
+        mRemoved.clear();
+        mFull = false;
+    }
+
+    /// @}
+
+    /// @brief Apply the changes to a map from keys to elements (e.g.
+    ///        a `std::unordered_map<std::uint32_t, T>`).
+    template <typename Map> void applyTo(Map &state) const {
+        if (mFull) {
+            state.clear();
+        }
+
+        for (key_type key : mRemoved) {
+            state.erase(key);
+        }
+
+        for (const T &element : mElements) {
+            state[TLVDeltaKey<T>::of(element)] = element;
+        }
+    }
+
+  private:
+    value_type mElements;
+    std::vector<key_type> mRemoved;
+    bool mFull = false;
+
+    enum {
+        tlvTypeOffset = 0,
+        flagsOffset = 2,
+        countOffset = 4,
+        removedCountOffset = 6,
+        elementsOffset = 8,
+    };
+};
+
+template <typename T>
+std::size_t TLVDeltaListOf<T>::encode(NetworkLib::BufferWritableView buffer) {
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+template <typename T>
+std::size_t TLVDeltaListOf<T>::decode(NetworkLib::BufferView buffer) {
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+template <typename T>
+NetworkLib::Status
+TLVDeltaListOf<T>::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                  std::size_t &length) {
+    const std::size_t requiredSize = encodedSize();
+
+    if (requiredSize > 0xFFFF - TLVHeader::headerLength) {
+        // Too many elements and removed keys for the TLV length
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    if (requiredSize > buffer.size()) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Bounds already checked above
+    buffer.setUint16At_nocheck(tlvTypeOffset,
+                               static_cast<std::uint16_t>(LayoutType::type()));
+    buffer.setUint16At_nocheck(flagsOffset, mFull ? fullFlag : 0);
+    buffer.setUint16At_nocheck(countOffset, mElements.size());
+    buffer.setUint16At_nocheck(removedCountOffset, mRemoved.size());
+
+    std::size_t offset = elementsOffset;
+    for (const T &element : mElements) {
+        LayoutType::encode_nocheck(element, buffer, offset);
+        offset += LayoutType::size();
+    }
+
+    for (key_type key : mRemoved) {
+        buffer.setUint32At_nocheck(offset, key);
+        offset += sizeof(key_type);
+    }
+
+    length = requiredSize;
+    return NetworkLib::Status();
+}
+
+template <typename T>
+NetworkLib::Status
+TLVDeltaListOf<T>::decode_nothrow(NetworkLib::BufferView buffer,
+                                  std::size_t &length) {
+    NetworkLib::Status status =
+        NetworkLib::CheckedRegion<headerSize>::check(buffer, 0);
+
+    if (!status) {
+        return status;
+    }
+
+    const auto header =
+        NetworkLib::CheckedRegion<headerSize>::make_nocheck(buffer, 0);
+
+    const TLVType tlvType =
+        static_cast<TLVType>(header.template getUint16At<tlvTypeOffset>());
+
+    if (tlvType != LayoutType::type()) {
+        // The delta elements have an unexpected type
+        return NetworkLib::ErrorCode::TLV_TYPE_MISMATCH;
+    }
+
+    mFull = (header.template getUint16At<flagsOffset>() & fullFlag) != 0;
+    mElements.resize(header.template getUint16At<countOffset>());
+    mRemoved.resize(header.template getUint16At<removedCountOffset>());
+
+    const std::size_t requiredSize = encodedSize();
+
+    if (requiredSize > buffer.size()) {
+        // The TLV data is too short for all the elements and keys
+        clear();
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    // Bounds already checked above
+    std::size_t offset = elementsOffset;
+    for (T &element : mElements) {
+        LayoutType::decode_nocheck(element, buffer, offset);
+        offset += LayoutType::size();
+    }
+
+    for (key_type &key : mRemoved) {
+        key = buffer.getUint32At_nocheck(offset);
+        offset += sizeof(key_type);
+    }
+
+    length = requiredSize;
+    return NetworkLib::Status();
+}
+
+/**
+ * @brief Turns periodic snapshots of a set of TLVs of type T (e.g.
+ *        one TLVUEReport per attached UE) into deltas (see
+ *        TLVDeltaListOf).
+ *
+ * The last value sent for each key (see TLVDeltaKey) is kept in an
+ * open-addressing hash table, so that each period costs one lookup and
+ * one field-by-field comparison per element, and only the elements
+ * which changed get encoded:
+ *
+ *     DeltaReporter<TLVUEReport> reporter;
+ *     ...
+ *     // Every period
+ *     reporter.begin();
+ *     for (const auto &ue : ues) {
+ *         reporter.update(makeReport(ue));
+ *     }
+ *     auto &delta = reporter.end();
+ *     if (!delta.empty()) {
+ *         encoder.add(delta);
+ *         ...
+ *     }
+ *
+ * Elements not updated in a period are reported as removed. Every
+ * `resyncPeriod()` periods (and on the first one, or after `resync()`)
+ * the delta is a full resync instead, so that a receiver which lost
+ * its state (or a message) recovers.
+ *
+ * Like for TLVListOf, a delta must fit in a TLV (see
+ * TLVDeltaListOf::encode()): report large sets with several reporters
+ * (e.g. one per cell).
+ */
+template <typename T> class DeltaReporter {
+  public:
+    using key_type = std::uint32_t;
+
+    /// @brief Constructor.
+    ///
+    /// @param resyncPeriod Make a full resync every that many periods
+    ///        (`0` means only on the first one and after `resync()`).
+    explicit DeltaReporter(std::size_t resyncPeriod = 16)
+        : mResyncPeriod{resyncPeriod}, mTable(initialCapacity) {}
+
+    /// @brief Return the number of periods between full resyncs.
+    std::size_t resyncPeriod() const { return mResyncPeriod; }
+
+    /// @brief Make the next period a full resync.
+    void resync() { mForceFull = true; }
+
+    /// @brief Return the number of elements currently known.
+    std::size_t size() const { return mCount; }
+
+    /// @brief Start a new period.
+    void begin() {
+        mDelta.clear();
+
+        if (++mEpoch == 0) {
+            // Wrapped around: renumber the live entries.
+            for (Entry &entry : mTable) {
+                if (entry.epoch != 0) {
+                    entry.epoch = 1;
+                }
+            }
+
+            mEpoch = 2;
+        }
+
+        const bool full =
+            mForceFull || (mResyncPeriod != 0 && mPeriod % mResyncPeriod == 0);
+        mDelta.full(full);
+        mForceFull = false;
+        ++mPeriod;
+        mUpdated = 0;
+    }
+
+    /// @brief Report the current value of an element (at most once
+    ///        per period for each key).
+    void update(const T &value) {
+        if ((mCount + 1) * 2 > mTable.size()) {
+            rehash(mTable.size() * 2);
+        }
+
+        const key_type key = TLVDeltaKey<T>::of(value);
+        Entry &entry = mTable[findSlot(key)];
+
+        if (entry.epoch == 0) {
+            // A new element
+            entry.key = key;
+            entry.value = value;
+            ++mCount;
+            mDelta.elements().push_back(value);
+        } else if (!T::Layout::equal(entry.value, value)) {
+            entry.value = value;
+            mDelta.elements().push_back(value);
+        } else if (mDelta.full()) {
+            mDelta.elements().push_back(value);
+        }
+
+        if (entry.epoch != mEpoch) {
+            entry.epoch = mEpoch;
+            ++mUpdated;
+        }
+    }
+
+    /// @brief End the period, and return the delta to be sent (valid
+    ///        up to the next `begin()`).
+    TLVDeltaListOf<T> &end() {
+        // Forget about the elements not updated in this period (if
+        // any).
+        mStale.clear();
+
+        for (const Entry &entry : mTable) {
+            if (mUpdated == mCount) {
+                break;
+            }
+
+            if (entry.epoch != 0 && entry.epoch != mEpoch) {
+                mStale.push_back(entry.key);
+                ++mUpdated;
+            }
+        }
+
+        for (key_type key : mStale) {
+            erase(key);
+        }
+
+        if (!mDelta.full()) {
+            mDelta.removed() = mStale;
+        }
+
+        return mDelta;
+    }
+
+  private:
+    static const std::size_t initialCapacity = 64;
+
+    // An entry of the table (`epoch == 0` means empty).
+    struct Entry {
+        key_type key = 0;
+        std::uint32_t epoch = 0;
+        T value;
+    };
+
+    std::size_t mResyncPeriod;
+    bool mForceFull = true;
+    std::size_t mPeriod = 0;
+    std::uint32_t mEpoch = 0;
+
+    // Linear probing, with a power of two size and a load factor of
+    // at most 1/2.
+    std::vector<Entry> mTable;
+    std::size_t mCount = 0;
+
+    // Entries updated in this period (and stale ones found by end()).
+    std::size_t mUpdated = 0;
+
+    TLVDeltaListOf<T> mDelta;
+    std::vector<key_type> mStale;
+
+    std::size_t home(key_type key) const {
+        // Spread RNTIs (often consecutive) over the table
+        std::uint32_t h = key * 0x9E3779B1u;
+        h ^= h >> 16;
+        return h & (mTable.size() - 1);
+    }
+
+    // Return the slot of the key, or the empty slot where it belongs.
+    std::size_t findSlot(key_type key) const {
+        const std::size_t mask = mTable.size() - 1;
+        std::size_t i = home(key);
+
+        while (mTable[i].epoch != 0 && mTable[i].key != key) {
+            i = (i + 1) & mask;
+        }
+
+        return i;
+    }
+
+    // Remove a key, shifting back the following entries of its cluster
+    // (so there's no need for tombstones).
+    void erase(key_type key) {
+        const std::size_t mask = mTable.size() - 1;
+        std::size_t hole = findSlot(key);
+
+        if (mTable[hole].epoch == 0) {
+            return;
+        }
+
+        for (std::size_t i = (hole + 1) & mask; mTable[i].epoch != 0;
+             i = (i + 1) & mask) {
+            // Move the entry to the hole, unless its home is in
+            // (hole, i].
+            const std::size_t h = home(mTable[i].key);
+
+            if (((i - h) & mask) >= ((i - hole) & mask)) {
+                mTable[hole] = mTable[i];
+                hole = i;
+            }
+        }
+
+        mTable[hole].epoch = 0;
+        --mCount;
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<Entry> old(capacity);
+        old.swap(mTable);
+
+        for (const Entry &entry : old) {
+            if (entry.epoch != 0) {
+                mTable[findSlot(entry.key)] = entry;
+            }
+        }
+    }
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <empoweragentproto/networklib.hh>
 #include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/tlvindex.hh>
+#include <empoweragentproto/tlvlayout.hh>
 #include <ostream>
 
 namespace Empower {
@@ -16,6 +18,9 @@ enum class TLVType : std::uint16_t;
 /// @brief Obtain a textual representation of a TLVtype
 std::ostream &operator<<(std::ostream &ostr, const TLVType &v);
 
+// Forward declaration (see `tlvviews.hh`).
+class TLVView;
+
 /**
  * @brief Basic interface for all classes representing TLVs.
  *
@@ -51,6 +56,41 @@ class TLVBase {
     /// `buffer.size()`).
     virtual std::size_t decode(NetworkLib::BufferView buffer) = 0;
 
+    /// @brief Same as `encode()`, but return an error Status (e.g.
+    ///        ErrorCode::OUT_OF_BOUNDS if the buffer is too small)
+    ///        instead of throwing, and the number of bytes used in
+    ///        `length`.
+    ///
+    /// The TLVs of this library override it, and implement `encode()`
+    /// on top of it. The default implementation calls `encode()`,
+    /// turning its exceptions (but std::bad_alloc) into
+    /// ErrorCode::OUT_OF_BOUNDS: with EMPOWER_NETWORKLIB_NO_EXCEPTIONS,
+    /// TLVs whose `encode()` may fail must override it.
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer, std::size_t &length);
+
+    /// @brief Same as `decode()`, but return an error Status (e.g.
+    ///        when the data is malformed) instead of throwing, and the
+    ///        number of bytes decoded in `length`.
+    ///
+    /// On error the TLV may be partially decoded. As for
+    /// `encode_nothrow()`, the default implementation calls
+    /// `decode()`, turning its exceptions into
+    /// ErrorCode::BAD_TLV_LENGTH.
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length);
+
+    /// @brief Return a NetworkLib::BufferView with the already encoded
+    ///        TLV data (without type and length), for TLVs which keep
+    ///        it around anyway (e.g. bulk payloads).
+    ///
+    /// Used by MessageSegmentEncoder to refer to the data instead of
+    /// copying it. The default implementation returns an empty
+    /// BufferView, meaning that `encode()` must be used.
+    virtual NetworkLib::BufferView encodedData() const {
+        return NetworkLib::BufferView();
+    }
+
     virtual ~TLVBase() {}
 };
 
@@ -61,12 +101,48 @@ class TLVBase {
  */
 class MessageEncoder {
   public:
-    //
+    /// @brief Constructor (throw if the buffer is unsuitable, see
+    ///        `check()`).
     MessageEncoder(NetworkLib::BufferWritableView);
 
+    /// @brief Check if a buffer is suitable for encoding a message
+    ///        (i.e. if the constructor wouldn't throw), without
+    ///        throwing.
+    static NetworkLib::Status
+    check(const NetworkLib::BufferWritableView &buffer) noexcept {
+        return CommonHeaderEncoder::check(buffer);
+    }
+
+    /// @brief Start encoding a new message in the given buffer, as if
+    ///        newly constructed (throw if the buffer is unsuitable, in
+    ///        which case the encoder is unchanged).
+    ///
+    /// Useful to reuse the same encoder for many messages.
+    void reset(NetworkLib::BufferWritableView buffer);
+
     /// @brief Append a TLV, encoding it.
     MessageEncoder &add(TLVBase &tlv);
 
+    /// @brief Same as `add(TLVBase &)`, but return an error Status
+    ///        instead of throwing (see TLVBase::encode_nothrow()).
+    ///
+    /// On error nothing is appended.
+    NetworkLib::Status add_nothrow(TLVBase &tlv);
+
+    /// @brief Append a TLV with a fixed layout (see TLVLayout),
+    ///        encoding it without virtual calls and with a single
+    ///        bounds check.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value, MessageEncoder &>::type
+    add(const T &tlv);
+
+    /// @brief Same as the `add()` above, but return
+    ///        ErrorCode::OUT_OF_BOUNDS instead of throwing if there's
+    ///        no room for the TLV.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value, NetworkLib::Status>::type
+    add_nothrow(const T &tlv) noexcept;
+
     /// @brief Tell the encoder that we finished adding TLVs.
     void end();
 
@@ -84,27 +160,117 @@ class MessageEncoder {
     std::size_t mCurrentOffset;
 };
 
+/**
+ * @brief A class which helps encoding a message made of a generic
+ *        header and series of TLVs as a list of segments (see
+ *        NetworkLib::BufferViewSegments), suitable for `writev(2)`
+ *        (see `IO::writeMessage(const NetworkLib::BufferViewSegments &)`).
+ *
+ * The header and the TLVs are encoded in the given
+ * NetworkLib::BufferWritableView like MessageEncoder does, except for
+ * the data of large TLVs providing `TLVBase::encodedData()`: only
+ * their type and length are encoded, and the segment list refers to
+ * their data, which is not copied. The data must not change until
+ * the message has been sent.
+ */
+class MessageSegmentEncoder {
+  public:
+    /// @brief TLV data shorter than this is copied anyway (copying a
+    ///        few bytes is cheaper than an additional segment).
+    static const std::size_t minReferencedDataSize = 256;
+
+    MessageSegmentEncoder(NetworkLib::BufferWritableView);
+
+    /// @brief Start encoding a new message in the given buffer, as if
+    ///        newly constructed (throw if the buffer is unsuitable, in
+    ///        which case the encoder is unchanged).
+    ///
+    /// The memory allocated for the segment list is kept.
+    void reset(NetworkLib::BufferWritableView buffer);
+
+    /// @brief Append a TLV, encoding it or referring to its data.
+    MessageSegmentEncoder &add(TLVBase &tlv);
+
+    /// @brief Same as `add()`, but return an error Status instead of
+    ///        throwing (see TLVBase::encode_nothrow()).
+    ///
+    /// On error nothing is appended.
+    NetworkLib::Status add_nothrow(TLVBase &tlv);
+
+    /// @brief Tell the encoder that we finished adding TLVs.
+    void end();
+
+    /// @brief Return the segments making up the encoded message (valid
+    ///        after `end()`).
+    const NetworkLib::BufferViewSegments &segments() const {
+        return mSegments;
+    }
+
+    /// @brief Return the total size in bytes of the encoded message.
+    std::size_t size() const { return mTotalLength; }
+
+    /// @brief Provide access to the generic head encoder.
+    CommonHeaderEncoder &header() { return mHeaderEncoder; }
+
+  private:
+    NetworkLib::BufferWritableView mBuffer;
+    CommonHeaderEncoder mHeaderEncoder;
+
+    // Offset in mBuffer of the data not yet part of a segment, and of
+    // the free space.
+    std::size_t mSegmentOffset;
+    std::size_t mCurrentOffset;
+
+    std::size_t mTotalLength;
+    NetworkLib::BufferViewSegments mSegments;
+
+    // Turn what's been encoded in mBuffer so far into a segment
+    void closeSegment();
+};
+
 /**
  * @brief A class which helps decoding a series of TLVs stored
  * in a NetworkLib::BufferView.
  */
 class MessageDecoder {
   public:
+    /// @brief Constructor (throw if the buffer doesn't start with a
+    ///        valid common header, see `check()`).
     MessageDecoder(NetworkLib::BufferView buffer);
 
+    /// @brief Check if a buffer starts with a valid common header
+    ///        (i.e. if the constructor wouldn't throw), without
+    ///        throwing.
+    static NetworkLib::Status
+    check(const NetworkLib::BufferView &buffer) noexcept {
+        return CommonHeaderDecoder::check(buffer);
+    }
+
+    /// @brief Start decoding another message, as if newly constructed
+    ///        (throw if the buffer doesn't start with a valid common
+    ///        header, in which case the decoder is unchanged).
+    ///
+    /// Useful to reuse the same decoder (and its TLVIndex) for many
+    /// messages.
+    void reset(NetworkLib::BufferView buffer);
+
     /// @brief Provide access to the generic head encoder.
     CommonHeaderDecoder &header() { return mHeaderDecoder; }
 
+    /// @brief Return the message class (decoded once, see
+    ///        CommonHeaderDecoder::messageClass()).
+    MessageClass messageClass() const { return mMessageClass; }
+
     bool isFailure() const {
-        return mHeaderDecoder.messageClass() == MessageClass::RESPONSE_FAILURE;
+        return mMessageClass == MessageClass::RESPONSE_FAILURE;
     }
 
     bool isSuccess() const {
-        return mHeaderDecoder.messageClass() == MessageClass::RESPONSE_SUCCESS;
+        return mMessageClass == MessageClass::RESPONSE_SUCCESS;
     }
 
     bool isRequest() const {
-        switch (mHeaderDecoder.messageClass()) {
+        switch (mMessageClass) {
         case MessageClass::REQUEST_SET:
         case MessageClass::REQUEST_ADD:
         case MessageClass::REQUEST_DEL:
@@ -119,17 +285,236 @@ class MessageDecoder {
     /// @brief decode the next TLV
     MessageDecoder &get(TLVBase &tlv);
 
+    /// @brief Same as `get(TLVBase &)`, but return an error Status
+    ///        instead of throwing (see TLVBase::decode_nothrow()).
+    ///
+    /// On error the TLV isn't skipped (but may be partially decoded).
+    NetworkLib::Status get_nothrow(TLVBase &tlv);
+
+    /// @brief Decode the next TLV, with a fixed layout (see
+    ///        TLVLayout), without virtual calls.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value, MessageDecoder &>::type
+    get(T &tlv);
+
+    /// @brief Same as the `get()` above, but return an error Status
+    ///        instead of throwing.
+    ///
+    /// On error nothing is decoded and the TLV isn't skipped.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value, NetworkLib::Status>::type
+    get_nothrow(T &tlv) noexcept;
+
+    /// @brief Return a view on the next TLV, whatever its type, and
+    ///        skip it (see `tlvviews.hh`).
+    ///
+    /// Nothing is decoded or copied. Return an invalid TLVView if
+    /// there's no next TLV, and throw if it's truncated.
+    TLVView next();
+
+    /// @brief Same as `next()`, but return ErrorCode::BAD_TLV_LENGTH
+    ///        instead of throwing.
+    ///
+    /// The view is set to an invalid TLVView if there's no next TLV.
+    NetworkLib::Status next_nothrow(TLVView &view) noexcept;
+
     /// @brief Return the type of the next TLV, if any.
     ///
     /// Return TLVType::NONE if there's no next TLV.
     TLVType getNextTLVType() const;
 
+    /// @name Lookup by type
+    ///
+    /// These work on the index of all the TLVs in the message (built
+    /// on first use, see TLVIndex), in any order, independently of
+    /// the TLVs already decoded by `get()` and `next()`.
+    ///
+    /// @{
+
+    /// @brief Return the index of the TLVs in the message, building
+    ///        it if needed (throw if the message is malformed).
+    const TLVIndex &index();
+
+    /// @brief Build the index of the TLVs in the message, if not done
+    ///        yet, returning an error Status instead of throwing.
+    ///
+    /// Once it succeeds, the functions below don't throw because of a
+    /// malformed message.
+    NetworkLib::Status index_nothrow() noexcept;
+
+    /// @brief Return a view on an indexed TLV.
+    TLVView view(const TLVIndex::Entry &entry) const;
+
+    /// @brief Return a view on the first TLV of the given type, or an
+    ///        invalid TLVView if there's none.
+    TLVView find(TLVType type);
+
+    /// @brief Decode the first TLV of the type of the given one, if
+    ///        any.
+    ///
+    /// @return false if there's no such TLV in the message.
+    bool tryGet(TLVBase &tlv);
+
+    /// @brief Same as `tryGet(TLVBase &)`, but return an error Status
+    ///        instead of throwing (see TLVBase::decode_nothrow()).
+    ///
+    /// @return false (as value) if there's no such TLV in the message.
+    NetworkLib::Result<bool> tryGet_nothrow(TLVBase &tlv);
+
+    /// @brief Decode the first TLV of the type of the given one, with
+    ///        a fixed layout (see TLVLayout), if any, without virtual
+    ///        calls nor bounds checks.
+    ///
+    /// @return false if there's no such TLV in the message.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value, bool>::type
+    tryGet(T &tlv);
+
+    /// @brief Same as the `tryGet()` above, but return an error Status
+    ///        instead of throwing.
+    ///
+    /// @return false (as value) if there's no such TLV in the message.
+    template <typename T>
+    typename std::enable_if<HasTLVLayout<T>::value,
+                            NetworkLib::Result<bool>>::type
+    tryGet_nothrow(T &tlv) noexcept;
+
+    /// @}
+
   private:
     NetworkLib::BufferView mBuffer;
     CommonHeaderDecoder mHeaderDecoder;
+    MessageClass mMessageClass;
     std::size_t mCurrentOffset;
+
+    TLVIndex mIndex;
+    bool mIndexed;
+
+    // Type and length of the next TLV, validated against the buffer
+    NetworkLib::Status nextHeader(TLVType &tlvType,
+                                  std::size_t &tlvLength) const noexcept;
 };
 
+/**********************************************************************/
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value, MessageEncoder &>::type
+MessageEncoder::add(const T &tlv) {
+    add_nothrow(tlv).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return *this;
+}
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value, NetworkLib::Status>::type
+MessageEncoder::add_nothrow(const T &tlv) noexcept {
+    using Layout = typename T::Layout;
+
+    const std::size_t tlvTotalLength =
+        TLVHeader::headerLength + Layout::size();
+
+    if (!mBuffer.isWithinBounds(mCurrentOffset, tlvTotalLength)) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Bounds already checked above
+    mBuffer.setUint16At_nocheck(mCurrentOffset + TLVHeader::typeOffset,
+                                static_cast<std::uint16_t>(Layout::type()));
+    mBuffer.setUint16At_nocheck(mCurrentOffset + TLVHeader::lengthOffset,
+                                tlvTotalLength);
+    {
+        const NetworkLib::Metrics::ScopedTimer timer(
+            NetworkLib::Timer::TLV_ENCODE,
+            static_cast<std::size_t>(Layout::type()));
+        Layout::encode_nocheck(tlv, mBuffer,
+                               mCurrentOffset + TLVHeader::dataOffset);
+    }
+
+    mCurrentOffset += tlvTotalLength;
+
+    return NetworkLib::Status();
+}
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value, MessageDecoder &>::type
+MessageDecoder::get(T &tlv) {
+    get_nothrow(tlv).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return *this;
+}
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value, NetworkLib::Status>::type
+MessageDecoder::get_nothrow(T &tlv) noexcept {
+    using Layout = typename T::Layout;
+
+    TLVType tlvType;
+    std::size_t tlvLength;
+    NetworkLib::Status status = nextHeader(tlvType, tlvLength);
+
+    if (!status) {
+        return status;
+    }
+
+    if (tlvType != Layout::type()) {
+        return NetworkLib::ErrorCode::TLV_TYPE_MISMATCH;
+    }
+
+    if (tlvLength != TLVHeader::headerLength + Layout::size()) {
+        return NetworkLib::ErrorCode::TLV_LENGTH_MISMATCH;
+    }
+
+    // Bounds already checked by nextHeader()
+    {
+        const NetworkLib::Metrics::ScopedTimer timer(
+            NetworkLib::Timer::TLV_DECODE,
+            static_cast<std::size_t>(Layout::type()));
+        Layout::decode_nocheck(tlv, mBuffer,
+                               mCurrentOffset + TLVHeader::dataOffset);
+    }
+
+    mCurrentOffset += tlvLength;
+
+    return NetworkLib::Status();
+}
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value, bool>::type
+MessageDecoder::tryGet(T &tlv) {
+    return tryGet_nothrow(tlv).valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+template <typename T>
+typename std::enable_if<HasTLVLayout<T>::value,
+                        NetworkLib::Result<bool>>::type
+MessageDecoder::tryGet_nothrow(T &tlv) noexcept {
+    using Layout = typename T::Layout;
+
+    NetworkLib::Status status = index_nothrow();
+
+    if (!status) {
+        return status;
+    }
+
+    const std::size_t i = mIndex.find(Layout::type());
+
+    if (i == TLVIndex::npos) {
+        return false;
+    }
+
+    const TLVIndex::Entry &entry = mIndex[i];
+
+    if (entry.length != Layout::size()) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::TLV_LENGTH_MISMATCH);
+    }
+
+    // Bounds already checked when building the index
+    const NetworkLib::Metrics::ScopedTimer timer(
+        NetworkLib::Timer::TLV_DECODE,
+        static_cast<std::size_t>(Layout::type()));
+    Layout::decode_nocheck(tlv, mBuffer, entry.offset);
+
+    return true;
+}
+
 } // namespace Agent
 } // namespace Empower
 
@@ -0,0 +1,119 @@
+#ifndef EMPOWER_AGENT_TLVINDEX_HH
+#define EMPOWER_AGENT_TLVINDEX_HH
+
+#include <empoweragentproto/networklib.hh>
+
+#include <array>
+#include <cstdint>
+
+namespace Empower {
+namespace Agent {
+
+// Forward declaration of main enum assigning an ID to each TLV type
+// (see `tlvencoding.hh`).
+enum class TLVType : std::uint16_t;
+
+/**
+ * @brief A fixed-capacity index of the TLVs of a message: type,
+ *        offset and length of each of them, in order.
+ *
+ * The index is built in a single pass (see `build()`), which also
+ * validates all the TLV lengths against the buffer, so that the data
+ * of indexed TLVs can be accessed without further bounds checks.
+ *
+ * Lookup by type is O(1) for the first TLV of a given type and for
+ * the next one of the same type (for types less than
+ * `directLookupTypes`, which covers all currently defined TLVs, and a
+ * linear scan otherwise).
+ *
+ * Usually obtained via MessageDecoder::index().
+ */
+class TLVIndex {
+  public:
+    /// @brief The maximum number of TLVs in an index.
+    static const std::size_t maxEntries = 64;
+
+    /// @brief TLV types which are looked up through a direct table.
+    static const std::size_t directLookupTypes = 16;
+
+    /// @brief Returned by lookups when there's no such TLV.
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    /// @brief An entry of the index.
+    struct Entry {
+        /// @brief The TLV type.
+        TLVType type;
+
+        /// @brief The length of the TLV data (excluding the
+        ///        TLVHeader).
+        std::uint16_t length;
+
+        /// @brief The offset of the TLV data within the indexed
+        ///        buffer.
+        std::uint32_t offset;
+    };
+
+    using const_iterator = const Entry *;
+
+    TLVIndex() { clear(); }
+
+    /// @brief Index all the TLVs stored in the buffer from the given
+    ///        offset up to its end.
+    ///
+    /// Throw std::runtime_error if a TLV is truncated or has a bad
+    /// length, or if there are more than `maxEntries` TLVs (in which
+    /// case use MessageDecoder::next() to go through them). The index
+    /// is left empty in case of error.
+    void build(const NetworkLib::BufferView &buffer, std::size_t offset);
+
+    /// @brief Same as `build()`, but return an error Status instead of
+    ///        throwing (ErrorCode::BAD_TLV_LENGTH or
+    ///        ErrorCode::TOO_MANY_TLVS).
+    NetworkLib::Status build_nothrow(const NetworkLib::BufferView &buffer,
+                                     std::size_t offset) noexcept;
+
+    /// @brief Remove all the entries.
+    void clear() noexcept;
+
+    /// @brief Return the number of indexed TLVs.
+    std::size_t size() const { return mSize; }
+
+    bool empty() const { return mSize == 0; }
+
+    /// @name Forward iteration over the entries
+    /// @{
+    const_iterator begin() const { return mEntries.data(); }
+    const_iterator end() const { return mEntries.data() + mSize; }
+    /// @}
+
+    /// @brief Return the i-th entry, **without** checking bounds.
+    const Entry &operator[](std::size_t i) const { return mEntries[i]; }
+
+    /// @brief Return the position of the first TLV of the given type,
+    ///        or `npos`.
+    std::size_t find(TLVType type) const;
+
+    /// @brief Return the position of the next TLV of the same type as
+    ///        the one at position i, or `npos`.
+    std::size_t findNext(std::size_t i) const;
+
+    /// @brief Return the number of TLVs of the given type.
+    std::size_t count(TLVType type) const;
+
+  private:
+    // Marks the end of the chains below
+    static const std::uint8_t noEntry = 0xFF;
+
+    std::array<Entry, maxEntries> mEntries;
+    std::size_t mSize;
+
+    // First entry for each type (if less than directLookupTypes),
+    // and next entry with the same type for each entry.
+    std::array<std::uint8_t, directLookupTypes> mFirst;
+    std::array<std::uint8_t, maxEntries> mNext;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef EMPOWER_AGENT_TLVLAYOUT_HH
+#define EMPOWER_AGENT_TLVLAYOUT_HH
+
+#include <empoweragentproto/networklib.hh>
+
+#include <cstdint>
+#include <sstream>
+#include <type_traits>
+
+namespace Empower {
+namespace Agent {
+
+// Forward declaration of main enum assigning an ID to each TLV type
+// (see `tlvencoding.hh`).
+enum class TLVType : std::uint16_t;
+
+/**
+ * @brief Encoding/decoding of an integer field of type T (in network
+ *        order), **without** checking bounds.
+ *
+ * Specialized for std::uint8_t, std::uint16_t, std::uint32_t and
+ * std::uint64_t.
+ */
+template <typename T> struct TLVFieldCodec;
+
+template <> struct TLVFieldCodec<std::uint8_t> {
+    static void store(const NetworkLib::BufferWritableView &buffer,
+                      std::size_t offset, std::uint8_t v) noexcept {
+        buffer.setUint8At_nocheck(offset, v);
+    }
+
+    static std::uint8_t load(const NetworkLib::BufferView &buffer,
+                             std::size_t offset) noexcept {
+        return buffer.getUint8At_nocheck(offset);
+    }
+};
+
+template <> struct TLVFieldCodec<std::uint16_t> {
+    static void store(const NetworkLib::BufferWritableView &buffer,
+                      std::size_t offset, std::uint16_t v) noexcept {
+        buffer.setUint16At_nocheck(offset, v);
+    }
+
+    static std::uint16_t load(const NetworkLib::BufferView &buffer,
+                              std::size_t offset) noexcept {
+        return buffer.getUint16At_nocheck(offset);
+    }
+};
+
+template <> struct TLVFieldCodec<std::uint32_t> {
+    static void store(const NetworkLib::BufferWritableView &buffer,
+                      std::size_t offset, std::uint32_t v) noexcept {
+        buffer.setUint32At_nocheck(offset, v);
+    }
+
+    static std::uint32_t load(const NetworkLib::BufferView &buffer,
+                              std::size_t offset) noexcept {
+        return buffer.getUint32At_nocheck(offset);
+    }
+};
+
+template <> struct TLVFieldCodec<std::uint64_t> {
+    static void store(const NetworkLib::BufferWritableView &buffer,
+                      std::size_t offset, std::uint64_t v) noexcept {
+        buffer.setUint64At_nocheck(offset, v);
+    }
+
+    static std::uint64_t load(const NetworkLib::BufferView &buffer,
+                              std::size_t offset) noexcept {
+        return buffer.getUint64At_nocheck(offset);
+    }
+};
+
+/**
+ * @brief Descriptor of a field of a fixed-layout TLV (see TLVLayout):
+ *        the data member `member` of type T of class C.
+ *
+ * The field is encoded as sizeof(T) bytes in network order.
+ */
+template <typename C, typename T, T C::*member> struct TLVField {
+    using value_type = T;
+
+    /// @brief The size in bytes of the encoded field.
+    static constexpr std::size_t size() { return sizeof(T); }
+
+    static void store(const C &obj,
+                      const NetworkLib::BufferWritableView &buffer,
+                      std::size_t offset) noexcept {
+        TLVFieldCodec<T>::store(buffer, offset, obj.*member);
+    }
+
+    static void load(C &obj, const NetworkLib::BufferView &buffer,
+                     std::size_t offset) noexcept {
+        obj.*member = TLVFieldCodec<T>::load(buffer, offset);
+    }
+
+    static bool equal(const C &lhs, const C &rhs) noexcept {
+        return lhs.*member == rhs.*member;
+    }
+};
+
+namespace TLVLayoutDetail {
+
+// A list of TLVField, the first one being at the given offset and
+// the following ones right after it.
+template <std::size_t offset, typename... Fields> struct FieldList;
+
+template <std::size_t offset> struct FieldList<offset> {
+    static constexpr std::size_t size() { return 0; }
+
+    template <typename C>
+    static void store(const C &, const NetworkLib::BufferWritableView &,
+                      std::size_t) noexcept {}
+
+    template <typename C>
+    static void load(C &, const NetworkLib::BufferView &,
+                     std::size_t) noexcept {}
+
+    template <typename C> static bool equal(const C &, const C &) noexcept {
+        return true;
+    }
+};
+
+template <std::size_t offset, typename F, typename... Rest>
+struct FieldList<offset, F, Rest...> {
+    using Next = FieldList<offset + F::size(), Rest...>;
+
+    static constexpr std::size_t size() { return F::size() + Next::size(); }
+
+    template <typename C>
+    static void store(const C &obj,
+                      const NetworkLib::BufferWritableView &buffer,
+                      std::size_t base) noexcept {
+        F::store(obj, buffer, base + offset);
+        Next::store(obj, buffer, base);
+    }
+
+    template <typename C>
+    static void load(C &obj, const NetworkLib::BufferView &buffer,
+                     std::size_t base) noexcept {
+        F::load(obj, buffer, base + offset);
+        Next::load(obj, buffer, base);
+    }
+
+    template <typename C>
+    static bool equal(const C &lhs, const C &rhs) noexcept {
+        return F::equal(lhs, rhs) && Next::equal(lhs, rhs);
+    }
+};
+
+// The i-th field of a FieldList, and its offset.
+template <std::size_t i, typename List> struct FieldAt;
+
+template <std::size_t offset, typename F, typename... Rest>
+struct FieldAt<0, FieldList<offset, F, Rest...>> {
+    using type = F;
+    static constexpr std::size_t fieldOffset() { return offset; }
+};
+
+template <std::size_t i, std::size_t offset, typename F, typename... Rest>
+struct FieldAt<i, FieldList<offset, F, Rest...>>
+    : FieldAt<i - 1, FieldList<offset + F::size(), Rest...>> {};
+
+// std::void_t is C++17
+template <typename T> struct Void { using type = void; };
+
+} // namespace TLVLayoutDetail
+
+/**
+ * @brief Compile-time description of a fixed-layout TLV of type
+ *        `tlvType`, made of the given TLVField in that order, with no
+ *        padding.
+ *
+ * A TLV class declares its layout as a public member type `Layout`:
+ *
+ *       class TLVFoo : public TLVBase {
+ *           ...
+ *         private:
+ *           std::uint16_t mBar = 0;
+ *           std::uint32_t mBaz = 0;
+ *
+ *         public:
+ *           using Layout =
+ *               TLVLayout<TLVType::FOO,
+ *                         TLVField<TLVFoo, std::uint16_t, &TLVFoo::mBar>,
+ *                         TLVField<TLVFoo, std::uint32_t, &TLVFoo::mBaz>>;
+ *       };
+ *
+ * Size and field offsets are then known at compile time, so that
+ * encoding/decoding is inlined as a single bounds check followed by
+ * one store/load per field. MessageEncoder::add() and
+ * MessageDecoder::get() use it directly (without virtual calls) for
+ * such TLVs, and the TLVBase interface can be implemented with
+ * `encode()` and `decode()` below.
+ */
+template <TLVType tlvType, typename... Fields> struct TLVLayout {
+    using FieldList = TLVLayoutDetail::FieldList<0, Fields...>;
+
+    /// @brief The TLV type.
+    static constexpr TLVType type() { return tlvType; }
+
+    /// @brief The size in bytes of the encoded TLV data (excluding
+    ///        the TLVHeader).
+    static constexpr std::size_t size() { return FieldList::size(); }
+
+    /// @brief The i-th TLVField (as `Field<i>::type`) and its offset
+    ///        (as `Field<i>::fieldOffset()`).
+    template <std::size_t i>
+    using Field = TLVLayoutDetail::FieldAt<i, FieldList>;
+
+    /// @brief Get the value of the i-th field straight from the
+    ///        encoded data, **without** checking bounds.
+    template <std::size_t i>
+    static typename Field<i>::type::value_type
+    load_nocheck(const NetworkLib::BufferView &buffer) noexcept {
+        using T = typename Field<i>::type::value_type;
+        return TLVFieldCodec<T>::load(buffer, Field<i>::fieldOffset());
+    }
+
+    /// @brief Set the value of the i-th field straight in the encoded
+    ///        data starting at the given offset, **without** checking
+    ///        bounds.
+    template <std::size_t i>
+    static void
+    store_nocheck(const NetworkLib::BufferWritableView &buffer,
+                  typename Field<i>::type::value_type v,
+                  std::size_t offset = 0) noexcept {
+        using T = typename Field<i>::type::value_type;
+        TLVFieldCodec<T>::store(buffer, offset + Field<i>::fieldOffset(), v);
+    }
+
+    /// @brief Encode obj at the given offset of the buffer, **without**
+    ///        checking bounds.
+    template <typename C>
+    static void encode_nocheck(const C &obj,
+                               const NetworkLib::BufferWritableView &buffer,
+                               std::size_t offset = 0) noexcept {
+        FieldList::store(obj, buffer, offset);
+    }
+
+    /// @brief Decode obj from the given offset of the buffer,
+    ///        **without** checking bounds.
+    template <typename C>
+    static void decode_nocheck(C &obj, const NetworkLib::BufferView &buffer,
+                               std::size_t offset = 0) noexcept {
+        FieldList::load(obj, buffer, offset);
+    }
+
+    /// @brief Tell if lhs and rhs have the same value in all the
+    ///        fields (i.e. they would be encoded the same way).
+    template <typename C>
+    static bool equal(const C &lhs, const C &rhs) noexcept {
+        return FieldList::equal(lhs, rhs);
+    }
+
+    /// @brief Encode obj at the beginning of the buffer (see
+    ///        TLVBase::encode()).
+    ///
+    /// Throw std::out_of_range if the buffer is too small.
+    template <typename C>
+    static std::size_t encode(const C &obj,
+                              const NetworkLib::BufferWritableView &buffer) {
+        checkSize(buffer);
+        encode_nocheck(obj, buffer);
+        return size();
+    }
+
+    /// @brief Decode obj from the beginning of the buffer (see
+    ///        TLVBase::decode()).
+    ///
+    /// Throw std::out_of_range if the buffer is too small.
+    template <typename C>
+    static std::size_t decode(C &obj, const NetworkLib::BufferView &buffer) {
+        checkSize(buffer);
+        decode_nocheck(obj, buffer);
+        return size();
+    }
+
+    /// @brief Same as `encode()`, but return ErrorCode::OUT_OF_BOUNDS
+    ///        instead of throwing (see TLVBase::encode_nothrow()).
+    template <typename C>
+    static NetworkLib::Status
+    encode_nothrow(const C &obj, const NetworkLib::BufferWritableView &buffer,
+                   std::size_t &length) noexcept {
+        if (buffer.size() < size()) {
+            return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+        }
+
+        encode_nocheck(obj, buffer);
+        length = size();
+        return NetworkLib::Status();
+    }
+
+    /// @brief Same as `decode()`, but return ErrorCode::OUT_OF_BOUNDS
+    ///        instead of throwing (see TLVBase::decode_nothrow()).
+    template <typename C>
+    static NetworkLib::Status
+    decode_nothrow(C &obj, const NetworkLib::BufferView &buffer,
+                   std::size_t &length) noexcept {
+        if (buffer.size() < size()) {
+            return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+        }
+
+        decode_nocheck(obj, buffer);
+        length = size();
+        return NetworkLib::Status();
+    }
+
+  private:
+    static void checkSize(const NetworkLib::BufferView &buffer) {
+        if (buffer.size() < size()) {
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": buffer too small for TLV (TLV size: " << size()
+                << ", buffer size: " << buffer.size() << ")";
+            NETWORKLIB_THROW(std::out_of_range, err.str());
+        }
+    }
+};
+
+/**
+ * @brief Tell whether T is a TLV with a fixed layout (i.e. it has a
+ *        member type `Layout`, see TLVLayout).
+ */
+template <typename T, typename = void>
+struct HasTLVLayout : std::false_type {};
+
+template <typename T>
+struct HasTLVLayout<
+    T, typename TLVLayoutDetail::Void<typename T::Layout>::type>
+    : std::true_type {};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -28,6 +28,7 @@ enum class TLVType : std::uint16_t {
     UE_MEASUREMENT_REPORT = 0x9,
     UE_MEASUREMENT_ID = 0xB,
     MAC_PRB_UTILIZATION_REPORT = 0xA,
+    DELTA_LIST_OF_TLV = 0xC,
 };
 
 /**
@@ -47,17 +48,23 @@ class TLVError : public TLVBase {
     virtual TLVType type() const override { return TLVType::ERROR; }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
     /// @{
 
     /// @brief Return the error message
-    std::string message() const { return mErrorMessage; }
+    const std::string &message() const { return mErrorMessage; }
 
-    /// @brief Set the error message
+    /// @brief Set the error message (pass an rvalue to avoid copying
+    ///        it)
     TLVError &message(std::string msg) {
-        mErrorMessage = msg;
+        mErrorMessage = std::move(msg);
         return *this;
     }
 
@@ -92,6 +99,14 @@ class TLVBinaryData : public TLVBase {
     virtual TLVType type() const override { return TLVType::BINARY_DATA; }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
+    virtual NetworkLib::BufferView encodedData() const override {
+        return mBuffer;
+    }
     /// @}
 
     /// @name Getters and setters
@@ -99,9 +114,10 @@ class TLVBinaryData : public TLVBase {
 
     TLVBinaryData &data(const NetworkLib::BufferView &d) {
         // Actual copy of content
-        mBuffer = IO::makeMessageBuffer();
-        d.copyTo(mBuffer);
-        mBuffer.shrinkTo(d.size());
+        auto buffer = IO::makeMessageBuffer(d.size());
+        d.copyTo(buffer);
+        buffer.shrinkTo(d.size());
+        mBuffer = buffer;
         return *this;
     }
 
@@ -110,19 +126,36 @@ class TLVBinaryData : public TLVBase {
     /// @brief Convenience setter for string data.
     TLVBinaryData &stringData(const std::string &s) {
         // Actual copy of content
-        mBuffer = IO::makeMessageBuffer();
-        mBuffer.setCStringAt(0, s);
-        mBuffer.shrinkTo(s.size() + 1);
+        auto buffer = IO::makeMessageBuffer(s.size() + 1);
+        buffer.setCStringAt(0, s);
+        buffer.shrinkTo(s.size() + 1);
+        mBuffer = buffer;
         return *this;
     }
 
     /// @brief Convenience getter for string data.
     std::string stringData() const { return mBuffer.getCStringAt(0); }
 
+    /// @brief When set, `decode()` doesn't copy the data, but keeps a
+    ///        view on the buffer being decoded. Default is `false`.
+    ///
+    /// Use it only when the buffer keeps its content as long as the
+    /// TLV needs it (e.g. messages received via the event-driven
+    /// interface of IO, but not buffers being reused for reading
+    /// further messages). The whole underlying buffer stays
+    /// allocated as long as the TLV refers to it.
+    TLVBinaryData &zeroCopy(bool v) {
+        mZeroCopy = v;
+        return *this;
+    }
+
+    bool zeroCopy() const { return mZeroCopy; }
+
     /// @}
 
   private:
-    NetworkLib::BufferWritableView mBuffer;
+    NetworkLib::BufferView mBuffer;
+    bool mZeroCopy = false;
 };
 
 /**
@@ -135,6 +168,11 @@ class TLVKeyValueStringPairs : public TLVBase {
     using reference = value_type &;
     using const_reference = const value_type &;
 
+    /// @brief The pairs as views on the decoded data (see
+    ///        `zeroCopy()`).
+    using views_type = std::vector<
+        std::pair<NetworkLib::StringView, NetworkLib::StringView>>;
+
     virtual ~TLVKeyValueStringPairs() {}
 
     /// @name TLVBase interface
@@ -144,21 +182,75 @@ class TLVKeyValueStringPairs : public TLVBase {
     }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
+    virtual NetworkLib::BufferView encodedData() const override {
+        return mData;
+    }
     /// @}
 
     /// @name Getters and setters
     /// @{
+
+    /// @brief Return the pairs (empty after a zero-copy `decode()`,
+    ///        see `views()`).
     const_reference getValue() const { return mValue; }
-    void setValue(const_reference &v) { mValue = v; }
+
+    /// @brief Set the pairs (pass an rvalue to avoid copying them).
+    void setValue(const_reference v) {
+        mValue = v;
+        clearData();
+    }
+
+    void setValue(value_type &&v) {
+        mValue = std::move(v);
+        clearData();
+    }
+
+    /// @brief Return the pairs decoded with `zeroCopy()` set, as
+    ///        views on the decoded buffer (empty otherwise).
+    const views_type &views() const { return mViews; }
+
+    /// @brief When set, `decode()` doesn't copy the strings, but keeps
+    ///        a view on the buffer being decoded, and the pairs are
+    ///        available via `views()`. Default is `false`.
+    ///
+    /// Same caveats as TLVBinaryData::zeroCopy(). Encoding a TLV
+    /// decoded this way copies (or refers to) the decoded data.
+    TLVKeyValueStringPairs &zeroCopy(bool v) {
+        mZeroCopy = v;
+        return *this;
+    }
+
+    bool zeroCopy() const { return mZeroCopy; }
 
     /// @}
 
   private:
+    // Without zero-copy, or after setValue()
     value_type mValue;
+
+    // After a zero-copy decode()
+    NetworkLib::BufferView mData;
+    views_type mViews;
+
+    bool mZeroCopy = false;
+
+    void clearData() {
+        mData = NetworkLib::BufferView();
+        mViews.clear();
+    }
 };
 
 /**
- * @brief A list of TLVs
+ * @brief A list of TLVs: the type and number of its elements.
+ *
+ * This class encodes just the type and the count, and skips the
+ * elements when decoding. See TLVListOf for a list actually holding
+ * its elements.
  */
 class TLVList : public TLVBase {
   public:
@@ -170,6 +262,30 @@ class TLVList : public TLVBase {
     virtual TLVType type() const override { return TLVType::LIST_OF_TLV; }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
+    /// @}
+
+    /// @name Getters and setters
+    /// @{
+
+    /// @brief Return the type of the elements of the list
+    TLVType tlvType() const { return mTLVType; }
+    TLVList &tlvType(TLVType t) {
+        mTLVType = t;
+        return *this;
+    }
+
+    /// @brief Return the number of elements of the list
+    std::uint16_t count() const { return mCount; }
+    TLVList &count(std::uint16_t c) {
+        mCount = c;
+        return *this;
+    }
+
     /// @}
 
   private:
@@ -193,9 +309,14 @@ class TLVPeriodicityMs : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::PERIODICITY; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -212,9 +333,12 @@ class TLVPeriodicityMs : public TLVBase {
   private:
     std::uint32_t mMilliseconds = 0;
 
-    enum {
-        millisecondsOffset = 0,
-    };
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::PERIODICITY,
+                  TLVField<TLVPeriodicityMs, std::uint32_t,
+                           &TLVPeriodicityMs::mMilliseconds>>;
 };
 
 /**
@@ -226,9 +350,14 @@ class TLVCell : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::CELL; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -266,12 +395,14 @@ class TLVCell : public TLVBase {
     std::uint32_t mUlEarfcn = 0;
     std::uint8_t mNPrb = 0;
 
-    enum {
-        pciOffset = 0,
-        dlEarfcnOffset = 2,
-        ulEarfcnOffset = 6,
-        nPrbOffset = 10,
-    };
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::CELL,
+                  TLVField<TLVCell, std::uint16_t, &TLVCell::mPci>,
+                  TLVField<TLVCell, std::uint32_t, &TLVCell::mDlEarfcn>,
+                  TLVField<TLVCell, std::uint32_t, &TLVCell::mUlEarfcn>,
+                  TLVField<TLVCell, std::uint8_t, &TLVCell::mNPrb>>;
 };
 
 /**
@@ -283,9 +414,14 @@ class TLVUEReport : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::UE_REPORT; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -330,13 +466,15 @@ class TLVUEReport : public TLVBase {
     std::uint8_t mStatus = 0;
     std::uint16_t mPCI = 0;
 
-    enum {
-        imsiOffset = 0,
-        tmsiOffset = 8,
-        rntiOffset = 12,
-        statusOffset = 14,
-        pciOffset = 15
-    };
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::UE_REPORT,
+                  TLVField<TLVUEReport, std::uint64_t, &TLVUEReport::mIMSI>,
+                  TLVField<TLVUEReport, std::uint32_t, &TLVUEReport::mTMSI>,
+                  TLVField<TLVUEReport, std::uint16_t, &TLVUEReport::mRNTI>,
+                  TLVField<TLVUEReport, std::uint8_t, &TLVUEReport::mStatus>,
+                  TLVField<TLVUEReport, std::uint16_t, &TLVUEReport::mPCI>>;
 };
 
 /**
@@ -348,9 +486,14 @@ class TLVUEMeasurementConfig : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::UE_MEASUREMENTS_CONFIG; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -388,12 +531,18 @@ class TLVUEMeasurementConfig : public TLVBase {
     std::uint8_t mInterval = 0;
     std::uint8_t mAmount = 0;
 
-    enum {
-        rntiOffset = 0,
-        measIdOffset = 2,
-        intervalOffset = 3,
-        amountOffset = 4
-    };
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::UE_MEASUREMENTS_CONFIG,
+                  TLVField<TLVUEMeasurementConfig, std::uint16_t,
+                           &TLVUEMeasurementConfig::mRNTI>,
+                  TLVField<TLVUEMeasurementConfig, std::uint8_t,
+                           &TLVUEMeasurementConfig::mMeasId>,
+                  TLVField<TLVUEMeasurementConfig, std::uint8_t,
+                           &TLVUEMeasurementConfig::mInterval>,
+                  TLVField<TLVUEMeasurementConfig, std::uint8_t,
+                           &TLVUEMeasurementConfig::mAmount>>;
 };
 
 /**
@@ -405,9 +554,14 @@ class TLVUEMeasurementId : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::UE_MEASUREMENT_ID; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -431,10 +585,14 @@ class TLVUEMeasurementId : public TLVBase {
     std::uint16_t mRNTI = 0;
     std::uint8_t mMeasId = 0;
 
-    enum {
-        rntiOffset = 0,
-        measIdOffset = 2
-    };
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::UE_MEASUREMENT_ID,
+                  TLVField<TLVUEMeasurementId, std::uint16_t,
+                           &TLVUEMeasurementId::mRNTI>,
+                  TLVField<TLVUEMeasurementId, std::uint8_t,
+                           &TLVUEMeasurementId::mMeasId>>;
 };
 
 /**
@@ -446,9 +604,14 @@ class TLVUEMeasurementReport : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::UE_MEASUREMENT_REPORT; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -486,13 +649,18 @@ class TLVUEMeasurementReport : public TLVBase {
     std::uint8_t mRSRP = 0;
     std::uint8_t mRSRQ = 0;
 
-    enum {
-        rntiOffset = 0,
-        measIdOffset = 2,
-        rsrpOffset = 3,
-        rsrqOffset = 4
-    };
-
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::UE_MEASUREMENT_REPORT,
+                  TLVField<TLVUEMeasurementReport, std::uint16_t,
+                           &TLVUEMeasurementReport::mRNTI>,
+                  TLVField<TLVUEMeasurementReport, std::uint8_t,
+                           &TLVUEMeasurementReport::mMeasId>,
+                  TLVField<TLVUEMeasurementReport, std::uint8_t,
+                           &TLVUEMeasurementReport::mRSRP>,
+                  TLVField<TLVUEMeasurementReport, std::uint8_t,
+                           &TLVUEMeasurementReport::mRSRQ>>;
 };
 
 /**
@@ -504,9 +672,14 @@ class TLVMACPrbReportReport : public TLVBase {
 
     /// @name TLVBase interface
     /// @{
-    virtual TLVType type() const override { return TLVType::MAC_PRB_UTILIZATION_REPORT; }
+    virtual TLVType type() const override { return Layout::type(); }
     virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
     virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
     /// @}
 
     /// @name Getters and setters
@@ -544,14 +717,182 @@ class TLVMACPrbReportReport : public TLVBase {
     std::uint32_t mUL = 0;
     std::uint16_t mPCI = 0;
 
+  public:
+    /// @brief The encoding of this TLV (see TLVLayout).
+    using Layout =
+        TLVLayout<TLVType::MAC_PRB_UTILIZATION_REPORT,
+                  TLVField<TLVMACPrbReportReport, std::uint16_t,
+                           &TLVMACPrbReportReport::mNPrb>,
+                  TLVField<TLVMACPrbReportReport, std::uint32_t,
+                           &TLVMACPrbReportReport::mDL>,
+                  TLVField<TLVMACPrbReportReport, std::uint32_t,
+                           &TLVMACPrbReportReport::mUL>,
+                  TLVField<TLVMACPrbReportReport, std::uint16_t,
+                           &TLVMACPrbReportReport::mPCI>>;
+};
+
+/**
+ * @brief A list of TLVs of type T, which must have a fixed layout (see
+ *        TLVLayout), e.g. `TLVListOf<TLVUEReport>`.
+ *
+ * It is encoded as a TLVType::LIST_OF_TLV TLV (i.e. the elements type
+ * and count, like TLVList) followed by the data of all the elements
+ * (without their TLVHeader), one after the other. Encoding and
+ * decoding check bounds once for the whole list, and then loop over
+ * the elements without virtual calls.
+ *
+ * See also TLVListOfView, to read the elements without decoding all of
+ * them.
+ */
+template <typename T> class TLVListOf : public TLVBase {
+  public:
+    using LayoutType = typename T::Layout;
+    using value_type = std::vector<T>;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+
     enum {
-        nPrbOffset = 0,
-        dlOffset = 2,
-        ulOffset = 6,
-        pciOffset = 10,
+        /// @brief The size of the list header (elements type and
+        ///        count).
+        headerSize = 4,
+    };
+
+    /// @brief The maximum number of elements of a list (so that
+    ///        the TLV length fits in the TLVHeader).
+    static constexpr std::size_t maxElements() {
+        return (0xFFFF - TLVHeader::headerLength - headerSize) /
+               LayoutType::size();
+    }
+
+    virtual ~TLVListOf() {}
+
+    /// @name TLVBase interface
+    /// @{
+    virtual TLVType type() const override { return TLVType::LIST_OF_TLV; }
+    virtual std::size_t encode(NetworkLib::BufferWritableView buffer) override;
+    virtual std::size_t decode(NetworkLib::BufferView buffer) override;
+    virtual NetworkLib::Status
+    encode_nothrow(NetworkLib::BufferWritableView buffer,
+                   std::size_t &length) override;
+    virtual NetworkLib::Status decode_nothrow(NetworkLib::BufferView buffer,
+                                              std::size_t &length) override;
+    /// @}
+
+    /// @name Getters and setters
+    /// @{
+
+    const_reference elements() const { return mElements; }
+    reference elements() { return mElements; }
+
+    /// @brief Append an element.
+    TLVListOf &add(const T &element) {
+        mElements.push_back(element);
+        return *this;
+    }
+
+    std::size_t size() const { return mElements.size(); }
+    bool empty() const { return mElements.empty(); }
+    void clear() { mElements.clear(); }
+    void reserve(std::size_t n) { mElements.reserve(n); }
+
+    /// @}
+
+  private:
+    value_type mElements;
+
+    enum {
+        tlvTypeOffset = 0,
+        countOffset = 2,
+        elementsOffset = 4,
     };
 };
 
+template <typename T>
+std::size_t TLVListOf<T>::encode(NetworkLib::BufferWritableView buffer) {
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+template <typename T>
+std::size_t TLVListOf<T>::decode(NetworkLib::BufferView buffer) {
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+template <typename T>
+NetworkLib::Status
+TLVListOf<T>::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                             std::size_t &length) {
+    const std::size_t count = mElements.size();
+
+    if (count > maxElements()) {
+        // Too many elements for the TLV length
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    const std::size_t requiredSize = headerSize + count * LayoutType::size();
+
+    if (requiredSize > buffer.size()) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Bounds already checked above
+    buffer.setUint16At_nocheck(tlvTypeOffset,
+                               static_cast<std::uint16_t>(LayoutType::type()));
+    buffer.setUint16At_nocheck(countOffset, count);
+
+    std::size_t offset = elementsOffset;
+    for (const T &element : mElements) {
+        LayoutType::encode_nocheck(element, buffer, offset);
+        offset += LayoutType::size();
+    }
+
+    length = requiredSize;
+    return NetworkLib::Status();
+}
+
+template <typename T>
+NetworkLib::Status
+TLVListOf<T>::decode_nothrow(NetworkLib::BufferView buffer,
+                             std::size_t &length) {
+    if (buffer.size() < headerSize) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Bounds already checked above
+    const TLVType tlvType =
+        static_cast<TLVType>(buffer.getUint16At_nocheck(tlvTypeOffset));
+    const std::size_t count = buffer.getUint16At_nocheck(countOffset);
+
+    if (tlvType != LayoutType::type()) {
+        // The list elements have an unexpected type
+        return NetworkLib::ErrorCode::TLV_TYPE_MISMATCH;
+    }
+
+    const std::size_t requiredSize = headerSize + count * LayoutType::size();
+
+    if (requiredSize > buffer.size()) {
+        // The TLV data is too short for all the elements
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    mElements.resize(count);
+
+    // Bounds already checked above
+    std::size_t offset = elementsOffset;
+    for (T &element : mElements) {
+        LayoutType::decode_nocheck(element, buffer, offset);
+        offset += LayoutType::size();
+    }
+
+    length = requiredSize;
+    return NetworkLib::Status();
+}
+
 } // namespace Agent
 } // namespace Empower
 
@@ -0,0 +1,405 @@
+#ifndef EMPOWER_AGENT_TLVVIEWS_HH
+#define EMPOWER_AGENT_TLVVIEWS_HH
+
+#include <empoweragentproto/tlvs.hh>
+
+#include <iterator>
+#include <utility>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief A read-only view on an encoded TLV: its type and its data
+ *        (excluding the TLVHeader), referring to the buffer it has
+ *        been decoded from (see MessageDecoder::next()).
+ *
+ * Unlike classes derived from TLVBase, views don't decode anything
+ * in advance, and don't allocate memory: accessors of the typed
+ * views derived from TLVView (e.g. TLVUEReportView) read straight
+ * from the encoded data. This is convenient when only a few fields
+ * of a message are of interest.
+ */
+class TLVView {
+  public:
+    /// @brief Default constructor: an invalid view (type is
+    ///        TLVType::NONE).
+    TLVView() = default;
+
+    TLVView(TLVType type, NetworkLib::BufferView data)
+        : mType{type}, mData{std::move(data)} {}
+
+    /// @brief Return the TLV type.
+    TLVType type() const { return mType; }
+
+    /// @brief Return the encoded TLV data.
+    const NetworkLib::BufferView &data() const { return mData; }
+
+    /// @brief Return true if this view refers to a TLV.
+    explicit operator bool() const { return mType != TLVType::NONE; }
+
+  protected:
+    /// @brief Throw std::runtime_error if the type of this TLV isn't
+    ///        `expected`, or its data is shorter than `minSize`.
+    void check(TLVType expected, std::size_t minSize) const;
+
+  private:
+    TLVType mType = TLVType::NONE;
+    NetworkLib::BufferView mData;
+};
+
+/**
+ * @brief Base class for views on TLVs with a fixed layout (see
+ *        TLVLayout), given the corresponding TLV class T.
+ *
+ * The size and type of the TLV are checked once in the constructor,
+ * then each field is read without checking bounds.
+ */
+template <typename T> class TLVFixedView : public TLVView {
+  public:
+    using LayoutType = typename T::Layout;
+
+    /// @brief Build a view on the given TLV (throw if it's not a T).
+    explicit TLVFixedView(TLVView view) : TLVView(std::move(view)) {
+        check(LayoutType::type(), LayoutType::size());
+    }
+
+    /// @brief Decode the whole TLV as a T.
+    T materialize() const {
+        T tlv;
+        LayoutType::decode_nocheck(tlv, data());
+        return tlv;
+    }
+
+  protected:
+    /// @brief Get the value of the i-th field of the layout.
+    template <std::size_t i>
+    typename LayoutType::template Field<i>::type::value_type field() const {
+        return LayoutType::template load_nocheck<i>(data());
+    }
+};
+
+/**
+ * @brief A view on a TLVError
+ */
+class TLVErrorView : public TLVView {
+  public:
+    explicit TLVErrorView(TLVView view) : TLVView(std::move(view)) {
+        check(TLVType::ERROR, errorMessageOffset);
+    }
+
+    std::uint16_t errcode() const {
+        // Size already checked in the constructor
+        return data().getUint16At_nocheck(errorCodeOffset);
+    }
+
+    /// @brief Return the error message (throw if it's not
+    ///        zero-terminated)
+    NetworkLib::StringView message() const {
+        return data().getCStringViewAt(errorMessageOffset);
+    }
+
+  private:
+    enum {
+        errorCodeOffset = 0,
+        errorMessageOffset = 2,
+    };
+};
+
+/**
+ * @brief A view on a TLVBinaryData
+ */
+class TLVBinaryDataView : public TLVView {
+  public:
+    explicit TLVBinaryDataView(TLVView view) : TLVView(std::move(view)) {
+        check(TLVType::BINARY_DATA, 0);
+    }
+
+    /// @brief Convenience getter for string data.
+    NetworkLib::StringView stringData() const {
+        return data().getCStringViewAt(0);
+    }
+};
+
+/**
+ * @brief A view on a TLVKeyValueStringPairs, which is a range of
+ *        pairs of NetworkLib::StringView.
+ *
+ * Iterating parses the data on the fly; iterators are valid as long
+ * as the view.
+ */
+class TLVKeyValueStringPairsView : public TLVView {
+  public:
+    using value_type =
+        std::pair<NetworkLib::StringView, NetworkLib::StringView>;
+
+    /// @brief A forward iterator on the key-value pairs.
+    class const_iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TLVKeyValueStringPairsView::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        const_iterator(const NetworkLib::BufferView &buffer,
+                       std::size_t offset)
+            : mBuffer{&buffer}, mOffset{offset} {
+            parse();
+        }
+
+        reference operator*() const { return mValue; }
+        pointer operator->() const { return &mValue; }
+
+        const_iterator &operator++() {
+            mOffset += mValue.first.size() + 1 + mValue.second.size() + 1;
+            parse();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        friend bool operator==(const const_iterator &lhs,
+                               const const_iterator &rhs) {
+            return lhs.mOffset == rhs.mOffset;
+        }
+
+        friend bool operator!=(const const_iterator &lhs,
+                               const const_iterator &rhs) {
+            return !(lhs == rhs);
+        }
+
+      private:
+        const NetworkLib::BufferView *mBuffer;
+        std::size_t mOffset;
+        value_type mValue;
+
+        // Read the pair at mOffset (if not at the end)
+        void parse();
+    };
+
+    explicit TLVKeyValueStringPairsView(TLVView view)
+        : TLVView(std::move(view)) {
+        check(TLVType::KEY_VALUE_STRING_PAIRS, 0);
+    }
+
+    const_iterator begin() const { return const_iterator(data(), 0); }
+    const_iterator end() const { return const_iterator(data(), data().size()); }
+
+    /// @brief Return an iterator to the first pair with the given
+    ///        key, or `end()`.
+    const_iterator find(const NetworkLib::StringView &key) const;
+};
+
+/**
+ * @brief A view on a TLVPeriodicityMs
+ */
+class TLVPeriodicityMsView : public TLVFixedView<TLVPeriodicityMs> {
+  public:
+    explicit TLVPeriodicityMsView(TLVView view)
+        : TLVFixedView(std::move(view)) {}
+
+    std::uint32_t milliseconds() const { return field<0>(); }
+};
+
+/**
+ * @brief A view on a TLVCell
+ */
+class TLVCellView : public TLVFixedView<TLVCell> {
+  public:
+    explicit TLVCellView(TLVView view) : TLVFixedView(std::move(view)) {}
+
+    std::uint16_t pci() const { return field<0>(); }
+    std::uint32_t dlEarfcn() const { return field<1>(); }
+    std::uint32_t ulEarfcn() const { return field<2>(); }
+    std::uint8_t nPrb() const { return field<3>(); }
+};
+
+/**
+ * @brief A view on a TLVUEReport
+ */
+class TLVUEReportView : public TLVFixedView<TLVUEReport> {
+  public:
+    explicit TLVUEReportView(TLVView view) : TLVFixedView(std::move(view)) {}
+
+    std::uint64_t imsi() const { return field<0>(); }
+    std::uint32_t tmsi() const { return field<1>(); }
+    std::uint16_t rnti() const { return field<2>(); }
+    std::uint8_t status() const { return field<3>(); }
+    std::uint16_t pci() const { return field<4>(); }
+};
+
+/**
+ * @brief A view on a TLVUEMeasurementConfig
+ */
+class TLVUEMeasurementConfigView
+    : public TLVFixedView<TLVUEMeasurementConfig> {
+  public:
+    explicit TLVUEMeasurementConfigView(TLVView view)
+        : TLVFixedView(std::move(view)) {}
+
+    std::uint16_t rnti() const { return field<0>(); }
+    std::uint8_t measId() const { return field<1>(); }
+    std::uint8_t interval() const { return field<2>(); }
+    std::uint8_t amount() const { return field<3>(); }
+};
+
+/**
+ * @brief A view on a TLVUEMeasurementId
+ */
+class TLVUEMeasurementIdView : public TLVFixedView<TLVUEMeasurementId> {
+  public:
+    explicit TLVUEMeasurementIdView(TLVView view)
+        : TLVFixedView(std::move(view)) {}
+
+    std::uint16_t rnti() const { return field<0>(); }
+    std::uint8_t measId() const { return field<1>(); }
+};
+
+/**
+ * @brief A view on a TLVUEMeasurementReport
+ */
+class TLVUEMeasurementReportView
+    : public TLVFixedView<TLVUEMeasurementReport> {
+  public:
+    explicit TLVUEMeasurementReportView(TLVView view)
+        : TLVFixedView(std::move(view)) {}
+
+    std::uint16_t rnti() const { return field<0>(); }
+    std::uint8_t measId() const { return field<1>(); }
+    std::uint8_t rsrp() const { return field<2>(); }
+    std::uint8_t rsrq() const { return field<3>(); }
+};
+
+/**
+ * @brief A view on a TLVMACPrbReportReport
+ */
+class TLVMACPrbReportReportView
+    : public TLVFixedView<TLVMACPrbReportReport> {
+  public:
+    explicit TLVMACPrbReportReportView(TLVView view)
+        : TLVFixedView(std::move(view)) {}
+
+    std::uint16_t nPrb() const { return field<0>(); }
+    std::uint32_t dlPrbCounters() const { return field<1>(); }
+    std::uint32_t ulPrbCounters() const { return field<2>(); }
+    std::uint16_t pci() const { return field<3>(); }
+};
+
+/**
+ * @brief Base class of TLVListOfView, checking the list header.
+ */
+class TLVListViewBase : public TLVView {
+  public:
+    /// @brief Return the number of elements.
+    std::size_t size() const { return mCount; }
+
+    bool empty() const { return mCount == 0; }
+
+    /// @brief Return the type of the elements.
+    TLVType elementType() const { return mElementType; }
+
+  protected:
+    /// @brief Throw std::runtime_error if the view is not on a list of
+    ///        elements of the given type and size.
+    TLVListViewBase(TLVView view, TLVType elementType,
+                    std::size_t elementSize);
+
+    enum {
+        tlvTypeOffset = 0,
+        countOffset = 2,
+        elementsOffset = 4,
+    };
+
+  private:
+    TLVType mElementType;
+    std::size_t mCount;
+};
+
+/**
+ * @brief A view on a TLVListOf<T> (T having a fixed layout).
+ *
+ * Since the list size is checked once in the constructor, elements
+ * and their fields are read without checking bounds. In particular,
+ * `column()` copies one field of all the elements with a tight loop,
+ * which is handy to read a list into a struct-of-arrays:
+ *
+ *       TLVListOfView<TLVUEReport> list(decoder.next());
+ *       std::vector<std::uint16_t> rntis(list.size());
+ *       list.column<2>(rntis.begin()); // TLVUEReport::rnti()
+ */
+template <typename T> class TLVListOfView : public TLVListViewBase {
+  public:
+    using LayoutType = typename T::Layout;
+
+    /// @brief The type of the value of the i-th field of T.
+    template <std::size_t i>
+    using FieldType = typename LayoutType::template Field<i>::type::value_type;
+
+    explicit TLVListOfView(TLVView view)
+        : TLVListViewBase(std::move(view), LayoutType::type(),
+                          LayoutType::size()) {}
+
+    /// @brief Return a view on the n-th element, checking bounds.
+    ///
+    /// The typed view of T can be built from it (e.g. TLVUEReportView
+    /// for TLVUEReport).
+    TLVView element(std::size_t n) const {
+        return TLVView(LayoutType::type(),
+                       data().getSub(elementOffset(n), LayoutType::size()));
+    }
+
+    /// @brief Decode the n-th element, **without** checking bounds.
+    T materialize(std::size_t n) const {
+        T tlv;
+        LayoutType::decode_nocheck(tlv, data(), elementOffset(n));
+        return tlv;
+    }
+
+    /// @brief Decode all the elements, appending them to a container
+    ///        (e.g. TLVListOf<T>::elements()).
+    template <typename Container> void materializeAll(Container &c) const {
+        for (std::size_t n = 0; n < size(); ++n) {
+            c.push_back(materialize(n));
+        }
+    }
+
+    /// @brief Return the i-th field of the n-th element, **without**
+    ///        checking bounds.
+    template <std::size_t i> FieldType<i> get(std::size_t n) const {
+        using F = typename LayoutType::template Field<i>;
+        return TLVFieldCodec<FieldType<i>>::load(data(), elementOffset(n) +
+                                                             F::fieldOffset());
+    }
+
+    /// @brief Copy the i-th field of all the elements to `out`.
+    ///
+    /// @return The output iterator past the last copied value.
+    template <std::size_t i, typename OutputIt>
+    OutputIt column(OutputIt out) const {
+        using F = typename LayoutType::template Field<i>;
+        const NetworkLib::BufferView &buffer = data();
+
+        std::size_t offset = elementsOffset + F::fieldOffset();
+        for (std::size_t n = 0; n < size(); ++n) {
+            *out++ = TLVFieldCodec<FieldType<i>>::load(buffer, offset);
+            offset += LayoutType::size();
+        }
+
+        return out;
+    }
+
+  private:
+    static std::size_t elementOffset(std::size_t n) {
+        return elementsOffset + n * LayoutType::size();
+    }
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef EMPOWER_AGENT_URING_HH
+#define EMPOWER_AGENT_URING_HH
+
+#include <empoweragentproto/networklib.hh>
+
+// For struct msghdr
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+/**
+ * @brief A minimal `io_uring(7)` instance (Linux only), with a ring of
+ *        buffers the kernel picks from to complete receive requests.
+ *
+ * Requests are prepared (see `prepareRecvMultishot()` and the others)
+ * and then submitted all at once by `submitAndWait()`, which waits for
+ * and collects their completions in the same system call. A
+ * multishot receive keeps completing (each time into another buffer of
+ * the ring, see `receivedData()`) until the connection is closed or
+ * the ring runs out of buffers.
+ *
+ * The buffers come from a PacketBufferSizedPool and are registered
+ * with the kernel once. The interface of the kernel is used directly
+ * (no liburing needed), and it takes Linux 6.0 or later (see
+ * `available()`); the library also builds without the io_uring
+ * headers, in which case `available()` is always false.
+ *
+ * Used by IO (see IO::Transport::IO_URING). Not thread safe.
+ */
+class Uring {
+  public:
+    /// @brief The size (in bytes) of each receive buffer.
+    static const std::size_t receiveBufferSize = 16384;
+
+    /// @brief A completed request.
+    struct Completion {
+        /// @brief The value given when preparing the request.
+        std::uint64_t userData;
+
+        /// @brief The result of the operation (as returned by the
+        ///        corresponding system call, or `-errno`).
+        std::int32_t result;
+
+        /// @brief The receive buffer holding the data (`-1` if none,
+        ///        see `receivedData()`).
+        std::int32_t bufferId;
+
+        /// @brief Tell if the (multishot) request is going to complete
+        ///        again (otherwise it must be prepared again).
+        bool more;
+    };
+
+    /// @brief Tell if io_uring can be used (with all the features
+    ///        Uring relies on). The answer is computed once, by
+    ///        actually receiving data with a multishot request.
+    static bool available();
+
+    /// @brief Constructor. Check `ok()` before using the instance.
+    ///
+    /// @param entries The size of the submission queue (rounded up to
+    ///        a power of two).
+    /// @param bufferCount The number of receive buffers (a power of
+    ///        two, up to 32768).
+    explicit Uring(unsigned entries = 256, unsigned bufferCount = 64);
+
+    ~Uring();
+
+    ///@name No copy semantic
+    ///@{
+    Uring(const Uring &) = delete;
+    Uring &operator=(const Uring &) = delete;
+    ///@}
+
+    /// @brief Tell if the instance has been set up (the reason is in
+    ///        `status()` otherwise).
+    bool ok() const { return mFD != -1; }
+
+    /// @brief Return why setting up the instance failed (if it did).
+    NetworkLib::Status status() const { return mStatus; }
+
+    /// @name Requests
+    ///
+    /// Requests are only prepared, and submitted on the next call to
+    /// `submit()` or `submitAndWait()` (or earlier if the submission
+    /// queue gets full). Whatever the request refers to must stay
+    /// valid until it completes.
+    ///
+    /// @{
+
+    /// @brief Receive from a socket into buffers of the ring, until
+    ///        the completion has `more` unset.
+    void prepareRecvMultishot(int fd, std::uint64_t userData);
+
+    /// @brief Report each time the file descriptor becomes readable,
+    ///        until the completion has `more` unset.
+    void preparePollMultishot(int fd, std::uint64_t userData);
+
+    /// @brief Send the data described by the given header to a socket
+    ///        (with MSG_NOSIGNAL).
+    void prepareSendmsg(int fd, const msghdr *message, std::uint64_t userData);
+
+    /// @brief Return the number of requests not submitted yet.
+    std::size_t pending() const { return mPrepared; }
+
+    /// @}
+
+    /// @brief Submit the prepared requests, without waiting.
+    NetworkLib::Status submit() noexcept;
+
+    /// @brief Submit the prepared requests, wait up to `timeoutMsec`
+    ///        milliseconds (`-1` means forever, `0` means don't wait
+    ///        at all) for at least one completion, and then collect all
+    ///        the available completions (appended to `completions`).
+    ///
+    /// Being interrupted by a signal is not an error.
+    NetworkLib::Status submitAndWait(int timeoutMsec,
+                                     std::vector<Completion> &completions);
+
+    /// @brief Return the data received by a receive completion (with a
+    ///        positive result), in its buffer of the ring.
+    ///
+    /// The data must be used (or copied) before handing the buffer
+    /// back via `recycle()`.
+    NetworkLib::BufferView receivedData(const Completion &completion) const;
+
+    /// @brief Hand the buffer of a completion (if any) back to the
+    ///        kernel.
+    void recycle(const Completion &completion) noexcept;
+
+  private:
+    int mFD = -1;
+    NetworkLib::Status mStatus;
+
+    ///@name The submission queue (shared with the kernel)
+    ///@{
+    void *mSQRing = nullptr;
+    std::size_t mSQRingSize = 0;
+    unsigned *mSQHead = nullptr;
+    unsigned *mSQTail = nullptr;
+    unsigned mSQMask = 0;
+    unsigned mSQEntries = 0;
+    void *mSQEs = nullptr;
+    std::size_t mSQEsSize = 0;
+    std::size_t mPrepared = 0;
+    ///@}
+
+    ///@name The completion queue (shared with the kernel)
+    ///@{
+    void *mCQRing = nullptr;
+    std::size_t mCQRingSize = 0;
+    unsigned *mCQHead = nullptr;
+    unsigned *mCQTail = nullptr;
+    unsigned mCQMask = 0;
+    void *mCQEs = nullptr;
+    ///@}
+
+    ///@name The receive buffers
+    ///@{
+    NetworkLib::PacketBufferSizedPool<receiveBufferSize> mPool;
+    std::vector<NetworkLib::BufferWritableView> mBuffers;
+
+    // The ring telling the kernel which buffers are free
+    void *mBufferRing = nullptr;
+    std::size_t mBufferRingSize = 0;
+    std::uint16_t mBufferTail = 0;
+    std::uint16_t mBufferMask = 0;
+    ///@}
+
+    // Set everything up (see ok()).
+    NetworkLib::Status setup(unsigned entries, unsigned bufferCount);
+
+    // Undo setup() (even a partial one).
+    void release() noexcept;
+
+    // Return a cleared submission queue entry (submitting prepared
+    // requests if the queue is full).
+    void *nextSQE();
+
+    // Add a buffer at the tail of the buffer ring (without publishing
+    // the new tail).
+    void addBuffer(std::uint16_t id) noexcept;
+};
+
+} // namespace Agent
+} // namespace Empower
+
+#endif
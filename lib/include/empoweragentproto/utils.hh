@@ -19,6 +19,19 @@
 // For std::string
 #include <string>
 
+// For std::array
+#include <array>
+
+// For std::memcmp, std::strlen
+#include <cstring>
+
+// For std::ostream
+#include <ostream>
+
+// For std::fputs, std::abort (see NETWORKLIB_THROW)
+#include <cstdio>
+#include <cstdlib>
+
 ///@file
 
 /// @brief Declare packed structures.
@@ -57,17 +70,45 @@
 #define NETWORKLIB_CURRENT_FUNCTION __func__
 #endif
 
+/// @brief Throw an exception of the given type, built from the given
+/// message (a std::string).
+///
+/// When exceptions are disabled (e.g. `-fno-exceptions`), print the
+/// message on stderr and abort instead, so that the headers of the
+/// library can still be used: in that case, stick to the `_nothrow`
+/// variants of functions, which report errors via a
+/// NetworkLib::Status instead.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define NETWORKLIB_HAS_EXCEPTIONS 1
+#define NETWORKLIB_THROW(type, message) throw type(message)
+#else
+#define NETWORKLIB_HAS_EXCEPTIONS 0
+#define NETWORKLIB_THROW(type, message)                                        \
+    ::Empower::NetworkLib::abortWithMessage(#type, message)
+#endif
+
 namespace Empower {
 
 /// @brief Cross-platform code dealing with generic networking stuff.
 namespace NetworkLib {
 
+/// @brief Print an error on stderr and abort (see NETWORKLIB_THROW).
+[[noreturn]] inline void abortWithMessage(const char *type,
+                                          const std::string &message) {
+    std::fputs(type, stderr);
+    std::fputs(": ", stderr);
+    std::fputs(message.c_str(), stderr);
+    std::fputs("\n", stderr);
+    std::abort();
+}
+
 /// @brief RAII guard saving/restoring std::ios format status
 class Iosguard {
   public:
     explicit Iosguard(std::ios &ios)
         : mIos{ios}, mSavedFmtflags{ios.flags()}, mSavedFill{ios.fill()} {}
 
+#if NETWORKLIB_HAS_EXCEPTIONS
     ~Iosguard() try {
         mIos.flags(mSavedFmtflags);
         mIos.fill(mSavedFill);
@@ -75,6 +116,12 @@ class Iosguard {
         // Catch everything as we don't want calls to std::terminate()
         // because of this.
     }
+#else
+    ~Iosguard() {
+        mIos.flags(mSavedFmtflags);
+        mIos.fill(mSavedFill);
+    }
+#endif
 
   private:
     std::ios &mIos;
@@ -82,22 +129,40 @@ class Iosguard {
     const std::ios::char_type mSavedFill;
 };
 
+/// @brief Defined as 1 when the host stores integers in big-endian
+///        (i.e. network) order, and as 0 otherwise.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) &&               \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define NETWORKLIB_BIG_ENDIAN_HOST 1
+#else
+#define NETWORKLIB_BIG_ENDIAN_HOST 0
+#endif
+
 ///@name Byte ordering and data access functions
 ///
 /// They provide a superset of the functionalities of ntohl(), ntohs(),
 /// etc.
 ///
-/// Note: looking at the assembly output of both GCC and CLang, they
-///       result in code that's as efficient as using ntohl() and
-///       such, while still being a bit more handy to read values from
-///       buffers.
+/// Values are loaded and stored with `std::memcpy()` (which is fine
+/// with unaligned addresses, and compiles to a single move) and
+/// swapped with `__builtin_bswapNN()` where available (a single
+/// instruction), so they are as efficient as ntohl() and such, also
+/// when the compiler can't see through a sequence of shifts and ORs
+/// (e.g. in loops over arrays).
+///
+/// There are also bulk versions converting arrays of values (see
+/// `getUint32ArrayAt()` and such).
 ///
 ///@{
 
 /// @brief Swap byte order on a 32-bit unsigned value
 inline std::uint32_t swapByteOrder(std::uint32_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap32(value);
+#else
     return ((value & 0xFF) << 24) | (((value >> 8) & 0xFF) << 16) |
            (((value >> 16) & 0xFF) << 8) | (((value >> 24) & 0xFF));
+#endif
 }
 
 /// @brief Swap byte order on a 32-bit signed value
@@ -108,7 +173,11 @@ inline std::int32_t swapByteOrder(std::int32_t value) noexcept {
 
 /// @brief Swap byte order on a 16-bit unsigned value
 inline std::uint16_t swapByteOrder(std::uint16_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap16(value);
+#else
     return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
+#endif
 }
 
 /// @brief Swap byte order on a 16-bit signed value
@@ -117,35 +186,43 @@ inline std::int16_t swapByteOrder(std::int16_t value) noexcept {
     return swapByteOrder(v1);
 }
 
+/// @brief Swap byte order on a 64-bit unsigned value
+inline std::uint64_t swapByteOrder(std::uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap64(value);
+#else
+    return (static_cast<std::uint64_t>(
+                swapByteOrder(static_cast<std::uint32_t>(value)))
+            << 32) |
+           swapByteOrder(static_cast<std::uint32_t>(value >> 32));
+#endif
+}
+
+/// @brief Swap byte order on a 64-bit signed value
+inline std::int64_t swapByteOrder(std::int64_t value) noexcept {
+    const std::uint64_t v1 = value;
+    return swapByteOrder(v1);
+}
+
+/// @brief Convert an unsigned value between network order and host
+///        order (either way, it's the same operation).
+template <typename T> inline T networkToHostOrder(T value) noexcept {
+#if NETWORKLIB_BIG_ENDIAN_HOST
+    return value;
+#else
+    return swapByteOrder(value);
+#endif
+}
+
 /// @brief  Get a `std::uint64_t` stored at the given address.
 ///
 /// The value stored in memory is assumed to be in network order,
 /// while the returned value is in host order (i.e. `ntohl()` with a
 /// pointer).
 inline std::uint64_t getUint64At(const void *ptr) noexcept {
-    return (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 0))
-            << 56) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 1))
-            << 48) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 2))
-            << 40) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 3))
-            << 32) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 4))
-            << 24) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 5))
-            << 16) |
-           (static_cast<std::uint64_t>(
-                *(reinterpret_cast<const std::uint8_t *>(ptr) + 6))
-            << 8) |
-           (static_cast<std::uint64_t>(
-               *(reinterpret_cast<const std::uint8_t *>(ptr) + 7)));
+    std::uint64_t v;
+    std::memcpy(&v, ptr, sizeof(v));
+    return networkToHostOrder(v);
 }
 
 /// @brief  Get a `std::int64_t` stored at the given address.
@@ -163,10 +240,9 @@ inline std::int64_t getInt64At(const void *ptr) noexcept {
 /// while the returned value is in host order (i.e. `ntohl()` with a
 /// pointer).
 inline std::uint32_t getUint32At(const void *ptr) noexcept {
-    return ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 0)) << 24) |
-           ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 1)) << 16) |
-           ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 2)) << 8) |
-           ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 3)));
+    std::uint32_t v;
+    std::memcpy(&v, ptr, sizeof(v));
+    return networkToHostOrder(v);
 }
 
 /// @brief  Get a `std::int32_t` stored at the given address.
@@ -184,8 +260,9 @@ inline std::int32_t getInt32At(const void *ptr) noexcept {
 /// while the returned value is in host order (i.e. `ntohs()` with a
 /// pointer).
 inline std::uint16_t getUint16At(const void *ptr) noexcept {
-    return ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 0)) << 8) |
-           ((*(reinterpret_cast<const std::uint8_t *>(ptr) + 1)));
+    std::uint16_t v;
+    std::memcpy(&v, ptr, sizeof(v));
+    return networkToHostOrder(v);
 }
 
 /// @brief  Get a `std::int16_t` stored at the given address.
@@ -203,14 +280,8 @@ inline std::int16_t getInt16At(const void *ptr) noexcept {
 /// while the given value is in host order (i.e. `htonl()` with a
 /// pointer).
 inline void setUint64At(void *ptr, std::uint64_t v) noexcept {
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 0) = (v >> 56) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 1) = (v >> 48) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 2) = (v >> 40) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 3) = (v >> 32) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 4) = (v >> 24) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 5) = (v >> 16) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 6) = (v >> 8) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 7) = (v)&0xFF;
+    v = networkToHostOrder(v);
+    std::memcpy(ptr, &v, sizeof(v));
 }
 
 /// @brief  Set a `std::int64_t` at the given address.
@@ -228,10 +299,8 @@ inline void setInt64At(void *ptr, std::int64_t v) noexcept {
 /// while the given value is in host order (i.e. `htonl()` with a
 /// pointer).
 inline void setUint32At(void *ptr, std::uint32_t v) noexcept {
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 0) = (v >> 24) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 1) = (v >> 16) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 2) = (v >> 8) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 3) = (v)&0xFF;
+    v = networkToHostOrder(v);
+    std::memcpy(ptr, &v, sizeof(v));
 }
 
 /// @brief  Set a `std::int32_t` at the given address.
@@ -249,8 +318,8 @@ inline void setInt32At(void *ptr, std::int32_t v) noexcept {
 /// while the given value is in host order (i.e. `htons()` with a
 /// pointer).
 inline void setUint16At(void *ptr, std::uint16_t v) noexcept {
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 0) = (v >> 8) & 0xFF;
-    *(reinterpret_cast<std::uint8_t *>(ptr) + 1) = (v)&0xFF;
+    v = networkToHostOrder(v);
+    std::memcpy(ptr, &v, sizeof(v));
 }
 
 /// @brief  Set a `std::int16_t` at the given address.
@@ -264,6 +333,44 @@ inline void setInt16At(void *ptr, std::int16_t v) noexcept {
 
 ///@}
 
+///@name Bulk byte ordering functions
+///
+/// Convert arrays of `count` values stored in network order at the
+/// given address to/from host order, using SIMD instructions where
+/// available (SSE2 or AVX2, picked at run time, on x86-64, NEON on
+/// ARM) and falling back to `swapByteOrder()` otherwise.
+///
+/// The address needs not be aligned. The array of host values must
+/// either not overlap the memory area at all, or be exactly at the
+/// same address (for in-place conversions).
+///
+///@{
+
+void getUint64ArrayAt(const void *ptr, std::uint64_t *values,
+                      std::size_t count) noexcept;
+void getUint32ArrayAt(const void *ptr, std::uint32_t *values,
+                      std::size_t count) noexcept;
+void getUint16ArrayAt(const void *ptr, std::uint16_t *values,
+                      std::size_t count) noexcept;
+
+void setUint64ArrayAt(void *ptr, const std::uint64_t *values,
+                      std::size_t count) noexcept;
+void setUint32ArrayAt(void *ptr, const std::uint32_t *values,
+                      std::size_t count) noexcept;
+void setUint16ArrayAt(void *ptr, const std::uint16_t *values,
+                      std::size_t count) noexcept;
+
+///@}
+
+/// @brief Sum `size` bytes at the given address as 16-bit integers
+///        stored in network order (see BufferView::getSum16()).
+///
+/// If `size` is odd, the last byte counts as the high byte of a
+/// 16-bit integer (i.e. as if a `0x00` followed). Uses SIMD
+/// instructions where available, like the bulk byte ordering
+/// functions.
+std::uint64_t getSum16At(const void *ptr, std::size_t size) noexcept;
+
 ///@name Helpers to print out hex numbers.
 ///
 /// @brief Return a std::string with the hex representation of some
@@ -592,6 +699,95 @@ template <typename A> final_action<A> finally(A act) {
     return final_action<A>{act};
 }
 
+/**
+ * @brief A read-only, non-owning reference to a sequence of `char`
+ *        (a minimal replacement for C++17 `std::string_view`).
+ *
+ * A StringView doesn't keep the characters it refers to alive: they
+ * must outlive it (e.g. when obtained from
+ * BufferView::getCStringViewAt(), the buffer must not be released or
+ * changed).
+ */
+class StringView {
+  public:
+    using const_iterator = const char *;
+
+    ///@name Constructors
+    ///@{
+
+    /// @brief Default constructor (an empty string).
+    StringView() noexcept = default;
+
+    /// @brief Refer to `size` chars starting at `data`.
+    StringView(const char *data, std::size_t size) noexcept
+        : mData{data}, mSize{size} {}
+
+    /// @brief Refer to a zero-terminated string (excluding the NUL).
+    StringView(const char *cstr) noexcept
+        : mData{cstr}, mSize{std::strlen(cstr)} {}
+
+    /// @brief Refer to the content of a std::string.
+    StringView(const std::string &str) noexcept
+        : mData{str.data()}, mSize{str.size()} {}
+
+    ///@}
+
+    const char *data() const noexcept { return mData; }
+    std::size_t size() const noexcept { return mSize; }
+    bool empty() const noexcept { return mSize == 0; }
+
+    const_iterator begin() const noexcept { return mData; }
+    const_iterator end() const noexcept { return mData + mSize; }
+
+    /// @brief Access a char, **without** checking bounds.
+    char operator[](std::size_t i) const noexcept { return mData[i]; }
+
+    /// @brief Return a copy as a std::string.
+    std::string str() const { return std::string(mData, mSize); }
+
+    /// @brief Lexicographic comparison (like `std::string::compare()`).
+    int compare(const StringView &other) const noexcept {
+        const std::size_t n = mSize < other.mSize ? mSize : other.mSize;
+        const int result = n == 0 ? 0 : std::memcmp(mData, other.mData, n);
+
+        if (result != 0) {
+            return result;
+        }
+
+        if (mSize == other.mSize) {
+            return 0;
+        }
+
+        return mSize < other.mSize ? -1 : 1;
+    }
+
+    ///@name Comparison operators
+    ///@{
+
+    friend bool operator==(const StringView &lhs, const StringView &rhs) {
+        return lhs.mSize == rhs.mSize && lhs.compare(rhs) == 0;
+    }
+
+    friend bool operator!=(const StringView &lhs, const StringView &rhs) {
+        return !(lhs == rhs);
+    }
+
+    friend bool operator<(const StringView &lhs, const StringView &rhs) {
+        return lhs.compare(rhs) < 0;
+    }
+
+    ///@}
+
+  private:
+    const char *mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+/// @brief Write the characters referred by a StringView.
+inline std::ostream &operator<<(std::ostream &ostr, const StringView &s) {
+    return ostr.write(s.data(), s.size());
+}
+
 } // namespace NetworkLib
 } // namespace Empower
 
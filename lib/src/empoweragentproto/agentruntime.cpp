@@ -0,0 +1,220 @@
+#include <empoweragentproto/agentruntime.hh>
+
+#if defined(__linux__)
+// For pthread_setaffinity_np() and pthread_setname_np()
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// For std::strerror()
+#include <cstring>
+
+#include <sstream>
+
+namespace Empower {
+namespace Agent {
+
+bool AgentRuntime::Producer::publish(const NetworkLib::BufferView &message,
+                                     IO::ConnectionHandle connection) {
+    Message m;
+    m.connection = connection;
+    m.data = message;
+
+    while (!mRing.tryPush(std::move(m))) {
+        if (mRuntime.mOverflowPolicy == OverflowPolicy::REJECT ||
+            mRuntime.mStopRequested.load(std::memory_order_relaxed)) {
+            mRuntime.mTxRejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Make sure the I/O thread is draining the ring
+        mRuntime.wakeupIfIdle();
+        std::this_thread::yield();
+    }
+
+    mRuntime.wakeupIfIdle();
+    return true;
+}
+
+/****/
+
+AgentRuntime::AgentRuntime() {
+    mIO.nonBlocking(true).enableWakeup();
+    mIO.onMessage([this](IO::ConnectionHandle connection,
+                         NetworkLib::BufferView message) {
+        handleMessage(connection, message);
+    });
+}
+
+AgentRuntime::~AgentRuntime() { stop(); }
+
+AgentRuntime::Producer &AgentRuntime::addProducer() {
+    if (running()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION
+            << ": can't add producers while running";
+        NETWORKLIB_THROW(std::logic_error, err.str());
+    }
+
+    mProducers.emplace_back(new Producer(*this, mTxCapacity));
+    return *mProducers.back();
+}
+
+void AgentRuntime::start() {
+    if (running()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": already running";
+        NETWORKLIB_THROW(std::logic_error, err.str());
+    }
+
+    mRxRing.reset(new NetworkLib::SPSCRing<Message>(mRxCapacity));
+    mStopRequested.store(false);
+    mIdle.store(false);
+
+    mThread = std::thread(&AgentRuntime::run, this);
+
+#if defined(__linux__)
+    pthread_setname_np(mThread.native_handle(), "agent-io");
+
+    if (mCPU >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(mCPU, &cpus);
+
+        int result = pthread_setaffinity_np(mThread.native_handle(),
+                                            sizeof(cpus), &cpus);
+
+        if (result != 0) {
+            stop();
+
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": can't pin the I/O thread to CPU " << mCPU
+                << " (errno =" << result << ": " << std::strerror(result)
+                << ')';
+            NETWORKLIB_THROW(std::runtime_error, err.str());
+        }
+    }
+#endif
+}
+
+void AgentRuntime::stop() noexcept {
+    if (!running()) {
+        return;
+    }
+
+    mStopRequested.store(true);
+    mIO.wakeup();
+    mThread.join();
+}
+
+AgentRuntime::Stats AgentRuntime::stats() const {
+    Stats result;
+    result.sent = mSent.load(std::memory_order_relaxed);
+    result.sendFailures = mSendFailures.load(std::memory_order_relaxed);
+    result.received = mReceived.load(std::memory_order_relaxed);
+    result.receiveDropped = mReceiveDropped.load(std::memory_order_relaxed);
+    result.txRejected = mTxRejected.load(std::memory_order_relaxed);
+    result.ioErrors = mIOErrors.load(std::memory_order_relaxed);
+    return result;
+}
+
+void AgentRuntime::wakeupIfIdle() noexcept {
+    // Pairs with the fence in run(): either the I/O thread sees the
+    // message in the ring, or we see it idle (or both).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Only the first producer seeing it idle makes the system call.
+    if (mIdle.load(std::memory_order_relaxed) &&
+        mIdle.exchange(false, std::memory_order_relaxed)) {
+        mIO.wakeup();
+    }
+}
+
+void AgentRuntime::run() noexcept {
+    while (!mStopRequested.load(std::memory_order_acquire)) {
+        if (drainProducers()) {
+            // Busy: don't wait on the sockets.
+            processEvents(0);
+            continue;
+        }
+
+        mIdle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Something may have been published before we got idle.
+        if (drainProducers() ||
+            mStopRequested.load(std::memory_order_acquire)) {
+            mIdle.store(false, std::memory_order_relaxed);
+            processEvents(0);
+            continue;
+        }
+
+        processEvents(mIdleTimeout_msec);
+        mIdle.store(false, std::memory_order_relaxed);
+    }
+
+    drainProducers();
+    processEvents(0);
+}
+
+bool AgentRuntime::drainProducers() noexcept {
+    bool result = false;
+    Message message;
+
+    for (const auto &producer : mProducers) {
+        while (producer->mRing.tryPop(message)) {
+            result = true;
+
+            const IO::ConnectionHandle connection =
+                message.connection == IO::noConnection
+                    ? mIO.defaultConnection()
+                    : message.connection;
+
+            if (mIO.sendMessage_nothrow(connection, message.data).ok()) {
+                mSent.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                mSendFailures.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Release the buffer now (in the I/O thread)
+            message.data = NetworkLib::BufferView();
+        }
+    }
+
+    return result;
+}
+
+void AgentRuntime::processEvents(int timeoutMsec) noexcept {
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+        mIO.processEvents(timeoutMsec);
+    } catch (const std::exception &) {
+        // The failing connection has been closed: go on with the
+        // other ones.
+        mIOErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+#else
+    mIO.processEvents(timeoutMsec);
+#endif
+}
+
+void AgentRuntime::handleMessage(IO::ConnectionHandle connection,
+                                 const NetworkLib::BufferView &message) {
+    // The message is in the IO buffers, which get reused: copy it.
+    NetworkLib::BufferWritableView copy = IO::makeMessageBufferFor(message);
+    message.copyTo(copy);
+
+    Message m;
+    m.connection = connection;
+    m.data = copy;
+
+    if (mRxRing->tryPush(std::move(m))) {
+        mReceived.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        mReceiveDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace Agent
+} // namespace Empower
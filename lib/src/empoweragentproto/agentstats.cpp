@@ -0,0 +1,74 @@
+#include <empoweragentproto/agentstats.hh>
+
+#include <string>
+
+namespace Empower {
+namespace Agent {
+
+TLVKeyValueStringPairs::value_type
+agentStatsPairs(const NetworkLib::MetricsSnapshot &snapshot) {
+    using NetworkLib::Counter;
+    using NetworkLib::MetricsSnapshot;
+    using NetworkLib::Timer;
+
+    TLVKeyValueStringPairs::value_type result;
+
+    for (std::size_t c = 0; c < static_cast<std::size_t>(Counter::COUNT);
+         ++c) {
+        const Counter counter = static_cast<Counter>(c);
+        result.emplace_back(NetworkLib::counterName(counter),
+                            std::to_string(snapshot.counter(counter)));
+    }
+
+    for (std::size_t t = 0; t < static_cast<std::size_t>(Timer::COUNT); ++t) {
+        const Timer timer = static_cast<Timer>(t);
+
+        for (std::size_t key = 0; key < MetricsSnapshot::timerKeys; ++key) {
+            const auto &histogram = snapshot.timer(timer, key);
+
+            if (histogram.count() == 0) {
+                continue;
+            }
+
+            const std::string prefix =
+                std::string(NetworkLib::timerName(timer)) + '.' +
+                (key < MetricsSnapshot::timerKeys - 1 ? std::to_string(key)
+                                                      : "other") +
+                '.';
+
+            result.emplace_back(prefix + "count",
+                                std::to_string(histogram.count()));
+            result.emplace_back(prefix + "mean_ns",
+                                std::to_string(histogram.mean()));
+            result.emplace_back(prefix + "p50_ns",
+                                std::to_string(histogram.percentile(0.5)));
+            result.emplace_back(prefix + "p99_ns",
+                                std::to_string(histogram.percentile(0.99)));
+            result.emplace_back(prefix + "max_ns",
+                                std::to_string(histogram.max()));
+        }
+    }
+
+    return result;
+}
+
+NetworkLib::BufferView
+encodeAgentStatsReply(NetworkLib::BufferWritableView buffer,
+                      const CommonHeaderDecoder &request,
+                      const NetworkLib::MetricsSnapshot &snapshot) {
+    TLVKeyValueStringPairs tlv;
+    tlv.setValue(agentStatsPairs(snapshot));
+
+    MessageEncoder encoder(buffer);
+    encoder.header()
+        .messageClass(MessageClass::RESPONSE_SUCCESS)
+        .entityClass(EntityClass::AGENT_STATS_SERVICE)
+        .sequence(request.sequence())
+        .transactionId(request.transactionId());
+
+    encoder.add(tlv).end();
+    return encoder.data();
+}
+
+} // namespace Agent
+} // namespace Empower
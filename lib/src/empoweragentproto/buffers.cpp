@@ -9,19 +9,131 @@
 namespace Empower {
 namespace NetworkLib {
 
+namespace {
+
+// A PacketBuffer referring to a PacketBuffer managed by a
+// std::shared_ptr (see PacketBufferPtr(std::shared_ptr<PacketBuffer>)).
+class SharedPacketBuffer : public PacketBuffer {
+  public:
+    explicit SharedPacketBuffer(std::shared_ptr<PacketBuffer> b)
+        : mBuffer(std::move(b)) {}
+
+    virtual std::size_t size() const override { return mBuffer->size(); }
+    unsigned char *data() override { return mBuffer->data(); }
+
+  private:
+    std::shared_ptr<PacketBuffer> mBuffer;
+};
+
+} // namespace
+
+PacketBufferPtr::PacketBufferPtr(std::shared_ptr<PacketBuffer> b)
+    : PacketBufferPtr(b ? new SharedPacketBuffer(std::move(b)) : nullptr) {}
+
 void BufferView::copyTo(BufferWritableView &destination) const {
     if (destination.size() < size()) {
         std::ostringstream err;
         err << NETWORKLIB_CURRENT_FUNCTION
             << ": destination too small (required: " << size()
             << ", available: " << destination.size() << ")";
-        throw std::runtime_error(err.str());
+        NETWORKLIB_THROW(std::runtime_error, err.str());
     }
 
     unsigned char *dst = destination.getUnderlyingWritableBufferPtr();
     std::copy(mPtr, mPtr + mSize, dst);
 }
 
+void InternetChecksum::addAt(std::size_t offset,
+                             std::uint64_t sum16) noexcept {
+    while ((sum16 >> 16) != 0) {
+        sum16 = (sum16 & 0xFFFF) + (sum16 >> 16);
+    }
+
+    if ((offset % 2) != 0) {
+        // Words starting at odd offsets have their bytes swapped
+        // (see RFC 1071, section 2.B).
+        sum16 = swapByteOrder(static_cast<std::uint16_t>(sum16));
+    }
+
+    mSum += sum16;
+}
+
+InternetChecksum &InternetChecksum::add(const BufferView &data) noexcept {
+    addAt(mLength, getSum16At(data.getUnderlyingBufferPtr(), data.size()));
+    mLength += data.size();
+    return *this;
+}
+
+InternetChecksum &
+InternetChecksum::add(const BufferViewSegments &segments) noexcept {
+    for (const auto &segment : segments) {
+        add(segment);
+    }
+
+    return *this;
+}
+
+InternetChecksum &InternetChecksum::replace(std::size_t offset,
+                                            const BufferView &oldData,
+                                            const BufferView &newData) {
+    if (oldData.size() != newData.size()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": replacing " << oldData.size()
+            << " bytes with " << newData.size() << " bytes";
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    return replace(offset, oldData.getUnderlyingBufferPtr(),
+                   newData.getUnderlyingBufferPtr(), oldData.size());
+}
+
+InternetChecksum &InternetChecksum::replace(std::size_t offset,
+                                            const void *oldData,
+                                            const void *newData,
+                                            std::size_t size) noexcept {
+    // RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m')
+    std::uint64_t oldSum = getSum16At(oldData, size);
+
+    while ((oldSum >> 16) != 0) {
+        oldSum = (oldSum & 0xFFFF) + (oldSum >> 16);
+    }
+
+    addAt(offset, 0xFFFF - oldSum);
+    addAt(offset, getSum16At(newData, size));
+
+    return *this;
+}
+
+InternetChecksum &InternetChecksum::replaceUint16(
+    std::size_t offset, std::uint16_t oldValue,
+    std::uint16_t newValue) noexcept {
+    unsigned char oldData[sizeof(oldValue)];
+    unsigned char newData[sizeof(newValue)];
+    setUint16At(oldData, oldValue);
+    setUint16At(newData, newValue);
+    return replace(offset, oldData, newData, sizeof(oldData));
+}
+
+InternetChecksum &InternetChecksum::replaceUint32(
+    std::size_t offset, std::uint32_t oldValue,
+    std::uint32_t newValue) noexcept {
+    unsigned char oldData[sizeof(oldValue)];
+    unsigned char newData[sizeof(newValue)];
+    setUint32At(oldData, oldValue);
+    setUint32At(newData, newValue);
+    return replace(offset, oldData, newData, sizeof(oldData));
+}
+
+InternetChecksum &InternetChecksum::replaceUint64(
+    std::size_t offset, std::uint64_t oldValue,
+    std::uint64_t newValue) noexcept {
+    unsigned char oldData[sizeof(oldValue)];
+    unsigned char newData[sizeof(newValue)];
+    setUint64At(oldData, oldValue);
+    setUint64At(newData, newValue);
+    return replace(offset, oldData, newData, sizeof(oldData));
+}
+
 std::ostream &operator<<(std::ostream &ostr, const BufferView &obj) {
 
     auto guard = Iosguard(ostr);
@@ -71,5 +183,60 @@ std::ostream &operator<<(std::ostream &ostr, const BufferView &obj) {
     return ostr;
 }
 
+/**********************************************************************/
+
+const std::size_t PacketBufferArena::minSize;
+const std::size_t PacketBufferArena::maxSize;
+const std::size_t PacketBufferArena::sizeClassCount;
+
+std::size_t PacketBufferArena::sizeClass(std::size_t size) {
+    if (size > maxSize) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": requested size " << size
+            << " exceeds the maximum size " << maxSize;
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    std::size_t result = 0;
+
+    while (sizeClassSize(result) < size) {
+        ++result;
+    }
+
+    return result;
+}
+
+BufferWritableView PacketBufferArena::getBufferWritableView(std::size_t size) {
+    switch (sizeClass(size)) {
+    case 0:
+        return mPool256.getBufferWritableView();
+    case 1:
+        return mPool512.getBufferWritableView();
+    case 2:
+        return mPool1K.getBufferWritableView();
+    case 3:
+        return mPool2K.getBufferWritableView();
+    case 4:
+        return mPool4K.getBufferWritableView();
+    case 5:
+        return mPool8K.getBufferWritableView();
+    case 6:
+        return mPool16K.getBufferWritableView();
+    case 7:
+        return mPool32K.getBufferWritableView();
+    default:
+        return mPool64K.getBufferWritableView();
+    }
+}
+
+BufferWritableView
+PacketBufferArena::getBufferForMessage(const BufferView &preamble,
+                                       std::size_t lengthOffset) {
+    const std::size_t length = preamble.getUint32At(lengthOffset);
+    auto result = getBufferWritableView(length);
+    result.shrinkTo(length);
+    return result;
+}
+
 } // namespace NetworkLib
 } // namespace Empower
@@ -0,0 +1,440 @@
+#include <empoweragentproto/capture.hh>
+
+// For open(2)
+#include <fcntl.h>
+
+// For mmap(2)
+#include <sys/mman.h>
+
+// For fstat(2)
+#include <sys/stat.h>
+
+// For write(2), pread(2), ftruncate(2) and close(2)
+#include <unistd.h>
+
+#include <stdexcept>
+#include <thread>
+
+// For std::strerror() and std::memcpy()
+#include <cstring>
+
+namespace Empower {
+namespace Agent {
+
+namespace {
+
+// The header of the file
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+};
+
+const char fileMagic[8] = {'E', 'M', 'P', 'C', 'A', 'P', '0', '1'};
+const std::uint32_t fileVersion = 1;
+
+// The header of each record (followed by the message, padded to 8
+// bytes).
+struct RecordHeader {
+    std::uint64_t timestamp;
+    std::uint32_t connection;
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+// In RecordHeader::flags
+const std::uint32_t sentFlag = 0x1;
+
+static_assert(sizeof(FileHeader) == 16, "Unexpected FileHeader size");
+static_assert(sizeof(RecordHeader) == 24, "Unexpected RecordHeader size");
+
+std::size_t paddedSize(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+// Return the size of the (whole, and well-formed) record at the given
+// offset, or 0 if cut short or corrupted.
+std::size_t recordSizeAt(const unsigned char *data, std::size_t size,
+                         std::size_t offset, RecordHeader &header) {
+    if (size - offset < sizeof(header)) {
+        return 0;
+    }
+
+    std::memcpy(&header, data + offset, sizeof(header));
+
+    if (size - offset - sizeof(header) < paddedSize(header.size) ||
+        (header.flags & ~sentFlag) != 0) {
+        return 0;
+    }
+
+    return sizeof(header) + paddedSize(header.size);
+}
+
+[[noreturn]] void throwSystemError(const char *method, const char *what,
+                                   const std::string &path, int savedErrno) {
+    std::ostringstream err;
+    err << method << ": " << what << " " << path << " (errno =" << savedErrno
+        << ": " << std::strerror(savedErrno) << ')';
+    NETWORKLIB_THROW(std::runtime_error, err.str());
+}
+
+// Write out all the given data.
+NetworkLib::Status writeFully(int fd, const unsigned char *data,
+                              std::size_t size) noexcept {
+    while (size > 0) {
+        ssize_t rc = write(fd, data, size);
+
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                      errno);
+        }
+
+        data += rc;
+        size -= static_cast<std::size_t>(rc);
+    }
+
+    return NetworkLib::Status();
+}
+
+} // namespace
+
+// CaptureWriter
+
+CaptureWriter::CaptureWriter(const std::string &path, std::size_t bufferSize)
+    : mPath(path), mBuffer(bufferSize) {
+    mFD = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (mFD == -1) {
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot open", path,
+                         errno);
+    }
+
+    struct stat st;
+
+    if (fstat(mFD, &st) == -1) {
+        int savedErrno = errno;
+        close(mFD);
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot stat", path,
+                         savedErrno);
+    }
+
+    FileHeader header;
+
+    if (st.st_size == 0) {
+        // A new file
+        std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.reserved = 0;
+
+        NetworkLib::Status status =
+            writeFully(mFD, reinterpret_cast<const unsigned char *>(&header),
+                       sizeof(header));
+
+        if (!status) {
+            close(mFD);
+            throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot write to",
+                             path, status.sysErrno());
+        }
+
+        return;
+    }
+
+    // Appending to an existing capture
+    if (pread(mFD, &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 ||
+        header.version != fileVersion) {
+        close(mFD);
+
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": " << path
+            << " is not a capture file";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    // Drop a record cut short (e.g. by a crash), or else readers would
+    // stop there, before the records appended now.
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, mFD, 0);
+
+    if (data == MAP_FAILED) {
+        int savedErrno = errno;
+        close(mFD);
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot map", path,
+                         savedErrno);
+    }
+
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    std::size_t end = sizeof(header);
+    RecordHeader record;
+
+    for (std::size_t n;
+         (n = recordSizeAt(static_cast<const unsigned char *>(data), size,
+                           end, record)) != 0;) {
+        end += n;
+    }
+
+    munmap(data, size);
+
+    if (end != size && ftruncate(mFD, static_cast<off_t>(end)) == -1) {
+        int savedErrno = errno;
+        close(mFD);
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot truncate",
+                         path, savedErrno);
+    }
+}
+
+CaptureWriter::~CaptureWriter() {
+    // Errors are ignored here.
+    flush_nothrow();
+    close(mFD);
+}
+
+void CaptureWriter::record(std::uint32_t connection,
+                           CaptureDirection direction,
+                           const NetworkLib::BufferView &message) {
+    record_nothrow(connection, direction, message)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status
+CaptureWriter::record_nothrow(std::uint32_t connection,
+                              CaptureDirection direction,
+                              const NetworkLib::BufferView &message) {
+    return append(connection, direction, &message, 1);
+}
+
+NetworkLib::Status
+CaptureWriter::record_nothrow(std::uint32_t connection,
+                              CaptureDirection direction,
+                              const NetworkLib::BufferViewSegments &segments) {
+    return append(connection, direction, segments.data(), segments.size());
+}
+
+NetworkLib::Status CaptureWriter::append(std::uint32_t connection,
+                                         CaptureDirection direction,
+                                         const NetworkLib::BufferView *segments,
+                                         std::size_t count) {
+    if (!mStatus) {
+        return mStatus;
+    }
+
+    std::size_t size = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        size += segments[i].size();
+    }
+
+    if (size > 0xffffffffu) {
+        return NetworkLib::ErrorCode::BAD_MESSAGE_LENGTH;
+    }
+
+    RecordHeader header;
+    header.timestamp = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    header.connection = connection;
+    header.size = static_cast<std::uint32_t>(size);
+    header.flags = direction == CaptureDirection::SENT ? sentFlag : 0;
+    header.reserved = 0;
+
+    const std::size_t total = sizeof(header) + paddedSize(size);
+
+    if (mBuffered + total > mBuffer.size()) {
+        mStatus = flush_nothrow();
+
+        if (!mStatus) {
+            return mStatus;
+        }
+    }
+
+    ++mRecords;
+
+    if (total <= mBuffer.size()) {
+        // The usual case: just buffer it.
+        unsigned char *out = mBuffer.data() + mBuffered;
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!segments[i].empty()) {
+                std::memcpy(out, segments[i].getUnderlyingBufferPtr(),
+                            segments[i].size());
+                out += segments[i].size();
+            }
+        }
+
+        std::memset(out, 0, paddedSize(size) - size);
+        mBuffered += total;
+        return NetworkLib::Status();
+    }
+
+    // Too large to be buffered: write it out right away (the buffer
+    // has just been flushed).
+    const unsigned char padding[8] = {0};
+
+    mStatus = writeFully(mFD, reinterpret_cast<const unsigned char *>(&header),
+                         sizeof(header));
+
+    for (std::size_t i = 0; mStatus && i < count; ++i) {
+        mStatus = writeFully(mFD, segments[i].getUnderlyingBufferPtr(),
+                             segments[i].size());
+    }
+
+    if (mStatus) {
+        mStatus = writeFully(mFD, padding, paddedSize(size) - size);
+    }
+
+    return mStatus;
+}
+
+void CaptureWriter::flush() {
+    flush_nothrow().raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status CaptureWriter::flush_nothrow() {
+    if (!mStatus || mBuffered == 0) {
+        return mStatus;
+    }
+
+    mStatus = writeFully(mFD, mBuffer.data(), mBuffered);
+    mBuffered = 0;
+    return mStatus;
+}
+
+// CaptureReader
+
+CaptureReader::CaptureReader(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot open", path,
+                         errno);
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1) {
+        int savedErrno = errno;
+        close(fd);
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot stat", path,
+                         savedErrno);
+    }
+
+    FileHeader header;
+
+    if (st.st_size < static_cast<off_t>(sizeof(header))) {
+        close(fd);
+
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": " << path
+            << " is not a capture file";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mSize = static_cast<std::size_t>(st.st_size);
+
+    void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    int savedErrno = errno;
+
+    // The mapping stays valid without the file descriptor.
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION, "cannot map", path,
+                         savedErrno);
+    }
+
+    mData = static_cast<const unsigned char *>(data);
+
+    // Read sequentially (unless random access, see rewind())
+    madvise(data, mSize, MADV_SEQUENTIAL);
+
+    std::memcpy(&header, mData, sizeof(header));
+
+    if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 ||
+        header.version != fileVersion) {
+        munmap(data, mSize);
+
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": " << path
+            << " is not a capture file (or has an unsupported version)";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mFirstOffset = sizeof(header);
+    mOffset = mFirstOffset;
+}
+
+CaptureReader::~CaptureReader() {
+    munmap(const_cast<unsigned char *>(mData), mSize);
+}
+
+bool CaptureReader::next(Record &record) {
+    RecordHeader header;
+    const std::size_t size = recordSizeAt(mData, mSize, mOffset, header);
+
+    if (size == 0) {
+        mTruncated = mOffset != mSize;
+        return false;
+    }
+
+    record.timestamp = std::chrono::nanoseconds(header.timestamp);
+    record.connection = header.connection;
+    record.direction = (header.flags & sentFlag) != 0
+                           ? CaptureDirection::SENT
+                           : CaptureDirection::RECEIVED;
+    record.message = NetworkLib::BufferView::makeNonOwningBufferView(
+        mData + mOffset + sizeof(header), header.size);
+
+    mOffset += size;
+    return true;
+}
+
+std::uint64_t CaptureReader::replay(const RecordCallback &callback,
+                                    Pacing pacing, double speed) {
+    if (!(speed > 0.0)) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": invalid speed " << speed;
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    std::uint64_t count = 0;
+    std::chrono::nanoseconds first{0};
+    auto start = std::chrono::steady_clock::now();
+    Record record;
+
+    while (next(record)) {
+        if (pacing == Pacing::ORIGINAL) {
+            if (count == 0) {
+                first = record.timestamp;
+                start = std::chrono::steady_clock::now();
+            }
+
+            // (Records captured out of order go out right away.)
+            auto delay = std::chrono::duration_cast<
+                std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::nano>(
+                    (record.timestamp - first).count() / speed));
+
+            if (delay.count() > 0) {
+                std::this_thread::sleep_until(start + delay);
+            }
+        }
+
+        callback(record);
+        ++count;
+    }
+
+    return count;
+}
+
+} // namespace Agent
+} // namespace Empower
@@ -0,0 +1,214 @@
+#include <empoweragentproto/clientsession.hh>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Empower {
+namespace Agent {
+
+ClientSession::~ClientSession() {
+    for (const auto &entry : mRequests) {
+        mIO.timers().cancel(entry.second.timer);
+    }
+}
+
+std::uint32_t ClientSession::nextTransactionId() {
+    // Wraps around after 2^32 requests, skipping the ones still in
+    // flight.
+    do {
+        ++mNextTransactionId;
+    } while (mNextTransactionId == 0 ||
+             mRequests.count(mNextTransactionId) != 0);
+
+    return mNextTransactionId;
+}
+
+std::uint32_t ClientSession::request(MessageEncoder &encoder,
+                                     ResponseCallback callback) {
+    return request(encoder, std::move(callback), mTimeout);
+}
+
+std::uint32_t ClientSession::request(MessageEncoder &encoder,
+                                     ResponseCallback callback,
+                                     std::chrono::milliseconds timeout) {
+    const IO::ConnectionHandle connection =
+        mConnection == IO::noConnection ? mIO.defaultConnection()
+                                        : mConnection;
+
+    if (mIO.isConnectionClosed(connection)) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": no connection";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    const std::uint32_t transactionId = nextTransactionId();
+    encoder.header().sequence(mNextSequence++).transactionId(transactionId);
+
+    mIO.sendMessage(connection, encoder.data());
+    ++mStats.requests;
+
+    Outstanding &outstanding = mRequests[transactionId];
+    outstanding.connection = connection;
+    outstanding.callback = std::move(callback);
+
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+#endif
+        outstanding.timer = mIO.timers().schedule(
+            timeout, transactionId,
+            [this](TimerWheel::TimerId, std::uint64_t key) {
+                auto id = static_cast<std::uint32_t>(key);
+                auto it = mRequests.find(id);
+
+                if (it == mRequests.end()) {
+                    return;
+                }
+
+                // The timer is gone already.
+                it->second.timer = TimerWheel::noTimer;
+                ++mStats.timeouts;
+                complete(id, NetworkLib::ErrorCode::TIMED_OUT, Response());
+            });
+#if NETWORKLIB_HAS_EXCEPTIONS
+    } catch (...) {
+        mRequests.erase(transactionId);
+        throw;
+    }
+#endif
+
+    return transactionId;
+}
+
+std::future<NetworkLib::Result<ClientSession::Response>>
+ClientSession::request(MessageEncoder &encoder) {
+    auto promise =
+        std::make_shared<std::promise<NetworkLib::Result<Response>>>();
+    auto future = promise->get_future();
+
+    request(encoder, [promise](const NetworkLib::Status &status,
+                               const Response &response) {
+        if (status) {
+            promise->set_value(NetworkLib::Result<Response>(response));
+        } else {
+            promise->set_value(NetworkLib::Result<Response>(status));
+        }
+    });
+
+    return future;
+}
+
+bool ClientSession::complete(std::uint32_t transactionId,
+                             const NetworkLib::Status &status,
+                             const Response &response) {
+    auto it = mRequests.find(transactionId);
+
+    if (it == mRequests.end()) {
+        return false;
+    }
+
+    // Removed first: the callback may make other requests.
+    ResponseCallback callback = std::move(it->second.callback);
+    mIO.timers().cancel(it->second.timer);
+    mRequests.erase(it);
+
+    if (callback) {
+        callback(status, response);
+    }
+
+    return true;
+}
+
+bool ClientSession::handleMessage(IO::ConnectionHandle connection,
+                                  const NetworkLib::BufferView &message) {
+    if (mRequests.empty() || !CommonHeaderDecoder::check(message)) {
+        return false;
+    }
+
+    CommonHeaderDecoder decoder(message);
+    const MessageClass messageClass = decoder.messageClass();
+
+    if (messageClass != MessageClass::RESPONSE_SUCCESS &&
+        messageClass != MessageClass::RESPONSE_FAILURE) {
+        return false;
+    }
+
+    auto it = mRequests.find(decoder.transactionId());
+
+    if (it == mRequests.end() || it->second.connection != connection) {
+        ++mStats.unmatched;
+        return false;
+    }
+
+    Response response;
+    response.header = decoder.fields();
+    response.data = message;
+
+    ++mStats.responses;
+    complete(it->first, NetworkLib::Status(), response);
+    return true;
+}
+
+IO::MessageCallback ClientSession::callback(IO::MessageCallback next) {
+    return [this, next](IO::ConnectionHandle connection,
+                        NetworkLib::BufferView message) {
+        if (!handleMessage(connection, message) && next) {
+            next(connection, message);
+        }
+    };
+}
+
+void ClientSession::connectionClosed(IO::ConnectionHandle connection) {
+    std::vector<std::uint32_t> failed;
+
+    for (const auto &entry : mRequests) {
+        if (entry.second.connection == connection) {
+            failed.push_back(entry.first);
+        }
+    }
+
+    // Oldest first (unless the IDs wrapped around)
+    std::sort(failed.begin(), failed.end());
+
+    // (A callback may cancel the next ones.)
+    for (auto id : failed) {
+        if (complete(id, NetworkLib::ErrorCode::NO_CONNECTION, Response())) {
+            ++mStats.failures;
+        }
+    }
+}
+
+void ClientSession::cancelAll(NetworkLib::Status status) {
+    std::vector<std::uint32_t> failed;
+    failed.reserve(mRequests.size());
+
+    for (const auto &entry : mRequests) {
+        failed.push_back(entry.first);
+    }
+
+    std::sort(failed.begin(), failed.end());
+
+    for (auto id : failed) {
+        if (complete(id, status, Response())) {
+            ++mStats.failures;
+        }
+    }
+}
+
+bool ClientSession::cancel(std::uint32_t transactionId) noexcept {
+    auto it = mRequests.find(transactionId);
+
+    if (it == mRequests.end()) {
+        return false;
+    }
+
+    mIO.timers().cancel(it->second.timer);
+    mRequests.erase(it);
+    return true;
+}
+
+} // namespace Agent
+} // namespace Empower
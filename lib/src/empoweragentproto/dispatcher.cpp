@@ -0,0 +1,239 @@
+#include <empoweragentproto/dispatcher.hh>
+
+#if defined(__linux__)
+// For pthread_setname_np()
+#include <pthread.h>
+#endif
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Empower {
+namespace Agent {
+
+Dispatcher::~Dispatcher() { stop(); }
+
+Dispatcher &Dispatcher::on(EntityClass entityClass, MessageClass messageClass,
+                           Handler handler) {
+    const std::size_t column = columnOf(messageClass);
+
+    if (column >= columns) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": invalid message class "
+            << static_cast<unsigned>(messageClass);
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    mHandlers.push_back(std::move(handler));
+    row(entityClass).handlers[column] =
+        static_cast<std::uint16_t>(mHandlers.size());
+    dropUnusedHandlers();
+    return *this;
+}
+
+Dispatcher &Dispatcher::on(EntityClass entityClass, Handler handler) {
+    mHandlers.push_back(std::move(handler));
+
+    for (auto &index : row(entityClass).handlers) {
+        index = static_cast<std::uint16_t>(mHandlers.size());
+    }
+
+    dropUnusedHandlers();
+    return *this;
+}
+
+void Dispatcher::dropUnusedHandlers() {
+    // The new index (plus one) of each handler, or 0 if replaced
+    std::vector<std::uint16_t> indexes(mHandlers.size() + 1, 0);
+
+    for (const auto &r : mRows) {
+        for (auto index : r.handlers) {
+            indexes[index] = 1;
+        }
+    }
+
+    // (No handler stays no handler.)
+    indexes[0] = 0;
+
+    std::size_t kept = 0;
+
+    for (std::size_t i = 1; i < indexes.size(); ++i) {
+        if (indexes[i] != 0) {
+            mHandlers[kept] = std::move(mHandlers[i - 1]);
+            indexes[i] = static_cast<std::uint16_t>(++kept);
+        }
+    }
+
+    mHandlers.resize(kept);
+
+    for (auto &r : mRows) {
+        for (auto &index : r.handlers) {
+            index = indexes[index];
+        }
+    }
+}
+
+Dispatcher &Dispatcher::concurrent(EntityClass entityClass, bool v) {
+    row(entityClass).concurrent = v;
+    return *this;
+}
+
+void Dispatcher::start() {
+    if (running()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": already running";
+        NETWORKLIB_THROW(std::logic_error, err.str());
+    }
+
+    mStopRequested = false;
+
+    for (std::size_t i = 0; i < mWorkerCount; ++i) {
+        mThreads.emplace_back(&Dispatcher::work, this, i);
+#if defined(__linux__)
+        pthread_setname_np(mThreads.back().native_handle(), "agent-worker");
+#endif
+    }
+}
+
+void Dispatcher::stop() noexcept {
+    if (!running()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopRequested = true;
+    }
+
+    mCondition.notify_all();
+
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+
+    mThreads.clear();
+}
+
+bool Dispatcher::dispatch(IO::ConnectionHandle connection,
+                          const NetworkLib::BufferView &message) {
+    Message m;
+    m.connection = connection;
+
+    // The message comes from the peer: no exceptions (in the event
+    // loop) on malformed headers, they're just not handled.
+    if (!CommonHeaderDecoder::check(message)) {
+        mUnhandledCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    {
+        CommonHeaderDecoder decoder(message);
+        m.header = decoder.fields();
+    }
+
+    if (m.header.totalLength > message.size() ||
+        m.header.totalLength <
+            ReferenceProtocolStructs::CommonHeader::totalLength) {
+        mUnhandledCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const auto entity = static_cast<std::size_t>(m.header.entityClass);
+    std::uint16_t index = 0;
+    bool concurrent = false;
+
+    if (entity < mRows.size()) {
+        const Row &r = mRows[entity];
+        index = r.handlers[columnOf(m.header.messageClass)];
+        concurrent = r.concurrent;
+    }
+
+    if (index == 0) {
+        mUnhandledCount.fetch_add(1, std::memory_order_relaxed);
+
+        if (mUnhandled) {
+            m.data = message;
+            mUnhandled(m);
+        }
+
+        return false;
+    }
+
+    mDispatched.fetch_add(1, std::memory_order_relaxed);
+    const Handler &handler = mHandlers[index - 1];
+
+    if (concurrent && running()) {
+        // The message may be in the IO buffers, which get reused.
+        const NetworkLib::BufferView content =
+            message.getSub_nocheck(0, m.header.totalLength);
+        NetworkLib::BufferWritableView copy =
+            IO::makeMessageBufferFor(content);
+        content.copyTo(copy);
+        m.data = copy;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.emplace_back(&handler, std::move(m));
+        }
+
+        mCondition.notify_one();
+    } else {
+        m.data = message;
+        handler(m);
+    }
+
+    return true;
+}
+
+Dispatcher::Stats Dispatcher::stats() const {
+    Stats result;
+    result.dispatched = mDispatched.load(std::memory_order_relaxed);
+    result.unhandled = mUnhandledCount.load(std::memory_order_relaxed);
+    result.workerErrors = mWorkerErrors.load(std::memory_order_relaxed);
+    return result;
+}
+
+Dispatcher::Row &Dispatcher::row(EntityClass entityClass) {
+    const auto entity = static_cast<std::size_t>(entityClass);
+
+    if (entity >= mRows.size()) {
+        mRows.resize(entity + 1);
+    }
+
+    return mRows[entity];
+}
+
+void Dispatcher::work(std::size_t worker) noexcept {
+    for (;;) {
+        std::pair<const Handler *, Message> item;
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(
+                lock, [this] { return mStopRequested || !mQueue.empty(); });
+
+            // Stop only once the queue is empty
+            if (mQueue.empty()) {
+                return;
+            }
+
+            item = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        item.second.worker = worker;
+
+#if NETWORKLIB_HAS_EXCEPTIONS
+        try {
+            (*item.first)(item.second);
+        } catch (...) {
+            mWorkerErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+#else
+        (*item.first)(item.second);
+#endif
+    }
+}
+
+} // namespace Agent
+} // namespace Empower
@@ -4,100 +4,521 @@
 // For read(2) and write(2)
 #include <unistd.h>
 
+// For fcntl(2)
+#include <fcntl.h>
+
+// For writev(2)
+#include <sys/uio.h>
+
+// For IOV_MAX
+#include <climits>
+
 // For socket(2), bind(2), listen(2)
 #include <sys/socket.h>
 #include <sys/types.h>
 
-// To pause for some time while we wait for all the data
-#include <chrono>
-#include <thread>
-
 // For std::strerror() and std::memset()
 #include <cstring>
 
 // For htons()
 #include <arpa/inet.h>
 
+// For TCP_NODELAY and the other TCP options
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// For sockaddr_un
+#include <sys/un.h>
+
+// For stat(2)
+#include <sys/stat.h>
+
+// For offsetof()
+#include <cstddef>
+
 // For std::max()
 #include <algorithm>
 
+// For std::logic_error
+#include <stdexcept>
+
 namespace Empower {
 namespace Agent {
 
-IO::~IO() { closeConnection(); }
+// The kind of request, in the user data of the io_uring requests
+// (whose low 32 bits are the connection handle, if any).
+static const std::uint64_t receiveRequest = std::uint64_t(1) << 32;
+static const std::uint64_t sendRequest = std::uint64_t(2) << 32;
+static const std::uint64_t reactorRequest = std::uint64_t(3) << 32;
+static const std::uint64_t requestKindMask = ~std::uint64_t(0) << 32;
+
+struct IO::InFlightSend {
+    // Up to this many buffers are sent by a single request.
+    static const std::size_t maxSegments = 64;
+
+    msghdr header;
+    iovec iov[maxSegments];
+
+    // Keep the buffers alive
+    std::vector<NetworkLib::BufferView> data;
+};
+
+IO::IO()
+    : mBackoffRandom(static_cast<std::minstd_rand::result_type>(
+          std::chrono::steady_clock::now().time_since_epoch().count())) {}
+
+IO::~IO() {
+    // Don't invoke callbacks while being destroyed
+    mConnectionClosedCallback = nullptr;
+    closeConnection();
+    stopUring();
+}
+
+IO &IO::transport(Transport t) {
+    if (!mConnections.empty() || mListeningSocketFD != -1 || isConnecting()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION
+            << ": can't change the transport of open connections";
+        NETWORKLIB_THROW(std::logic_error, err.str());
+    }
+
+    if (t == Transport::READINESS) {
+        stopUring();
+    } else if (!mUring && Uring::available() && mReactor.fd() != -1) {
+        // Otherwise keep using the readiness transport.
+        std::unique_ptr<Uring> uring(new Uring());
+
+        if (uring->ok()) {
+            mUring = std::move(uring);
+        }
+    }
+
+    return *this;
+}
+
+void IO::stopUring() noexcept {
+    if (!mUring) {
+        return;
+    }
+
+    // The connections have been shut down, so the send requests in
+    // flight complete soon (but don't wait forever).
+    for (int i = 0; i < 100 && !mInFlightSends.empty(); ++i) {
+        mCompletions.clear();
+
+        if (!mUring->submitAndWait(10, mCompletions)) {
+            break;
+        }
+
+        for (const auto &c : mCompletions) {
+            if ((c.userData & requestKindMask) == sendRequest) {
+                mInFlightSends.erase(static_cast<ConnectionHandle>(c.userData));
+            }
+        }
+    }
+
+    mUring.reset();
+    mInFlightSends.clear();
+    mCompletions.clear();
+    mCompletionsHandled = 0;
+    mReactorPolled = false;
+    mReactorReady = false;
+}
 
 void IO::closeConnection() noexcept {
+    cancelConnect();
 
-    if (mConnectionFD != -1) {
-        close(mConnectionFD);
-        mConnectionFD = -1;
+    while (!mConnections.empty()) {
+        closeConnection(mConnections.begin()->first);
     }
 
+    // Closed on purpose: don't reconnect.
+    mReconnectNeeded = false;
+
     if (mListeningSocketFD != -1) {
+        mReactor.remove(mListeningSocketFD);
         close(mListeningSocketFD);
         mListeningSocketFD = -1;
     }
+
+    if (!mListeningPath.empty()) {
+        unlink(mListeningPath.c_str());
+        mListeningPath.clear();
+    }
 }
 
-void IO::openListeningSocket() {
+void IO::closeConnection(ConnectionHandle connection) noexcept {
+    auto it = mConnections.find(connection);
 
-    closeConnection();
+    if (it == mConnections.end()) {
+        return;
+    }
+
+    // Any partially read message and any pending output go away
+    // together with the connection.
+    const int fd = it->second->fd;
+
+    if (mUring) {
+        // Submit what's been prepared for the fd before it can be
+        // reused, and make the requests in flight complete.
+        mUring->submit();
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    mReactor.remove(fd);
+    close(fd);
+    mHandlesByFD.erase(fd);
+    mConnections.erase(it);
+
+    if (connection == mOutgoingConnection) {
+        mOutgoingConnection = noConnection;
+        mReconnectNeeded = mAutoReconnect;
+    }
+
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+        updateListeningInterest();
+    } catch (...) {
+        // Changing the interest of an fd that is already registered
+        // doesn't fail in practice. If it does, the worst that can
+        // happen is that no further connections are accepted.
+    }
+#else
+    updateListeningInterest();
+#endif
+
+    if (mConnectionClosedCallback) {
+        mConnectionClosedCallback(connection);
+    }
+}
+
+std::vector<IO::ConnectionHandle> IO::connections() const {
+    std::vector<ConnectionHandle> result;
+    result.reserve(mConnections.size());
+
+    for (const auto &c : mConnections) {
+        result.push_back(c.first);
+    }
+
+    return result;
+}
+
+IO::Connection *IO::findConnection(ConnectionHandle connection) const {
+    auto it = mConnections.find(connection);
+    return it == mConnections.end() ? nullptr : it->second.get();
+}
+
+IO::Connection &IO::getConnection(ConnectionHandle connection,
+                                  const char *method) const {
+    Connection *c = findConnection(connection);
+
+    if (c == nullptr) {
+        std::ostringstream err;
+        err << method << ": no connection";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
 
-    // Create a TCP socket
-    int socketFD = socket(AF_INET, SOCK_STREAM, 0);
+    return *c;
+}
+
+/// @brief Set the O_NONBLOCK flag on the given file descriptor.
+static void setNonBlockingFD(int fd, const char *method) {
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        int savedErrno = errno;
+        std::ostringstream err;
+        err << method << ": call to fcntl(2) failed "
+            << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
+            << ')';
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+}
 
-    if (socketFD == -1) {
+// Set an integer socket option, throwing on errors.
+static void setSocketOption(int fd, int level, int name, int value,
+                            const char *optionName, const char *method) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) == -1) {
         int savedErrno = errno;
         std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": call to socket(2) failed "
+        err << method << ": can't set " << optionName << " to " << value
             << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
             << ')';
-        throw std::runtime_error(err.str());
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+}
+
+// Tell if the socket is a TCP one (rather than a Unix-domain one).
+static bool isTCPSocket(int fd) {
+    sockaddr_storage address;
+    socklen_t length = sizeof(address);
+
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) ==
+        -1) {
+        return false;
+    }
+
+    return address.ss_family == AF_INET || address.ss_family == AF_INET6;
+}
+
+IO::ConnectionHandle IO::setupConnection(int fd) {
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+#endif
+        if (mNonBlocking) {
+            setNonBlockingFD(fd, NETWORKLIB_CURRENT_FUNCTION);
+        }
+
+        if (!mUring) {
+            mReactor.add(fd, Reactor::READABLE);
+        }
+#if NETWORKLIB_HAS_EXCEPTIONS
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+#endif
+
+    // Handles are never reused (and never equal to noConnection).
+    if (++mLastHandle == noConnection) {
+        ++mLastHandle;
+    }
+
+    const ConnectionHandle handle = mLastHandle;
+
+    std::unique_ptr<Connection> connection(new Connection());
+    connection->fd = fd;
+    connection->tcp = isTCPSocket(fd);
+    mConnections[handle] = std::move(connection);
+    mHandlesByFD[fd] = handle;
+
+    if (mUring) {
+        armReceive(handle, fd);
+    }
+
+    updateListeningInterest();
+
+    if (mConnectionOpenedCallback) {
+        mConnectionOpenedCallback(handle);
+    }
+
+    return handle;
+}
+
+void IO::updateConnectionInterest(Connection &connection) {
+    unsigned events = Reactor::READABLE;
+
+    if (!connection.pendingOutput.empty()) {
+        events |= Reactor::WRITABLE;
+    }
+
+    mReactor.modify(connection.fd, events);
+}
+
+void IO::updateListeningInterest() {
+    if (mListeningSocketFD == -1) {
+        return;
+    }
+
+    // Unless in server mode, pay attention to connection attempts only
+    // when there's no connection.
+    unsigned events = 0;
+
+    if (mServerMode || mConnections.empty()) {
+        events |= Reactor::READABLE;
+    }
+
+    mReactor.modify(mListeningSocketFD, events);
+}
+
+void IO::waitForFD(int fd, unsigned events) const {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = ((events & Reactor::READABLE) ? POLLIN : 0) |
+                 ((events & Reactor::WRITABLE) ? POLLOUT : 0);
+    pfd.revents = 0;
+
+    // With no timeout: the callers wait until the whole message is
+    // through anyway. Errors and signals are just returned from: the
+    // following read(2)/write(2) will tell what happened.
+    poll(&pfd, 1, -1);
+}
+
+// The address of a socket (see IO::unixPath()).
+union SocketAddress {
+    sockaddr generic;
+    sockaddr_in inet;
+    sockaddr_un local;
+};
+
+// Fill in the address to listen on or to connect to (localhost if
+// unspecified when connecting), and return its length.
+static socklen_t makeSocketAddress(const std::string &path,
+                                   NetworkLib::IPv4Address address,
+                                   std::uint16_t port, bool listening,
+                                   SocketAddress &result,
+                                   const char *method) {
+    std::memset(&result, 0, sizeof(result));
+
+    if (!path.empty()) {
+        if (path.size() >= sizeof(result.local.sun_path)) {
+            std::ostringstream err;
+            err << method << ": path too long for a Unix-domain socket ("
+                << path << ')';
+            NETWORKLIB_THROW(std::invalid_argument, err.str());
+        }
+
+        result.local.sun_family = AF_UNIX;
+        std::memcpy(result.local.sun_path, path.c_str(), path.size());
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) +
+                                      path.size() + 1);
+    }
+
+    result.inet.sin_family = AF_INET;
+
+    if (address == NetworkLib::IPv4Address(0, 0, 0, 0)) {
+        if (listening) {
+            result.inet.sin_addr.s_addr = htonl(INADDR_ANY);
+        } else {
+            NetworkLib::IPv4Address localhost(127, 0, 0, 1);
+            result.inet.sin_addr.s_addr =
+                htonl(static_cast<std::uint32_t>(localhost));
+        }
+    } else {
+        result.inet.sin_addr.s_addr =
+            htonl(static_cast<std::uint32_t>(address));
     }
+    result.inet.sin_port = htons(port);
+
+    return sizeof(result.inet);
+}
+
+// Create a stream socket, throwing on errors.
+static int makeSocket(int family, const char *method) {
+    int sockfd = socket(family, SOCK_STREAM, 0);
 
-    // Bind the listening address and port
-    sockaddr_in serverAddress;
-    std::memset(&serverAddress, 0, sizeof(sockaddr_in));
+    if (sockfd == -1) {
+        int savedErrno = errno;
+        std::ostringstream err;
+        err << method << ": call to socket(2) failed "
+            << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
+            << ')';
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
 
-    serverAddress.sin_family = AF_INET;
+    return sockfd;
+}
 
-    if (mAddress == NetworkLib::IPv4Address(0, 0, 0, 0)) {
-        serverAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+// Print what the IO connects to (for error messages).
+static void printEndpoint(std::ostream &out, const std::string &path,
+                          NetworkLib::IPv4Address address,
+                          std::uint16_t port) {
+    if (path.empty()) {
+        out << "address " << address << ", port " << port;
     } else {
-        serverAddress.sin_addr.s_addr =
-            htonl(static_cast<std::uint32_t>(mAddress));
+        out << "path " << path;
+    }
+}
+
+void IO::openListeningSocket() {
+
+    closeConnection();
+
+    // Create a TCP (or Unix-domain) socket
+    SocketAddress serverAddress;
+    const socklen_t serverAddressLen =
+        makeSocketAddress(mUnixPath, mAddress, mPort, true, serverAddress,
+                          NETWORKLIB_CURRENT_FUNCTION);
+
+    int socketFD = makeSocket(serverAddress.generic.sa_family,
+                              NETWORKLIB_CURRENT_FUNCTION);
+
+    // Accepted connections inherit the buffer sizes (which must be set
+    // before listen(2) to be taken into account for the TCP window).
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+#endif
+        if (mSocketOptions.sendBufferBytes > 0) {
+            setSocketOption(socketFD, SOL_SOCKET, SO_SNDBUF,
+                            mSocketOptions.sendBufferBytes, "SO_SNDBUF",
+                            NETWORKLIB_CURRENT_FUNCTION);
+        }
+
+        if (mSocketOptions.receiveBufferBytes > 0) {
+            setSocketOption(socketFD, SOL_SOCKET, SO_RCVBUF,
+                            mSocketOptions.receiveBufferBytes, "SO_RCVBUF",
+                            NETWORKLIB_CURRENT_FUNCTION);
+        }
+#if NETWORKLIB_HAS_EXCEPTIONS
+    } catch (...) {
+        close(socketFD);
+        throw;
+    }
+#endif
+
+    // Remove a stale Unix-domain socket (but nothing else).
+    struct stat info;
+
+    if (!mUnixPath.empty() && stat(mUnixPath.c_str(), &info) == 0 &&
+        S_ISSOCK(info.st_mode)) {
+        unlink(mUnixPath.c_str());
     }
-    serverAddress.sin_port = htons(mPort);
 
-    if ((bind(socketFD, reinterpret_cast<sockaddr *>(&serverAddress),
-              sizeof(serverAddress))) == -1) {
+    // Bind the listening address and port (or path)
+    if ((bind(socketFD, &serverAddress.generic, serverAddressLen)) == -1) {
 
         int savedErrno = errno;
+        close(socketFD);
         std::ostringstream err;
         err << NETWORKLIB_CURRENT_FUNCTION << ": call to bind(2) failed "
             << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
             << ')';
-        throw std::runtime_error(err.str());
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    if (!mUnixPath.empty()) {
+        mListeningPath = mUnixPath;
     }
 
     // Listen...
-    if ((listen(socketFD, 1)) == -1) {
+    if ((listen(socketFD, mListenBacklog)) == -1) {
         int savedErrno = errno;
+        close(socketFD);
+        closeConnection();
         std::ostringstream err;
         err << NETWORKLIB_CURRENT_FUNCTION << ": call to listen(2) failed "
             << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
             << ')';
-        throw std::runtime_error(err.str());
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    if (mNonBlocking) {
+#if NETWORKLIB_HAS_EXCEPTIONS
+        try {
+            setNonBlockingFD(socketFD, NETWORKLIB_CURRENT_FUNCTION);
+        } catch (...) {
+            close(socketFD);
+            closeConnection();
+            throw;
+        }
+#else
+        setNonBlockingFD(socketFD, NETWORKLIB_CURRENT_FUNCTION);
+#endif
     }
 
     mListeningSocketFD = socketFD;
+    mReactor.add(socketFD, Reactor::READABLE);
 }
 
 void IO::acceptConnectionIfNeeded() {
-    if (mListeningSocketFD != -1 && mConnectionFD == -1) {
+    acceptConnectionIfNeeded_nothrow().raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status IO::acceptConnectionIfNeeded_nothrow() {
+    if (mListeningSocketFD != -1 && (mServerMode || mConnections.empty())) {
 
         // Wait for a connection and accept it.
-        sockaddr_in clientAddress;
+        sockaddr_storage clientAddress;
         socklen_t clientAddressLen = sizeof(clientAddress);
 
         int fd = accept(mListeningSocketFD,
@@ -105,324 +526,764 @@ void IO::acceptConnectionIfNeeded() {
                         &clientAddressLen);
         if (fd == -1) {
             int savedErrno = errno;
-            std::ostringstream err;
-            err << NETWORKLIB_CURRENT_FUNCTION << ": call to accept(2) failed "
-                << " (errno =" << savedErrno << ": "
-                << std::strerror(savedErrno) << ')';
-            throw std::runtime_error(err.str());
+
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK ||
+                savedErrno == EINTR || savedErrno == ECONNABORTED) {
+                // No connection to accept at the moment (we are
+                // using a non-blocking socket, or the peer gave up).
+                return NetworkLib::Status();
+            }
+
+            // accept(2) failed (e.g. out of file descriptors)
+            return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                      savedErrno);
+        }
+
+        if (mConnections.size() >= mMaxConnections) {
+            // Too many connections already: turn this one down.
+            close(fd);
+            return NetworkLib::Status();
         }
 
-        mConnectionFD = fd;
+        NetworkLib::Metrics::add(NetworkLib::Counter::CONNECTIONS_ACCEPTED);
+
+#if NETWORKLIB_HAS_EXCEPTIONS
+        try {
+            applySocketOptions(fd, NETWORKLIB_CURRENT_FUNCTION);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+#else
+        applySocketOptions(fd, NETWORKLIB_CURRENT_FUNCTION);
+#endif
+
+        setupConnection(fd);
     }
+
+    return NetworkLib::Status();
+}
+
+// Tell if connect(2) failed in a (supposedly) recoverable way.
+static bool isRecoverableConnectError(int e) {
+    // For Unix-domain sockets: no one listening yet, or the backlog
+    // is full.
+    return e == ECONNREFUSED || e == EINTR || e == ETIMEDOUT ||
+           e == ENETUNREACH || e == EHOSTUNREACH || e == ECONNRESET ||
+           e == ENOENT || e == EAGAIN;
 }
 
 bool IO::openSocket() {
 
     closeConnection();
 
-    // Create a TCP socket
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-
-    if (sockfd == -1) {
-        int savedErrno = errno;
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": call to socket(2) failed "
-            << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
-            << ')';
-        throw std::runtime_error(err.str());
-    }
-
-    // Specify the destination address and port
-    sockaddr_in serverAddress;
-    std::memset(&serverAddress, 0, sizeof(sockaddr_in));
+    // Create a TCP (or Unix-domain) socket, for the destination
+    // address and port (or path)
+    SocketAddress serverAddress;
+    const socklen_t serverAddressLen =
+        makeSocketAddress(mUnixPath, mAddress, mPort, false, serverAddress,
+                          NETWORKLIB_CURRENT_FUNCTION);
 
-    serverAddress.sin_family = AF_INET;
+    int sockfd = makeSocket(serverAddress.generic.sa_family,
+                            NETWORKLIB_CURRENT_FUNCTION);
 
-    if (mAddress == NetworkLib::IPv4Address(0, 0, 0, 0)) {
-        NetworkLib::IPv4Address localhost(127, 0, 0, 1);
-        serverAddress.sin_addr.s_addr =
-            htonl(static_cast<std::uint32_t>(localhost));
-    } else {
-        serverAddress.sin_addr.s_addr =
-            htonl(static_cast<std::uint32_t>(mAddress));
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+        applySocketOptions(sockfd, NETWORKLIB_CURRENT_FUNCTION);
+    } catch (...) {
+        close(sockfd);
+        throw;
     }
-    serverAddress.sin_port = htons(mPort);
+#else
+    applySocketOptions(sockfd, NETWORKLIB_CURRENT_FUNCTION);
+#endif
 
     // Attempt to connect
-    if ((connect(sockfd, reinterpret_cast<sockaddr *>(&serverAddress),
-                 sizeof(serverAddress))) == -1) {
+    NetworkLib::Metrics::add(NetworkLib::Counter::CONNECT_ATTEMPTS);
+
+    if ((connect(sockfd, &serverAddress.generic, serverAddressLen)) == -1) {
 
         int savedErrno = errno;
+        NetworkLib::Metrics::add(NetworkLib::Counter::CONNECT_FAILURES);
 
         // connect(2) failed. In any case, close the socket.
         close(sockfd);
         sockfd = 0;
 
-        if (savedErrno == ECONNREFUSED || savedErrno == EINTR ||
-            savedErrno == ETIMEDOUT) {
+        if (isRecoverableConnectError(savedErrno)) {
             // connect(2) failed in a (supposedly) recoverable way.
             return false;
         } else {
             // connect(2) failed for something more serious
             std::ostringstream err;
-            err << NETWORKLIB_CURRENT_FUNCTION
-                << ": call to connect(2) (address " << mAddress << ", port "
-                << mPort << ") failed "
+            err << NETWORKLIB_CURRENT_FUNCTION << ": call to connect(2) (";
+            printEndpoint(err, mUnixPath, mAddress, mPort);
+            err << ") failed "
                 << "(errno =" << savedErrno << ": " << std::strerror(savedErrno)
                 << ')';
-            throw std::runtime_error(err.str());
+            NETWORKLIB_THROW(std::runtime_error, err.str());
         }
     }
 
-    mConnectionFD = sockfd;
+    mOutgoingConnection = setupConnection(sockfd);
     return true;
 }
 
-NetworkLib::BufferWritableView IO::makeMessageBuffer() {
+void IO::openSocketAsync() {
+    closeConnection();
+    startConnect();
+}
 
-    // Standard size (in bytes) for a message buffer.
-    //
-    // The encoded size of a single message cannot exceeed this size
-    // (note that the protocol uses a std::uint16_t in the message
-    // header for the message size, therefore a message can't be
-    // longer than 2^16 bytes (65536) anyway.
-    //
-    // Here we use a value which is slightly less than 2^16 to play
-    // nice with memory allocators.
-    static const std::size_t messageBufferStandardSizeBytes = 65500;
+void IO::startConnect() {
+    mConnectTimer = TimerWheel::noTimer;
 
-    // The buffer is allocated on the heap
-    auto pd = std::make_shared<
-        NetworkLib::PacketBufferArrayBased<messageBufferStandardSizeBytes>>();
+    SocketAddress serverAddress;
+    const socklen_t serverAddressLen =
+        makeSocketAddress(mUnixPath, mAddress, mPort, false, serverAddress,
+                          NETWORKLIB_CURRENT_FUNCTION);
 
-    // Cast the result to a generic NetworkLib::PacketBuffer
-    auto pb = std::static_pointer_cast<NetworkLib::PacketBuffer>(pd);
+    int sockfd = makeSocket(serverAddress.generic.sa_family,
+                            NETWORKLIB_CURRENT_FUNCTION);
 
-    // Return a BufferWritableView associated to the buffer.
-    return NetworkLib::BufferWritableView(pb);
-}
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+#endif
+        applySocketOptions(sockfd, NETWORKLIB_CURRENT_FUNCTION);
+        setNonBlockingFD(sockfd, NETWORKLIB_CURRENT_FUNCTION);
+#if NETWORKLIB_HAS_EXCEPTIONS
+    } catch (...) {
+        close(sockfd);
+        throw;
+    }
+#endif
 
-NetworkLib::BufferView
-IO::readMessage(NetworkLib::BufferWritableView &readBuffer) {
+    NetworkLib::Metrics::add(NetworkLib::Counter::CONNECT_ATTEMPTS);
 
-    using namespace ReferenceProtocolStructs;
+    mConnectingFD = sockfd;
 
-    // Refuse to read if there's no active connection
-    if (mConnectionFD == -1) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": no connection";
-        throw std::runtime_error(err.str());
+    if ((connect(sockfd, &serverAddress.generic, serverAddressLen)) == 0) {
+        // Connected already (e.g. to localhost)
+        finishConnect().raise(NETWORKLIB_CURRENT_FUNCTION);
+        return;
     }
 
-    // How many milliseconds we should sleep when waiting for further
-    // data to read a whole message.
-    static const int millisecondsToSleep = 100;
+    int savedErrno = errno;
 
-    // Check we have room at least to read the preamble of the common
-    // header of messages.
-    if (readBuffer.size() < Preamble::size) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": buffer too small (size is "
-            << readBuffer.size() << ", at least " << Preamble::size
-            << " required)";
+    if (savedErrno == EINPROGRESS) {
+        // Wait for the socket to become writable, but not forever.
+        mReactor.add(sockfd, Reactor::WRITABLE);
+        mConnectTimer = mTimers.schedule(
+            mConnectTimeout, 0,
+            [this](TimerWheel::TimerId, std::uint64_t) { retryConnect(); });
+        return;
+    }
 
-        throw std::runtime_error(err.str());
+    if (isRecoverableConnectError(savedErrno)) {
+        retryConnect();
+        return;
     }
 
-    unsigned char *rawBuffer = readBuffer.getUnderlyingWritableBufferPtr();
+    close(sockfd);
+    mConnectingFD = -1;
+    NetworkLib::Metrics::add(NetworkLib::Counter::CONNECT_FAILURES);
+
+    std::ostringstream err;
+    err << NETWORKLIB_CURRENT_FUNCTION << ": call to connect(2) (";
+    printEndpoint(err, mUnixPath, mAddress, mPort);
+    err << ") failed "
+        << "(errno =" << savedErrno << ": " << std::strerror(savedErrno)
+        << ')';
+    NETWORKLIB_THROW(std::runtime_error, err.str());
+}
 
-    // Attempt to read Protocol::Preamble::size bytes
-    ssize_t bytesRead = 0;
-    ssize_t rc;
+NetworkLib::Status IO::finishConnect() {
+    const int fd = mConnectingFD;
+    int error = 0;
+    socklen_t errorLen = sizeof(error);
 
-    do {
-        rc = read(mConnectionFD, rawBuffer + bytesRead,
-                  Preamble::size - bytesRead);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) == -1) {
+        error = errno;
+    }
 
-        if (rc == -1) {
-            int savedErrno = errno;
+    if (error != 0) {
+        retryConnect();
+        return NetworkLib::Status();
+    }
 
-            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK ||
-                savedErrno == EINTR) {
-                // Nothing to read at the moment (or we were interrupted by a
-                // signal. Sleep for a while and retry
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            } else if (savedErrno == ECONNABORTED || savedErrno == ECONNRESET) {
-                // End-of-file
-                closeConnection();
-                return NetworkLib::BufferView();
+    // The fd is registered again by setupConnection()
+    mTimers.cancel(mConnectTimer);
+    mConnectTimer = TimerWheel::noTimer;
+    mReactor.remove(fd);
+    mConnectingFD = -1;
+    mConnectFailures = 0;
 
-            } else {
-                // Something serious happened
-                std::ostringstream err;
-                err << NETWORKLIB_CURRENT_FUNCTION << ": error reading from fd"
-                    << mConnectionFD << " (errno = " << savedErrno << ": "
-                    << std::strerror(savedErrno) << ')';
+    if (!mNonBlocking) {
+        int flags = fcntl(fd, F_GETFL, 0);
 
-                closeConnection();
-                throw std::runtime_error(err.str());
-            }
-        } else if (rc == 0) {
-            // End-of-file
-            closeConnection();
-            return NetworkLib::BufferView();
+        if (flags == -1 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+            int savedErrno = errno;
+            close(fd);
+            return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                      savedErrno);
         }
+    }
 
-        // Otherwise, the result is the number of bytes read.
-        // Add it to the total number of bytes read.
-        bytesRead += rc;
-
-    } while (bytesRead < Preamble::size);
+    mOutgoingConnection = setupConnection(fd);
+    return NetworkLib::Status();
+}
 
-    // At this point, we read Protocol::Preamble::size bytes. Now try
-    // to read the rest of the common header and the rest of the
-    // message.
+void IO::retryConnect() noexcept {
+    if (mConnectingFD != -1) {
+        NetworkLib::Metrics::add(NetworkLib::Counter::CONNECT_FAILURES);
+        mReactor.remove(mConnectingFD);
+        close(mConnectingFD);
+        mConnectingFD = -1;
+    }
 
-    std::uint8_t version =
-        readBuffer.getUint8At_nocheck(Preamble::versionOffset);
-    ssize_t messageLength = static_cast<ssize_t>(
-        readBuffer.getUint32At_nocheck(Preamble::lengthOffset));
+    mTimers.cancel(mConnectTimer);
+
+    // The n-th retry waits between half and all of
+    // min(max, initial * 2^(n-1)).
+    const unsigned shift = std::min(mConnectFailures, 20u);
+    const auto limit = std::max(
+        std::chrono::milliseconds(2),
+        std::min(mBackoffMax, mBackoffInitial * (1L << shift)));
+    ++mConnectFailures;
+
+    const auto half = limit.count() / 2;
+    const auto delay = std::chrono::milliseconds(
+        half + static_cast<long>(mBackoffRandom() %
+                                 static_cast<unsigned long>(half + 1)));
+
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+#endif
+        mConnectTimer = mTimers.schedule(
+            delay, 0, [this](TimerWheel::TimerId, std::uint64_t) {
+#if NETWORKLIB_HAS_EXCEPTIONS
+                // Called from processEvents(): rather than letting the
+                // error out (and never retrying again), try again after
+                // the next backoff step.
+                try {
+                    startConnect();
+                } catch (...) {
+                    retryConnect();
+                }
+#else
+                startConnect();
+#endif
+            });
+#if NETWORKLIB_HAS_EXCEPTIONS
+    } catch (...) {
+        // Out of memory: give up (isConnecting() tells).
+        mConnectTimer = TimerWheel::noTimer;
+    }
+#endif
+}
 
-    // Check we have enough room to read the whole message.
-    if (readBuffer.size() < static_cast<std::size_t>(messageLength)) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": buffer too small (size is "
-            << readBuffer.size() << ", messageLength is " << messageLength
-            << ")";
-
-        // Here we could just skip `messageLength - bytesRead` bytes,
-        // and ignore the current message. But we prefer to make some
-        // noise, close down the connection and throwing an error
-        // (after all, we either received junk data, or our reading
-        // buffer is undersized).
-        closeConnection();
-        throw std::runtime_error(err.str());
+void IO::cancelConnect() noexcept {
+    if (mConnectingFD != -1) {
+        mReactor.remove(mConnectingFD);
+        close(mConnectingFD);
+        mConnectingFD = -1;
     }
 
-    // Read in the rest of the common header and the payload of the
-    // message.
-    do {
-        rc = read(mConnectionFD, rawBuffer + bytesRead,
-                  messageLength - bytesRead);
+    mTimers.cancel(mConnectTimer);
+    mConnectTimer = TimerWheel::noTimer;
+    mConnectFailures = 0;
+}
 
-        if (rc == -1) {
-            int savedErrno = errno;
+void IO::applySocketOptions(int fd, const char *method) const {
+    const SocketOptions &o = mSocketOptions;
+    const bool tcp = isTCPSocket(fd);
 
-            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK ||
-                savedErrno == EINTR) {
-                // Nothing to read at the moment (or we were interrupted by a
-                // signal. Sleep for a while and retry
-                std::this_thread::sleep_for(
-                    std::chrono::milliseconds(millisecondsToSleep));
+    if (tcp && o.noDelay) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY",
+                        method);
+    }
 
-            } else if (savedErrno == ECONNABORTED || savedErrno == ECONNRESET) {
-                // End-of-file
-                closeConnection();
-                return NetworkLib::BufferView();
-            } else {
-                // Something serious happened
-                std::ostringstream err;
-                err << NETWORKLIB_CURRENT_FUNCTION << ": error reading fd "
-                    << mConnectionFD << " (errno = " << savedErrno << ": "
-                    << std::strerror(savedErrno) << ')';
+    if (o.sendBufferBytes > 0) {
+        setSocketOption(fd, SOL_SOCKET, SO_SNDBUF, o.sendBufferBytes,
+                        "SO_SNDBUF", method);
+    }
 
-                closeConnection();
-                throw std::runtime_error(err.str());
-            }
+    if (o.receiveBufferBytes > 0) {
+        setSocketOption(fd, SOL_SOCKET, SO_RCVBUF, o.receiveBufferBytes,
+                        "SO_RCVBUF", method);
+    }
 
-        } else if (rc == 0) {
-            // End-of-file
-            closeConnection();
-            return NetworkLib::BufferView();
-        }
+    if (!tcp) {
+        // The other options are only for TCP.
+        return;
+    }
 
-        // Otherwise, the result is the number of bytes read.
-        // Add it to the total number of bytes read.
-        bytesRead += rc;
-    } while (bytesRead < messageLength);
+    if (o.keepAlive) {
+        setSocketOption(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE",
+                        method);
+    }
 
-    // At this point, we read in all the `messageLength` bytes of the message.
+#if defined(__linux__)
+    if (o.quickAck) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK",
+                        method);
+    }
 
-    // Check that this is protocol version 2.
-    if (version != 2) {
-        // Just silently skip this message and return a size of 0.
-        return NetworkLib::BufferView();
+    if (o.keepAlive && o.keepAliveIdleSec > 0) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, o.keepAliveIdleSec,
+                        "TCP_KEEPIDLE", method);
     }
 
-    // Sanity check. Redundant, in theory, but it doesn't hurt.
-    if (bytesRead != messageLength) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": error reading fd "
-            << mConnectionFD << " (bytesRead is " << bytesRead
-            << ", messageLength is " << messageLength << ')';
+    if (o.keepAlive && o.keepAliveIntervalSec > 0) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_KEEPINTVL,
+                        o.keepAliveIntervalSec, "TCP_KEEPINTVL", method);
+    }
 
-        throw std::runtime_error(err.str());
+    if (o.keepAlive && o.keepAliveCount > 0) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_KEEPCNT, o.keepAliveCount,
+                        "TCP_KEEPCNT", method);
     }
 
-    // Return a bufferview on the message
-    return readBuffer.getSub(0, bytesRead);
-}
+    if (o.userTimeoutMsec > 0) {
+        setSocketOption(fd, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                        static_cast<int>(o.userTimeoutMsec),
+                        "TCP_USER_TIMEOUT", method);
+    }
 
-bool IO::isDataAvailable() {
-    // Refuse to read if there's neither an active connection nor a
-    // listening socket.
-    if (mConnectionFD == -1 && mListeningSocketFD == -1) {
-        return false;
+    if (o.busyPollUsec > 0) {
+        setSocketOption(fd, SOL_SOCKET, SO_BUSY_POLL, o.busyPollUsec,
+                        "SO_BUSY_POLL", method);
     }
+#endif
+}
 
-    // Use the delay as a timeout (in milliseconds), and split it into seconds
-    // and *microseconds*
-    timeval tv;
-    tv.tv_sec = mDelay_msec / 1000;
-    tv.tv_usec = (mDelay_msec % 1000) * 1000;
+// Standard size (in bytes) for a message buffer.
+//
+// The encoded size of a single message cannot exceeed this size
+// (note that the protocol uses a std::uint16_t in the message
+// header for the message size, therefore a message can't be
+// longer than 2^16 bytes (65536) anyway.
+//
+// Here we use a value which is slightly less than 2^16 to play
+// nice with memory allocators.
+static const std::size_t messageBufferStandardSizeBytes = 65500;
+
+// Messages up to this size (in bytes) returned by readMessage() are
+// copied into a buffer of their own (otherwise they would keep alive
+// a whole receive buffer).
+static const std::size_t smallMessageSizeBytes = 4096;
+
+// Note: the arena is never destroyed, as buffers could still be
+//       referred to by other static objects at exit.
+static NetworkLib::PacketBufferArena &messageBufferArena() {
+    static auto *arena = new NetworkLib::PacketBufferArena();
+    return *arena;
+}
 
-    // Prepare the sets of file descriptors to monitor...
-    fd_set readFDs;
-    fd_set errorFDs;
+NetworkLib::BufferWritableView IO::makeMessageBuffer() {
+    auto result = messageBufferArena().getBufferWritableView(
+        messageBufferStandardSizeBytes);
+    result.shrinkTo(messageBufferStandardSizeBytes);
+    return result;
+}
 
-    FD_ZERO(&readFDs);
-    FD_ZERO(&errorFDs);
+NetworkLib::BufferWritableView IO::makeMessageBuffer(std::size_t size) {
+    if (size > messageBufferStandardSizeBytes) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": requested size " << size
+            << " exceeds the maximum size " << messageBufferStandardSizeBytes;
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
 
-    if (mListeningSocketFD != -1) {
-        FD_SET(mListeningSocketFD, &readFDs);
-        FD_SET(mListeningSocketFD, &errorFDs);
+    return messageBufferArena().getBufferWritableView(size);
+}
+
+NetworkLib::BufferWritableView
+IO::makeMessageBufferFor(const NetworkLib::BufferView &preamble) {
+    using namespace ReferenceProtocolStructs;
+
+    return messageBufferArena().getBufferForMessage(preamble,
+                                                    Preamble::lengthOffset);
+}
+
+IO::FillResult IO::fillFramer(ConnectionHandle handle, Connection &connection,
+                              NetworkLib::Status &status) {
+    NetworkLib::BufferWritableView space;
+    status = connection.framer.freeSpace_nothrow(space);
+
+    if (!status) {
+        // Our reading buffer is undersized
+        closeConnection(handle);
+        return FillResult::FAILED;
     }
 
-    if (mConnectionFD != -1) {
-        FD_SET(mConnectionFD, &readFDs);
-        FD_SET(mConnectionFD, &errorFDs);
+    std::size_t count = 0;
+    const FillResult result =
+        readSome(handle, connection.fd, space.getUnderlyingWritableBufferPtr(),
+                 space.size(), count, status);
+
+    if (result == FillResult::DATA) {
+        connection.framer.commit(count);
     }
 
-    // Note: we rely on the fact that a closed socket is -1
-    int nfds = std::max(mListeningSocketFD, mConnectionFD) + 1;
+    return result;
+}
+
+IO::FillResult IO::readSome(ConnectionHandle handle, int fd,
+                            unsigned char *data, std::size_t size,
+                            std::size_t &count, NetworkLib::Status &status) {
+    for (;;) {
+        ssize_t rc = read(fd, data, size);
 
-    int rc = select(nfds, &readFDs, NULL, &errorFDs, &tv);
+        if (rc == -1) {
+            int savedErrno = errno;
 
-    if (rc == 0) {
-        // Timeout expired
+            if (savedErrno == EINTR) {
+                // We were interrupted by a signal. Just retry.
+                continue;
+            } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                // Nothing to read at the moment.
+                NetworkLib::Metrics::add(NetworkLib::Counter::READ_WOULD_BLOCK);
+                return FillResult::WOULD_BLOCK;
+            } else if (savedErrno == ECONNABORTED || savedErrno == ECONNRESET) {
+                // End-of-file
+                closeConnection(handle);
+                return FillResult::CLOSED;
+            } else {
+                // Something serious happened
+                status = NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                            savedErrno);
+                closeConnection(handle);
+                return FillResult::FAILED;
+            }
+        } else if (rc == 0) {
+            // End-of-file
+            closeConnection(handle);
+            return FillResult::CLOSED;
+        }
+
+        // Otherwise, the result is the number of bytes read.
+        NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_READ,
+                                 static_cast<std::uint64_t>(rc));
+        count = static_cast<std::size_t>(rc);
+        return FillResult::DATA;
+    }
+}
+
+IO::FillResult IO::readFully(ConnectionHandle handle, int fd,
+                             unsigned char *data, std::size_t size,
+                             NetworkLib::Status &status) {
+    std::size_t done = 0;
+
+    while (done < size) {
+        std::size_t count = 0;
+
+        switch (readSome(handle, fd, data + done, size - done, count, status)) {
+        case FillResult::CLOSED:
+            return FillResult::CLOSED;
+
+        case FillResult::FAILED:
+            return FillResult::FAILED;
+
+        case FillResult::WOULD_BLOCK:
+            waitForFD(fd, Reactor::READABLE);
+            break;
+
+        case FillResult::DATA:
+            done += count;
+            break;
+        }
+    }
+
+    return FillResult::DATA;
+}
+
+NetworkLib::Status IO::nextFramedMessage(ConnectionHandle handle,
+                                         Connection &connection,
+                                         NetworkLib::BufferView &message) {
+    NetworkLib::Status status = connection.framer.nextMessage_nothrow(message);
+
+    if (!status) {
+        // We either received junk data, or our reading buffer is
+        // undersized. In any case, close down the connection.
+        closeConnection(handle);
+    } else if (!message.empty()) {
+        NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_READ);
+
+        if (mCapture != nullptr) {
+            mCapture->record_nothrow(handle, CaptureDirection::RECEIVED,
+                                     message);
+        }
+    }
+
+    return status;
+}
+
+NetworkLib::Status IO::receiveMessage(ConnectionHandle handle,
+                                      Connection &connection,
+                                      NetworkLib::BufferView &message) {
+    // Read in data until there's a whole message. Note that data
+    // read in the past (e.g. by a read(2) which brought in more than
+    // one message) could already contain a whole message.
+    NetworkLib::Status status = nextFramedMessage(handle, connection, message);
+
+    while (status && message.empty()) {
+        switch (fillFramer(handle, connection, status)) {
+        case FillResult::CLOSED:
+        case FillResult::FAILED:
+            return status;
+
+        case FillResult::WOULD_BLOCK:
+            // Nothing to read at the moment. Wait until there's
+            // something and retry.
+            waitForFD(connection.fd, Reactor::READABLE);
+            break;
+
+        case FillResult::DATA:
+            status = nextFramedMessage(handle, connection, message);
+            break;
+        }
+    }
+
+    return status;
+}
+
+NetworkLib::BufferView IO::readMessage() {
+    return readMessage(defaultConnection());
+}
+
+NetworkLib::BufferView IO::readMessage(ConnectionHandle handle) {
+    return readMessage_nothrow(handle).valueOrRaise(
+        NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<NetworkLib::BufferView>
+IO::readMessage_nothrow(ConnectionHandle handle) {
+    using namespace ReferenceProtocolStructs;
+
+    if (mUring) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::UNSUPPORTED);
+    }
+
+    // Refuse to read if there's no such connection
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::NO_CONNECTION);
+    }
+
+    NetworkLib::BufferView message;
+    NetworkLib::Status status = receiveMessage(handle, *connection, message);
+
+    if (!status) {
+        return status;
+    }
+
+    if (message.empty()) {
+        // The connection was closed
+        return NetworkLib::BufferView();
+    }
+
+    // Check that this is protocol version 2 (the framer only hands
+    // out messages with at least a whole preamble).
+    if (message.getUint8At_nocheck(Preamble::versionOffset) != 2) {
+        // Just silently skip this message and return a size of 0.
+        return NetworkLib::BufferView();
+    }
+
+    if (message.size() > smallMessageSizeBytes) {
+        // Large enough to be worth keeping the receive buffer alive.
+        return message;
+    }
+
+    // Copy it in a buffer sized after the length in the preamble, so
+    // that the receive buffer can go back to the arena.
+    auto buffer = makeMessageBufferFor(message);
+    message.copyTo(buffer);
+    return NetworkLib::BufferView(buffer);
+}
+
+NetworkLib::BufferView
+IO::readMessage(NetworkLib::BufferWritableView &readBuffer) {
+    return readMessage(defaultConnection(), readBuffer);
+}
+
+NetworkLib::BufferView
+IO::readMessage(ConnectionHandle handle,
+                NetworkLib::BufferWritableView &readBuffer) {
+    return readMessage_nothrow(handle, readBuffer)
+        .valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<NetworkLib::BufferView>
+IO::readMessage_nothrow(ConnectionHandle handle,
+                        NetworkLib::BufferWritableView &readBuffer) {
+
+    using namespace ReferenceProtocolStructs;
+
+    if (mUring) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::UNSUPPORTED);
+    }
+
+    // Refuse to read if there's no such connection
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::NO_CONNECTION);
+    }
+
+    // Check we have room at least to read the preamble of the common
+    // header of messages.
+    if (readBuffer.size() < Preamble::size) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::BUFFER_TOO_SMALL);
+    }
+
+    NetworkLib::BufferView message;
+    NetworkLib::Status status;
+
+    if (connection->framer.pendingBytes() == 0) {
+        // Nothing was read ahead: read the message straight into the
+        // given buffer, without going through the framer.
+        status = readMessageInto(handle, readBuffer, message);
+    } else {
+        status = receiveMessage(handle, *connection, message);
+
+        if (status && readBuffer.size() < message.size()) {
+            // There's not enough room to return the whole message.
+            closeConnection(handle);
+            status = NetworkLib::Status(
+                NetworkLib::ErrorCode::BUFFER_TOO_SMALL);
+        } else if (status && !message.empty()) {
+            message.copyTo(readBuffer);
+            message = readBuffer.getSub_nocheck(0, message.size());
+        }
+    }
+
+    if (!status) {
+        return status;
+    }
+
+    if (message.empty()) {
+        // The connection was closed
+        return NetworkLib::BufferView();
+    }
+
+    // Check that this is protocol version 2.
+    if (message.getUint8At_nocheck(Preamble::versionOffset) != 2) {
+        // Just silently skip this message and return a size of 0.
+        return NetworkLib::BufferView();
+    }
+
+    // Return a bufferview on the message (stored in the given buffer)
+    return message;
+}
+
+NetworkLib::Status
+IO::readMessageInto(ConnectionHandle handle,
+                    NetworkLib::BufferWritableView &readBuffer,
+                    NetworkLib::BufferView &message) {
+    using namespace ReferenceProtocolStructs;
+
+    const int fd = findConnection(handle)->fd;
+    unsigned char *data = readBuffer.getUnderlyingWritableBufferPtr();
+    NetworkLib::Status status;
+
+    // Read the preamble first, to learn the length of the message.
+    FillResult result = readFully(handle, fd, data, Preamble::size, status);
+
+    if (result != FillResult::DATA) {
+        // Either the connection was closed or the read failed (and
+        // then the connection was closed anyway).
+        return status;
+    }
+
+    const std::size_t length =
+        readBuffer.getUint32At_nocheck(Preamble::lengthOffset);
+
+    if (length < Preamble::size || length > messageBufferStandardSizeBytes) {
+        // We received junk data
+        closeConnection(handle);
+        return NetworkLib::Status(NetworkLib::ErrorCode::BAD_MESSAGE_LENGTH);
+    }
+
+    if (length > readBuffer.size()) {
+        // There's not enough room to return the whole message.
+        closeConnection(handle);
+        return NetworkLib::Status(NetworkLib::ErrorCode::BUFFER_TOO_SMALL);
+    }
+
+    result = readFully(handle, fd, data + Preamble::size,
+                       length - Preamble::size, status);
+
+    if (result != FillResult::DATA) {
+        return status;
+    }
+
+    message = readBuffer.getSub_nocheck(0, length);
+    NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_READ);
+
+    if (mCapture != nullptr) {
+        mCapture->record_nothrow(handle, CaptureDirection::RECEIVED, message);
+    }
+
+    return status;
+}
+
+bool IO::isDataAvailable() {
+    if (mUring) {
+        NetworkLib::Status(NetworkLib::ErrorCode::UNSUPPORTED)
+            .raise(NETWORKLIB_CURRENT_FUNCTION);
+    }
+
+    // Refuse to read if there's neither an active connection nor a
+    // listening socket (nor a watched file descriptor).
+    if (mConnections.empty() && mListeningSocketFD == -1 && mWatched.empty()) {
         return false;
-    } else if (rc == -1) {
-        // Some error occurred.
-        int savedErrno = errno;
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": call to select(2) failed "
-            << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
-            << ')';
-        throw std::runtime_error(err.str());
     }
 
-    if (mListeningSocketFD != -1 && mConnectionFD == -1) {
-        // There's a connection to accept
-        acceptConnectionIfNeeded();
+    // Messages received along with the last one read (e.g. pipelined
+    // requests) don't make the socket readable again.
+    for (const auto &entry : mConnections) {
+        if (entry.second->framer.state() == MessageFramer::State::COMPLETE) {
+            return true;
+        }
+    }
+
+    if (mReactor.wait(mDelay_msec, mEvents) == 0) {
+        // Timeout expired
+        return false;
+    }
 
-        if (mConnectionFD != -1) {
-            // If now there's a connection, Wait again for data.
-            return isDataAvailable();
+    bool accepted = false;
+    bool dataAvailable = false;
+
+    for (const auto &event : mEvents) {
+        if (isWakeup(event)) {
+            continue;
+        } else if (invokeWatcher(event.fd)) {
+            continue;
+        } else if (event.fd == mListeningSocketFD) {
+            // There's a connection to accept
+            const std::size_t before = mConnections.size();
+            acceptConnectionIfNeeded();
+            accepted = accepted || mConnections.size() != before;
+        } else if (mHandlesByFD.count(event.fd) != 0) {
+            // There's something now to read.
+            dataAvailable = true;
         }
     }
 
-    // There's something now to read.
-    return true;
+    if (dataAvailable) {
+        return true;
+    }
+
+    if (accepted) {
+        // If now there's a (new) connection, wait again for data.
+        return isDataAvailable();
+    }
+
+    // The connection attempt vanished in the meantime (or we've been
+    // woken up).
+    return false;
 }
 
 void IO::sleep() const {
@@ -432,53 +1293,107 @@ void IO::sleep() const {
     select(0, NULL, NULL, NULL, &tv);
 }
 
-std::size_t IO::writeMessage(const NetworkLib::BufferView &messageBuffer) {
+/// @brief Get the length of the message in the given buffer (from its
+///        preamble), checking that it's all there.
+static NetworkLib::Status
+getMessageLength(const NetworkLib::BufferView &messageBuffer,
+                 std::size_t &messageLength) noexcept {
     using namespace ReferenceProtocolStructs;
 
-    // Refuse to read if there's no active connection
-    if (mConnectionFD == -1) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": no connection";
-        throw std::runtime_error(err.str());
+    if (messageBuffer.size() < Preamble::size) {
+        return NetworkLib::ErrorCode::BAD_MESSAGE_LENGTH;
+    }
+
+    // Bounds checked just above
+    messageLength = messageBuffer.getUint32At_nocheck(Preamble::lengthOffset);
+
+    if (messageLength < Preamble::size ||
+        messageLength > messageBuffer.size()) {
+        return NetworkLib::ErrorCode::BAD_MESSAGE_LENGTH;
+    }
+
+    return NetworkLib::Status();
+}
+
+std::size_t IO::writeMessage(const NetworkLib::BufferView &messageBuffer) {
+    return writeMessage(defaultConnection(), messageBuffer);
+}
+
+std::size_t IO::writeMessage(ConnectionHandle handle,
+                             const NetworkLib::BufferView &messageBuffer) {
+    return writeMessage_nothrow(handle, messageBuffer)
+        .valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<std::size_t>
+IO::writeMessage_nothrow(ConnectionHandle handle,
+                         const NetworkLib::BufferView &messageBuffer) {
+    if (mUring) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::UNSUPPORTED);
+    }
+
+    // Refuse to write if there's no such connection
+    if (findConnection(handle) == nullptr) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::NO_CONNECTION);
+    }
+
+    std::size_t messageLength = 0;
+    NetworkLib::Status status = getMessageLength(messageBuffer, messageLength);
+
+    if (!status) {
+        return status;
     }
 
-    // How many milliseconds we should sleep when waiting before
-    // writing further data.
-    static const int millisecondsToSleep = 100;
+    if (mCapture != nullptr) {
+        mCapture->record_nothrow(
+            handle, CaptureDirection::SENT,
+            messageBuffer.getSub_nocheck(0, messageLength));
+    }
+
+    status = drainPendingOutput(handle);
+
+    if (!status) {
+        return status;
+    }
+
+    if (isConnectionClosed(handle)) {
+        // The connection was closed while writing pending data.
+        return std::size_t(0);
+    }
+
+    const int fd = findConnection(handle)->fd;
 
     // Attempt to write the message data.
-    ssize_t bytesWritten = 0;
+    std::size_t bytesWritten = 0;
     ssize_t rc;
-    ssize_t messageLength = static_cast<ssize_t>(
-        messageBuffer.getUint32At_nocheck(Preamble::lengthOffset));
     const unsigned char *rawBuffer = messageBuffer.getUnderlyingBufferPtr();
 
     do {
-        rc = write(mConnectionFD, rawBuffer + bytesWritten,
-                   messageLength - bytesWritten);
+        rc = write(fd, rawBuffer + bytesWritten, messageLength - bytesWritten);
 
         if (rc == -1) {
             int savedErrno = errno;
 
-            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK ||
-                savedErrno == EINTR) {
-                // Nothing to read at the moment (or we were interrupted by a
-                // signal. Sleep for a while and retry
-                std::this_thread::sleep_for(
-                    std::chrono::milliseconds(millisecondsToSleep));
+            if (savedErrno == EINTR) {
+                // We were interrupted by a signal. Just retry.
+                continue;
+            } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                // No room to write at the moment. Wait until there's
+                // some and retry.
+                NetworkLib::Metrics::add(
+                    NetworkLib::Counter::WRITE_WOULD_BLOCK);
+                waitForFD(fd, Reactor::WRITABLE);
+                continue;
             } else {
                 // Something serious happened
-                std::ostringstream err;
-                err << NETWORKLIB_CURRENT_FUNCTION << ": error writing fd "
-                    << mConnectionFD << " (errno = " << savedErrno << ")";
-
-                closeConnection();
-                throw std::runtime_error(err.str());
+                closeConnection(handle);
+                return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                          savedErrno);
             }
         } else if (rc == 0) {
             // Something weird happened.
-            closeConnection();
-            return 0;
+            closeConnection(handle);
+            return std::size_t(0);
         }
 
         // Otherwise, the result is the number of bytes written out.
@@ -487,18 +1402,1039 @@ std::size_t IO::writeMessage(const NetworkLib::BufferView &messageBuffer) {
 
     } while (bytesWritten < messageLength);
 
-    // Sanity check. Redundant, in theory, but it doesn't hurt.
-    if (bytesWritten != messageLength) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": error writing fd "
-            << mConnectionFD << " (bytesWritten is " << bytesWritten
-            << ", messageLength is " << messageLength << ')';
+    NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_WRITTEN, bytesWritten);
+    NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_WRITTEN);
+
+    // Return the number of written bytes
+    return bytesWritten;
+}
+
+NetworkLib::Status IO::drainPendingOutput(ConnectionHandle handle) {
+    // Data queued by queueMessage() and sendMessage() must go out
+    // first.
+    NetworkLib::Status status = flushBatch(handle);
+
+    while (status && hasPendingOutput(handle)) {
+        status = handleWritable(handle);
 
-        throw std::runtime_error(err.str());
+        if (status && hasPendingOutput(handle)) {
+            waitForFD(findConnection(handle)->fd, Reactor::WRITABLE);
+        }
     }
 
-    // Return the number of written bytes
-    return static_cast<std::size_t>(bytesWritten);
+    return status;
+}
+
+std::size_t
+IO::writeMessage(const NetworkLib::BufferViewSegments &segments) {
+    return writeMessage(defaultConnection(), segments);
+}
+
+std::size_t IO::writeMessage(ConnectionHandle handle,
+                             const NetworkLib::BufferViewSegments &segments) {
+    return writeMessage_nothrow(handle, segments)
+        .valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<std::size_t>
+IO::writeMessage_nothrow(ConnectionHandle handle,
+                         const NetworkLib::BufferViewSegments &segments) {
+    if (mUring) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::UNSUPPORTED);
+    }
+
+    // Refuse to write if there's no such connection
+    if (findConnection(handle) == nullptr) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::NO_CONNECTION);
+    }
+
+    if (mCapture != nullptr) {
+        mCapture->record_nothrow(handle, CaptureDirection::SENT, segments);
+    }
+
+    NetworkLib::Status status = drainPendingOutput(handle);
+
+    if (!status) {
+        return status;
+    }
+
+    if (isConnectionClosed(handle)) {
+        // The connection was closed while writing pending data.
+        return std::size_t(0);
+    }
+
+    const int fd = findConnection(handle)->fd;
+
+    // Prepare the I/O vector (skipping empty segments)
+    std::vector<iovec> iov;
+    iov.reserve(segments.size());
+
+    for (const auto &segment : segments) {
+        if (segment.empty()) {
+            continue;
+        }
+
+        iovec v;
+        v.iov_base =
+            const_cast<unsigned char *>(segment.getUnderlyingBufferPtr());
+        v.iov_len = segment.size();
+        iov.push_back(v);
+    }
+
+    std::size_t bytesWritten = 0;
+    std::size_t first = 0;
+
+    while (first < iov.size()) {
+        const int count = static_cast<int>(
+            std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        ssize_t rc = writev(fd, iov.data() + first, count);
+
+        if (rc == -1) {
+            int savedErrno = errno;
+
+            if (savedErrno == EINTR) {
+                // We were interrupted by a signal. Just retry.
+                continue;
+            } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                // No room to write at the moment. Wait until there's
+                // some and retry.
+                NetworkLib::Metrics::add(
+                    NetworkLib::Counter::WRITE_WOULD_BLOCK);
+                waitForFD(fd, Reactor::WRITABLE);
+                continue;
+            } else {
+                // Something serious happened
+                closeConnection(handle);
+                return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                          savedErrno);
+            }
+        } else if (rc == 0) {
+            // Something weird happened.
+            closeConnection(handle);
+            return std::size_t(0);
+        }
+
+        bytesWritten += rc;
+
+        // Skip what's been written out (the last segment could have
+        // been written only partially).
+        std::size_t n = static_cast<std::size_t>(rc);
+
+        while (first < iov.size() && n >= iov[first].iov_len) {
+            n -= iov[first].iov_len;
+            ++first;
+        }
+
+        if (n > 0) {
+            iov[first].iov_base =
+                static_cast<unsigned char *>(iov[first].iov_base) + n;
+            iov[first].iov_len -= n;
+        }
+    }
+
+    NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_WRITTEN, bytesWritten);
+    NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_WRITTEN);
+
+    return bytesWritten;
+}
+
+int IO::flushExpiredBatches(int timeoutMsec, NetworkLib::Status &status) {
+    const auto now = std::chrono::steady_clock::now();
+    int result = timeoutMsec;
+
+    for (ConnectionHandle handle : connections()) {
+        Connection *connection = findConnection(handle);
+
+        if (connection == nullptr || connection->batchSize == 0) {
+            continue;
+        }
+
+        if (connection->batchDeadline <= now) {
+            NetworkLib::Status s = flushBatch(handle);
+
+            if (status && !s) {
+                status = s;
+            }
+
+            continue;
+        }
+
+        // Round up, so we don't wake up too early.
+        const auto left = connection->batchDeadline - now;
+        auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(left);
+
+        if (msec < left) {
+            msec += std::chrono::milliseconds(1);
+        }
+
+        if (result == -1 || msec.count() < result) {
+            result = static_cast<int>(msec.count());
+        }
+    }
+
+    return result;
+}
+
+std::size_t IO::processEvents(int timeoutMsec) {
+    return processEvents_nothrow(timeoutMsec)
+        .valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<std::size_t> IO::processEvents_nothrow(int timeoutMsec) {
+    if (mReconnectNeeded) {
+        // The outgoing connection got closed (see autoReconnect()).
+        mReconnectNeeded = false;
+
+        if (mOutgoingConnection == noConnection && !isConnecting()) {
+            retryConnect();
+        }
+    }
+
+    // Don't wait past the next job, nor past the deadline of queued
+    // messages.
+    const int timersMsec = mTimers.timeoutMsec();
+
+    if (timersMsec != -1 && (timeoutMsec == -1 || timersMsec < timeoutMsec)) {
+        timeoutMsec = timersMsec;
+    }
+
+    // Errors of a connection don't keep the others from being
+    // handled: the first one is returned in the end.
+    NetworkLib::Status status;
+    std::size_t count = 0;
+
+    timeoutMsec = flushExpiredBatches(timeoutMsec, status);
+
+    if (mUring) {
+        NetworkLib::Result<std::size_t> completions =
+            processCompletions(timeoutMsec);
+
+        if (status && !completions) {
+            status = completions.status();
+        }
+
+        count = completions.value();
+    } else {
+        count = mReactor.wait(timeoutMsec, mEvents);
+
+        NetworkLib::Status s = handleReactorEvents();
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    // Send out at once what the jobs expiring now have queued.
+    if (mTimers.advance() > 0) {
+        NetworkLib::Status s = flush_nothrow();
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    flushExpiredBatches(0, status);
+
+    if (mUring && mUring->pending() > 0) {
+        // Don't leave for the next call what's been prepared meanwhile.
+        NetworkLib::Status s = mUring->submit();
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    if (!status) {
+        return status;
+    }
+
+    return count;
+}
+
+NetworkLib::Status IO::handleReactorEvents() {
+    NetworkLib::Status status;
+
+    for (const auto &event : mEvents) {
+        NetworkLib::Status s;
+
+        if (isWakeup(event)) {
+            continue;
+        }
+
+        if (event.fd == mListeningSocketFD) {
+            s = acceptConnectionIfNeeded_nothrow();
+        } else if (invokeWatcher(event.fd)) {
+            continue;
+        } else if (event.fd == mConnectingFD) {
+            s = finishConnect();
+        } else {
+            auto it = mHandlesByFD.find(event.fd);
+
+            if (it == mHandlesByFD.end()) {
+                // Closed while handling a previous event.
+                continue;
+            }
+
+            // Note: handling an event may close the connection, so
+            //       always look it up again by handle.
+            const ConnectionHandle handle = it->second;
+
+            if (event.events & (Reactor::READABLE | Reactor::FAILED)) {
+                s = handleReadable(handle);
+            }
+
+            if (s && (event.events & Reactor::WRITABLE) &&
+                !isConnectionClosed(handle)) {
+                s = handleWritable(handle);
+            }
+        }
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    return status;
+}
+
+NetworkLib::Result<std::size_t> IO::processCompletions(int timeoutMsec) {
+    if (!mReactorPolled) {
+        mUring->preparePollMultishot(mReactor.fd(), reactorRequest);
+        mReactorPolled = true;
+    }
+
+    if (mCompletionsHandled == mCompletions.size()) {
+        // Level-triggered events may be left in the reactor, which
+        // doesn't signal them again: look again without waiting.
+        mCompletions.clear();
+        mCompletionsHandled = 0;
+
+        NetworkLib::Status status = mUring->submitAndWait(
+            mReactorReady ? 0 : timeoutMsec, mCompletions);
+
+        if (!status) {
+            return status;
+        }
+    }
+
+    const std::size_t count = mCompletions.size() - mCompletionsHandled;
+    bool reactorReady = mReactorReady;
+    NetworkLib::Status status;
+
+    while (mCompletionsHandled < mCompletions.size()) {
+        // Counted as handled even if a callback throws.
+        const Uring::Completion c = mCompletions[mCompletionsHandled++];
+        NetworkLib::Status s;
+
+        switch (c.userData & requestKindMask) {
+        case receiveRequest:
+            s = handleReceived(c);
+            break;
+
+        case sendRequest:
+            s = handleSent(c);
+            break;
+
+        case reactorRequest:
+            reactorReady = true;
+            mReactorPolled = c.more;
+            break;
+        }
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    rearmQuickAcks();
+
+    if (reactorReady) {
+        mReactorReady = mReactor.wait(0, mEvents) > 0;
+
+        NetworkLib::Status s = handleReactorEvents();
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    if (!status) {
+        return status;
+    }
+
+    return count;
+}
+
+void IO::armReceive(ConnectionHandle handle, int fd) {
+    mUring->prepareRecvMultishot(fd, receiveRequest | handle);
+}
+
+void IO::rearmQuickAcks() {
+    for (ConnectionHandle handle : mQuickAcks) {
+        Connection *connection = findConnection(handle);
+
+        if (connection == nullptr) {
+            // Closed meanwhile
+            continue;
+        }
+
+        connection->quickAckPending = false;
+
+#if defined(__linux__)
+        // Cleared by the kernel as it sees fit (errors don't matter
+        // here).
+        int one = 1;
+        setsockopt(connection->fd, IPPROTO_TCP, TCP_QUICKACK, &one,
+                   sizeof(one));
+#endif
+    }
+
+    mQuickAcks.clear();
+}
+
+NetworkLib::Status IO::handleReceived(const Uring::Completion &completion) {
+    // The buffer goes back to the ring when done (even if a callback
+    // throws).
+    struct Recycler {
+        Uring &uring;
+        const Uring::Completion &completion;
+        ~Recycler() { uring.recycle(completion); }
+    } recycler{*mUring, completion};
+
+    const auto handle = static_cast<ConnectionHandle>(completion.userData);
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        // Closed meanwhile
+        return NetworkLib::Status();
+    }
+
+    const int result = completion.result;
+
+    if (result == 0 || result == -ECONNABORTED || result == -ECONNRESET) {
+        // End-of-file
+        closeConnection(handle);
+        return NetworkLib::Status();
+    }
+
+    if (result < 0 && result != -ENOBUFS && result != -EINTR &&
+        result != -EAGAIN) {
+        // Something serious happened
+        closeConnection(handle);
+        return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                  -result);
+    }
+
+    // Otherwise, we received data, or we ran out of buffers (which go
+    // back to the ring as we handle the completions).
+    if (!completion.more) {
+        armReceive(handle, connection->fd);
+    }
+
+    if (result < 0) {
+        return NetworkLib::Status();
+    }
+
+    if (mSocketOptions.quickAck && connection->tcp &&
+        !connection->quickAckPending) {
+        // Set again once for the whole batch of completions (see
+        // rearmQuickAcks()).
+        connection->quickAckPending = true;
+        mQuickAcks.push_back(handle);
+    }
+
+    // Copy the data into the framer, handing out the messages as they
+    // get complete (so the framer never holds more than one message
+    // plus a buffer of the ring).
+    const NetworkLib::BufferView data = mUring->receivedData(completion);
+    NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_READ, data.size());
+
+    std::size_t offset = 0;
+
+    while (offset < data.size()) {
+        connection = findConnection(handle);
+
+        if (connection == nullptr) {
+            // The callback closed the connection
+            return NetworkLib::Status();
+        }
+
+        NetworkLib::BufferWritableView space;
+        NetworkLib::Status status = connection->framer.freeSpace_nothrow(space);
+
+        if (!status) {
+            // Our reading buffer is undersized
+            closeConnection(handle);
+            return status;
+        }
+
+        const std::size_t len = std::min(space.size(), data.size() - offset);
+        std::memcpy(space.getUnderlyingWritableBufferPtr(),
+                    data.getUnderlyingBufferPtr() + offset, len);
+        connection->framer.commit(len);
+        offset += len;
+
+        status = deliverMessages(handle);
+
+        if (!status) {
+            return status;
+        }
+    }
+
+    return NetworkLib::Status();
+}
+
+void IO::submitSend(ConnectionHandle handle) {
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr || connection->pendingOutput.empty() ||
+        mInFlightSends.count(handle) != 0) {
+        return;
+    }
+
+    std::unique_ptr<InFlightSend> &send = mInFlightSends[handle];
+    send.reset(new InFlightSend);
+
+    std::size_t count = 0;
+    std::size_t offset = connection->pendingOutputOffset;
+
+    for (const auto &pending : connection->pendingOutput) {
+        if (count == InFlightSend::maxSegments) {
+            break;
+        }
+
+        send->iov[count].iov_base = const_cast<unsigned char *>(
+            pending.getUnderlyingBufferPtr() + offset);
+        send->iov[count].iov_len = pending.size() - offset;
+        send->data.push_back(pending);
+        offset = 0;
+        ++count;
+    }
+
+    std::memset(&send->header, 0, sizeof(send->header));
+    send->header.msg_iov = send->iov;
+    send->header.msg_iovlen = count;
+
+    mUring->prepareSendmsg(connection->fd, &send->header,
+                           sendRequest | handle);
+}
+
+NetworkLib::Status IO::handleSent(const Uring::Completion &completion) {
+    const auto handle = static_cast<ConnectionHandle>(completion.userData);
+
+    // The buffers are not referred to by the kernel any more.
+    mInFlightSends.erase(handle);
+
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        return NetworkLib::Status();
+    }
+
+    const int result = completion.result;
+
+    if (result == -EINTR || result == -EAGAIN) {
+        // Just retry.
+        submitSend(handle);
+        return NetworkLib::Status();
+    } else if (result < 0) {
+        // Something serious happened
+        closeConnection(handle);
+        return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                  -result);
+    } else if (result == 0) {
+        // Something weird happened.
+        closeConnection(handle);
+        return NetworkLib::Status();
+    }
+
+    NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_WRITTEN,
+                             static_cast<std::uint64_t>(result));
+    consumePendingOutput(*connection, static_cast<std::size_t>(result));
+
+    if (!connection->pendingOutput.empty()) {
+        submitSend(handle);
+    } else if (mWritableCallback) {
+        mWritableCallback(handle);
+    }
+
+    return NetworkLib::Status();
+}
+
+IO &IO::enableWakeup() {
+    if (!mWaker) {
+        mWaker.reset(new Waker);
+        mReactor.add(mWaker->fd(), Reactor::READABLE);
+    }
+
+    return *this;
+}
+
+IO &IO::watch(int fd, std::function<void()> cb) {
+    auto it = mWatched.find(fd);
+
+    if (it != mWatched.end()) {
+        it->second = std::move(cb);
+        return *this;
+    }
+
+    mReactor.add(fd, Reactor::READABLE);
+    mWatched[fd] = std::move(cb);
+    return *this;
+}
+
+void IO::unwatch(int fd) noexcept {
+    if (mWatched.erase(fd) != 0) {
+        mReactor.remove(fd);
+    }
+}
+
+bool IO::invokeWatcher(int fd) {
+    auto it = mWatched.find(fd);
+
+    if (it == mWatched.end()) {
+        return false;
+    }
+
+    // The callback may unwatch (or watch again) the file descriptor.
+    std::function<void()> cb = it->second;
+
+    if (cb) {
+        cb();
+    }
+
+    return true;
+}
+
+bool IO::isWakeup(const Reactor::Event &event) noexcept {
+    if (!mWaker || event.fd != mWaker->fd()) {
+        return false;
+    }
+
+    mWaker->drain();
+    return true;
+}
+
+NetworkLib::Status IO::handleReadable(ConnectionHandle handle) {
+    using namespace ReferenceProtocolStructs;
+
+    // Keep reading as long as there's data (with blocking sockets,
+    // read just once so we never block).
+    bool keepReading = true;
+
+    while (keepReading) {
+        keepReading = mNonBlocking;
+
+        Connection *connection = findConnection(handle);
+
+        if (connection == nullptr) {
+            return NetworkLib::Status();
+        }
+
+        NetworkLib::Status status;
+
+        switch (fillFramer(handle, *connection, status)) {
+        case FillResult::DATA:
+#if defined(__linux__)
+            if (mSocketOptions.quickAck && connection->tcp) {
+                // Cleared by the kernel as it sees fit (errors don't
+                // matter here).
+                int one = 1;
+                setsockopt(connection->fd, IPPROTO_TCP, TCP_QUICKACK, &one,
+                           sizeof(one));
+            }
+#endif
+            break;
+
+        case FillResult::FAILED:
+            return status;
+
+        default:
+            // Nothing more for now (or the connection was closed).
+            return NetworkLib::Status();
+        }
+
+        // Hand out all the messages we have now.
+        status = deliverMessages(handle);
+
+        if (!status) {
+            return status;
+        }
+    }
+
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status IO::deliverMessages(ConnectionHandle handle) {
+    using namespace ReferenceProtocolStructs;
+
+    NetworkLib::BufferView message;
+
+    for (;;) {
+        Connection *connection = findConnection(handle);
+
+        if (connection == nullptr) {
+            // The callback closed the connection
+            return NetworkLib::Status();
+        }
+
+        NetworkLib::Status status =
+            nextFramedMessage(handle, *connection, message);
+
+        if (!status || message.empty()) {
+            return status;
+        }
+
+        // Silently skip messages with the wrong version (see
+        // readMessage()).
+        if (message.getUint8At_nocheck(Preamble::versionOffset) == 2 &&
+            mMessageCallback) {
+            mMessageCallback(handle, message);
+        }
+    }
+}
+
+NetworkLib::Status IO::handleWritable(ConnectionHandle handle) {
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr || connection->pendingOutput.empty()) {
+        return NetworkLib::Status();
+    }
+
+    if (mUring) {
+        submitSend(handle);
+        return NetworkLib::Status();
+    }
+
+    // Write out many pending buffers at once (this is where messages
+    // sent via sendMessage() or flushed get coalesced).
+    static const std::size_t maxSegmentsPerWrite = 64;
+    iovec iov[maxSegmentsPerWrite];
+
+    while (!connection->pendingOutput.empty()) {
+        int count = 0;
+        std::size_t offset = connection->pendingOutputOffset;
+
+        for (const auto &pending : connection->pendingOutput) {
+            if (static_cast<std::size_t>(count) == maxSegmentsPerWrite) {
+                break;
+            }
+
+            iov[count].iov_base = const_cast<unsigned char *>(
+                pending.getUnderlyingBufferPtr() + offset);
+            iov[count].iov_len = pending.size() - offset;
+            offset = 0;
+            ++count;
+        }
+
+        ssize_t rc = writev(connection->fd, iov, count);
+
+        if (rc == -1) {
+            int savedErrno = errno;
+
+            if (savedErrno == EINTR) {
+                // We were interrupted by a signal. Just retry.
+                continue;
+            } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                // No more room at the moment.
+                NetworkLib::Metrics::add(
+                    NetworkLib::Counter::WRITE_WOULD_BLOCK);
+                break;
+            } else {
+                // Something serious happened
+                closeConnection(handle);
+                return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                          savedErrno);
+            }
+        } else if (rc == 0) {
+            // Something weird happened.
+            closeConnection(handle);
+            return NetworkLib::Status();
+        }
+
+        const std::size_t n = static_cast<std::size_t>(rc);
+        NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_WRITTEN, n);
+        consumePendingOutput(*connection, n);
+    }
+
+    updateConnectionInterest(*connection);
+
+    if (connection->pendingOutput.empty() && mWritableCallback) {
+        mWritableCallback(handle);
+    }
+
+    return NetworkLib::Status();
+}
+
+void IO::consumePendingOutput(Connection &connection, std::size_t n) {
+    // The last buffer could have been written only partially.
+    while (n > 0) {
+        const std::size_t left = connection.pendingOutput.front().size() -
+                                 connection.pendingOutputOffset;
+
+        if (n < left) {
+            connection.pendingOutputOffset += n;
+            break;
+        }
+
+        n -= left;
+        connection.pendingOutput.pop_front();
+        connection.pendingOutputOffset = 0;
+    }
+}
+
+std::size_t IO::sendMessage(const NetworkLib::BufferView &messageBuffer) {
+    return sendMessage(defaultConnection(), messageBuffer);
+}
+
+std::size_t IO::sendMessage(ConnectionHandle handle,
+                            const NetworkLib::BufferView &messageBuffer) {
+    return sendMessage_nothrow(handle, messageBuffer)
+        .valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<std::size_t>
+IO::sendMessage_nothrow(ConnectionHandle handle,
+                        const NetworkLib::BufferView &messageBuffer) {
+    // Messages queued before this one go out first.
+    NetworkLib::Status status = flushBatch(handle);
+
+    if (!status) {
+        return status;
+    }
+
+    // Refuse to write if there's no such connection
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        return NetworkLib::Status(NetworkLib::ErrorCode::NO_CONNECTION);
+    }
+
+    std::size_t messageLength = 0;
+    status = getMessageLength(messageBuffer, messageLength);
+
+    if (!status) {
+        return status;
+    }
+
+    if (mCapture != nullptr) {
+        mCapture->record_nothrow(
+            handle, CaptureDirection::SENT,
+            messageBuffer.getSub_nocheck(0, messageLength));
+    }
+
+    std::size_t bytesWritten = 0;
+
+    // Write immediately only if there's nothing queued before us
+    // (otherwise data would be sent out of order), and never with
+    // io_uring (the send request goes out with the next batch).
+    while (!mUring && connection->pendingOutput.empty() &&
+           bytesWritten < messageLength) {
+        ssize_t rc =
+            write(connection->fd,
+                  messageBuffer.getUnderlyingBufferPtr() + bytesWritten,
+                  messageLength - bytesWritten);
+
+        if (rc == -1) {
+            int savedErrno = errno;
+
+            if (savedErrno == EINTR) {
+                // We were interrupted by a signal. Just retry.
+                continue;
+            } else if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                // No more room at the moment: queue the rest.
+                NetworkLib::Metrics::add(
+                    NetworkLib::Counter::WRITE_WOULD_BLOCK);
+                break;
+            } else {
+                // Something serious happened
+                closeConnection(handle);
+                return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR,
+                                          savedErrno);
+            }
+        } else if (rc == 0) {
+            // Something weird happened.
+            closeConnection(handle);
+            return std::size_t(0);
+        }
+
+        bytesWritten += rc;
+    }
+
+    NetworkLib::Metrics::add(NetworkLib::Counter::BYTES_WRITTEN, bytesWritten);
+    NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_WRITTEN);
+
+    if (bytesWritten < messageLength) {
+        // Keep a copy of what's left, so the caller can reuse its
+        // buffer right away (bounds already checked above).
+        auto rest = messageBuffer.getSub_nocheck(bytesWritten,
+                                                 messageLength - bytesWritten);
+        auto copy = makeMessageBuffer(rest.size());
+        rest.copyTo(copy);
+        copy.shrinkTo(rest.size());
+
+        connection->pendingOutput.push_back(copy);
+
+        if (mUring) {
+            submitSend(handle);
+        } else {
+            updateConnectionInterest(*connection);
+        }
+    }
+
+    return bytesWritten;
+}
+
+void IO::queueMessage(const NetworkLib::BufferView &messageBuffer) {
+    queueMessage(defaultConnection(), messageBuffer);
+}
+
+void IO::queueMessage(ConnectionHandle handle,
+                      const NetworkLib::BufferView &messageBuffer) {
+    queueMessage_nothrow(handle, messageBuffer)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status
+IO::queueMessage_nothrow(ConnectionHandle handle,
+                         const NetworkLib::BufferView &messageBuffer) {
+    // Refuse to queue if there's no such connection
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr) {
+        return NetworkLib::ErrorCode::NO_CONNECTION;
+    }
+
+    std::size_t messageLength = 0;
+    NetworkLib::Status status = getMessageLength(messageBuffer, messageLength);
+
+    if (!status) {
+        return status;
+    }
+
+    if (connection->batchSize > 0 &&
+        connection->batch.size() - connection->batchSize < messageLength) {
+        // No room left: send out what we have.
+        status = flushBatch(handle);
+
+        if (!status) {
+            return status;
+        }
+
+        connection = findConnection(handle);
+
+        if (connection == nullptr) {
+            return NetworkLib::Status();
+        }
+    }
+
+    if (connection->batchSize == 0) {
+        connection->batch = makeMessageBuffer();
+        connection->batchDeadline =
+            std::chrono::steady_clock::now() + mFlushLatency;
+    }
+
+    if (messageLength > connection->batch.size()) {
+        // Too large to be coalesced
+        return sendMessage_nothrow(handle, messageBuffer).status();
+    }
+
+    // Bounds already checked above
+    auto space =
+        connection->batch.getSub_nocheck(connection->batchSize, messageLength);
+    auto message = messageBuffer.getSub_nocheck(0, messageLength);
+    message.copyTo(space);
+    connection->batchSize += messageLength;
+
+    if (mCapture != nullptr) {
+        mCapture->record_nothrow(handle, CaptureDirection::SENT, message);
+    }
+    NetworkLib::Metrics::add(NetworkLib::Counter::MESSAGES_WRITTEN);
+
+    if (connection->batchSize >= mFlushThreshold) {
+        return flushBatch(handle);
+    }
+
+    return NetworkLib::Status();
+}
+
+void IO::flush() { flush_nothrow().raise(NETWORKLIB_CURRENT_FUNCTION); }
+
+void IO::flush(ConnectionHandle handle) {
+    flush_nothrow(handle).raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status IO::flush_nothrow() {
+    NetworkLib::Status status;
+
+    for (ConnectionHandle handle : connections()) {
+        NetworkLib::Status s = flushBatch(handle);
+
+        if (status && !s) {
+            status = s;
+        }
+    }
+
+    return status;
+}
+
+NetworkLib::Status IO::flush_nothrow(ConnectionHandle handle) {
+    return flushBatch(handle);
+}
+
+NetworkLib::Status IO::flushBatch(ConnectionHandle handle) {
+    Connection *connection = findConnection(handle);
+
+    if (connection == nullptr || connection->batchSize == 0) {
+        return NetworkLib::Status();
+    }
+
+    // Turn the batch into pending output, and try writing it out.
+    connection->pendingOutput.push_back(
+        connection->batch.getSub(0, connection->batchSize));
+    connection->batch = NetworkLib::BufferWritableView();
+    connection->batchSize = 0;
+
+    return handleWritable(handle);
+}
+
+std::size_t
+IO::broadcastMessage(const NetworkLib::BufferView &messageBuffer) {
+    std::size_t count = 0;
+
+    for (ConnectionHandle handle : connections()) {
+        if (isConnectionClosed(handle)) {
+            // Closed by a callback in the meantime
+            continue;
+        }
+
+        if (!sendMessage_nothrow(handle, messageBuffer).ok()) {
+            // The connection has already been closed: go on with the
+            // others.
+            continue;
+        }
+
+        if (!isConnectionClosed(handle)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool IO::hasPendingOutput() const {
+    for (const auto &c : mConnections) {
+        if (!c.second->pendingOutput.empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool IO::hasPendingOutput(ConnectionHandle handle) const {
+    Connection *connection = findConnection(handle);
+    return connection != nullptr && !connection->pendingOutput.empty();
 }
 
 } // namespace Agent
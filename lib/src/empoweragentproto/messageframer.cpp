@@ -0,0 +1,170 @@
+#include <empoweragentproto/messageframer.hh>
+#include <empoweragentproto/protocol.hh>
+
+#include <algorithm>
+
+namespace Empower {
+namespace Agent {
+
+// Don't bother reading into less than this many bytes: get a new
+// receive buffer instead.
+static const std::size_t minFreeSpace = 512;
+
+std::size_t MessageFramer::currentMessageLength() const {
+    using namespace ReferenceProtocolStructs;
+
+    if (pendingBytes() < Preamble::size) {
+        return 0;
+    }
+
+    // Bounds already checked above
+    return mBuffer.getUint32At_nocheck(mBegin + Preamble::lengthOffset);
+}
+
+MessageFramer::State MessageFramer::state() const {
+    using namespace ReferenceProtocolStructs;
+
+    if (pendingBytes() < Preamble::size) {
+        return State::READING_PREAMBLE;
+    } else if (pendingBytes() < currentMessageLength()) {
+        return State::READING_BODY;
+    }
+
+    return State::COMPLETE;
+}
+
+std::size_t MessageFramer::remaining() const {
+    using namespace ReferenceProtocolStructs;
+
+    if (pendingBytes() < Preamble::size) {
+        return Preamble::size - pendingBytes();
+    } else if (pendingBytes() < currentMessageLength()) {
+        return currentMessageLength() - pendingBytes();
+    }
+
+    return 0;
+}
+
+NetworkLib::BufferWritableView MessageFramer::freeSpace() {
+    NetworkLib::BufferWritableView space;
+    freeSpace_nothrow(space).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return space;
+}
+
+NetworkLib::Status
+MessageFramer::freeSpace_nothrow(NetworkLib::BufferWritableView &space) {
+    // How much room we need (from the start of the pending data),
+    // and at least how much free space is worth a read. Once the
+    // length of the message currently received is known, that's just
+    // the rest of the message (a bogus length will be reported by
+    // nextMessage(), so don't plan for it here).
+    std::size_t required = pendingBytes() + minFreeSpace;
+    std::size_t minRead = minFreeSpace;
+    const std::size_t messageLength = currentMessageLength();
+
+    if (messageLength <= mMaxMessageSize && messageLength > pendingBytes()) {
+        required = messageLength;
+        minRead = std::min(minRead, messageLength - pendingBytes());
+    }
+
+    if (mBuffer.empty() || (mBuffer.size() - mBegin) < required ||
+        (mBuffer.size() - mEnd) < minRead) {
+
+        // Get a new receive buffer, and move there the pending data.
+        // Note: we can't reuse the old buffer, as there could still be
+        //       messages pointing into it.
+        if (required > mMaxMessageSize) {
+            // Only with a whole message (or more) pending
+            return NetworkLib::ErrorCode::BUFFER_TOO_SMALL;
+        }
+
+        auto newBuffer = mBufferFactory != nullptr
+                             ? mBufferFactory(mMaxMessageSize)
+                             : NetworkLib::BufferWritableView::makeEthBuffer();
+
+        if (newBuffer.size() < required) {
+            return NetworkLib::ErrorCode::BUFFER_TOO_SMALL;
+        }
+
+        if (pendingBytes() > 0) {
+            auto pending = mBuffer.getSub(mBegin, pendingBytes());
+            pending.copyTo(newBuffer);
+        }
+
+        mEnd = pendingBytes();
+        mBegin = 0;
+        mBuffer = newBuffer;
+    }
+
+    space = mBuffer.getSub(mEnd);
+    return NetworkLib::Status();
+}
+
+void MessageFramer::commit(std::size_t n) {
+    if (mEnd + n > mBuffer.size()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": committing " << n
+            << " bytes, but only " << (mBuffer.size() - mEnd)
+            << " are available";
+        NETWORKLIB_THROW(std::out_of_range, err.str());
+    }
+
+    mEnd += n;
+}
+
+void MessageFramer::feed(const NetworkLib::BufferView &data) {
+    std::size_t offset = 0;
+
+    while (offset < data.size()) {
+        auto space = freeSpace();
+        const std::size_t len = std::min(space.size(), data.size() - offset);
+
+        data.copyTo(offset, len, space.getUnderlyingWritableBufferPtr());
+        commit(len);
+        offset += len;
+    }
+}
+
+NetworkLib::BufferView MessageFramer::nextMessage() {
+    NetworkLib::BufferView message;
+    nextMessage_nothrow(message).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return message;
+}
+
+NetworkLib::Status
+MessageFramer::nextMessage_nothrow(NetworkLib::BufferView &message) noexcept {
+    using namespace ReferenceProtocolStructs;
+
+    message = NetworkLib::BufferView();
+
+    if (pendingBytes() < Preamble::size) {
+        // No preamble yet
+        return NetworkLib::Status();
+    }
+
+    const std::size_t messageLength = currentMessageLength();
+
+    if (messageLength < Preamble::size || messageLength > mMaxMessageSize) {
+        return NetworkLib::ErrorCode::BAD_MESSAGE_LENGTH;
+    }
+
+    if (pendingBytes() < messageLength) {
+        // Not yet complete
+        return NetworkLib::Status();
+    }
+
+    // Bounds already checked above (pending data is within mBuffer)
+    message = mBuffer.getSub_nocheck(mBegin, messageLength);
+    mBegin += messageLength;
+
+    return NetworkLib::Status();
+}
+
+void MessageFramer::reset() {
+    mBuffer = NetworkLib::BufferWritableView();
+    mBegin = 0;
+    mEnd = 0;
+}
+
+} // namespace Agent
+} // namespace Empower
@@ -0,0 +1,57 @@
+#include <empoweragentproto/messagetemplate.hh>
+
+#include <sstream>
+
+namespace Empower {
+namespace Agent {
+
+MessageTemplate::MessageTemplate(const NetworkLib::BufferView &message)
+    : mMessage(message) {
+    CommonHeaderDecoder header(mMessage);
+
+    if (header.totalLengthBytes() != mMessage.size()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": message length is "
+            << header.totalLengthBytes() << ", but the buffer size is "
+            << mMessage.size();
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mIndex.build(mMessage, header.size());
+}
+
+std::size_t MessageTemplate::findEntry(TLVType type, std::size_t length,
+                                       std::size_t n) const {
+    std::size_t i = mIndex.find(type);
+
+    for (std::size_t k = 0; k < n && i != TLVIndex::npos; ++k) {
+        i = mIndex.findNext(i);
+    }
+
+    if (i == TLVIndex::npos) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": no TLV of type " << type
+            << " at position " << n << " in the message";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    if (mIndex[i].length != length) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": TLV of type " << type
+            << " has length " << mIndex[i].length << ", expected "
+            << length;
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    return i;
+}
+
+NetworkLib::BufferWritableView
+MessageTemplate::instantiate(NetworkLib::BufferWritableView buffer) const {
+    mMessage.copyTo(buffer);
+    buffer.shrinkTo(mMessage.size());
+    return buffer;
+}
+
+} // namespace Agent
+} // namespace Empower
@@ -0,0 +1,263 @@
+#include <empoweragentproto/metrics.hh>
+
+#include <algorithm>
+#include <mutex>
+
+namespace Empower {
+namespace NetworkLib {
+
+const char *counterName(Counter c) {
+    switch (c) {
+    case Counter::BYTES_READ:
+        return "bytes_read";
+    case Counter::BYTES_WRITTEN:
+        return "bytes_written";
+    case Counter::MESSAGES_READ:
+        return "messages_read";
+    case Counter::MESSAGES_WRITTEN:
+        return "messages_written";
+    case Counter::READ_WOULD_BLOCK:
+        return "read_would_block";
+    case Counter::WRITE_WOULD_BLOCK:
+        return "write_would_block";
+    case Counter::CONNECT_ATTEMPTS:
+        return "connect_attempts";
+    case Counter::CONNECT_FAILURES:
+        return "connect_failures";
+    case Counter::CONNECTIONS_ACCEPTED:
+        return "connections_accepted";
+    case Counter::POOL_GROWTHS:
+        return "pool_growths";
+    case Counter::POOL_BUFFERS_ADDED:
+        return "pool_buffers_added";
+    case Counter::COUNT:
+        break;
+    }
+
+    return "unknown";
+}
+
+const char *timerName(Timer t) {
+    switch (t) {
+    case Timer::TLV_ENCODE:
+        return "tlv_encode";
+    case Timer::TLV_DECODE:
+        return "tlv_decode";
+    case Timer::COUNT:
+        break;
+    }
+
+    return "unknown";
+}
+
+/**********************************************************************/
+
+void LatencyHistogram::merge(const LatencyHistogram &other) noexcept {
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+        mBuckets[i] += other.mBuckets[i];
+    }
+
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMax = std::max(mMax, other.mMax);
+}
+
+std::uint64_t LatencyHistogram::percentile(double fraction) const noexcept {
+    if (mCount == 0) {
+        return 0;
+    }
+
+    // The rank (1-based) of the wanted duration
+    const double wanted = std::max(1.0, fraction * mCount);
+    std::uint64_t seen = 0;
+
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+        seen += mBuckets[i];
+
+        if (seen >= wanted) {
+            if (i == bucketCount - 1) {
+                return mMax;
+            }
+
+            return std::min(mMax, bucketLowerBound(i + 1) - 1);
+        }
+    }
+
+    return mMax;
+}
+
+/**********************************************************************/
+
+MetricsSnapshot::MetricsSnapshot()
+    : mTimers(static_cast<std::size_t>(Timer::COUNT) * timerKeys) {}
+
+/**********************************************************************/
+
+#if NETWORKLIB_HAS_METRICS
+
+namespace {
+
+const std::size_t counterCount = static_cast<std::size_t>(Counter::COUNT);
+const std::size_t histogramCount =
+    static_cast<std::size_t>(Timer::COUNT) * MetricsSnapshot::timerKeys;
+
+// Increment a value only written by the calling thread.
+inline void bump(std::atomic<std::uint64_t> &value, std::uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+// A histogram of a thread (read concurrently by Metrics::snapshot()).
+struct ThreadHistogram {
+    std::atomic<std::uint64_t> buckets[LatencyHistogram::bucketCount];
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+
+    ThreadHistogram() {
+        for (auto &bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(std::uint64_t nsec) {
+        bump(buckets[LatencyHistogram::bucketOf(nsec)], 1);
+        bump(count, 1);
+        bump(sum, nsec);
+
+        if (nsec > max.load(std::memory_order_relaxed)) {
+            max.store(nsec, std::memory_order_relaxed);
+        }
+    }
+};
+
+} // namespace
+
+// The metrics of a thread, registered while the thread is alive.
+struct Metrics::ThreadMetrics {
+    std::atomic<std::uint64_t> counters[counterCount];
+
+    // Allocated on the first duration recorded by the thread (see
+    // Metrics::timing()).
+    std::atomic<ThreadHistogram *> histograms{nullptr};
+
+    ThreadMetrics();
+    ~ThreadMetrics();
+};
+
+namespace {
+
+// All the live ThreadMetrics, and the sum of the terminated ones.
+struct Registry {
+    std::mutex mutex;
+    std::vector<const Metrics::ThreadMetrics *> threads;
+    MetricsSnapshot retired;
+};
+
+// Never destroyed, as threads may terminate after static destructors.
+Registry &registry() {
+    static Registry *r = new Registry;
+    return *r;
+}
+
+thread_local Metrics::ThreadMetrics tThreadMetrics;
+
+} // namespace
+
+Metrics::ThreadMetrics::ThreadMetrics() {
+    for (auto &counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(this);
+}
+
+Metrics::ThreadMetrics::~ThreadMetrics() {
+    Registry &r = registry();
+
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        accumulate(r.retired, *this);
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+    }
+
+    delete[] histograms.load(std::memory_order_relaxed);
+}
+
+std::atomic<bool> Metrics::sTiming{false};
+
+std::atomic<std::uint64_t> *Metrics::localCounters() noexcept {
+    return tThreadMetrics.counters;
+}
+
+void Metrics::record(Timer t, std::size_t key, std::uint64_t nsec) noexcept {
+    ThreadHistogram *histograms =
+        tThreadMetrics.histograms.load(std::memory_order_relaxed);
+
+    if (histograms == nullptr) {
+        histograms = new ThreadHistogram[histogramCount];
+        tThreadMetrics.histograms.store(histograms, std::memory_order_release);
+    }
+
+    histograms[MetricsSnapshot::histogramIndex(t, key)].record(nsec);
+}
+
+void Metrics::timing(bool v) noexcept {
+    sTiming.store(v, std::memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    MetricsSnapshot result = r.retired;
+
+    for (const ThreadMetrics *thread : r.threads) {
+        accumulate(result, *thread);
+    }
+
+    return result;
+}
+
+void Metrics::accumulate(MetricsSnapshot &snapshot,
+                         const ThreadMetrics &thread) {
+    for (std::size_t i = 0; i < counterCount; ++i) {
+        snapshot.mCounters[i] +=
+            thread.counters[i].load(std::memory_order_relaxed);
+    }
+
+    const ThreadHistogram *histograms =
+        thread.histograms.load(std::memory_order_acquire);
+
+    if (histograms == nullptr) {
+        return;
+    }
+
+    for (std::size_t h = 0; h < histogramCount; ++h) {
+        const ThreadHistogram &from = histograms[h];
+        LatencyHistogram &to = snapshot.mTimers[h];
+
+        for (std::size_t i = 0; i < LatencyHistogram::bucketCount; ++i) {
+            to.mBuckets[i] += from.buckets[i].load(std::memory_order_relaxed);
+        }
+
+        to.mCount += from.count.load(std::memory_order_relaxed);
+        to.mSum += from.sum.load(std::memory_order_relaxed);
+        to.mMax = std::max(to.mMax, from.max.load(std::memory_order_relaxed));
+    }
+}
+
+#else
+
+MetricsSnapshot Metrics::snapshot() { return MetricsSnapshot(); }
+
+void Metrics::record(Timer, std::size_t, std::uint64_t) noexcept {}
+
+void Metrics::timing(bool) noexcept {}
+
+#endif
+
+} // namespace NetworkLib
+} // namespace Empower
@@ -58,6 +58,11 @@ MessageClass CommonHeaderDecoder::messageClass() const {
         // This is a request
         const std::uint8_t op = (tsRc() >> 14);
         switch (op) {
+        case 0:
+            // UNDEFINED (see CommonHeaderEncoder::messageClass())
+            result = MessageClass::REQUEST_GET;
+            break;
+
         case 1:
             result = MessageClass::REQUEST_SET;
             break;
@@ -69,10 +74,6 @@ MessageClass CommonHeaderDecoder::messageClass() const {
         case 3:
             result = MessageClass::REQUEST_DEL;
             break;
-
-        case 4:
-            result = MessageClass::REQUEST_GET;
-            break;
         }
     } else {
         // This is a response.
@@ -86,6 +87,17 @@ MessageClass CommonHeaderDecoder::messageClass() const {
     return result;
 }
 
+CommonHeaderFields CommonHeaderDecoder::fields() const {
+    CommonHeaderFields result;
+    result.messageClass = messageClass();
+    result.entityClass = entityClass();
+    result.sequence = sequence();
+    result.elementId = elementId();
+    result.transactionId = transactionId();
+    result.totalLength = totalLengthBytes();
+    return result;
+}
+
 EntityClass CommonHeaderDecoder::entityClass() const {
 
     // Consider only bits 0-13
@@ -93,24 +105,28 @@ EntityClass CommonHeaderDecoder::entityClass() const {
     return EntityClass(entity);
 }
 
-void CommonHeaderDecoder::throwIfBufferIsUnsuitable(const char *method) {
+NetworkLib::Status
+CommonHeaderDecoder::check(const NetworkLib::BufferView &messageData) noexcept {
     // Catch some quirks early
-    if (mBufferView.size() < 24) {
-        std::ostringstream err;
-        err << method
-            << ": called with "
-               "BufferView.size() == "
-            << mBufferView.size() << " (min size is "
-            << CommonHeader::totalLength << ')';;
-        throw std::length_error(err.str());
+    if (messageData.size() < CommonHeader::totalLength) {
+        return NetworkLib::ErrorCode::MESSAGE_TOO_SHORT;
     }
 
-    if (version() != 2) {
-        std::ostringstream err;
-        err << method << ": wrong version (version is " << +(version())
-            << ", should be 2)";
-        throw std::runtime_error(err.str());
+    // Bounds checked just above
+    if (messageData.getUint8At_nocheck(CommonHeader::versionOffset) != 2) {
+        return NetworkLib::ErrorCode::BAD_VERSION;
     }
+
+    return NetworkLib::Status();
+}
+
+void CommonHeaderDecoder::throwIfBufferIsUnsuitable(const char *method) {
+    check(mBufferView).raise(method);
+}
+
+void CommonHeaderDecoder::reset(const NetworkLib::BufferView &messageData) {
+    check(messageData).raise(NETWORKLIB_CURRENT_FUNCTION);
+    mBufferView = messageData;
 }
 
 /****/
@@ -166,27 +182,34 @@ CommonHeaderEncoder::messageClass(MessageClass messageClass) {
         std::ostringstream err;
         err << NETWORKLIB_CURRENT_FUNCTION
             << ": called with invalid message class";
-        throw std::invalid_argument(err.str());
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
     } break;
 
+    // Operation types as in Preamble::ts_rc
     case MessageClass::REQUEST_SET:
+        // UPDATE
         isRequest = true;
-        highBits = 0;
+        highBits = 1;
         break;
 
     case MessageClass::REQUEST_ADD:
+        // CREATE
         isRequest = true;
-        highBits = 1;
+        highBits = 2;
         break;
 
     case MessageClass::REQUEST_DEL:
+        // DELETE
         isRequest = true;
-        highBits = 2;
+        highBits = 3;
         break;
 
     case MessageClass::REQUEST_GET:
+        // RETRIEVE (4) doesn't fit in bits 14-15: these go out as
+        // UNDEFINED, which is what the retrieving requests of the
+        // services (e.g. HELLO, CAPABILITIES) use anyway.
         isRequest = true;
-        highBits = 3;
+        highBits = 0;
         break;
 
     case MessageClass::RESPONSE_SUCCESS:
@@ -230,17 +253,24 @@ CommonHeaderEncoder &CommonHeaderEncoder::entityClass(EntityClass entityClass) {
     return *this;
 }
 
-void CommonHeaderEncoder::throwIfBufferIsUnsuitable(const char *method) {
+NetworkLib::Status CommonHeaderEncoder::check(
+    const NetworkLib::BufferWritableView &buffer) noexcept {
     // Catch some quirks early
-    if (mBufferWritableView.size() < CommonHeader::totalLength) {
-        std::ostringstream err;
-        err << method
-            << ": called with "
-               "BufferWritableView.size() == "
-            << mBufferWritableView.size() << " (min size is "
-            << CommonHeader::totalLength << ')';
-        throw std::length_error(err.str());
+    if (buffer.size() < CommonHeader::totalLength) {
+        return NetworkLib::ErrorCode::MESSAGE_TOO_SHORT;
     }
+
+    return NetworkLib::Status();
+}
+
+void CommonHeaderEncoder::throwIfBufferIsUnsuitable(const char *method) {
+    check(mBufferWritableView).raise(method);
+}
+
+void CommonHeaderEncoder::reset(const NetworkLib::BufferWritableView &buffer) {
+    check(buffer).raise(NETWORKLIB_CURRENT_FUNCTION);
+    mBufferWritableView = buffer;
+    setDefaults();
 }
 
 CommonHeaderEncoder &CommonHeaderEncoder::sequence(std::uint32_t v) {
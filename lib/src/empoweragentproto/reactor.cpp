@@ -0,0 +1,381 @@
+#include <empoweragentproto/reactor.hh>
+
+// For close(2)
+#include <unistd.h>
+
+// For fcntl(2)
+#include <fcntl.h>
+
+#if defined(__linux__)
+// For epoll_create1(2) and such
+#include <sys/epoll.h>
+
+// For eventfd(2)
+#include <sys/eventfd.h>
+#endif
+
+// For std::strerror()
+#include <cstring>
+
+#include <algorithm>
+
+namespace Empower {
+namespace Agent {
+
+Reactor::Backend Reactor::defaultBackend() {
+#if defined(__linux__)
+    return Backend::EPOLL;
+#else
+    return Backend::POLL;
+#endif
+}
+
+Reactor::Reactor(Backend backend) : mBackend(backend) {
+#if defined(__linux__)
+    if (mBackend == Backend::EPOLL) {
+        mEpollFD = epoll_create1(EPOLL_CLOEXEC);
+
+        if (mEpollFD == -1) {
+            int savedErrno = errno;
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": call to epoll_create1(2) failed "
+                << " (errno =" << savedErrno << ": "
+                << std::strerror(savedErrno) << ')';
+            NETWORKLIB_THROW(std::runtime_error, err.str());
+        }
+    }
+#else
+    // No epoll(7) here: silently fall back to poll(2)
+    mBackend = Backend::POLL;
+#endif
+}
+
+Reactor::~Reactor() {
+    if (mEpollFD != -1) {
+        close(mEpollFD);
+        mEpollFD = -1;
+    }
+}
+
+std::vector<Reactor::Event>::iterator Reactor::findRegistered(int fd) {
+    return std::find_if(mRegistered.begin(), mRegistered.end(),
+                        [fd](const Event &e) { return e.fd == fd; });
+}
+
+std::vector<Reactor::Event>::const_iterator
+Reactor::findRegistered(int fd) const {
+    return std::find_if(mRegistered.begin(), mRegistered.end(),
+                        [fd](const Event &e) { return e.fd == fd; });
+}
+
+bool Reactor::isRegistered(int fd) const {
+    return findRegistered(fd) != mRegistered.end();
+}
+
+#if defined(__linux__)
+static std::uint32_t toEpollEvents(unsigned events) {
+    std::uint32_t result = 0;
+
+    if (events & Reactor::READABLE) {
+        result |= EPOLLIN;
+    }
+
+    if (events & Reactor::WRITABLE) {
+        result |= EPOLLOUT;
+    }
+
+    return result;
+}
+#endif
+
+static short toPollEvents(unsigned events) {
+    short result = 0;
+
+    if (events & Reactor::READABLE) {
+        result |= POLLIN;
+    }
+
+    if (events & Reactor::WRITABLE) {
+        result |= POLLOUT;
+    }
+
+    return result;
+}
+
+void Reactor::add(int fd, unsigned events) {
+    if (isRegistered(fd)) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": fd " << fd
+            << " is already registered";
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+#if defined(__linux__)
+    if (mBackend == Backend::EPOLL) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = toEpollEvents(events);
+        ev.data.fd = fd;
+
+        if (epoll_ctl(mEpollFD, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            int savedErrno = errno;
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": call to epoll_ctl(2) failed for fd " << fd
+                << " (errno =" << savedErrno << ": "
+                << std::strerror(savedErrno) << ')';
+            NETWORKLIB_THROW(std::runtime_error, err.str());
+        }
+    }
+#endif
+
+    if (mBackend == Backend::POLL) {
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = toPollEvents(events);
+        pfd.revents = 0;
+        mPollFDs.push_back(pfd);
+    }
+
+    mRegistered.push_back(Event{fd, events});
+}
+
+void Reactor::modify(int fd, unsigned events) {
+    auto it = findRegistered(fd);
+
+    if (it == mRegistered.end()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": fd " << fd
+            << " is not registered";
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    if (it->events == events) {
+        // Nothing to do (and we save a system call).
+        return;
+    }
+
+#if defined(__linux__)
+    if (mBackend == Backend::EPOLL) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = toEpollEvents(events);
+        ev.data.fd = fd;
+
+        if (epoll_ctl(mEpollFD, EPOLL_CTL_MOD, fd, &ev) == -1) {
+            int savedErrno = errno;
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": call to epoll_ctl(2) failed for fd " << fd
+                << " (errno =" << savedErrno << ": "
+                << std::strerror(savedErrno) << ')';
+            NETWORKLIB_THROW(std::runtime_error, err.str());
+        }
+    }
+#endif
+
+    if (mBackend == Backend::POLL) {
+        for (auto &pfd : mPollFDs) {
+            if (pfd.fd == fd) {
+                pfd.events = toPollEvents(events);
+            }
+        }
+    }
+
+    it->events = events;
+}
+
+void Reactor::remove(int fd) noexcept {
+    auto it = findRegistered(fd);
+
+    if (it == mRegistered.end()) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (mBackend == Backend::EPOLL) {
+        // Note: a non-NULL event is required by kernels before 2.6.9.
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        epoll_ctl(mEpollFD, EPOLL_CTL_DEL, fd, &ev);
+    }
+#endif
+
+    if (mBackend == Backend::POLL) {
+        mPollFDs.erase(std::remove_if(mPollFDs.begin(), mPollFDs.end(),
+                                      [fd](const pollfd &p) {
+                                          return p.fd == fd;
+                                      }),
+                       mPollFDs.end());
+    }
+
+    mRegistered.erase(it);
+}
+
+std::size_t Reactor::wait(int timeoutMsec, std::vector<Event> &events) {
+    events.clear();
+
+#if defined(__linux__)
+    if (mBackend == Backend::EPOLL) {
+        // Always ask for room for all the registered fds (plus one,
+        // as epoll_wait(2) refuses a maxevents of 0).
+        static const std::size_t maxEventsPerCall = 64;
+        epoll_event epollEvents[maxEventsPerCall];
+        const int maxEvents = static_cast<int>(
+            std::min(maxEventsPerCall, mRegistered.size() + 1));
+
+        int rc = epoll_wait(mEpollFD, epollEvents, maxEvents, timeoutMsec);
+
+        if (rc == -1) {
+            int savedErrno = errno;
+
+            if (savedErrno == EINTR) {
+                // Interrupted by a signal: just report no events
+                return 0;
+            }
+
+            std::ostringstream err;
+            err << NETWORKLIB_CURRENT_FUNCTION
+                << ": call to epoll_wait(2) failed "
+                << " (errno =" << savedErrno << ": "
+                << std::strerror(savedErrno) << ')';
+            NETWORKLIB_THROW(std::runtime_error, err.str());
+        }
+
+        for (int i = 0; i < rc; ++i) {
+            unsigned e = 0;
+
+            if (epollEvents[i].events & EPOLLIN) {
+                e |= READABLE;
+            }
+
+            if (epollEvents[i].events & EPOLLOUT) {
+                e |= WRITABLE;
+            }
+
+            if (epollEvents[i].events & (EPOLLERR | EPOLLHUP)) {
+                e |= FAILED;
+            }
+
+            events.push_back(Event{epollEvents[i].data.fd, e});
+        }
+
+        return events.size();
+    }
+#endif
+
+    int rc = poll(mPollFDs.data(), mPollFDs.size(), timeoutMsec);
+
+    if (rc == -1) {
+        int savedErrno = errno;
+
+        if (savedErrno == EINTR) {
+            // Interrupted by a signal: just report no events
+            return 0;
+        }
+
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": call to poll(2) failed "
+            << " (errno =" << savedErrno << ": " << std::strerror(savedErrno)
+            << ')';
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    for (auto &pfd : mPollFDs) {
+        if (pfd.revents == 0) {
+            continue;
+        }
+
+        unsigned e = 0;
+
+        if (pfd.revents & POLLIN) {
+            e |= READABLE;
+        }
+
+        if (pfd.revents & POLLOUT) {
+            e |= WRITABLE;
+        }
+
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            e |= FAILED;
+        }
+
+        events.push_back(Event{pfd.fd, e});
+    }
+
+    return events.size();
+}
+
+/****/
+
+Waker::Waker() {
+#if defined(__linux__)
+    mReadFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    mWriteFD = mReadFD;
+
+    if (mReadFD == -1) {
+        int savedErrno = errno;
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION
+            << ": call to eventfd(2) failed "
+            << " (errno =" << savedErrno << ": "
+            << std::strerror(savedErrno) << ')';
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+#else
+    int fds[2];
+
+    if (pipe(fds) == -1) {
+        int savedErrno = errno;
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": call to pipe(2) failed "
+            << " (errno =" << savedErrno << ": "
+            << std::strerror(savedErrno) << ')';
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mReadFD = fds[0];
+    mWriteFD = fds[1];
+
+    // Never block: a full pipe is readable anyway.
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+}
+
+Waker::~Waker() {
+    if (mWriteFD != mReadFD) {
+        close(mWriteFD);
+    }
+
+    close(mReadFD);
+}
+
+void Waker::wake() noexcept {
+#if defined(__linux__)
+    const std::uint64_t one = 1;
+#else
+    const unsigned char one = 1;
+#endif
+
+    // Failing with EAGAIN means the fd is readable already
+    ssize_t result = write(mWriteFD, &one, sizeof(one));
+    (void)result;
+}
+
+void Waker::drain() noexcept {
+    unsigned char buffer[64];
+
+    while (read(mReadFD, buffer, sizeof(buffer)) > 0) {
+#if defined(__linux__)
+        // A single read(2) resets the eventfd(2) counter
+        break;
+#endif
+    }
+}
+
+} // namespace Agent
+} // namespace Empower
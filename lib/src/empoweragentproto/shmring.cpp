@@ -0,0 +1,705 @@
+#include <empoweragentproto/shmring.hh>
+
+#if defined(__linux__)
+
+// For memfd_create(2) and mmap(2)
+#include <sys/mman.h>
+
+// For eventfd(2)
+#include <sys/eventfd.h>
+
+// For fstat(2)
+#include <sys/stat.h>
+
+// For sendmsg(2) and recvmsg(2)
+#include <sys/socket.h>
+
+// For poll(2)
+#include <poll.h>
+
+// For read(2), write(2), ftruncate(2) and close(2)
+#include <unistd.h>
+
+// For fcntl(2)
+#include <fcntl.h>
+
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+
+// For std::strerror() and std::memcpy()
+#include <cstring>
+
+namespace Empower {
+namespace Agent {
+
+#if defined(__linux__)
+
+struct SharedMemoryRing::Shared {
+    std::uint64_t magic;
+    std::uint64_t capacity;
+
+    // Each on its own cache line, so that the producer and the consumer
+    // don't fight over the same one.
+
+    // Where the producer writes the next record
+    alignas(64) std::atomic<std::uint64_t> tail;
+
+    // Where the consumer reads the next record
+    alignas(64) std::atomic<std::uint64_t> head;
+
+    // Set when the consumer waits for data (or the producer for space)
+    alignas(64) std::atomic<std::uint32_t> dataWaiting;
+    alignas(64) std::atomic<std::uint32_t> spaceWaiting;
+};
+
+namespace {
+
+// "EMPWRING", version 1
+const std::uint64_t ringMagic = 0x454d505752494e01ULL;
+
+// Where the records start in the shared memory
+const std::size_t dataOffset = 4096;
+
+// So that any message (see MessageFramer) fits
+const std::size_t minCapacity = 128 * 1024;
+
+// Each record is a header, and then the message (padded to 8 bytes).
+struct RecordHeader {
+    std::uint32_t size;
+    std::uint32_t flags;
+};
+
+// The size of a record telling the consumer to go on at the start of
+// the ring.
+const std::uint32_t wrapMarker = 0xffffffff;
+
+std::size_t recordSize(std::size_t size) {
+    return sizeof(RecordHeader) + ((size + 7) & ~std::size_t(7));
+}
+
+[[noreturn]] void throwSystemError(const char *method, const char *what,
+                                   int savedErrno) {
+    std::ostringstream err;
+    err << method << ": " << what << " (errno =" << savedErrno << ": "
+        << std::strerror(savedErrno) << ')';
+    NETWORKLIB_THROW(std::runtime_error, err.str());
+}
+
+// Wake up the other side.
+void signal(int fd) noexcept {
+    std::uint64_t one = 1;
+    ssize_t r;
+
+    do {
+        r = write(fd, &one, sizeof(one));
+    } while (r == -1 && errno == EINTR);
+}
+
+// Clear the signals on an eventfd (which is non-blocking).
+void drain(int fd) noexcept {
+    std::uint64_t count;
+    ssize_t r;
+
+    do {
+        r = read(fd, &count, sizeof(count));
+    } while (r == -1 && errno == EINTR);
+}
+
+// Wait for the file descriptor to become readable, until the deadline
+// (if any).
+bool waitReadable(int fd, bool forever,
+                  std::chrono::steady_clock::time_point deadline) {
+    for (;;) {
+        int timeoutMsec = -1;
+
+        if (!forever) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            timeoutMsec = left.count() > 0 ? static_cast<int>(left.count()) : 0;
+        }
+
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int r = poll(&pfd, 1, timeoutMsec);
+
+        if (r > 0) {
+            return true;
+        }
+
+        if (r == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+} // namespace
+
+SharedMemoryRing::SharedMemoryRing(std::size_t capacity) {
+    const char *method = NETWORKLIB_CURRENT_FUNCTION;
+
+    mCapacity = minCapacity;
+
+    while (mCapacity < capacity) {
+        mCapacity <<= 1;
+    }
+
+    mMemoryFD = memfd_create("empower-agent-ring", MFD_CLOEXEC);
+
+    if (mMemoryFD == -1) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "call to memfd_create(2) failed",
+                         savedErrno);
+    }
+
+    if (ftruncate(mMemoryFD, static_cast<off_t>(dataOffset + mCapacity)) ==
+        -1) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "call to ftruncate(2) failed", savedErrno);
+    }
+
+    mDataFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    mSpaceFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (mDataFD == -1 || mSpaceFD == -1) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "call to eventfd(2) failed", savedErrno);
+    }
+
+    map(true, method);
+}
+
+SharedMemoryRing::SharedMemoryRing(const Descriptors &descriptors) {
+    const char *method = NETWORKLIB_CURRENT_FUNCTION;
+
+    mMemoryFD = fcntl(descriptors.memory, F_DUPFD_CLOEXEC, 0);
+    mDataFD = fcntl(descriptors.data, F_DUPFD_CLOEXEC, 0);
+    mSpaceFD = fcntl(descriptors.space, F_DUPFD_CLOEXEC, 0);
+
+    if (mMemoryFD == -1 || mDataFD == -1 || mSpaceFD == -1) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "invalid file descriptor", savedErrno);
+    }
+
+    // Both sides rely on the eventfds not to block.
+    int flags = fcntl(mDataFD, F_GETFL, 0);
+
+    if (flags == -1 || (flags & O_NONBLOCK) == 0) {
+        release();
+        std::ostringstream err;
+        err << method << ": not the file descriptors of a ring";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    struct stat info;
+
+    if (fstat(mMemoryFD, &info) == -1) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "call to fstat(2) failed", savedErrno);
+    }
+
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+
+    if (size < dataOffset + minCapacity) {
+        release();
+        std::ostringstream err;
+        err << method << ": not the file descriptors of a ring";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mCapacity = size - dataOffset;
+    map(false, method);
+}
+
+SharedMemoryRing::~SharedMemoryRing() { release(); }
+
+void SharedMemoryRing::map(bool create, const char *method) {
+    mMappedSize = dataOffset + mCapacity;
+
+    void *memory = mmap(nullptr, mMappedSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, mMemoryFD, 0);
+
+    if (memory == MAP_FAILED) {
+        int savedErrno = errno;
+        release();
+        throwSystemError(method, "call to mmap(2) failed", savedErrno);
+    }
+
+    mData = static_cast<unsigned char *>(memory) + dataOffset;
+
+    if (create) {
+        mShared = new (memory) Shared();
+        mShared->magic = ringMagic;
+        mShared->capacity = mCapacity;
+        mShared->tail.store(0);
+        mShared->head.store(0);
+        mShared->dataWaiting.store(0);
+        mShared->spaceWaiting.store(0);
+        return;
+    }
+
+    mShared = static_cast<Shared *>(memory);
+
+    if (mShared->magic != ringMagic || mShared->capacity != mCapacity ||
+        (mCapacity & (mCapacity - 1)) != 0) {
+        release();
+        std::ostringstream err;
+        err << method << ": not the file descriptors of a ring";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    mTail = mCachedTail = mShared->tail.load();
+    mHead = mCachedHead = mShared->head.load();
+}
+
+void SharedMemoryRing::release() noexcept {
+    if (mShared != nullptr) {
+        munmap(mShared, mMappedSize);
+        mShared = nullptr;
+        mData = nullptr;
+    }
+
+    for (int *fd : {&mMemoryFD, &mDataFD, &mSpaceFD}) {
+        if (*fd != -1) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+SharedMemoryRing::Descriptors SharedMemoryRing::descriptors() const {
+    Descriptors result;
+    result.memory = mMemoryFD;
+    result.data = mDataFD;
+    result.space = mSpaceFD;
+    return result;
+}
+
+void SharedMemoryRing::sendDescriptors(int socketFD,
+                                       const Descriptors &descriptors) {
+    const int fds[3] = {descriptors.memory, descriptors.data,
+                        descriptors.space};
+
+    // At least one byte of data must go with the descriptors.
+    unsigned char byte = 0;
+    iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    union {
+        unsigned char buffer[CMSG_SPACE(sizeof(fds))];
+        cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t r;
+
+    do {
+        r = sendmsg(socketFD, &message, MSG_NOSIGNAL);
+    } while (r == -1 && errno == EINTR);
+
+    if (r != 1) {
+        throwSystemError(NETWORKLIB_CURRENT_FUNCTION,
+                         "call to sendmsg(2) failed", r == -1 ? errno : EIO);
+    }
+}
+
+SharedMemoryRing::Descriptors SharedMemoryRing::receiveDescriptors(
+    int socketFD) {
+    const char *method = NETWORKLIB_CURRENT_FUNCTION;
+
+    int fds[3];
+    unsigned char byte;
+    iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    union {
+        unsigned char buffer[CMSG_SPACE(sizeof(fds))];
+        cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t r;
+
+    do {
+        r = recvmsg(socketFD, &message, MSG_CMSG_CLOEXEC);
+    } while (r == -1 && errno == EINTR);
+
+    if (r == -1) {
+        throwSystemError(method, "call to recvmsg(2) failed", errno);
+    }
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+
+    if (r != 1 || cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        // Don't leak whatever came in.
+        if (cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_RIGHTS) {
+            std::size_t count =
+                (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+            for (std::size_t i = 0; i < count && i < 3; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int),
+                            sizeof(int));
+                close(fd);
+            }
+        }
+
+        std::ostringstream err;
+        err << method << ": no ring descriptors received";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    Descriptors result;
+    result.memory = fds[0];
+    result.data = fds[1];
+    result.space = fds[2];
+    return result;
+}
+
+bool SharedMemoryRing::makeRoom(std::size_t record) noexcept {
+    const std::size_t offset = mTail & (mCapacity - 1);
+
+    if (offset + record > mCapacity) {
+        // Skip the end of the ring, as soon as the marker fits.
+        const std::size_t padding = mCapacity - offset;
+
+        if (mTail + padding - mCachedHead > mCapacity) {
+            mCachedHead = mShared->head.load(std::memory_order_acquire);
+
+            if (mTail + padding - mCachedHead > mCapacity) {
+                return false;
+            }
+        }
+
+        RecordHeader marker;
+        marker.size = wrapMarker;
+        marker.flags = 0;
+        std::memcpy(mData + offset, &marker, sizeof(marker));
+        publish(mTail + padding);
+    }
+
+    if (mTail + record - mCachedHead > mCapacity) {
+        mCachedHead = mShared->head.load(std::memory_order_acquire);
+
+        if (mTail + record - mCachedHead > mCapacity) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SharedMemoryRing::publish(std::uint64_t tail) noexcept {
+    mTail = tail;
+
+    // Sequentially consistent, against armDataNotification(): either
+    // the consumer sees the new tail, or we see it waiting.
+    mShared->tail.store(tail);
+
+    if (mShared->dataWaiting.load() != 0 &&
+        mShared->dataWaiting.exchange(0) != 0) {
+        signal(mDataFD);
+    }
+}
+
+void SharedMemoryRing::advance(std::uint64_t head) noexcept {
+    mHead = head;
+
+    // Sequentially consistent, against armSpaceNotification().
+    mShared->head.store(head);
+
+    if (mShared->spaceWaiting.load() != 0 &&
+        mShared->spaceWaiting.exchange(0) != 0) {
+        signal(mSpaceFD);
+    }
+}
+
+NetworkLib::BufferWritableView SharedMemoryRing::reserve(std::size_t size) {
+    if (size == 0 || size > mCapacity - sizeof(RecordHeader)) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": invalid size " << size
+            << " (capacity is " << mCapacity << ')';
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    mHasReservation = false;
+
+    if (!makeRoom(recordSize(size))) {
+        return NetworkLib::BufferWritableView();
+    }
+
+    mReserved = size;
+    mHasReservation = true;
+
+    const std::size_t offset = mTail & (mCapacity - 1);
+    return NetworkLib::BufferWritableView::makeNonOwningBufferWritableView(
+        mData + offset + sizeof(RecordHeader), size);
+}
+
+void SharedMemoryRing::commit(std::size_t size) {
+    if (size == 0) {
+        mHasReservation = false;
+        return;
+    }
+
+    if (!mHasReservation || size > mReserved) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": committing " << size
+            << " bytes, but "
+            << (mHasReservation ? mReserved : std::size_t(0))
+            << " reserved";
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    mHasReservation = false;
+
+    RecordHeader header;
+    header.size = static_cast<std::uint32_t>(size);
+    header.flags = 0;
+    std::memcpy(mData + (mTail & (mCapacity - 1)), &header, sizeof(header));
+    publish(mTail + recordSize(size));
+}
+
+bool SharedMemoryRing::tryWrite(const NetworkLib::BufferView &message) {
+    auto space = reserve(message.size());
+
+    if (!mHasReservation) {
+        return false;
+    }
+
+    std::memcpy(space.getUnderlyingWritableBufferPtr(),
+                message.getUnderlyingBufferPtr(), message.size());
+    commit(message.size());
+    return true;
+}
+
+bool SharedMemoryRing::armSpaceNotification(std::size_t size) noexcept {
+    drain(mSpaceFD);
+    mShared->spaceWaiting.store(1);
+
+    // Sequentially consistent, against advance().
+    mCachedHead = mShared->head.load();
+    return !makeRoom(recordSize(size));
+}
+
+bool SharedMemoryRing::waitForSpace(std::size_t size, int timeoutMsec) {
+    if (size == 0 || size > mCapacity - sizeof(RecordHeader)) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": invalid size " << size
+            << " (capacity is " << mCapacity << ')';
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(timeoutMsec);
+
+    while (armSpaceNotification(size)) {
+        if (!waitReadable(mSpaceFD, timeoutMsec < 0, deadline)) {
+            return makeRoom(recordSize(size));
+        }
+    }
+
+    return true;
+}
+
+NetworkLib::BufferView SharedMemoryRing::front() {
+    for (;;) {
+        if (mCorrupted) {
+            return NetworkLib::BufferView();
+        }
+
+        if (mHead == mCachedTail) {
+            mCachedTail = mShared->tail.load(std::memory_order_acquire);
+
+            if (mHead == mCachedTail) {
+                return NetworkLib::BufferView();
+            }
+        }
+
+        // The tail and the records come from the producer: don't trust
+        // them to stay within the ring.
+        const std::uint64_t available = mCachedTail - mHead;
+        const std::size_t offset = mHead & (mCapacity - 1);
+
+        if (available > mCapacity || available < sizeof(RecordHeader)) {
+            mCorrupted = true;
+            continue;
+        }
+
+        RecordHeader header;
+        std::memcpy(&header, mData + offset, sizeof(header));
+
+        if (header.size == wrapMarker) {
+            if (available < mCapacity - offset) {
+                mCorrupted = true;
+                continue;
+            }
+
+            advance(mHead + (mCapacity - offset));
+            continue;
+        }
+
+        const std::size_t record = recordSize(header.size);
+
+        if (record > mCapacity - offset || record > available) {
+            mCorrupted = true;
+            continue;
+        }
+
+        mFrontRecord = record;
+        return NetworkLib::BufferView::makeNonOwningBufferView(
+            mData + offset + sizeof(RecordHeader), header.size);
+    }
+}
+
+void SharedMemoryRing::pop() {
+    if (mFrontRecord == 0 && front().empty()) {
+        return;
+    }
+
+    const std::size_t record = mFrontRecord;
+    mFrontRecord = 0;
+    advance(mHead + record);
+}
+
+bool SharedMemoryRing::empty() { return front().empty(); }
+
+bool SharedMemoryRing::armDataNotification() noexcept {
+    if (mCorrupted) {
+        // Nothing more will be handed out.
+        return true;
+    }
+
+    drain(mDataFD);
+    mShared->dataWaiting.store(1);
+
+    // Sequentially consistent, against publish().
+    mCachedTail = mShared->tail.load();
+    return mHead == mCachedTail;
+}
+
+bool SharedMemoryRing::waitForData(int timeoutMsec) {
+    if (mCorrupted) {
+        return false;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(timeoutMsec);
+
+    while (empty() && armDataNotification()) {
+        if (!waitReadable(mDataFD, timeoutMsec < 0, deadline)) {
+            return !empty();
+        }
+    }
+
+    return true;
+}
+
+#else // !defined(__linux__)
+
+struct SharedMemoryRing::Shared {};
+
+namespace {
+
+[[noreturn]] void throwUnsupported(const char *method) {
+    std::ostringstream err;
+    err << method << ": shared memory rings need Linux";
+    NETWORKLIB_THROW(std::runtime_error, err.str());
+}
+
+} // namespace
+
+SharedMemoryRing::SharedMemoryRing(std::size_t) {
+    throwUnsupported(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+SharedMemoryRing::SharedMemoryRing(const Descriptors &) {
+    throwUnsupported(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+SharedMemoryRing::~SharedMemoryRing() {}
+
+// Unreachable: no instance can be constructed.
+
+SharedMemoryRing::Descriptors SharedMemoryRing::descriptors() const {
+    return Descriptors();
+}
+
+void SharedMemoryRing::sendDescriptors(int, const Descriptors &) {
+    throwUnsupported(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+SharedMemoryRing::Descriptors SharedMemoryRing::receiveDescriptors(int) {
+    throwUnsupported(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::BufferWritableView SharedMemoryRing::reserve(std::size_t) {
+    return NetworkLib::BufferWritableView();
+}
+
+void SharedMemoryRing::commit(std::size_t) {}
+
+bool SharedMemoryRing::tryWrite(const NetworkLib::BufferView &) {
+    return false;
+}
+
+bool SharedMemoryRing::waitForSpace(std::size_t, int) { return false; }
+
+bool SharedMemoryRing::armSpaceNotification(std::size_t) noexcept {
+    return false;
+}
+
+NetworkLib::BufferView SharedMemoryRing::front() {
+    return NetworkLib::BufferView();
+}
+
+void SharedMemoryRing::pop() {}
+
+bool SharedMemoryRing::empty() { return true; }
+
+bool SharedMemoryRing::waitForData(int) { return false; }
+
+bool SharedMemoryRing::armDataNotification() noexcept { return false; }
+
+#endif
+
+} // namespace Agent
+} // namespace Empower
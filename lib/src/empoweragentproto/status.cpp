@@ -0,0 +1,75 @@
+#include <empoweragentproto/status.hh>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace Empower {
+namespace NetworkLib {
+
+const char *Status::message() const noexcept {
+    switch (mCode) {
+    case ErrorCode::OK:
+        return "no error";
+    case ErrorCode::OUT_OF_BOUNDS:
+        return "requested area out of bounds";
+    case ErrorCode::MESSAGE_TOO_SHORT:
+        return "message shorter than the common header";
+    case ErrorCode::BAD_VERSION:
+        return "wrong protocol version";
+    case ErrorCode::BAD_MESSAGE_LENGTH:
+        return "bad message length";
+    case ErrorCode::BAD_TLV_LENGTH:
+        return "bad TLV length";
+    case ErrorCode::TLV_TYPE_MISMATCH:
+        return "unexpected TLV type";
+    case ErrorCode::TLV_LENGTH_MISMATCH:
+        return "unexpected TLV length";
+    case ErrorCode::TOO_MANY_TLVS:
+        return "too many TLVs";
+    case ErrorCode::BUFFER_TOO_SMALL:
+        return "buffer too small";
+    case ErrorCode::NO_CONNECTION:
+        return "no connection";
+    case ErrorCode::INVALID_ARGUMENT:
+        return "invalid argument";
+    case ErrorCode::SYSTEM_ERROR:
+        return "system error";
+    case ErrorCode::UNSUPPORTED:
+        return "operation not supported";
+    case ErrorCode::TIMED_OUT:
+        return "timed out";
+    }
+
+    return "unknown error";
+}
+
+std::ostream &operator<<(std::ostream &ostr, const Status &status) {
+    ostr << status.message();
+
+    if (status.code() == ErrorCode::SYSTEM_ERROR) {
+        ostr << " (errno = " << status.sysErrno() << ": "
+             << std::strerror(status.sysErrno()) << ')';
+    }
+
+    return ostr;
+}
+
+void Status::raiseError(const char *function) const {
+    std::ostringstream err;
+    err << function << ": " << *this;
+
+    switch (mCode) {
+    case ErrorCode::OUT_OF_BOUNDS:
+        NETWORKLIB_THROW(std::out_of_range, err.str());
+    case ErrorCode::MESSAGE_TOO_SHORT:
+        NETWORKLIB_THROW(std::length_error, err.str());
+    case ErrorCode::INVALID_ARGUMENT:
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    default:
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+}
+
+} // namespace NetworkLib
+} // namespace Empower
@@ -0,0 +1,337 @@
+#include <empoweragentproto/timerwheel.hh>
+
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+
+namespace Empower {
+namespace Agent {
+
+const TimerWheel::TimerId TimerWheel::noTimer;
+const std::uint32_t TimerWheel::nil;
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick,
+                       Clock::time_point start)
+    : mTick{tick}, mStart{start} {
+    if (tick.count() < 1) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": invalid tick of "
+            << tick.count() << " ms";
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
+    }
+
+    mSlots.fill(nil);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(std::chrono::milliseconds delay,
+                                         std::uint64_t key,
+                                         Callback callback) {
+    return add(ticksFromNow(delay), 0, key, std::move(callback));
+}
+
+TimerWheel::TimerId
+TimerWheel::schedulePeriodic(std::chrono::milliseconds period,
+                             std::uint64_t key, Callback callback) {
+    return add(ticksFromNow(period), ticksOf(period), key,
+               std::move(callback));
+}
+
+bool TimerWheel::cancel(TimerId id) noexcept {
+    if (find(id) == nullptr) {
+        return false;
+    }
+
+    const auto index = static_cast<std::uint32_t>(id) - 1;
+    unlink(index);
+    release(index);
+    return true;
+}
+
+bool TimerWheel::scheduled(TimerId id) const noexcept {
+    return const_cast<TimerWheel *>(this)->find(id) != nullptr;
+}
+
+std::size_t TimerWheel::advance(Clock::time_point now) {
+    const std::uint64_t target = tickAt(now);
+
+    if (target <= mNow) {
+        return 0;
+    }
+
+    std::size_t result = 0;
+    mTarget = target;
+
+    while (mNow < target && mSize != 0) {
+        ++mNow;
+
+        // Every 256 ticks, move the jobs of the next slot of level 1
+        // down (and so on for the higher levels).
+        for (std::size_t level = 1; level < levels; ++level) {
+            if (((mNow >> (slotBits * (level - 1))) & (slotsPerLevel - 1)) !=
+                0) {
+                break;
+            }
+
+            cascade(level);
+        }
+
+        result += expire();
+    }
+
+    // Nothing left to move between levels: skip the idle ticks.
+    mNow = target;
+    return result;
+}
+
+int TimerWheel::timeoutMsec(Clock::time_point now) const {
+    if (mSize == 0) {
+        return -1;
+    }
+
+    // The next move between levels, if there's anything to move
+    std::uint64_t next = UINT64_MAX;
+
+    for (std::size_t level = 1; level < levels; ++level) {
+        for (std::uint64_t word : mOccupied[level]) {
+            if (word != 0) {
+                next = (mNow | (slotsPerLevel - 1)) + 1;
+                break;
+            }
+        }
+    }
+
+    // The first non-empty slot of level 0
+    for (std::uint64_t tick = mNow + 1; tick < mNow + slotsPerLevel;
+         ++tick) {
+        const std::size_t slot = tick & (slotsPerLevel - 1);
+
+        if (mOccupied[0][slot / 64] & (std::uint64_t(1) << (slot % 64))) {
+            next = std::min(next, tick);
+            break;
+        }
+    }
+
+    const auto deadline =
+        mStart + mTick * static_cast<std::chrono::milliseconds::rep>(next);
+
+    if (deadline <= now) {
+        return 0;
+    }
+
+    // Round up, so we don't wake up too early.
+    const auto left = deadline - now;
+    auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(left);
+
+    if (msec < left) {
+        msec += std::chrono::milliseconds(1);
+    }
+
+    return msec.count() < INT_MAX ? static_cast<int>(msec.count()) : INT_MAX;
+}
+
+std::uint64_t TimerWheel::ticksOf(std::chrono::milliseconds d) const {
+    if (d <= mTick) {
+        return 1;
+    }
+
+    return static_cast<std::uint64_t>((d.count() + mTick.count() - 1) /
+                                      mTick.count());
+}
+
+std::uint64_t TimerWheel::ticksFromNow(std::chrono::milliseconds d) const {
+    // The first tick at or after now + d, so that jobs never run
+    // early, even if advance() hasn't been called for a while.
+    const auto elapsed = Clock::now() - mStart;
+    const auto tickNsec =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(mTick).count();
+    const auto when =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed + d)
+            .count();
+    const std::uint64_t expiry =
+        when <= 0 ? 0
+                  : static_cast<std::uint64_t>((when + tickNsec - 1) /
+                                               tickNsec);
+
+    return expiry > mNow ? expiry - mNow : 1;
+}
+
+std::uint64_t TimerWheel::tickAt(Clock::time_point t) const {
+    if (t <= mStart) {
+        return 0;
+    }
+
+    return static_cast<std::uint64_t>((t - mStart) / mTick);
+}
+
+TimerWheel::TimerId TimerWheel::add(std::uint64_t ticks, std::uint64_t period,
+                                    std::uint64_t key, Callback &&callback) {
+    std::uint32_t index = mFreeList;
+
+    if (index == nil) {
+        index = static_cast<std::uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    } else {
+        mFreeList = mNodes[index].next;
+    }
+
+    Node &node = mNodes[index];
+    node.callback = std::move(callback);
+    node.key = key;
+    node.expiry = mNow + ticks;
+    node.period = period;
+    node.active = true;
+
+    link(index);
+    ++mSize;
+
+    return idOf(index);
+}
+
+TimerWheel::Node *TimerWheel::find(TimerId id) noexcept {
+    const auto low = static_cast<std::uint32_t>(id);
+
+    if (low == 0 || low > mNodes.size()) {
+        return nullptr;
+    }
+
+    Node &node = mNodes[low - 1];
+
+    if (!node.active ||
+        node.generation != static_cast<std::uint32_t>(id >> 32)) {
+        return nullptr;
+    }
+
+    return &node;
+}
+
+void TimerWheel::link(std::uint32_t index) noexcept {
+    Node &node = mNodes[index];
+    const std::uint64_t diff = node.expiry - mNow;
+
+    std::size_t level = 0;
+    std::uint64_t slotTick = node.expiry;
+
+    while (level < levels - 1 &&
+           diff >= (std::uint64_t(1) << (slotBits * (level + 1)))) {
+        ++level;
+    }
+
+    if (level == levels - 1 &&
+        diff >= (std::uint64_t(1) << (slotBits * levels))) {
+        // Too far away: park it in the farthest slot (it moves back
+        // there until it gets close enough).
+        slotTick = mNow + ((slotsPerLevel - 1) << (slotBits * level));
+    }
+
+    const std::size_t slotIndex =
+        (slotTick >> (slotBits * level)) & (slotsPerLevel - 1);
+    const std::uint32_t slot =
+        static_cast<std::uint32_t>(level * slotsPerLevel + slotIndex);
+
+    node.slot = static_cast<std::uint16_t>(slot);
+    node.prev = nil;
+    node.next = mSlots[slot];
+
+    if (node.next != nil) {
+        mNodes[node.next].prev = index;
+    }
+
+    mSlots[slot] = index;
+    mOccupied[level][slotIndex / 64] |= std::uint64_t(1) << (slotIndex % 64);
+}
+
+void TimerWheel::unlink(std::uint32_t index) noexcept {
+    Node &node = mNodes[index];
+
+    if (node.prev == nil) {
+        mSlots[node.slot] = node.next;
+    } else {
+        mNodes[node.prev].next = node.next;
+    }
+
+    if (node.next != nil) {
+        mNodes[node.next].prev = node.prev;
+    }
+
+    if (mSlots[node.slot] == nil) {
+        const std::size_t level = node.slot / slotsPerLevel;
+        const std::size_t slotIndex = node.slot % slotsPerLevel;
+        mOccupied[level][slotIndex / 64] &=
+            ~(std::uint64_t(1) << (slotIndex % 64));
+    }
+}
+
+void TimerWheel::release(std::uint32_t index) noexcept {
+    Node &node = mNodes[index];
+    node.callback = nullptr;
+    node.active = false;
+    ++node.generation;
+    node.next = mFreeList;
+    mFreeList = index;
+    --mSize;
+}
+
+void TimerWheel::cascade(std::size_t level) noexcept {
+    const std::size_t slotIndex =
+        (mNow >> (slotBits * level)) & (slotsPerLevel - 1);
+    const std::size_t slot = level * slotsPerLevel + slotIndex;
+
+    std::uint32_t index = mSlots[slot];
+    mSlots[slot] = nil;
+    mOccupied[level][slotIndex / 64] &=
+        ~(std::uint64_t(1) << (slotIndex % 64));
+
+    while (index != nil) {
+        const std::uint32_t next = mNodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+std::size_t TimerWheel::expire() {
+    const std::size_t slot = mNow & (slotsPerLevel - 1);
+    std::size_t result = 0;
+
+    // Jobs may cancel or schedule others (possibly in this slot, and
+    // reallocating mNodes): take them one at a time.
+    while (mSlots[slot] != nil) {
+        const std::uint32_t index = mSlots[slot];
+        unlink(index);
+
+        Node &node = mNodes[index];
+        const TimerId id = idOf(index);
+        const std::uint64_t key = node.key;
+        Callback callback = std::move(node.callback);
+        ++result;
+
+        if (node.period == 0) {
+            release(index);
+            callback(id, key);
+            continue;
+        }
+
+        // Keep the phase, but run only once if late.
+        node.expiry += node.period;
+
+        if (node.expiry <= mTarget) {
+            node.expiry +=
+                ((mTarget - node.expiry) / node.period + 1) * node.period;
+        }
+
+        link(index);
+        callback(id, key);
+
+        // Unless the job cancelled itself
+        Node *again = find(id);
+
+        if (again != nullptr) {
+            again->callback = std::move(callback);
+        }
+    }
+
+    return result;
+}
+
+} // namespace Agent
+} // namespace Empower
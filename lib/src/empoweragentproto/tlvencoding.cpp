@@ -3,6 +3,11 @@
 // Just for TLVType::NONE
 #include <empoweragentproto/tlvs.hh>
 
+#include <empoweragentproto/tlvviews.hh>
+
+// For std::bad_alloc
+#include <new>
+
 namespace Empower {
 namespace Agent {
 
@@ -11,29 +16,125 @@ std::ostream &operator<<(std::ostream &ostr, const TLVType &v) {
     return ostr;
 }
 
+/**********************************************************************/
+
+NetworkLib::Status
+TLVBase::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                        std::size_t &length) {
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+        length = encode(std::move(buffer));
+    } catch (const std::bad_alloc &) {
+        throw;
+    } catch (...) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+#else
+    length = encode(std::move(buffer));
+#endif
+
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status TLVBase::decode_nothrow(NetworkLib::BufferView buffer,
+                                           std::size_t &length) {
+#if NETWORKLIB_HAS_EXCEPTIONS
+    try {
+        length = decode(std::move(buffer));
+    } catch (const std::bad_alloc &) {
+        throw;
+    } catch (...) {
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+#else
+    length = decode(std::move(buffer));
+#endif
+
+    return NetworkLib::Status();
+}
+
+/**********************************************************************/
+
+namespace {
+
+// Encode a TLV (type, length and data) at the given offset of the
+// buffer, and return its total length.
+NetworkLib::Status encodeAt(const NetworkLib::BufferWritableView &buffer,
+                            std::size_t offset, TLVBase &tlv,
+                            std::size_t &tlvTotalLength) {
+    // Check once that there's room for the type and the length
+    if (!buffer.isWithinBounds(offset, TLVHeader::headerLength)) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Get a BufferWritableView of the 'free' space at the end of the
+    // buffer, leaving out the type and the length
+    const std::size_t dataOffset = offset + TLVHeader::dataOffset;
+    auto subBuffer_V =
+        buffer.getSub_nocheck(dataOffset, buffer.size() - dataOffset);
+
+    // Encode the data and keep the length
+    std::size_t dataLength = 0;
+    NetworkLib::Status status;
+    {
+        const NetworkLib::Metrics::ScopedTimer timer(
+            NetworkLib::Timer::TLV_ENCODE,
+            static_cast<std::size_t>(tlv.type()));
+        status = tlv.encode_nothrow(subBuffer_V, dataLength);
+    }
+
+    if (!status) {
+        return status;
+    }
+
+    if (dataLength > 0xFFFF - TLVHeader::headerLength) {
+        // The length doesn't fit in the TLVHeader
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    tlvTotalLength = TLVHeader::headerLength + dataLength;
+
+    // Set type and length (bounds checked above)
+    buffer.setUint16At_nocheck(offset + TLVHeader::typeOffset,
+                               static_cast<std::uint16_t>(tlv.type()));
+    buffer.setUint16At_nocheck(offset + TLVHeader::lengthOffset,
+                               tlvTotalLength);
+
+    return NetworkLib::Status();
+}
+
+} // namespace
+
+/**********************************************************************/
+
 MessageEncoder::MessageEncoder(NetworkLib::BufferWritableView buffer)
     : mBuffer{buffer}, mHeaderEncoder{buffer}, mCurrentOffset{
                                                    mHeaderEncoder.size()} {}
 
-MessageEncoder &MessageEncoder::add(TLVBase &tlv) {
-    // Get a BufferWritableView of the 'free' space at the end of the buffer
-    auto subBuffer_TL = mBuffer.getSub(mCurrentOffset);
+void MessageEncoder::reset(NetworkLib::BufferWritableView buffer) {
+    mHeaderEncoder.reset(buffer);
+    mBuffer = std::move(buffer);
+    mCurrentOffset = mHeaderEncoder.size();
+}
 
-    // Leave out the type and the length
-    auto subBuffer_V = subBuffer_TL.getSub(TLVHeader::dataOffset);
+MessageEncoder &MessageEncoder::add(TLVBase &tlv) {
+    add_nothrow(tlv).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return *this;
+}
 
-    // Encode the data and keep the length
-    auto tlvTotalLength = TLVHeader::headerLength + tlv.encode(subBuffer_V);
+NetworkLib::Status MessageEncoder::add_nothrow(TLVBase &tlv) {
+    std::size_t tlvTotalLength = 0;
+    NetworkLib::Status status =
+        encodeAt(mBuffer, mCurrentOffset, tlv, tlvTotalLength);
 
-    // Set type and length
-    subBuffer_TL.setUint16At(TLVHeader::typeOffset,
-                             static_cast<std::uint16_t>(tlv.type()));
-    subBuffer_TL.setUint16At(TLVHeader::lengthOffset, tlvTotalLength);
+    if (!status) {
+        return status;
+    }
 
     // Advance the current offset
     mCurrentOffset += tlvTotalLength;
 
-    return *this;
+    return NetworkLib::Status();
 }
 
 void MessageEncoder::end() {
@@ -43,43 +144,205 @@ void MessageEncoder::end() {
 
 /**********************************************************************/
 
+const std::size_t MessageSegmentEncoder::minReferencedDataSize;
+
+MessageSegmentEncoder::MessageSegmentEncoder(
+    NetworkLib::BufferWritableView buffer)
+    : mBuffer{buffer}, mHeaderEncoder{buffer}, mSegmentOffset{0},
+      mCurrentOffset{mHeaderEncoder.size()}, mTotalLength{
+                                                 mHeaderEncoder.size()} {}
+
+void MessageSegmentEncoder::reset(NetworkLib::BufferWritableView buffer) {
+    mHeaderEncoder.reset(buffer);
+    mBuffer = std::move(buffer);
+    mSegmentOffset = 0;
+    mCurrentOffset = mHeaderEncoder.size();
+    mTotalLength = mHeaderEncoder.size();
+    mSegments.clear();
+}
+
+void MessageSegmentEncoder::closeSegment() {
+    if (mCurrentOffset > mSegmentOffset) {
+        mSegments.push_back(
+            mBuffer.getSub(mSegmentOffset, mCurrentOffset - mSegmentOffset));
+        mSegmentOffset = mCurrentOffset;
+    }
+}
+
+MessageSegmentEncoder &MessageSegmentEncoder::add(TLVBase &tlv) {
+    add_nothrow(tlv).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return *this;
+}
+
+NetworkLib::Status MessageSegmentEncoder::add_nothrow(TLVBase &tlv) {
+    NetworkLib::BufferView data = tlv.encodedData();
+
+    if (data.size() < minReferencedDataSize) {
+        // Encode it in place, just like MessageEncoder
+        std::size_t tlvTotalLength = 0;
+        NetworkLib::Status status =
+            encodeAt(mBuffer, mCurrentOffset, tlv, tlvTotalLength);
+
+        if (!status) {
+            return status;
+        }
+
+        mCurrentOffset += tlvTotalLength;
+        mTotalLength += tlvTotalLength;
+        return NetworkLib::Status();
+    }
+
+    const std::size_t tlvTotalLength = TLVHeader::headerLength + data.size();
+
+    if (tlvTotalLength > 0xFFFF) {
+        // TLV data is too long
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    if (!mBuffer.isWithinBounds(mCurrentOffset, TLVHeader::headerLength)) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Encode only type and length (bounds checked just above)...
+    mBuffer.setUint16At_nocheck(mCurrentOffset + TLVHeader::typeOffset,
+                                static_cast<std::uint16_t>(tlv.type()));
+    mBuffer.setUint16At_nocheck(mCurrentOffset + TLVHeader::lengthOffset,
+                                tlvTotalLength);
+    mCurrentOffset += TLVHeader::headerLength;
+
+    // ...and refer to the data.
+    closeSegment();
+    mSegments.push_back(data);
+    mTotalLength += tlvTotalLength;
+
+    return NetworkLib::Status();
+}
+
+void MessageSegmentEncoder::end() {
+    // Set the total length in the message common header (note that
+    // the header is in the first segment, which is a view on mBuffer).
+    mHeaderEncoder.totalLengthBytes(mTotalLength);
+    closeSegment();
+}
+
+/**********************************************************************/
+
 MessageDecoder::MessageDecoder(NetworkLib::BufferView buffer)
-    : mBuffer(buffer),
-      mHeaderDecoder(buffer), mCurrentOffset{mHeaderDecoder.size()} {}
+    : mBuffer(buffer), mHeaderDecoder(buffer),
+      mMessageClass{mHeaderDecoder.messageClass()},
+      mCurrentOffset{mHeaderDecoder.size()}, mIndexed{false} {}
+
+void MessageDecoder::reset(NetworkLib::BufferView buffer) {
+    mHeaderDecoder.reset(buffer);
+    mMessageClass = mHeaderDecoder.messageClass();
+    mBuffer = std::move(buffer);
+    mCurrentOffset = mHeaderDecoder.size();
+    mIndexed = false;
+}
 
 MessageDecoder &MessageDecoder::get(TLVBase &obj) {
+    get_nothrow(obj).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return *this;
+}
 
-    // Get the type and length of the encoded TLV
-    auto subBuffer_TL = mBuffer.getSub(mCurrentOffset, TLVHeader::headerLength);
+NetworkLib::Status MessageDecoder::get_nothrow(TLVBase &obj) {
 
-    TLVType tlvType =
-        static_cast<TLVType>(subBuffer_TL.getUint16At(TLVHeader::typeOffset));
-    std::size_t tlvLength = subBuffer_TL.getUint16At(TLVHeader::lengthOffset);
+    // Get the type and length of the encoded TLV, checking that the
+    // length covers at least the header, and fits in the buffer
+    TLVType tlvType;
+    std::size_t tlvLength;
+    NetworkLib::Status status = nextHeader(tlvType, tlvLength);
+
+    if (!status) {
+        return status;
+    }
 
     if (tlvType != obj.type()) {
         // Mismatched TLV type...
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": encoded TLV has type "
-            << tlvType << ", expected TLV has type " << obj.type();
-        throw std::runtime_error(err.str());
+        return NetworkLib::ErrorCode::TLV_TYPE_MISMATCH;
     }
 
-    auto subBuffer_V = mBuffer.getSub(mCurrentOffset + TLVHeader::headerLength,
-                                      tlvLength - TLVHeader::headerLength);
-    std::size_t reportedLength =
-        TLVHeader::headerLength + obj.decode(subBuffer_V);
+    auto subBuffer_V =
+        mBuffer.getSub_nocheck(mCurrentOffset + TLVHeader::headerLength,
+                               tlvLength - TLVHeader::headerLength);
+    std::size_t reportedLength = 0;
+    {
+        const NetworkLib::Metrics::ScopedTimer timer(
+            NetworkLib::Timer::TLV_DECODE, static_cast<std::size_t>(tlvType));
+        status = obj.decode_nothrow(subBuffer_V, reportedLength);
+    }
 
-    if (reportedLength != tlvLength) {
+    if (!status) {
+        return status;
+    }
+
+    if (TLVHeader::headerLength + reportedLength != tlvLength) {
         // Mismatched TLV length when decoding...
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": encoded TLV has length "
-            << tlvLength << ", but decoding gives length " << reportedLength;
-        throw std::runtime_error(err.str());
+        return NetworkLib::ErrorCode::TLV_LENGTH_MISMATCH;
     }
 
     mCurrentOffset += tlvLength;
 
-    return *this;
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status
+MessageDecoder::nextHeader(TLVType &tlvType,
+                           std::size_t &tlvLength) const noexcept {
+
+    if (mCurrentOffset >= mBuffer.size()) {
+        // We are already at the end, so there's no next TLV
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    const std::size_t remaining = mBuffer.size() - mCurrentOffset;
+    tlvLength = 0;
+
+    if (remaining >= TLVHeader::headerLength) {
+        // Bounds checked just above
+        tlvLength = mBuffer.getUint16At_nocheck(mCurrentOffset +
+                                                TLVHeader::lengthOffset);
+    }
+
+    if (tlvLength < TLVHeader::headerLength || tlvLength > remaining) {
+        return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+    }
+
+    tlvType = static_cast<TLVType>(
+        mBuffer.getUint16At_nocheck(mCurrentOffset + TLVHeader::typeOffset));
+
+    return NetworkLib::Status();
+}
+
+TLVView MessageDecoder::next() {
+    TLVView view;
+    next_nothrow(view).raise(NETWORKLIB_CURRENT_FUNCTION);
+    return view;
+}
+
+NetworkLib::Status MessageDecoder::next_nothrow(TLVView &view) noexcept {
+
+    if (mCurrentOffset >= mBuffer.size()) {
+        // We are already at the end, so there's no next TLV
+        view = TLVView();
+        return NetworkLib::Status();
+    }
+
+    TLVType tlvType;
+    std::size_t tlvLength;
+    NetworkLib::Status status = nextHeader(tlvType, tlvLength);
+
+    if (!status) {
+        return status;
+    }
+
+    view = TLVView(tlvType,
+                   mBuffer.getSub_nocheck(mCurrentOffset +
+                                              TLVHeader::headerLength,
+                                          tlvLength - TLVHeader::headerLength));
+    mCurrentOffset += tlvLength;
+
+    return NetworkLib::Status();
 }
 
 TLVType MessageDecoder::getNextTLVType() const {
@@ -89,12 +352,15 @@ TLVType MessageDecoder::getNextTLVType() const {
         return TLVType::NONE;
     }
 
-    // Get the type and length of the encoded TLV
-    auto subBuffer_TL = mBuffer.getSub(mCurrentOffset, TLVHeader::headerLength);
+    // Get the type and length of the encoded TLV (bounds checked just
+    // above)
+    const auto header =
+        NetworkLib::CheckedRegion<TLVHeader::headerLength>::make_nocheck(
+            mBuffer, mCurrentOffset);
 
     TLVType tlvType =
-        static_cast<TLVType>(subBuffer_TL.getUint16At(TLVHeader::typeOffset));
-    std::size_t tlvLength = subBuffer_TL.getUint16At(TLVHeader::lengthOffset);
+        static_cast<TLVType>(header.getUint16At<TLVHeader::typeOffset>());
+    std::size_t tlvLength = header.getUint16At<TLVHeader::lengthOffset>();
 
     if ((mCurrentOffset + tlvLength) > mBuffer.size()) {
         // TLV is truncated in the buffer.
@@ -104,5 +370,81 @@ TLVType MessageDecoder::getNextTLVType() const {
     return tlvType;
 }
 
+const TLVIndex &MessageDecoder::index() {
+    index_nothrow().raise(NETWORKLIB_CURRENT_FUNCTION);
+    return mIndex;
+}
+
+NetworkLib::Status MessageDecoder::index_nothrow() noexcept {
+    if (!mIndexed) {
+        NetworkLib::Status status =
+            mIndex.build_nothrow(mBuffer, mHeaderDecoder.size());
+
+        if (!status) {
+            return status;
+        }
+
+        mIndexed = true;
+    }
+
+    return NetworkLib::Status();
+}
+
+TLVView MessageDecoder::view(const TLVIndex::Entry &entry) const {
+    return TLVView(entry.type, mBuffer.getSub(entry.offset, entry.length));
+}
+
+TLVView MessageDecoder::find(TLVType type) {
+    const TLVIndex &tlvIndex = index();
+    const std::size_t i = tlvIndex.find(type);
+
+    if (i == TLVIndex::npos) {
+        return TLVView();
+    }
+
+    return view(tlvIndex[i]);
+}
+
+bool MessageDecoder::tryGet(TLVBase &tlv) {
+    return tryGet_nothrow(tlv).valueOrRaise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Result<bool> MessageDecoder::tryGet_nothrow(TLVBase &tlv) {
+    NetworkLib::Status status = index_nothrow();
+
+    if (!status) {
+        return status;
+    }
+
+    const std::size_t i = mIndex.find(tlv.type());
+
+    if (i == TLVIndex::npos) {
+        return false;
+    }
+
+    // Bounds already checked when building the index
+    const TLVIndex::Entry &entry = mIndex[i];
+    std::size_t reportedLength = 0;
+    {
+        const NetworkLib::Metrics::ScopedTimer timer(
+            NetworkLib::Timer::TLV_DECODE,
+            static_cast<std::size_t>(tlv.type()));
+        status = tlv.decode_nothrow(
+            mBuffer.getSub_nocheck(entry.offset, entry.length),
+            reportedLength);
+    }
+
+    if (!status) {
+        return status;
+    }
+
+    if (reportedLength != entry.length) {
+        // Mismatched TLV length when decoding...
+        return NetworkLib::Status(NetworkLib::ErrorCode::TLV_LENGTH_MISMATCH);
+    }
+
+    return true;
+}
+
 } // namespace Agent
 } // namespace Empower
@@ -0,0 +1,135 @@
+#include <empoweragentproto/tlvindex.hh>
+
+#include <empoweragentproto/protocol.hh>
+#include <empoweragentproto/tlvs.hh>
+
+namespace Empower {
+namespace Agent {
+
+const std::size_t TLVIndex::maxEntries;
+const std::size_t TLVIndex::directLookupTypes;
+const std::size_t TLVIndex::npos;
+const std::uint8_t TLVIndex::noEntry;
+
+void TLVIndex::clear() noexcept {
+    mSize = 0;
+    mFirst.fill(noEntry);
+}
+
+void TLVIndex::build(const NetworkLib::BufferView &buffer,
+                     std::size_t offset) {
+    build_nothrow(buffer, offset).raise(NETWORKLIB_CURRENT_FUNCTION);
+}
+
+NetworkLib::Status
+TLVIndex::build_nothrow(const NetworkLib::BufferView &buffer,
+                        std::size_t offset) noexcept {
+    clear();
+
+    // Last entry for each type, to chain the next one
+    std::array<std::uint8_t, directLookupTypes> last;
+    last.fill(noEntry);
+
+    while (offset < buffer.size()) {
+        const std::size_t remaining = buffer.size() - offset;
+        std::size_t tlvLength = 0;
+
+        if (remaining >= TLVHeader::headerLength) {
+            // Bounds checked just above
+            tlvLength =
+                buffer.getUint16At_nocheck(offset + TLVHeader::lengthOffset);
+        }
+
+        if (tlvLength < TLVHeader::headerLength || tlvLength > remaining) {
+            clear();
+            return NetworkLib::ErrorCode::BAD_TLV_LENGTH;
+        }
+
+        if (mSize == maxEntries) {
+            clear();
+            return NetworkLib::ErrorCode::TOO_MANY_TLVS;
+        }
+
+        Entry &entry = mEntries[mSize];
+        entry.type = static_cast<TLVType>(
+            buffer.getUint16At_nocheck(offset + TLVHeader::typeOffset));
+        entry.length = tlvLength - TLVHeader::headerLength;
+        entry.offset = offset + TLVHeader::dataOffset;
+
+        mNext[mSize] = noEntry;
+
+        const std::size_t t = static_cast<std::size_t>(entry.type);
+
+        if (t < directLookupTypes) {
+            if (last[t] == noEntry) {
+                mFirst[t] = mSize;
+            } else {
+                mNext[last[t]] = mSize;
+            }
+
+            last[t] = mSize;
+        }
+
+        ++mSize;
+        offset += tlvLength;
+    }
+
+    return NetworkLib::Status();
+}
+
+std::size_t TLVIndex::find(TLVType type) const {
+    const std::size_t t = static_cast<std::size_t>(type);
+
+    if (t < directLookupTypes) {
+        if (mFirst[t] == noEntry) {
+            return npos;
+        }
+
+        return mFirst[t];
+    }
+
+    for (std::size_t i = 0; i < mSize; ++i) {
+        if (mEntries[i].type == type) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+std::size_t TLVIndex::findNext(std::size_t i) const {
+    if (i >= mSize) {
+        return npos;
+    }
+
+    const TLVType type = mEntries[i].type;
+
+    if (static_cast<std::size_t>(type) < directLookupTypes) {
+        if (mNext[i] == noEntry) {
+            return npos;
+        }
+
+        return mNext[i];
+    }
+
+    for (++i; i < mSize; ++i) {
+        if (mEntries[i].type == type) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+std::size_t TLVIndex::count(TLVType type) const {
+    std::size_t result = 0;
+
+    for (std::size_t i = find(type); i != npos; i = findNext(i)) {
+        ++result;
+    }
+
+    return result;
+}
+
+} // namespace Agent
+} // namespace Empower
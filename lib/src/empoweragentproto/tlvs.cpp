@@ -1,40 +1,138 @@
 #include <empoweragentproto/tlvs.hh>
 
+#include <algorithm>
+#include <tuple>
+
 namespace Empower {
 namespace Agent {
 
 /**********************************************************************/
 
 std::size_t TLVError::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(errorCodeOffset, mErrorCode);
-    buffer.setCStringAt(errorMessageOffset, mErrorMessage);
-    return 2 + (mErrorMessage.size() + 1);
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
 }
 
 std::size_t TLVError::decode(NetworkLib::BufferView buffer) {
-    mErrorCode = buffer.getUint16At(errorCodeOffset);
-    mErrorMessage = buffer.getCStringAt(errorMessageOffset);
-    return 2 + (mErrorMessage.size() + 1);
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+NetworkLib::Status
+TLVError::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                         std::size_t &length) {
+    const std::size_t requiredSize = 2 + (mErrorMessage.size() + 1);
+
+    if (requiredSize > buffer.size()) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Bounds already checked above
+    buffer.setUint16At_nocheck(errorCodeOffset, mErrorCode);
+    buffer.setCStringAt_nocheck(errorMessageOffset, mErrorMessage);
+
+    length = requiredSize;
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status TLVError::decode_nothrow(NetworkLib::BufferView buffer,
+                                            std::size_t &length) {
+    NetworkLib::StringView message;
+    NetworkLib::Status status =
+        buffer.getCStringViewAt_nothrow(errorMessageOffset, message);
+
+    if (!status) {
+        return status;
+    }
+
+    // Bounds already checked above (the message follows the code)
+    mErrorCode = buffer.getUint16At_nocheck(errorCodeOffset);
+
+    // Reuse the memory of the current message, if any
+    mErrorMessage.assign(message.data(), message.size());
+
+    length = 2 + (mErrorMessage.size() + 1);
+    return NetworkLib::Status();
 }
 
 /**********************************************************************/
 
 std::size_t TLVBinaryData::encode(NetworkLib::BufferWritableView buffer) {
-    mBuffer.copyTo(buffer);
-    return mBuffer.size();
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
 }
 
 std::size_t TLVBinaryData::decode(NetworkLib::BufferView buffer) {
-    mBuffer = IO::makeMessageBuffer();
-    buffer.copyTo(mBuffer);
-    mBuffer.shrinkTo(buffer.size());
-    return buffer.size();
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+NetworkLib::Status
+TLVBinaryData::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                              std::size_t &length) {
+    if (mBuffer.size() > buffer.size()) {
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+    }
+
+    // Size already checked above
+    mBuffer.copyTo(buffer);
+
+    length = mBuffer.size();
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status
+TLVBinaryData::decode_nothrow(NetworkLib::BufferView buffer,
+                              std::size_t &length) {
+    if (mZeroCopy) {
+        mBuffer = buffer;
+    } else {
+        data(buffer);
+    }
+
+    length = buffer.size();
+    return NetworkLib::Status();
 }
 
 /**********************************************************************/
 
 std::size_t
 TLVKeyValueStringPairs::encode(NetworkLib::BufferWritableView buffer) {
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+std::size_t TLVKeyValueStringPairs::decode(NetworkLib::BufferView buffer) {
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+NetworkLib::Status
+TLVKeyValueStringPairs::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                       std::size_t &length) {
+
+    if (!mData.empty()) {
+        // Decoded with zero-copy: just copy the data back
+        if (mData.size() > buffer.size()) {
+            return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
+        }
+
+        mData.copyTo(buffer);
+        length = mData.size();
+        return NetworkLib::Status();
+    }
 
     // First pass: check if there's enough room
     std::size_t requiredSize = 0;
@@ -43,40 +141,92 @@ TLVKeyValueStringPairs::encode(NetworkLib::BufferWritableView buffer) {
     }
 
     if (requiredSize > buffer.size()) {
-        std::ostringstream err;
-        err << NETWORKLIB_CURRENT_FUNCTION << ": TLV requires a buffer of "
-            << requiredSize << ", available size is " << buffer.size();
-        throw std::runtime_error(err.str());
+        return NetworkLib::ErrorCode::OUT_OF_BOUNDS;
     }
 
-    // Second pass: encode data
+    // Second pass: encode data (bounds already checked above)
     std::size_t offset = 0;
     for (auto &a : mValue) {
-        buffer.setCStringAt(offset, a.first);
+        buffer.setCStringAt_nocheck(offset, a.first);
         offset += a.first.size() + 1;
 
-        buffer.setCStringAt(offset, a.second);
+        buffer.setCStringAt_nocheck(offset, a.second);
         offset += a.second.size() + 1;
     }
 
-    return requiredSize;
+    length = requiredSize;
+    return NetworkLib::Status();
 }
 
-std::size_t
-TLVKeyValueStringPairs::decode(const NetworkLib::BufferView buffer) {
-    mValue.clear();
+NetworkLib::Status
+TLVKeyValueStringPairs::decode_nothrow(const NetworkLib::BufferView buffer,
+                                       std::size_t &length) {
+    const unsigned char *data = buffer.getUnderlyingBufferPtr();
+
+    // Each pair has two terminating NULs: count them to allocate all
+    // the pairs at once.
+    const std::size_t maxPairs =
+        (std::count(data, data + buffer.size(), 0) + 1) / 2;
+
+    clearData();
+
+    if (mZeroCopy) {
+        mViews.reserve(maxPairs);
+        mValue.clear();
+    } else {
+        mValue.reserve(maxPairs);
+    }
 
+    std::size_t n = 0;
     std::size_t offset = 0;
+    NetworkLib::Status status;
+
     while (offset < buffer.size()) {
-        std::string a = buffer.getCStringAt(offset);
-        offset += a.size() + 1;
-        std::string b = buffer.getCStringAt(offset);
+        NetworkLib::StringView a;
+        NetworkLib::StringView b;
+
+        status = buffer.getCStringViewAt_nothrow(offset, a);
+
+        if (status) {
+            offset += a.size() + 1;
+            status = buffer.getCStringViewAt_nothrow(offset, b);
+        }
+
+        if (!status) {
+            // Keep just the pairs decoded so far (and no views on a
+            // buffer we don't refer to)
+            clearData();
+            mValue.resize(n);
+            return status;
+        }
+
         offset += b.size() + 1;
-        mValue.push_back(std::make_pair(a, b));
+
+        if (mZeroCopy) {
+            mViews.emplace_back(a, b);
+        } else if (n < mValue.size()) {
+            // Reuse the memory of the strings already there
+            mValue[n].first.assign(a.data(), a.size());
+            mValue[n].second.assign(b.data(), b.size());
+        } else {
+            mValue.emplace_back(std::piecewise_construct,
+                                std::forward_as_tuple(a.data(), a.size()),
+                                std::forward_as_tuple(b.data(), b.size()));
+        }
+
+        ++n;
+    }
+
+    if (mZeroCopy) {
+        // Keeps the underlying buffer alive for the views
+        mData = buffer.getSub_nocheck(0, offset);
+    } else {
+        mValue.resize(n);
     }
 
     // Offset is also the total length
-    return offset;
+    length = offset;
+    return NetworkLib::Status();
 }
 
 /**********************************************************************/
@@ -84,133 +234,206 @@ TLVKeyValueStringPairs::decode(const NetworkLib::BufferView buffer) {
 TLVList::TLVList() : mTLVType{TLVType::NONE}, mCount{0} {}
 
 std::size_t TLVList::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(tlvTypeOffset, static_cast<std::uint16_t>(mTLVType));
-    buffer.setUint16At(countOffset, mCount);
-    return 4;
+    std::size_t length = 0;
+    encode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
 }
 
 std::size_t TLVList::decode(NetworkLib::BufferView buffer) {
-    mTLVType = static_cast<TLVType>(buffer.getUint16At(tlvTypeOffset));
-    mCount = buffer.getUint16At(countOffset);
-    return 4;
+    std::size_t length = 0;
+    decode_nothrow(std::move(buffer), length)
+        .raise(NETWORKLIB_CURRENT_FUNCTION);
+    return length;
+}
+
+NetworkLib::Status
+TLVList::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                        std::size_t &length) {
+    NetworkLib::Status status = NetworkLib::CheckedRegion<4>::check(buffer, 0);
+
+    if (!status) {
+        return status;
+    }
+
+    const auto region =
+        NetworkLib::CheckedWritableRegion<4>::make_nocheck(buffer, 0);
+    region.setUint16At<tlvTypeOffset>(static_cast<std::uint16_t>(mTLVType));
+    region.setUint16At<countOffset>(mCount);
+
+    length = region.size();
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status TLVList::decode_nothrow(NetworkLib::BufferView buffer,
+                                           std::size_t &length) {
+    NetworkLib::Status status = NetworkLib::CheckedRegion<4>::check(buffer, 0);
+
+    if (!status) {
+        return status;
+    }
+
+    const auto region = NetworkLib::CheckedRegion<4>::make_nocheck(buffer, 0);
+    mTLVType = static_cast<TLVType>(region.getUint16At<tlvTypeOffset>());
+    mCount = region.getUint16At<countOffset>();
+
+    // Skip the elements, if any (see TLVListOf).
+    length = buffer.size();
+    return NetworkLib::Status();
 }
 
 /**********************************************************************/
 
 std::size_t TLVPeriodicityMs::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint32At(millisecondsOffset, mMilliseconds);
-    return 4;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVPeriodicityMs::decode(NetworkLib::BufferView buffer) {
-    mMilliseconds = buffer.getUint32At(millisecondsOffset);
-    return 4;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVPeriodicityMs::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                 std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVPeriodicityMs::decode_nothrow(NetworkLib::BufferView buffer,
+                                 std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVCell::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(pciOffset, mPci);
-    buffer.setUint32At(dlEarfcnOffset, mDlEarfcn);
-    buffer.setUint32At(ulEarfcnOffset, mUlEarfcn);
-    buffer.setUint8At(nPrbOffset, mNPrb);
-    return 11;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVCell::decode(NetworkLib::BufferView buffer) {
-    mPci = buffer.getUint16At(pciOffset);
-    mDlEarfcn = buffer.getUint32At(dlEarfcnOffset);
-    mUlEarfcn = buffer.getUint32At(ulEarfcnOffset);
-    mNPrb = buffer.getUint8At(nPrbOffset);
-    return 11;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVCell::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                        std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVCell::decode_nothrow(NetworkLib::BufferView buffer,
+                        std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVUEReport::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint64At(imsiOffset, mIMSI);
-    buffer.setUint32At(tmsiOffset, mTMSI);
-    buffer.setUint16At(rntiOffset, mRNTI);
-    buffer.setUint8At(statusOffset, mStatus);
-    buffer.setUint16At(pciOffset, mPCI);
-    return 17;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVUEReport::decode(NetworkLib::BufferView buffer) {
-    mIMSI = buffer.getUint64At(imsiOffset);
-    mTMSI = buffer.getUint32At(tmsiOffset);
-    mRNTI = buffer.getUint16At(rntiOffset);
-    mStatus = buffer.getUint8At(statusOffset);
-    mPCI = buffer.getUint16At(pciOffset);
-    return 17;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVUEReport::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                            std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVUEReport::decode_nothrow(NetworkLib::BufferView buffer,
+                            std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVUEMeasurementConfig::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(rntiOffset, mRNTI);
-    buffer.setUint8At(measIdOffset, mMeasId);
-    buffer.setUint8At(intervalOffset, mInterval);
-    buffer.setUint8At(amountOffset, mAmount);
-    return 5;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVUEMeasurementConfig::decode(NetworkLib::BufferView buffer) {
-    mRNTI = buffer.getUint16At(rntiOffset);
-    mMeasId = buffer.getUint8At(measIdOffset);
-    mInterval = buffer.getUint8At(intervalOffset);
-    mAmount = buffer.getUint8At(amountOffset);
-    return 5;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVUEMeasurementConfig::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                       std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVUEMeasurementConfig::decode_nothrow(NetworkLib::BufferView buffer,
+                                       std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVUEMeasurementId::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(rntiOffset, mRNTI);
-    buffer.setUint8At(measIdOffset, mMeasId);
-    return 3;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVUEMeasurementId::decode(NetworkLib::BufferView buffer) {
-    mRNTI = buffer.getUint16At(rntiOffset);
-    mMeasId = buffer.getUint8At(measIdOffset);
-    return 3;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVUEMeasurementId::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                   std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVUEMeasurementId::decode_nothrow(NetworkLib::BufferView buffer,
+                                   std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVUEMeasurementReport::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(rntiOffset, mRNTI);
-    buffer.setUint8At(measIdOffset, mMeasId);
-    buffer.setUint8At(rsrpOffset, mRSRP);
-    buffer.setUint8At(rsrqOffset, mRSRQ);
-    return 5;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVUEMeasurementReport::decode(NetworkLib::BufferView buffer) {
-    mRNTI = buffer.getUint16At(rntiOffset);
-    mMeasId = buffer.getUint8At(measIdOffset);
-    mRSRP = buffer.getUint8At(rsrpOffset);
-    mRSRQ = buffer.getUint8At(rsrqOffset);
-    return 5;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVUEMeasurementReport::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                       std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVUEMeasurementReport::decode_nothrow(NetworkLib::BufferView buffer,
+                                       std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
 
 std::size_t TLVMACPrbReportReport::encode(NetworkLib::BufferWritableView buffer) {
-    buffer.setUint16At(nPrbOffset, mNPrb);
-    buffer.setUint32At(dlOffset, mDL);
-    buffer.setUint32At(ulOffset, mUL);
-    buffer.setUint16At(pciOffset, mPCI);
-    return 12;
+    return Layout::encode(*this, buffer);
 }
 
 std::size_t TLVMACPrbReportReport::decode(NetworkLib::BufferView buffer) {
-    mNPrb = buffer.getUint16At(nPrbOffset);
-    mDL = buffer.getUint32At(dlOffset);
-    mUL = buffer.getUint32At(ulOffset);
-    mPCI = buffer.getUint16At(pciOffset);
-    return 12;
+    return Layout::decode(*this, buffer);
+}
+
+NetworkLib::Status
+TLVMACPrbReportReport::encode_nothrow(NetworkLib::BufferWritableView buffer,
+                                      std::size_t &length) {
+    return Layout::encode_nothrow(*this, buffer, length);
+}
+
+NetworkLib::Status
+TLVMACPrbReportReport::decode_nothrow(NetworkLib::BufferView buffer,
+                                      std::size_t &length) {
+    return Layout::decode_nothrow(*this, buffer, length);
 }
 
 /**********************************************************************/
@@ -0,0 +1,78 @@
+#include <empoweragentproto/tlvviews.hh>
+
+namespace Empower {
+namespace Agent {
+
+void TLVView::check(TLVType expected, std::size_t minSize) const {
+    if (mType != expected) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": TLV has type " << mType
+            << ", expected TLV has type " << expected;
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    if (mData.size() < minSize) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": TLV data is too short ("
+            << mData.size() << " bytes, at least " << minSize
+            << " expected)";
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+}
+
+/**********************************************************************/
+
+void TLVKeyValueStringPairsView::const_iterator::parse() {
+    if (mOffset >= mBuffer->size()) {
+        // At the end
+        mValue = value_type();
+        return;
+    }
+
+    mValue.first = mBuffer->getCStringViewAt(mOffset);
+    mValue.second =
+        mBuffer->getCStringViewAt(mOffset + mValue.first.size() + 1);
+}
+
+TLVKeyValueStringPairsView::const_iterator
+TLVKeyValueStringPairsView::find(const NetworkLib::StringView &key) const {
+    const_iterator it = begin();
+    const const_iterator last = end();
+
+    while (it != last && it->first != key) {
+        ++it;
+    }
+
+    return it;
+}
+
+/**********************************************************************/
+
+TLVListViewBase::TLVListViewBase(TLVView view, TLVType elementType,
+                                 std::size_t elementSize)
+    : TLVView(std::move(view)), mElementType{TLVType::NONE}, mCount{0} {
+    check(TLVType::LIST_OF_TLV, elementsOffset);
+
+    // Size checked just above
+    mElementType =
+        static_cast<TLVType>(data().getUint16At_nocheck(tlvTypeOffset));
+    mCount = data().getUint16At_nocheck(countOffset);
+
+    if (mElementType != elementType) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": list elements have type "
+            << mElementType << ", expected type is " << elementType;
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+
+    if (elementsOffset + mCount * elementSize > data().size()) {
+        std::ostringstream err;
+        err << NETWORKLIB_CURRENT_FUNCTION << ": list of " << mCount
+            << " elements requires " << (elementsOffset + mCount * elementSize)
+            << " bytes, TLV data size is " << data().size();
+        NETWORKLIB_THROW(std::runtime_error, err.str());
+    }
+}
+
+} // namespace Agent
+} // namespace Empower
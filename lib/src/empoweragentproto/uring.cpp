@@ -0,0 +1,463 @@
+#include <empoweragentproto/uring.hh>
+
+#if defined(EMPOWER_AGENT_HAVE_IO_URING)
+
+// For the structures, constants and system call numbers of io_uring
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+// For syscall(2), write(2) and close(2)
+#include <unistd.h>
+
+// For mmap(2)
+#include <sys/mman.h>
+
+// For POLLIN
+#include <poll.h>
+
+// For std::memset()
+#include <cstring>
+
+// For std::max()
+#include <algorithm>
+
+#endif
+
+namespace Empower {
+namespace Agent {
+
+#if defined(EMPOWER_AGENT_HAVE_IO_URING)
+
+namespace {
+
+// The buffer group of the receive buffers
+const std::uint16_t bufferGroup = 0;
+
+int uringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+               unsigned flags, const void *arg, std::size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+
+int uringRegister(int fd, unsigned opcode, const void *arg, unsigned count) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// Return the given field of a ring mapped at base.
+template <typename T> T *fieldAt(void *base, std::size_t offset) {
+    return reinterpret_cast<T *>(static_cast<unsigned char *>(base) + offset);
+}
+
+NetworkLib::Status systemError() {
+    return NetworkLib::Status(NetworkLib::ErrorCode::SYSTEM_ERROR, errno);
+}
+
+// Receive one byte through a socket pair with a multishot request.
+bool probe() {
+    Uring uring(4, 1);
+
+    if (!uring.ok()) {
+        return false;
+    }
+
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+        return false;
+    }
+
+    bool received = false;
+    uring.prepareRecvMultishot(fds[0], 1);
+
+    if (uring.submit() && write(fds[1], "x", 1) == 1) {
+        std::vector<Uring::Completion> completions;
+
+        if (uring.submitAndWait(1000, completions) && !completions.empty()) {
+            received = completions[0].result == 1 &&
+                       completions[0].bufferId == 0;
+        }
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return received;
+}
+
+} // namespace
+
+bool Uring::available() {
+    static const bool result = probe();
+    return result;
+}
+
+Uring::Uring(unsigned entries, unsigned bufferCount)
+    : mPool(bufferCount <= 32768 ? bufferCount : 0) {
+    mStatus = setup(entries, bufferCount);
+
+    if (!mStatus) {
+        release();
+    }
+}
+
+Uring::~Uring() { release(); }
+
+NetworkLib::Status Uring::setup(unsigned entries, unsigned bufferCount) {
+    if (bufferCount == 0 || bufferCount > 32768 ||
+        (bufferCount & (bufferCount - 1)) != 0) {
+        return NetworkLib::ErrorCode::INVALID_ARGUMENT;
+    }
+
+    // Each receive buffer can make a completion before we collect
+    // them, on top of one per request.
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries + bufferCount;
+
+    mFD = uringSetup(entries, &params);
+
+    if (mFD == -1) {
+        return systemError();
+    }
+
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0) {
+        // Before Linux 5.11: no timeout when waiting for completions
+        return NetworkLib::ErrorCode::UNSUPPORTED;
+    }
+
+    // Map the rings (possibly both at once) and the submission queue
+    // entries.
+    mSQRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    mCQRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    if (singleMap) {
+        mSQRingSize = std::max(mSQRingSize, mCQRingSize);
+        mCQRingSize = 0;
+    }
+
+    mSQRing = mmap(nullptr, mSQRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQ_RING);
+
+    if (mSQRing == MAP_FAILED) {
+        mSQRing = nullptr;
+        return systemError();
+    }
+
+    if (singleMap) {
+        mCQRing = mSQRing;
+    } else {
+        mCQRing = mmap(nullptr, mCQRingSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_CQ_RING);
+
+        if (mCQRing == MAP_FAILED) {
+            mCQRing = nullptr;
+            return systemError();
+        }
+    }
+
+    mSQEsSize = params.sq_entries * sizeof(io_uring_sqe);
+    mSQEs = mmap(nullptr, mSQEsSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQES);
+
+    if (mSQEs == MAP_FAILED) {
+        mSQEs = nullptr;
+        return systemError();
+    }
+
+    mSQHead = fieldAt<unsigned>(mSQRing, params.sq_off.head);
+    mSQTail = fieldAt<unsigned>(mSQRing, params.sq_off.tail);
+    mSQMask = *fieldAt<unsigned>(mSQRing, params.sq_off.ring_mask);
+    mSQEntries = params.sq_entries;
+
+    mCQHead = fieldAt<unsigned>(mCQRing, params.cq_off.head);
+    mCQTail = fieldAt<unsigned>(mCQRing, params.cq_off.tail);
+    mCQMask = *fieldAt<unsigned>(mCQRing, params.cq_off.ring_mask);
+    mCQEs = fieldAt<void>(mCQRing, params.cq_off.cqes);
+
+    // Slot i of the submission ring always refers to entry i.
+    unsigned *array = fieldAt<unsigned>(mSQRing, params.sq_off.array);
+
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        array[i] = i;
+    }
+
+    // Register the ring of receive buffers (Linux 5.19 and later).
+    mBufferRingSize = bufferCount * sizeof(io_uring_buf);
+    mBufferRing = mmap(nullptr, mBufferRingSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mBufferRing == MAP_FAILED) {
+        mBufferRing = nullptr;
+        return systemError();
+    }
+
+    io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<std::uintptr_t>(mBufferRing);
+    registration.ring_entries = bufferCount;
+    registration.bgid = bufferGroup;
+
+    if (uringRegister(mFD, IORING_REGISTER_PBUF_RING, &registration, 1) ==
+        -1) {
+        return systemError();
+    }
+
+    mBuffers.reserve(bufferCount);
+    mBufferMask = static_cast<std::uint16_t>(bufferCount - 1);
+
+    for (unsigned i = 0; i < bufferCount; ++i) {
+        mBuffers.push_back(mPool.getBufferWritableView());
+        addBuffer(static_cast<std::uint16_t>(i));
+    }
+
+    // The tail of the buffer ring overlays the reserved field of its
+    // first entry.
+    __atomic_store_n(&static_cast<io_uring_buf *>(mBufferRing)[0].resv,
+                     mBufferTail, __ATOMIC_RELEASE);
+
+    return NetworkLib::Status();
+}
+
+void Uring::release() noexcept {
+    // Closing the file descriptor cancels the requests in flight (and
+    // unregisters the buffer ring).
+    if (mFD != -1) {
+        close(mFD);
+        mFD = -1;
+    }
+
+    if (mBufferRing != nullptr) {
+        munmap(mBufferRing, mBufferRingSize);
+        mBufferRing = nullptr;
+    }
+
+    if (mSQEs != nullptr) {
+        munmap(mSQEs, mSQEsSize);
+        mSQEs = nullptr;
+    }
+
+    if (mCQRing != nullptr && mCQRing != mSQRing) {
+        munmap(mCQRing, mCQRingSize);
+    }
+
+    mCQRing = nullptr;
+
+    if (mSQRing != nullptr) {
+        munmap(mSQRing, mSQRingSize);
+        mSQRing = nullptr;
+    }
+
+    mPrepared = 0;
+}
+
+void *Uring::nextSQE() {
+    unsigned tail = *mSQTail;
+
+    if (tail - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE) >= mSQEntries) {
+        // Full: make room (the kernel consumes the entries right away).
+        submit().raise(NETWORKLIB_CURRENT_FUNCTION);
+    }
+
+    io_uring_sqe *sqe = &static_cast<io_uring_sqe *>(mSQEs)[tail & mSQMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    // Without IORING_SETUP_SQPOLL the kernel reads the entries only in
+    // io_uring_enter(2), so the tail can be moved before filling it.
+    __atomic_store_n(mSQTail, tail + 1, __ATOMIC_RELEASE);
+    ++mPrepared;
+
+    return sqe;
+}
+
+void Uring::prepareRecvMultishot(int fd, std::uint64_t userData) {
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(nextSQE());
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bufferGroup;
+    sqe->user_data = userData;
+}
+
+void Uring::preparePollMultishot(int fd, std::uint64_t userData) {
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(nextSQE());
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = userData;
+}
+
+void Uring::prepareSendmsg(int fd, const msghdr *message,
+                           std::uint64_t userData) {
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(nextSQE());
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(message);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+}
+
+NetworkLib::Status Uring::submit() noexcept {
+    while (mPrepared > 0) {
+        const int rc = uringEnter(mFD, static_cast<unsigned>(mPrepared), 0, 0,
+                                  nullptr, 0);
+
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return systemError();
+        }
+
+        mPrepared = *mSQTail - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE);
+
+        if (rc == 0) {
+            break;
+        }
+    }
+
+    return NetworkLib::Status();
+}
+
+NetworkLib::Status
+Uring::submitAndWait(int timeoutMsec, std::vector<Completion> &completions) {
+    unsigned head = *mCQHead;
+    unsigned tail = __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE);
+
+    // Don't wait if there are completions already.
+    const unsigned minComplete = (timeoutMsec == 0 || head != tail) ? 0 : 1;
+
+    if (mPrepared > 0 || minComplete > 0) {
+        __kernel_timespec ts;
+        io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+
+        if (timeoutMsec > 0) {
+            ts.tv_sec = timeoutMsec / 1000;
+            ts.tv_nsec = (timeoutMsec % 1000) * 1000000L;
+            arg.ts = reinterpret_cast<std::uintptr_t>(&ts);
+        }
+
+        const int rc = uringEnter(
+            mFD, static_cast<unsigned>(mPrepared), minComplete,
+            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+        if (rc == -1 && errno != ETIME && errno != EINTR && errno != EBUSY &&
+            errno != EAGAIN) {
+            return systemError();
+        }
+
+        mPrepared = *mSQTail - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE);
+        tail = __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE);
+    }
+
+    const io_uring_cqe *cqes = static_cast<const io_uring_cqe *>(mCQEs);
+
+    for (; head != tail; ++head) {
+        const io_uring_cqe &cqe = cqes[head & mCQMask];
+        Completion c;
+        c.userData = cqe.user_data;
+        c.result = cqe.res;
+        c.bufferId = (cqe.flags & IORING_CQE_F_BUFFER)
+                         ? static_cast<std::int32_t>(cqe.flags >>
+                                                     IORING_CQE_BUFFER_SHIFT)
+                         : -1;
+        c.more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        completions.push_back(c);
+    }
+
+    __atomic_store_n(mCQHead, head, __ATOMIC_RELEASE);
+
+    return NetworkLib::Status();
+}
+
+NetworkLib::BufferView Uring::receivedData(const Completion &completion) const {
+    if (completion.bufferId < 0 ||
+        static_cast<std::size_t>(completion.bufferId) >= mBuffers.size() ||
+        completion.result <= 0) {
+        return NetworkLib::BufferView();
+    }
+
+    return NetworkLib::BufferView(mBuffers[completion.bufferId])
+        .getSub_nocheck(0, static_cast<std::size_t>(completion.result));
+}
+
+void Uring::addBuffer(std::uint16_t id) noexcept {
+    // Only set the fields of the entry: the buffer ring tail overlays
+    // the reserved field of the first one.
+    io_uring_buf &buf = static_cast<io_uring_buf *>(
+        mBufferRing)[mBufferTail & mBufferMask];
+    buf.addr = reinterpret_cast<std::uintptr_t>(
+        mBuffers[id].getUnderlyingWritableBufferPtr());
+    buf.len = static_cast<std::uint32_t>(receiveBufferSize);
+    buf.bid = id;
+    ++mBufferTail;
+}
+
+void Uring::recycle(const Completion &completion) noexcept {
+    if (completion.bufferId < 0 ||
+        static_cast<std::size_t>(completion.bufferId) >= mBuffers.size()) {
+        return;
+    }
+
+    addBuffer(static_cast<std::uint16_t>(completion.bufferId));
+    __atomic_store_n(&static_cast<io_uring_buf *>(mBufferRing)[0].resv,
+                     mBufferTail, __ATOMIC_RELEASE);
+}
+
+#else
+
+// Built without the io_uring headers: never available.
+
+bool Uring::available() { return false; }
+
+Uring::Uring(unsigned, unsigned)
+    : mStatus(NetworkLib::ErrorCode::UNSUPPORTED), mPool(0) {}
+
+Uring::~Uring() {}
+
+NetworkLib::Status Uring::setup(unsigned, unsigned) {
+    return NetworkLib::ErrorCode::UNSUPPORTED;
+}
+
+void Uring::release() noexcept {}
+
+void *Uring::nextSQE() { return nullptr; }
+
+void Uring::prepareRecvMultishot(int, std::uint64_t) {}
+
+void Uring::preparePollMultishot(int, std::uint64_t) {}
+
+void Uring::prepareSendmsg(int, const msghdr *, std::uint64_t) {}
+
+NetworkLib::Status Uring::submit() noexcept {
+    return NetworkLib::ErrorCode::UNSUPPORTED;
+}
+
+NetworkLib::Status Uring::submitAndWait(int, std::vector<Completion> &) {
+    return NetworkLib::ErrorCode::UNSUPPORTED;
+}
+
+NetworkLib::BufferView Uring::receivedData(const Completion &) const {
+    return NetworkLib::BufferView();
+}
+
+void Uring::addBuffer(std::uint16_t) noexcept {}
+
+void Uring::recycle(const Completion &) noexcept {}
+
+#endif
+
+} // namespace Agent
+} // namespace Empower
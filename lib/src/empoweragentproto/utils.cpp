@@ -5,6 +5,19 @@
 #include <iterator>
 #include <string>
 
+// SIMD kernels for the bulk byte ordering functions. On x86-64 SSE2
+// is always there, while AVX2 is picked at run time (so it works
+// without building for a specific CPU).
+#if !NETWORKLIB_BIG_ENDIAN_HOST
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NETWORKLIB_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define NETWORKLIB_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
 namespace Empower {
 namespace NetworkLib {
 
@@ -145,7 +158,7 @@ static IPv4Address parseIPv4Address(
         err << "IPv4Address::IPv4Address(const std::string &): bad IPv4 "
                "address \""
             << std::string(range.first, range.second) << "\": " << errorCause;
-        throw std::invalid_argument(err.str());
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
     }
 
     return IPv4Address(parts[0], parts[1], parts[2], parts[3]);
@@ -317,7 +330,7 @@ MACAddress::MACAddress(const std::string &str) {
         std::ostringstream err;
         err << "MACAddress::MACAddress(const std::string &): bad MAC address \""
             << str << "\": " << errorCause;
-        throw std::invalid_argument(err.str());
+        NETWORKLIB_THROW(std::invalid_argument, err.str());
     }
 
     // Initialize the address, and we are done.
@@ -326,5 +339,307 @@ MACAddress::MACAddress(const std::string &str) {
     }
 }
 
+/**********************************************************************/
+
+namespace {
+
+#if NETWORKLIB_SIMD_X86
+
+bool cpuHasAVX2() noexcept {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+// Byte shuffles swapping 2, 4 or 8 bytes (for both 128-bit lanes)
+template <std::size_t width> struct SwapMask;
+
+template <> struct SwapMask<2> {
+    static __m128i get() {
+        return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                             14);
+    }
+};
+
+template <> struct SwapMask<4> {
+    static __m128i get() {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13,
+                             12);
+    }
+};
+
+template <> struct SwapMask<8> {
+    static __m128i get() {
+        return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9,
+                             8);
+    }
+};
+
+// Return the number of bytes converted (a multiple of 32).
+template <std::size_t width>
+__attribute__((target("avx2"))) std::size_t
+swapAVX2(const unsigned char *src, unsigned char *dst,
+         std::size_t bytes) noexcept {
+    const __m256i mask = _mm256_broadcastsi128_si256(SwapMask<width>::get());
+    std::size_t i = 0;
+
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                            _mm256_shuffle_epi8(v, mask));
+    }
+
+    return i;
+}
+
+// SSE2 has no byte shuffle: swap 16-bit words via shuffles, and bytes
+// within words via shifts.
+template <std::size_t width> __m128i swapSSE2(__m128i v) noexcept;
+
+template <> inline __m128i swapSSE2<2>(__m128i v) noexcept {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+template <> inline __m128i swapSSE2<4>(__m128i v) noexcept {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return swapSSE2<2>(v);
+}
+
+template <> inline __m128i swapSSE2<8>(__m128i v) noexcept {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return swapSSE2<2>(v);
+}
+
+// Return the number of bytes converted (a multiple of 16).
+template <std::size_t width>
+std::size_t swapSIMD(const unsigned char *src, unsigned char *dst,
+                     std::size_t bytes) noexcept {
+    std::size_t i = 0;
+
+    if (cpuHasAVX2()) {
+        i = swapAVX2<width>(src, dst, bytes);
+    }
+
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         swapSSE2<width>(v));
+    }
+
+    return i;
+}
+
+#elif NETWORKLIB_SIMD_NEON
+
+template <std::size_t width> uint8x16_t swapNEON(uint8x16_t v) noexcept;
+
+template <> inline uint8x16_t swapNEON<2>(uint8x16_t v) noexcept {
+    return vrev16q_u8(v);
+}
+
+template <> inline uint8x16_t swapNEON<4>(uint8x16_t v) noexcept {
+    return vrev32q_u8(v);
+}
+
+template <> inline uint8x16_t swapNEON<8>(uint8x16_t v) noexcept {
+    return vrev64q_u8(v);
+}
+
+// Return the number of bytes converted (a multiple of 16).
+template <std::size_t width>
+std::size_t swapSIMD(const unsigned char *src, unsigned char *dst,
+                     std::size_t bytes) noexcept {
+    std::size_t i = 0;
+
+    for (; i + 16 <= bytes; i += 16) {
+        vst1q_u8(dst + i, swapNEON<width>(vld1q_u8(src + i)));
+    }
+
+    return i;
+}
+
+#else
+
+template <std::size_t width>
+std::size_t swapSIMD(const unsigned char *, unsigned char *,
+                     std::size_t) noexcept {
+    return 0;
+}
+
+#endif
+
+// Sum the bytes at even offsets (the high bytes of the 16-bit
+// integers) and at odd offsets of the first bytes of the given
+// area. Return the number of bytes summed (a multiple of 16).
+#if NETWORKLIB_SIMD_X86
+
+__attribute__((target("avx2"))) std::size_t
+sumBytesAVX2(const unsigned char *p, std::size_t size, std::uint64_t &even,
+             std::uint64_t &odd) noexcept {
+    const __m256i lowMask = _mm256_set1_epi16(0x00FF);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i evenSums = zero;
+    __m256i oddSums = zero;
+    std::size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        // Loaded as little-endian words, even bytes are the low ones
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        evenSums = _mm256_add_epi64(
+            evenSums, _mm256_sad_epu8(_mm256_and_si256(v, lowMask), zero));
+        oddSums = _mm256_add_epi64(
+            oddSums, _mm256_sad_epu8(_mm256_srli_epi16(v, 8), zero));
+    }
+
+    std::uint64_t e[4];
+    std::uint64_t o[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(e), evenSums);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(o), oddSums);
+    even += e[0] + e[1] + e[2] + e[3];
+    odd += o[0] + o[1] + o[2] + o[3];
+
+    return i;
+}
+
+std::size_t sumBytesSIMD(const unsigned char *p, std::size_t size,
+                         std::uint64_t &even, std::uint64_t &odd) noexcept {
+    std::size_t i = 0;
+
+    if (cpuHasAVX2()) {
+        i = sumBytesAVX2(p, size, even, odd);
+    }
+
+    const __m128i lowMask = _mm_set1_epi16(0x00FF);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i evenSums = zero;
+    __m128i oddSums = zero;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        evenSums = _mm_add_epi64(
+            evenSums, _mm_sad_epu8(_mm_and_si128(v, lowMask), zero));
+        oddSums =
+            _mm_add_epi64(oddSums, _mm_sad_epu8(_mm_srli_epi16(v, 8), zero));
+    }
+
+    std::uint64_t e[2];
+    std::uint64_t o[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(e), evenSums);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(o), oddSums);
+    even += e[0] + e[1];
+    odd += o[0] + o[1];
+
+    return i;
+}
+
+#elif NETWORKLIB_SIMD_NEON
+
+std::size_t sumBytesSIMD(const unsigned char *p, std::size_t size,
+                         std::uint64_t &even, std::uint64_t &odd) noexcept {
+    uint64x2_t evenSums = vdupq_n_u64(0);
+    uint64x2_t oddSums = vdupq_n_u64(0);
+    std::size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        // De-interleave even and odd bytes
+        const uint8x16x2_t v = vld2q_u8(p + i);
+        evenSums = vpadalq_u32(evenSums, vpaddlq_u16(vpaddlq_u8(v.val[0])));
+        oddSums = vpadalq_u32(oddSums, vpaddlq_u16(vpaddlq_u8(v.val[1])));
+    }
+
+    even += vgetq_lane_u64(evenSums, 0) + vgetq_lane_u64(evenSums, 1);
+    odd += vgetq_lane_u64(oddSums, 0) + vgetq_lane_u64(oddSums, 1);
+
+    return i;
+}
+
+#else
+
+std::size_t sumBytesSIMD(const unsigned char *, std::size_t,
+                         std::uint64_t &, std::uint64_t &) noexcept {
+    return 0;
+}
+
+#endif
+
+// Convert count values of type T between network and host order.
+template <typename T>
+void convertArray(const void *from, void *to, std::size_t count) noexcept {
+    const unsigned char *src = static_cast<const unsigned char *>(from);
+    unsigned char *dst = static_cast<unsigned char *>(to);
+    const std::size_t bytes = count * sizeof(T);
+
+#if NETWORKLIB_BIG_ENDIAN_HOST
+    // Network order is host order: just copy (unless in place).
+    if (src != dst) {
+        std::memcpy(dst, src, bytes);
+    }
+#else
+    std::size_t i = swapSIMD<sizeof(T)>(src, dst, bytes);
+
+    for (; i < bytes; i += sizeof(T)) {
+        T v;
+        std::memcpy(&v, src + i, sizeof(T));
+        v = swapByteOrder(v);
+        std::memcpy(dst + i, &v, sizeof(T));
+    }
+#endif
+}
+
+} // namespace
+
+std::uint64_t getSum16At(const void *ptr, std::size_t size) noexcept {
+    const unsigned char *p = static_cast<const unsigned char *>(ptr);
+    std::uint64_t even = 0;
+    std::uint64_t odd = 0;
+    std::size_t i = sumBytesSIMD(p, size, even, odd);
+
+    for (; i + 2 <= size; i += 2) {
+        even += p[i];
+        odd += p[i + 1];
+    }
+
+    if (i < size) {
+        // Add the last byte as if a 0 was appended to make the size
+        // even.
+        even += p[i];
+    }
+
+    return (even << 8) + odd;
+}
+
+void getUint64ArrayAt(const void *ptr, std::uint64_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint64_t>(ptr, values, count);
+}
+
+void getUint32ArrayAt(const void *ptr, std::uint32_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint32_t>(ptr, values, count);
+}
+
+void getUint16ArrayAt(const void *ptr, std::uint16_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint16_t>(ptr, values, count);
+}
+
+void setUint64ArrayAt(void *ptr, const std::uint64_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint64_t>(values, ptr, count);
+}
+
+void setUint32ArrayAt(void *ptr, const std::uint32_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint32_t>(values, ptr, count);
+}
+
+void setUint16ArrayAt(void *ptr, const std::uint16_t *values,
+                      std::size_t count) noexcept {
+    convertArray<std::uint16_t>(values, ptr, count);
+}
+
 } // namespace NetworkLib
 } // namespace Empower
@@ -0,0 +1,157 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+std::string tempPath() {
+    char path[] = "/tmp/capturetestXXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+    return path;
+}
+
+std::vector<unsigned char> makeMessage(std::size_t size, unsigned char c) {
+    return std::vector<unsigned char>(size, c);
+}
+
+NL::BufferView viewOf(const std::vector<unsigned char> &data) {
+    return NL::BufferView::makeNonOwningBufferView(data.data(), data.size());
+}
+
+// Read back all the records, checking that the i-th one is
+// `messages[i]`.
+void checkRecords(const std::string &path,
+                  const std::vector<std::vector<unsigned char>> &messages,
+                  bool truncated) {
+    AGT::CaptureReader reader(path);
+    AGT::CaptureReader::Record record;
+    std::size_t count = 0;
+
+    while (reader.next(record)) {
+        CHECK(count < messages.size());
+
+        if (count < messages.size()) {
+            const auto &expected = messages[count];
+            CHECK(record.message.size() == expected.size());
+            CHECK(record.message.size() == 0 ||
+                  std::memcmp(record.message.getUnderlyingBufferPtr(),
+                              expected.data(), expected.size()) == 0);
+            CHECK(record.connection == count);
+            CHECK(record.direction == (count % 2 == 0
+                                           ? AGT::CaptureDirection::SENT
+                                           : AGT::CaptureDirection::RECEIVED));
+        }
+
+        ++count;
+    }
+
+    CHECK(count == messages.size());
+    CHECK(reader.truncated() == truncated);
+}
+
+void record(AGT::CaptureWriter &writer,
+            std::vector<std::vector<unsigned char>> &messages,
+            std::size_t size) {
+    const std::uint32_t connection =
+        static_cast<std::uint32_t>(messages.size());
+    messages.push_back(makeMessage(size, static_cast<unsigned char>(size)));
+    CHECK(writer.record_nothrow(connection,
+                                connection % 2 == 0
+                                    ? AGT::CaptureDirection::SENT
+                                    : AGT::CaptureDirection::RECEIVED,
+                                viewOf(messages.back())));
+}
+
+void testRoundTrip() {
+    const std::string path = tempPath();
+    std::remove(path.c_str());
+    std::vector<std::vector<unsigned char>> messages;
+
+    {
+        // A small buffer, so that some records are written right away.
+        AGT::CaptureWriter writer(path, 256);
+
+        for (std::size_t size : {0, 1, 7, 8, 9, 100, 300, 1000}) {
+            record(writer, messages, size);
+        }
+
+        CHECK(writer.records() == messages.size());
+    }
+
+    checkRecords(path, messages, false);
+
+    // Appending
+    {
+        AGT::CaptureWriter writer(path);
+        record(writer, messages, 50);
+    }
+
+    checkRecords(path, messages, false);
+    std::remove(path.c_str());
+}
+
+void testTruncatedTail() {
+    const std::string path = tempPath();
+    std::remove(path.c_str());
+    std::vector<std::vector<unsigned char>> messages;
+
+    {
+        AGT::CaptureWriter writer(path);
+        record(writer, messages, 100);
+        record(writer, messages, 200);
+    }
+
+    // Cut the last record short, as a crash could.
+    std::FILE *file = std::fopen(path.c_str(), "r+");
+    CHECK(file != nullptr);
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    CHECK(truncate(path.c_str(), size - 50) == 0);
+
+    messages.pop_back();
+    checkRecords(path, messages, true);
+
+    // Appending drops it first.
+    {
+        AGT::CaptureWriter writer(path);
+        record(writer, messages, 300);
+        record(writer, messages, 5);
+    }
+
+    checkRecords(path, messages, false);
+
+    // Same with just part of a record header.
+    file = std::fopen(path.c_str(), "a");
+    CHECK(file != nullptr);
+    std::fwrite("abc", 1, 3, file);
+    std::fclose(file);
+    checkRecords(path, messages, true);
+
+    {
+        AGT::CaptureWriter writer(path);
+        record(writer, messages, 10);
+    }
+
+    checkRecords(path, messages, false);
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testTruncatedTail();
+    return TestUtils::result();
+}
@@ -0,0 +1,116 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+NL::BufferWritableView makeMessage(AGT::EntityClass entityClass,
+                                   AGT::MessageClass messageClass) {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    encoder.header().messageClass(messageClass).entityClass(entityClass);
+    encoder.end();
+    return encoder.data();
+}
+
+void testRouting() {
+    int echoGets = 0;
+    int echoOthers = 0;
+    int hellos = 0;
+    int unhandled = 0;
+
+    AGT::Dispatcher dispatcher;
+    dispatcher.on(AGT::EntityClass::ECHO_SERVICE,
+                  [&](const AGT::Dispatcher::Message &) { ++echoOthers; })
+        .on(AGT::EntityClass::ECHO_SERVICE, AGT::MessageClass::REQUEST_GET,
+            [&](const AGT::Dispatcher::Message &m) {
+                CHECK(m.header.messageClass ==
+                      AGT::MessageClass::REQUEST_GET);
+                ++echoGets;
+            })
+        .on(AGT::EntityClass::HELLO_SERVICE,
+            [&](const AGT::Dispatcher::Message &) { ++hellos; })
+        .onUnhandled(
+            [&](const AGT::Dispatcher::Message &) { ++unhandled; });
+
+    CHECK(dispatcher.dispatch(
+        1, makeMessage(AGT::EntityClass::ECHO_SERVICE,
+                       AGT::MessageClass::REQUEST_GET)));
+    CHECK(dispatcher.dispatch(
+        1, makeMessage(AGT::EntityClass::ECHO_SERVICE,
+                       AGT::MessageClass::RESPONSE_SUCCESS)));
+    CHECK(dispatcher.dispatch(
+        1, makeMessage(AGT::EntityClass::HELLO_SERVICE,
+                       AGT::MessageClass::REQUEST_SET)));
+    CHECK(!dispatcher.dispatch(
+        1, makeMessage(AGT::EntityClass::CAPABILITIES_SERVICE,
+                       AGT::MessageClass::REQUEST_GET)));
+
+    CHECK(echoGets == 1 && echoOthers == 1 && hellos == 1 && unhandled == 1);
+    CHECK(dispatcher.stats().dispatched == 3);
+    CHECK(dispatcher.stats().unhandled == 1);
+}
+
+void testReplacedHandlers() {
+    int first = 0;
+    int second = 0;
+
+    AGT::Dispatcher dispatcher;
+
+    for (int i = 0; i < 1000; ++i) {
+        dispatcher.on(AGT::EntityClass::ECHO_SERVICE,
+                      [&](const AGT::Dispatcher::Message &) { ++first; });
+    }
+
+    dispatcher.on(AGT::EntityClass::ECHO_SERVICE,
+                  AGT::MessageClass::REQUEST_GET,
+                  [&](const AGT::Dispatcher::Message &) { ++second; });
+
+    dispatcher.dispatch(1, makeMessage(AGT::EntityClass::ECHO_SERVICE,
+                                       AGT::MessageClass::REQUEST_GET));
+    dispatcher.dispatch(1, makeMessage(AGT::EntityClass::ECHO_SERVICE,
+                                       AGT::MessageClass::REQUEST_ADD));
+    CHECK(first == 1 && second == 1);
+}
+
+void testMalformed() {
+    int handled = 0;
+
+    AGT::Dispatcher dispatcher;
+    dispatcher.on(AGT::EntityClass::ECHO_SERVICE,
+                  [&](const AGT::Dispatcher::Message &) { ++handled; })
+        .onUnhandled([&](const AGT::Dispatcher::Message &) { ++handled; });
+
+    auto message = makeMessage(AGT::EntityClass::ECHO_SERVICE,
+                               AGT::MessageClass::REQUEST_GET);
+
+    // Too short
+    CHECK(!dispatcher.dispatch(1, message.getSub(0, 10)));
+
+    // Bad version
+    auto copy = AGT::IO::makeMessageBufferFor(message);
+    message.copyTo(copy);
+    copy.setUint8At(AGT::ReferenceProtocolStructs::Preamble::versionOffset, 3);
+    CHECK(!dispatcher.dispatch(1, copy));
+
+    // Longer than what's there
+    message.copyTo(copy);
+    copy.setUint32At(AGT::ReferenceProtocolStructs::Preamble::lengthOffset,
+                     60000);
+    CHECK(!dispatcher.dispatch(1, copy));
+
+    CHECK(handled == 0);
+    CHECK(dispatcher.stats().unhandled == 3);
+}
+
+} // namespace
+
+int main() {
+    testRouting();
+    testReplacedHandlers();
+    testMalformed();
+    return TestUtils::result();
+}
@@ -0,0 +1,211 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+using Preamble = AGT::ReferenceProtocolStructs::Preamble;
+
+namespace {
+
+// A message of the given length (only the preamble matters to the
+// framer), filled with a pattern telling the messages apart.
+std::vector<unsigned char> makeMessage(std::size_t length,
+                                       unsigned char pattern) {
+    std::vector<unsigned char> message(length, pattern);
+    auto view =
+        NL::BufferWritableView::makeNonOwningBufferWritableView(
+            message.data(), message.size());
+    view.setUint8At(Preamble::versionOffset, 2);
+    view.setUint32At(Preamble::lengthOffset,
+                     static_cast<std::uint32_t>(length));
+    return message;
+}
+
+// Like a read(2) of up to `max` bytes of the data (from `offset`) into
+// the free space of the framer.
+NL::Status read(AGT::MessageFramer &framer,
+                const std::vector<unsigned char> &data, std::size_t &offset,
+                std::size_t max) {
+    NL::BufferWritableView space;
+    NL::Status status = framer.freeSpace_nothrow(space);
+
+    if (!status) {
+        return status;
+    }
+
+    CHECK(!space.empty());
+
+    std::size_t len = std::min(space.size(), data.size() - offset);
+    len = std::min(len, max);
+    std::memcpy(space.getUnderlyingWritableBufferPtr(), data.data() + offset,
+                len);
+    framer.commit(len);
+    offset += len;
+    return status;
+}
+
+bool sameAs(const NL::BufferView &message,
+            const std::vector<unsigned char> &expected) {
+    return message.size() == expected.size() &&
+           std::memcmp(message.getUnderlyingBufferPtr(), expected.data(),
+                       expected.size()) == 0;
+}
+
+// A message coming in with reads of at most `chunk` bytes.
+void testSplit(AGT::MessageFramer &framer, std::size_t length,
+               std::size_t chunk) {
+    const auto message = makeMessage(length, 0x5a);
+    std::size_t offset = 0;
+    NL::BufferView out;
+
+    while (offset < message.size()) {
+        CHECK(framer.nextMessage_nothrow(out));
+        CHECK(out.empty());
+
+        const NL::Status status = read(framer, message, offset, chunk);
+        CHECK(status);
+
+        if (!status) {
+            return;
+        }
+    }
+
+    CHECK(framer.state() == AGT::MessageFramer::State::COMPLETE);
+    CHECK(framer.nextMessage_nothrow(out));
+    CHECK(sameAs(out, message));
+    CHECK(framer.pendingBytes() == 0);
+}
+
+void testSplitAcrossReads() {
+    AGT::MessageFramer framer;
+
+    for (std::size_t chunk : {1, 3, 7, 100, 1500}) {
+        testSplit(framer, 3000, chunk);
+    }
+
+    // Two messages and a half in one read, then the rest.
+    const auto first = makeMessage(100, 1);
+    const auto second = makeMessage(200, 2);
+    const auto third = makeMessage(300, 3);
+
+    std::vector<unsigned char> data(first);
+    data.insert(data.end(), second.begin(), second.end());
+    data.insert(data.end(), third.begin(), third.end());
+
+    std::size_t offset = 0;
+    CHECK(read(framer, data, offset, 450));
+
+    NL::BufferView out;
+    CHECK(framer.nextMessage_nothrow(out) && sameAs(out, first));
+    CHECK(framer.nextMessage_nothrow(out) && sameAs(out, second));
+    CHECK(framer.nextMessage_nothrow(out) && out.empty());
+    CHECK(framer.state() == AGT::MessageFramer::State::READING_BODY);
+    CHECK(framer.remaining() == 150);
+
+    CHECK(read(framer, data, offset, data.size()));
+    CHECK(framer.nextMessage_nothrow(out) && sameAs(out, third));
+}
+
+void testMaximumLength() {
+    // Both with heap buffers and with the ones of IO.
+    AGT::MessageFramer heapFramer;
+    AGT::MessageFramer ioFramer(65500, &AGT::IO::makeMessageBuffer);
+
+    for (AGT::MessageFramer *framer : {&heapFramer, &ioFramer}) {
+        testSplit(*framer, 65500, 65500);
+
+        // The last few bytes come in a read of their own (into less
+        // than the minimum free space).
+        for (std::size_t length : {64990, 65000, 65300, 65500}) {
+            testSplit(*framer, length, 64999);
+            testSplit(*framer, length, length - 1);
+        }
+
+        // After a bit of a previous message.
+        const auto small = makeMessage(1000, 1);
+        const auto large = makeMessage(65500, 2);
+        std::vector<unsigned char> data(small);
+        data.insert(data.end(), large.begin(), large.end());
+
+        std::size_t offset = 0;
+        NL::BufferView out;
+        bool ok = true;
+
+        while (ok && offset < data.size()) {
+            ok = read(*framer, data, offset, 30000).ok();
+            CHECK(ok);
+
+            for (CHECK(framer->nextMessage_nothrow(out)); !out.empty();
+                 CHECK(framer->nextMessage_nothrow(out))) {
+                CHECK(sameAs(out, out.size() == 1000 ? small : large));
+            }
+        }
+
+        CHECK(framer->pendingBytes() == 0);
+    }
+
+    // One byte too many
+    AGT::MessageFramer framer;
+    framer.feed(NL::BufferView::makeNonOwningBufferView(
+        makeMessage(65501, 0).data(), Preamble::size));
+    NL::BufferView out;
+    CHECK(framer.nextMessage_nothrow(out).code() ==
+          NL::ErrorCode::BAD_MESSAGE_LENGTH);
+}
+
+void testHeaderOnly() {
+    AGT::MessageFramer framer;
+    NL::BufferView out;
+
+    // A message made of just its preamble
+    const auto empty = makeMessage(Preamble::size, 1);
+    framer.feed(NL::BufferView::makeNonOwningBufferView(empty.data(),
+                                                        empty.size()));
+    CHECK(framer.state() == AGT::MessageFramer::State::COMPLETE);
+    CHECK(framer.nextMessage_nothrow(out) && sameAs(out, empty));
+
+    // The preamble of a longer one: then the free space is enough for
+    // the rest of it.
+    const auto message = makeMessage(40000, 2);
+    std::size_t offset = 0;
+    CHECK(read(framer, message, offset, Preamble::size));
+    CHECK(framer.state() == AGT::MessageFramer::State::READING_BODY);
+    CHECK(framer.remaining() == 40000 - Preamble::size);
+    CHECK(framer.nextMessage_nothrow(out) && out.empty());
+    CHECK(framer.freeSpace().size() >= framer.remaining());
+
+    // Part of a preamble
+    AGT::MessageFramer partial;
+    offset = 0;
+    CHECK(read(partial, message, offset, Preamble::size - 1));
+    CHECK(partial.state() == AGT::MessageFramer::State::READING_PREAMBLE);
+    CHECK(partial.remaining() == 1);
+    CHECK(partial.nextMessage_nothrow(out) && out.empty());
+
+    // A length shorter than the preamble
+    auto shorter = makeMessage(Preamble::size, 0);
+    NL::BufferWritableView::makeNonOwningBufferWritableView(shorter.data(),
+                                                            shorter.size())
+        .setUint32At(Preamble::lengthOffset, 4);
+
+    AGT::MessageFramer bogus;
+    bogus.feed(NL::BufferView::makeNonOwningBufferView(shorter.data(),
+                                                       shorter.size()));
+    CHECK(bogus.nextMessage_nothrow(out).code() ==
+          NL::ErrorCode::BAD_MESSAGE_LENGTH);
+}
+
+} // namespace
+
+int main() {
+    testSplitAcrossReads();
+    testMaximumLength();
+    testHeaderOnly();
+    return TestUtils::result();
+}
@@ -0,0 +1,71 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <stdexcept>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+void testMessageClassRoundTrip() {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+
+    for (AGT::MessageClass c :
+         {AGT::MessageClass::REQUEST_SET, AGT::MessageClass::REQUEST_ADD,
+          AGT::MessageClass::REQUEST_DEL, AGT::MessageClass::REQUEST_GET,
+          AGT::MessageClass::RESPONSE_SUCCESS,
+          AGT::MessageClass::RESPONSE_FAILURE}) {
+        AGT::CommonHeaderEncoder encoder(buffer);
+        encoder.messageClass(c)
+            .entityClass(AGT::EntityClass::ECHO_SERVICE)
+            .totalLengthBytes(encoder.size());
+
+        AGT::CommonHeaderDecoder decoder(buffer);
+        CHECK(decoder.messageClass() == c);
+        CHECK(decoder.entityClass() == AGT::EntityClass::ECHO_SERVICE);
+    }
+
+    // Bits 14-15 of ts_rc, as in the README
+    const struct {
+        AGT::MessageClass messageClass;
+        unsigned operation;
+    } requests[] = {{AGT::MessageClass::REQUEST_GET, 0},
+                    {AGT::MessageClass::REQUEST_SET, 1},
+                    {AGT::MessageClass::REQUEST_ADD, 2},
+                    {AGT::MessageClass::REQUEST_DEL, 3}};
+
+    for (const auto &r : requests) {
+        AGT::CommonHeaderEncoder encoder(buffer);
+        encoder.messageClass(r.messageClass);
+        CHECK((buffer.getUint16At(
+                   AGT::ReferenceProtocolStructs::CommonHeader::tsrcOffset) >>
+               14) == r.operation);
+    }
+}
+
+void testInvalidMessageClass() {
+    // (Without exceptions, the library aborts instead.)
+#if !defined(EMPOWER_NETWORKLIB_NO_EXCEPTIONS)
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    AGT::CommonHeaderEncoder encoder(buffer);
+    bool thrown = false;
+
+    try {
+        encoder.messageClass(AGT::MessageClass::INVALID);
+    } catch (std::invalid_argument &) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+#endif
+}
+
+} // namespace
+
+int main() {
+    testMessageClassRoundTrip();
+    testInvalidMessageClass();
+    return TestUtils::result();
+}
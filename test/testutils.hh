@@ -0,0 +1,39 @@
+#ifndef EMPOWER_AGENT_TEST_TESTUTILS_HH
+#define EMPOWER_AGENT_TEST_TESTUTILS_HH
+
+#include <iostream>
+
+// A minimal harness: each test program runs its checks, reporting the
+// failed ones (and going on), and returns the outcome from main().
+
+namespace TestUtils {
+
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool ok, const char *what, const char *file, int line) {
+    if (!ok) {
+        ++failures();
+        std::cerr << file << ':' << line << ": check failed: " << what
+                  << '\n';
+    }
+}
+
+// Return the exit status of the test program.
+inline int result() {
+    if (failures() != 0) {
+        std::cerr << failures() << " check(s) failed\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+} // namespace TestUtils
+
+#define CHECK(cond)                                                           \
+    TestUtils::check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
+
+#endif
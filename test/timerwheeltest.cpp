@@ -0,0 +1,185 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <cstdint>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+
+using Clock = AGT::TimerWheel::Clock;
+using TimerId = AGT::TimerWheel::TimerId;
+
+namespace {
+
+const std::chrono::milliseconds tick(1000);
+
+// Jobs are scheduled from the current time: starting the wheel half a
+// tick ago, a delay of n ticks always expires at tick n + 1.
+Clock::time_point halfTickAgo() { return Clock::now() - tick / 2; }
+
+Clock::time_point timeOf(Clock::time_point start, std::uint64_t ticks) {
+    return start + tick * ticks;
+}
+
+struct Fired {
+    std::uint64_t key;
+    std::uint64_t tick;
+};
+
+// One-shot jobs at delays spanning all the levels, so that most of
+// them move down one or more levels before running.
+const std::vector<std::uint64_t> delays = {
+    1,        2,        255,      256,      257,      511,
+    512,      65535,    65536,    65537,    65792,    70000,
+    196625,   16777215, 16777216, 16777217, 16777516,
+};
+
+void testCascade() {
+    const auto start = halfTickAgo();
+    AGT::TimerWheel wheel(tick, start);
+    std::uint64_t now = 0;
+    std::vector<Fired> fired;
+
+    for (std::uint64_t delay : delays) {
+        wheel.schedule(tick * delay, delay,
+                       [&](TimerId, std::uint64_t key) {
+                           fired.push_back({key, now});
+                       });
+    }
+
+    CHECK(wheel.size() == delays.size());
+
+    // Advance as the wheel tells, which is never past the next job (or
+    // the next move between levels).
+    while (!wheel.empty()) {
+        const int timeout = wheel.timeoutMsec(timeOf(start, now));
+        CHECK(timeout >= 0);
+        const std::uint64_t ticks =
+            (static_cast<std::uint64_t>(timeout) + tick.count() - 1) /
+            tick.count();
+        now += ticks == 0 ? 1 : ticks;
+        wheel.advance(timeOf(start, now));
+    }
+
+    CHECK(wheel.timeoutMsec(timeOf(start, now)) == -1);
+    CHECK(fired.size() == delays.size());
+
+    for (std::size_t i = 0; i < fired.size() && i < delays.size(); ++i) {
+        // Never early nor late, and in order.
+        CHECK(fired[i].key == delays[i]);
+        CHECK(fired[i].tick == delays[i] + 1);
+    }
+
+    // One big step runs them all, still in order.
+    AGT::TimerWheel late(tick, start);
+    fired.clear();
+
+    for (std::uint64_t delay : delays) {
+        late.schedule(tick * delay, delay, [&](TimerId, std::uint64_t key) {
+            fired.push_back({key, 0});
+        });
+    }
+
+    CHECK(late.advance(timeOf(start, 16777216)) == delays.size() - 3);
+    CHECK(late.size() == 3);
+    CHECK(late.advance(timeOf(start, 16777517)) == 3);
+    CHECK(late.empty());
+    CHECK(fired.size() == delays.size());
+
+    for (std::size_t i = 0; i < fired.size() && i < delays.size(); ++i) {
+        CHECK(fired[i].key == delays[i]);
+    }
+}
+
+void testPeriodic() {
+    const auto start = halfTickAgo();
+    AGT::TimerWheel wheel(tick, start);
+    std::vector<std::uint64_t> runs;
+    std::uint64_t now = 0;
+
+    // First run at tick 4, then every 3 ticks.
+    const TimerId id = wheel.schedulePeriodic(
+        tick * 3, 7, [&](TimerId, std::uint64_t key) {
+            CHECK(key == 7);
+            runs.push_back(now);
+        });
+
+    for (now = 1; now <= 13; ++now) {
+        wheel.advance(timeOf(start, now));
+    }
+
+    CHECK((runs == std::vector<std::uint64_t>{4, 7, 10, 13}));
+    CHECK(wheel.scheduled(id));
+
+    // Late: it runs once, and keeps its phase.
+    now = 20;
+    CHECK(wheel.advance(timeOf(start, now)) == 1);
+    CHECK(runs.size() == 5);
+    now = 21;
+    CHECK(wheel.advance(timeOf(start, now)) == 0);
+    now = 22;
+    CHECK(wheel.advance(timeOf(start, now)) == 1);
+    CHECK(runs.back() == 22);
+
+    CHECK(wheel.cancel(id));
+    CHECK(!wheel.scheduled(id));
+    CHECK(!wheel.cancel(id));
+    CHECK(wheel.empty());
+    CHECK(wheel.advance(timeOf(start, 100)) == 0);
+}
+
+void testCancel() {
+    const auto start = halfTickAgo();
+    AGT::TimerWheel wheel(tick, start);
+    int runs = 0;
+
+    // A one-shot job is gone once it ran.
+    const TimerId once =
+        wheel.schedule(tick, 0, [&](TimerId, std::uint64_t) { ++runs; });
+    CHECK(wheel.scheduled(once));
+    CHECK(wheel.advance(timeOf(start, 2)) == 1);
+    CHECK(!wheel.scheduled(once));
+    CHECK(!wheel.cancel(once));
+
+    // Cancelled on a higher level, before moving down.
+    const TimerId far =
+        wheel.schedule(tick * 1000, 0, [&](TimerId, std::uint64_t) { ++runs; });
+    CHECK(wheel.cancel(far));
+    CHECK(wheel.advance(timeOf(start, 2000)) == 0);
+
+    // Its identifier isn't reused by the next job in the same node.
+    const TimerId next =
+        wheel.schedule(tick * 5000, 0, [&](TimerId, std::uint64_t) { ++runs; });
+    CHECK(next != far);
+    CHECK(!wheel.scheduled(far));
+    CHECK(wheel.scheduled(next));
+    CHECK(wheel.cancel(next));
+
+    // Jobs in the same slot cancelling each other, and themselves.
+    runs = 0;
+    TimerId ids[2];
+
+    for (int i = 0; i < 2; ++i) {
+        ids[i] = wheel.schedulePeriodic(
+            tick * 3000, i, [&](TimerId self, std::uint64_t key) {
+                ++runs;
+                CHECK(wheel.cancel(ids[1 - key]));
+                CHECK(wheel.cancel(self));
+            });
+    }
+
+    CHECK(wheel.size() == 2);
+    CHECK(wheel.advance(timeOf(start, 10000)) == 1);
+    CHECK(runs == 1);
+    CHECK(wheel.empty());
+}
+
+} // namespace
+
+int main() {
+    testCascade();
+    testPeriodic();
+    testCancel();
+    return TestUtils::result();
+}
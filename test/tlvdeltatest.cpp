@@ -0,0 +1,175 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+AGT::TLVUEReport report(std::uint16_t rnti, std::uint64_t imsi) {
+    AGT::TLVUEReport result;
+    result.rnti(rnti).imsi(imsi).tmsi(rnti * 3).status(1);
+    return result;
+}
+
+// The TLV as a receiver would see it.
+AGT::TLVDeltaListOf<AGT::TLVUEReport>
+roundTrip(AGT::TLVDeltaListOf<AGT::TLVUEReport> &delta) {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    const std::size_t length = delta.encode(buffer);
+    CHECK(length == delta.encodedSize());
+
+    AGT::TLVDeltaListOf<AGT::TLVUEReport> result;
+    CHECK(result.decode(buffer.getSub(0, length)) == length);
+    return result;
+}
+
+std::vector<std::uint16_t>
+rntisOf(const std::vector<AGT::TLVUEReport> &elements) {
+    std::vector<std::uint16_t> result;
+
+    for (const auto &element : elements) {
+        result.push_back(element.rnti());
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void testPeriods() {
+    AGT::DeltaReporter<AGT::TLVUEReport> reporter(4);
+
+    // The first period is a full resync.
+    reporter.begin();
+    reporter.update(report(1, 100));
+    reporter.update(report(2, 200));
+    reporter.update(report(3, 300));
+    auto *delta = &reporter.end();
+    CHECK(delta->full());
+    CHECK((rntisOf(delta->elements()) == std::vector<std::uint16_t>{1, 2, 3}));
+    CHECK(delta->removed().empty());
+    CHECK(reporter.size() == 3);
+
+    // Nothing changed
+    reporter.begin();
+    reporter.update(report(1, 100));
+    reporter.update(report(2, 200));
+    reporter.update(report(3, 300));
+    delta = &reporter.end();
+    CHECK(!delta->full());
+    CHECK(delta->empty());
+
+    // Updated, added and removed
+    reporter.begin();
+    reporter.update(report(1, 100));
+    reporter.update(report(2, 201));
+    reporter.update(report(4, 400));
+    delta = &reporter.end();
+    CHECK(!delta->full());
+    CHECK((rntisOf(delta->elements()) == std::vector<std::uint16_t>{2, 4}));
+    CHECK((delta->removed() == std::vector<std::uint32_t>{3}));
+    CHECK(reporter.size() == 3);
+
+    const auto received = roundTrip(*delta);
+    CHECK(!received.full());
+    CHECK((rntisOf(received.elements()) == rntisOf(delta->elements())));
+    CHECK(received.removed() == delta->removed());
+
+    // A removed element coming back is a new one.
+    reporter.begin();
+    reporter.update(report(1, 100));
+    reporter.update(report(2, 201));
+    reporter.update(report(3, 300));
+    reporter.update(report(4, 400));
+    delta = &reporter.end();
+    CHECK((rntisOf(delta->elements()) == std::vector<std::uint16_t>{3}));
+    CHECK(delta->removed().empty());
+
+    // Every 4 periods, all of them (and no removed keys).
+    reporter.begin();
+    reporter.update(report(1, 100));
+    reporter.update(report(2, 201));
+    delta = &reporter.end();
+    CHECK(delta->full());
+    CHECK((rntisOf(delta->elements()) == std::vector<std::uint16_t>{1, 2}));
+    CHECK(delta->removed().empty());
+    CHECK(reporter.size() == 2);
+
+    // And on request
+    reporter.resync();
+    reporter.begin();
+    reporter.update(report(1, 100));
+    delta = &reporter.end();
+    CHECK(delta->full());
+    CHECK(delta->elements().size() == 1);
+}
+
+// Many elements coming and going: the state rebuilt by a receiver
+// from the deltas must always be the current one. Removing many keys
+// out of crowded clusters of the table exercises the backward-shift
+// erase (a key lost by it would never be reported again, and a stale
+// one would make the next lookup miss).
+void testChurn() {
+    AGT::DeltaReporter<AGT::TLVUEReport> reporter(0);
+    std::mt19937 rng(1);
+    std::map<std::uint16_t, std::uint64_t> current;
+    std::unordered_map<std::uint32_t, AGT::TLVUEReport> received;
+
+    for (int period = 0; period < 500; ++period) {
+        // Remove some, change some, and add some (in bursts, so that
+        // the table grows and clusters form).
+        for (auto it = current.begin(); it != current.end();) {
+            if (rng() % 4 == 0) {
+                it = current.erase(it);
+            } else {
+                if (rng() % 8 == 0) {
+                    ++it->second;
+                }
+
+                ++it;
+            }
+        }
+
+        const std::size_t added = period % 50 < 10 ? 40 : 5;
+
+        for (std::size_t i = 0; i < added; ++i) {
+            // Mostly consecutive RNTIs, as they are usually assigned
+            const std::uint16_t rnti =
+                static_cast<std::uint16_t>(rng() % 4 == 0 ? rng() % 65536
+                                                          : rng() % 600);
+            current.emplace(rnti, rng());
+        }
+
+        reporter.begin();
+
+        for (const auto &entry : current) {
+            reporter.update(report(entry.first, entry.second));
+        }
+
+        auto delta = roundTrip(reporter.end());
+        delta.applyTo(received);
+
+        CHECK(reporter.size() == current.size());
+        CHECK(received.size() == current.size());
+
+        for (const auto &entry : current) {
+            auto it = received.find(entry.first);
+            CHECK(it != received.end() && it->second.imsi() == entry.second);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    testPeriods();
+    testChurn();
+    return TestUtils::result();
+}
@@ -0,0 +1,170 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <cstdint>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+AGT::TLVUEReport report(std::uint16_t rnti) {
+    AGT::TLVUEReport result;
+    result.rnti(rnti).imsi(1000 + rnti);
+    return result;
+}
+
+void setHeader(AGT::MessageEncoder &encoder) {
+    encoder.header()
+        .messageClass(AGT::MessageClass::REQUEST_GET)
+        .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE);
+}
+
+void testLookup() {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    setHeader(encoder);
+
+    AGT::TLVUEMeasurementReport measurement;
+    measurement.rnti(7).rsrp(77);
+    AGT::TLVError error;
+    error.errcode(42).message("boom");
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+    list.add(report(10)).add(report(11));
+
+    encoder.add(report(1))
+        .add(measurement)
+        .add(report(2))
+        .add(error)
+        .add(list)
+        .add(report(3))
+        .end();
+
+    AGT::MessageDecoder decoder(encoder.data());
+    const AGT::TLVIndex &index = decoder.index();
+    CHECK(index.size() == 6);
+
+    // In order, with the data in place
+    std::size_t n = 0;
+
+    for (const auto &entry : index) {
+        CHECK(entry.offset + entry.length <= encoder.data().size());
+        ++n;
+    }
+
+    CHECK(n == index.size());
+    CHECK(index[1].type == AGT::TLVType::UE_MEASUREMENT_REPORT);
+    CHECK(index[4].type == AGT::TLVType::LIST_OF_TLV);
+
+    // The chain of TLVs of the same type
+    CHECK(index.count(AGT::TLVType::UE_REPORT) == 3);
+    std::size_t i = index.find(AGT::TLVType::UE_REPORT);
+    CHECK(i == 0);
+    i = index.findNext(i);
+    CHECK(i == 2);
+    i = index.findNext(i);
+    CHECK(i == 5);
+    CHECK(index.findNext(i) == AGT::TLVIndex::npos);
+    CHECK(AGT::TLVUEReportView(decoder.view(index[5])).rnti() == 3);
+
+    CHECK(index.count(AGT::TLVType::CELL) == 0);
+    CHECK(index.find(AGT::TLVType::CELL) == AGT::TLVIndex::npos);
+    CHECK(!decoder.find(AGT::TLVType::CELL));
+
+    // Decoding by type, in any order
+    AGT::TLVError decodedError;
+    CHECK(decoder.tryGet(decodedError) && decodedError.errcode() == 42 &&
+          decodedError.message() == "boom");
+    AGT::TLVUEMeasurementReport decodedMeasurement;
+    CHECK(decoder.tryGet(decodedMeasurement) &&
+          decodedMeasurement.rsrp() == 77);
+    AGT::TLVCell cell;
+    CHECK(!decoder.tryGet(cell));
+
+    // A list is found as such.
+    AGT::TLVListOfView<AGT::TLVUEReport> listView(
+        decoder.find(AGT::TLVType::LIST_OF_TLV));
+    CHECK(listView.size() == 2 && listView.materialize(1).rnti() == 11);
+
+    // Independent of the decoding in sequence
+    AGT::TLVUEReport first;
+    decoder.get(first);
+    CHECK(first.rnti() == 1);
+}
+
+void testOtherTypes() {
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    setHeader(encoder);
+    encoder.add(report(1)).add(report(2)).add(report(3)).end();
+
+    // Types beyond the direct lookup table are scanned for.
+    const auto otherType =
+        static_cast<AGT::TLVType>(AGT::TLVIndex::directLookupTypes + 5);
+
+    {
+        AGT::MessageDecoder decoder(encoder.data());
+
+        for (std::size_t i : {0, 2}) {
+            const auto &entry = decoder.index()[i];
+            buffer.setUint16At(entry.offset - AGT::TLVHeader::headerLength,
+                               static_cast<std::uint16_t>(otherType));
+        }
+    }
+
+    AGT::MessageDecoder decoder(encoder.data());
+    const AGT::TLVIndex &index = decoder.index();
+    CHECK(index.count(otherType) == 2);
+    CHECK(index.find(otherType) == 0);
+    CHECK(index.findNext(0) == 2);
+    CHECK(index.findNext(2) == AGT::TLVIndex::npos);
+    CHECK(index.find(AGT::TLVType::UE_REPORT) == 1);
+    CHECK(index.findNext(1) == AGT::TLVIndex::npos);
+}
+
+void testMalformed() {
+    // A bad TLV length
+    auto buffer = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder encoder(buffer);
+    setHeader(encoder);
+    encoder.add(report(1)).add(report(2)).end();
+    buffer.setUint16At(AGT::CommonHeader::totalLength + 2, 200);
+
+    AGT::MessageDecoder bad(encoder.data());
+    CHECK(bad.index_nothrow().code() == NL::ErrorCode::BAD_TLV_LENGTH);
+
+    AGT::TLVUEReport tlv;
+    CHECK(!bad.tryGet_nothrow(tlv).ok());
+
+    // Too many TLVs for an index (but not for next())
+    auto large = AGT::IO::makeMessageBuffer();
+    AGT::MessageEncoder many(large);
+    setHeader(many);
+
+    for (std::size_t i = 0; i <= AGT::TLVIndex::maxEntries; ++i) {
+        many.add(report(static_cast<std::uint16_t>(i)));
+    }
+
+    many.end();
+
+    AGT::MessageDecoder decoder(many.data());
+    CHECK(decoder.index_nothrow().code() == NL::ErrorCode::TOO_MANY_TLVS);
+
+    std::size_t count = 0;
+
+    while (decoder.next()) {
+        ++count;
+    }
+
+    CHECK(count == AGT::TLVIndex::maxEntries + 1);
+}
+
+} // namespace
+
+int main() {
+    testLookup();
+    testOtherTypes();
+    testMalformed();
+    return TestUtils::result();
+}
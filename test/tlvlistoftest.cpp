@@ -0,0 +1,156 @@
+#include <empoweragentproto/empoweragentproto.hh>
+
+#include "testutils.hh"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace AGT = Empower::Agent;
+namespace NL = Empower::NetworkLib;
+
+namespace {
+
+AGT::TLVUEReport report(std::uint16_t rnti) {
+    AGT::TLVUEReport result;
+    result.rnti(rnti).imsi(1000 + rnti).tmsi(rnti * 7).status(rnti % 2);
+    return result;
+}
+
+bool sameReport(const AGT::TLVUEReport &lhs, const AGT::TLVUEReport &rhs) {
+    return AGT::TLVUEReport::Layout::equal(lhs, rhs);
+}
+
+void testRoundTrip() {
+    for (std::size_t count : {0, 1, 2, 500}) {
+        AGT::TLVListOf<AGT::TLVUEReport> list;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            list.add(report(static_cast<std::uint16_t>(i)));
+        }
+
+        auto buffer = AGT::IO::makeMessageBuffer();
+        AGT::MessageEncoder encoder(buffer);
+        encoder.header()
+            .messageClass(AGT::MessageClass::RESPONSE_SUCCESS)
+            .entityClass(AGT::EntityClass::UE_REPORTS_SERVICE);
+        encoder.add(list).end();
+
+        // Decoded as a whole
+        AGT::MessageDecoder decoder(encoder.data());
+        CHECK(decoder.getNextTLVType() == AGT::TLVType::LIST_OF_TLV);
+        AGT::TLVListOf<AGT::TLVUEReport> decoded;
+        decoder.get(decoded);
+        CHECK(decoded.size() == count);
+
+        for (std::size_t i = 0; i < count && i < decoded.size(); ++i) {
+            CHECK(sameReport(decoded.elements()[i], list.elements()[i]));
+        }
+
+        // Through a view, with no copy
+        AGT::MessageDecoder again(encoder.data());
+        AGT::TLVListOfView<AGT::TLVUEReport> view(again.next());
+        CHECK(view.size() == count);
+        CHECK(view.elementType() == AGT::TLVType::UE_REPORT);
+
+        std::vector<std::uint16_t> rntis(view.size());
+        view.column<2>(rntis.begin()); // TLVUEReport::rnti()
+
+        for (std::size_t i = 0; i < count; ++i) {
+            CHECK(rntis[i] == i);
+            CHECK(view.get<0>(i) == 1000 + i); // TLVUEReport::imsi()
+            CHECK(sameReport(view.materialize(i), list.elements()[i]));
+            CHECK(AGT::TLVUEReportView(view.element(i)).tmsi() == i * 7);
+        }
+
+        std::vector<AGT::TLVUEReport> all;
+        view.materializeAll(all);
+        CHECK(all.size() == count);
+    }
+}
+
+void testLimits() {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    std::size_t length = 0;
+
+    // As many elements as fit in a TLV, and one more.
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+
+    for (std::size_t i = 0;
+         i < AGT::TLVListOf<AGT::TLVUEReport>::maxElements(); ++i) {
+        list.add(report(static_cast<std::uint16_t>(i)));
+    }
+
+    CHECK(list.encode_nothrow(buffer, length));
+    CHECK(length + AGT::TLVHeader::headerLength <= 0xFFFF);
+
+    list.add(report(0));
+    CHECK(list.encode_nothrow(buffer, length).code() ==
+          NL::ErrorCode::BAD_TLV_LENGTH);
+
+    // A buffer too small
+    list.clear();
+    list.add(report(1)).add(report(2));
+    CHECK(list.encode_nothrow(buffer.getSub(0, 10), length).code() ==
+          NL::ErrorCode::OUT_OF_BOUNDS);
+}
+
+void testMalformed() {
+    auto buffer = NL::BufferWritableView::makeEthBuffer();
+    std::size_t length = 0;
+
+    AGT::TLVListOf<AGT::TLVUEReport> list;
+    list.add(report(1)).add(report(2));
+    CHECK(list.encode_nothrow(buffer, length));
+
+    // Elements of another type
+    AGT::TLVListOf<AGT::TLVCell> cells;
+    std::size_t decodedLength = 0;
+    CHECK(cells.decode_nothrow(buffer.getSub(0, length), decodedLength)
+              .code() == NL::ErrorCode::TLV_TYPE_MISMATCH);
+
+    // Fewer elements than stated
+    AGT::TLVListOf<AGT::TLVUEReport> decoded;
+    CHECK(decoded.decode_nothrow(buffer.getSub(0, length - 1), decodedLength)
+              .code() == NL::ErrorCode::BAD_TLV_LENGTH);
+    CHECK(decoded.decode_nothrow(buffer.getSub(0, 3), decodedLength).code() ==
+          NL::ErrorCode::OUT_OF_BOUNDS);
+
+    CHECK(decoded.decode_nothrow(buffer.getSub(0, length), decodedLength));
+    CHECK(decodedLength == length && decoded.size() == 2);
+
+#if !defined(EMPOWER_NETWORKLIB_NO_EXCEPTIONS)
+    // The same for views
+    AGT::TLVView truncated(AGT::TLVType::LIST_OF_TLV,
+                           buffer.getSub(0, length - 1));
+    bool thrown = false;
+
+    try {
+        AGT::TLVListOfView<AGT::TLVUEReport> view(truncated);
+    } catch (std::runtime_error &) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+
+    AGT::TLVView whole(AGT::TLVType::LIST_OF_TLV, buffer.getSub(0, length));
+    thrown = false;
+
+    try {
+        AGT::TLVListOfView<AGT::TLVCell> view(whole);
+    } catch (std::runtime_error &) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+#endif
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testLimits();
+    testMalformed();
+    return TestUtils::result();
+}